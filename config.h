@@ -15,8 +15,25 @@ extern "C" {
 #define NET_PROTO_DEFAULT(SUFFIX)    net_coap ## SUFFIX
 #define NET_COAP_PROTO_LOWER(SUFFIX) net_udp ## SUFFIX
 #define NET_UDP_PROTO_LOWER(SUFFIX)  net_ip6 ## SUFFIX
+#ifdef NET_LOWPAN_ENABLE
+#define NET_IP6_PROTO_LOWER(SUFFIX)  net_lowpan ## SUFFIX
+#else
 #define NET_IP6_PROTO_LOWER(SUFFIX)  net_mac ## SUFFIX
+#endif
+
+/* Host builds select their link driver with -DNET_LINK_* */
+#if defined(NET_LINK_STUB)
+#define NET_MAC_PROTO_LOWER(SUFFIX)  hw_stub ## SUFFIX
+#elif defined(NET_LINK_W5500)
+#define NET_MAC_PROTO_LOWER(SUFFIX)  hw_w5500 ## SUFFIX
+#elif defined(NET_LINK_PCAP)
+#define NET_MAC_PROTO_LOWER(SUFFIX)  hw_pcap ## SUFFIX
+#elif defined(NET_LINK_VHUB)
+#define NET_MAC_PROTO_LOWER(SUFFIX)  hw_vhub ## SUFFIX
+#else
 #define NET_MAC_PROTO_LOWER(SUFFIX)  hw_serial ## SUFFIX
+#endif
+#define NET_LOWPAN_PROTO_LOWER(SUFFIX) NET_MAC_PROTO_LOWER(SUFFIX)
 
 #if 0
 #define NET_PROTO_DEFAULT(SUFFIX)    net_coap ## SUFFIX
@@ -34,13 +51,49 @@ extern "C" {
 
 #define NET_STUB_GET_L2_ADDR_ENABLE 1
 
+/* Stack high-water marks of the recv/send functions, see net_memstats.h */
+//#define NET_MEMSTATS_ENABLE
+
+/* Packet and drop counters in each context, see net_stats.h */
+//#define NET_STATS_ENABLE
+
+/* Binary trace of the recv/send functions and SPI transfers, see net_trace.h */
+//#define NET_TRACE_ENABLE
+
+/* 6LoWPAN header compression in place of the MAC layer, see proto_lowpan.h */
+//#define NET_LOWPAN_ENABLE
+
+/* Capture of the frames at the MAC boundary, see net_tap.h */
+//#define NET_TAP_ENABLE
+
+/* Neighbor cache and address resolution of the IPv6 layer, see proto_ip6.h */
+//#define NET_IP6_NC_ENABLE
+
+/* Stateless address autoconfiguration of the IPv6 layer, see proto_ip6.h */
+//#define NET_IP6_AUTOCONF_ENABLE
+
+/* Duplicate Address Detection of the IPv6 layer, see proto_ip6.h */
+//#define NET_IP6_DAD_ENABLE
+
+/* Rate limit of the ICMPv6 replies of the IPv6 layer, see proto_ip6.h */
+//#define NET_IP6_RATELIMIT_ENABLE
+
 #include "common.h"
 #include "hw_serial.h"
-//#include "hw_w5500.h"
+#include "hw_w5500.h"
+#include "hw_stub.h"
+#ifdef NET_LINK_PCAP
+#include "hw_pcap.h"  /* Host only, in host/ */
+#endif
+#ifdef NET_LINK_VHUB
+#include "hw_vhub.h"  /* Host only, in host/ */
+#endif
 #include "proto_mac.h"
+#include "proto_lowpan.h"
 #include "proto_ip6.h"
 #include "proto_udp.h"
 #include "proto_coap.h"
+#include "net_poll.h"
 
 #ifdef __cplusplus
 }
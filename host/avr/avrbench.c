@@ -0,0 +1,128 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/**
+ * AVR benchmark firmware, run by avrbench_run under simavr.
+ *
+ * Every layer sends a payload, then receives a CoAP response injected by the
+ * runner, then a Neighbor Solicitation is answered. Each call is framed by
+ * the markers of avrbench.h.
+ */
+
+#include "config.h"
+#include "platform.h"
+#include "avrbench.h"
+
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <string.h>
+
+#ifndef AVRBENCH_BUFLEN
+#define AVRBENCH_BUFLEN 320  /* The 328p has 2 KB of SRAM */
+#endif
+
+#define MEASURE(id, call) \
+	do { \
+		AVRBENCH_PREPARE(id); \
+		AVRBENCH_BEGIN(id); \
+		call; \
+		AVRBENCH_END(id); \
+	} while (0)
+
+
+static uint8_t buffer[AVRBENCH_BUFLEN];
+
+static uint8_t src_l2addr[6] = {0x10, 0x22, 0x33, 0x44, 0x55, 0x66};
+static uint8_t dst_l2addr[6] = {0x76, 0x88, 0x99, 0xAA, 0xBB, 0xCC};
+static uint8_t src_addr[16] = {0x20,0x01,0,0x01,0,0x02,0,0x03,0,0x0f,0,0x0e,0,0x0d,0,0x0c};
+static uint8_t dst_addr[16] = {0x20,0x01,0,0x01,0,0x02,0,0x03,0,0x0a,0,0x0b,0,0x0c,0,0x0d};
+static uint8_t token[] = {0x12};
+static net_mac_mcsuffix_t mcsuffixes[NET_IP6_L2_MCSUFFIX_CNT];
+
+static struct hw_w5500_ctx hw;
+static struct net_mac_ctx mac = { .lower = &hw };
+static struct net_ip6_ctx ip6 = { .lower = &mac };
+static struct net_udp_ctx udp = { .lower = &ip6 };
+static struct net_coap_ctx coap = { .lower = &udp };
+
+
+static void put_payload(uint16_t dataoffset)
+{
+	memcpy(&buffer[dataoffset], AVRBENCH_PAYLOAD, AVRBENCH_PAYLOADLEN);
+}
+
+int main(void)
+{
+	net_mac_mcsuffix_t mcsuffixes_init[] = NET_IP6_L2_MCSUFFIXES(src_addr);
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+
+	memcpy(mcsuffixes, mcsuffixes_init, sizeof(mcsuffixes));
+
+	hw_w5500_init();
+	hw_w5500_set_macaddress(src_l2addr);
+	hw_w5500_open(&hw);
+
+	net_mac_set_source_addr(&mac, src_l2addr);
+	net_mac_set_destination_addr(&mac, dst_l2addr);
+	net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_IPV6);
+	net_mac_set_ip6mcast(&mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes);
+	net_ip6_set_source_addr(&ip6, src_addr);
+	net_ip6_set_destination_addr(&ip6, dst_addr);
+	net_ip6_set_nexthdr(&ip6, NET_IP6_NH_UDP);
+	net_udp_set_source_port(&udp, 1234);
+	net_udp_set_destination_port(&udp, 5683);
+	net_udp_connect(&udp);
+	net_coap_set_method(&coap, NET_COAP_TYPE_NONCONFIRMABLE, NET_COAP_CODE_POST);
+	net_coap_set_token(&coap, sizeof(token), token);
+
+	/* Send path, the driver alone sends a frame as large as the MAC one */
+	dataoffset = net_mac_pload_pos(&mac);
+	put_payload(dataoffset);
+	MEASURE(AVRBENCH_W5500_SEND,
+	        hw_w5500_send(&hw, buffer, dataoffset + AVRBENCH_PAYLOADLEN));
+	MEASURE(AVRBENCH_MAC_SEND,
+	        net_mac_send(&mac, buffer, sizeof(buffer), dataoffset, AVRBENCH_PAYLOADLEN));
+
+	dataoffset = net_ip6_pload_pos(&ip6);
+	put_payload(dataoffset);
+	MEASURE(AVRBENCH_IP6_SEND,
+	        net_ip6_send(&ip6, buffer, sizeof(buffer), dataoffset, AVRBENCH_PAYLOADLEN));
+
+	dataoffset = net_udp_pload_pos(&udp);
+	put_payload(dataoffset);
+	MEASURE(AVRBENCH_UDP_SEND,
+	        net_udp_send(&udp, buffer, sizeof(buffer), dataoffset, AVRBENCH_PAYLOADLEN));
+
+	dataoffset = net_coap_pload_pos(&coap);
+	put_payload(dataoffset);
+	MEASURE(AVRBENCH_COAP_SEND,
+	        net_coap_send(&coap, buffer, sizeof(buffer), dataoffset, AVRBENCH_PAYLOADLEN));
+
+	/* Receive path, each layer parses the same CoAP response */
+	MEASURE(AVRBENCH_W5500_RECV,
+	        hw_w5500_recv(&hw, buffer, sizeof(buffer)));
+	MEASURE(AVRBENCH_MAC_RECV,
+	        net_mac_recv(&mac, buffer, sizeof(buffer), &dataoffset, &datalen));
+	MEASURE(AVRBENCH_IP6_RECV,
+	        net_ip6_recv(&ip6, buffer, sizeof(buffer), &dataoffset, &datalen));
+	MEASURE(AVRBENCH_UDP_RECV,
+	        net_udp_recv(&udp, buffer, sizeof(buffer), &dataoffset, &datalen));
+	MEASURE(AVRBENCH_COAP_RECV,
+	        net_coap_recv(&coap, buffer, sizeof(buffer), &dataoffset, &datalen));
+
+	/* Neighbor Solicitation, answered within net_ip6_recv */
+	MEASURE(AVRBENCH_NS_ANSWER,
+	        net_ip6_recv(&ip6, buffer, sizeof(buffer), &dataoffset, &datalen));
+
+	/* Sleeping with interrupts disabled ends the simulation */
+	cli();
+	set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+	sleep_enable();
+	sleep_cpu();
+
+	return 0;
+}
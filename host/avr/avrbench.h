@@ -0,0 +1,52 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _AVRBENCH_H
+#define _AVRBENCH_H
+
+/**
+ * Protocol between the AVR benchmark firmware and its simavr runner.
+ *
+ * The firmware writes to the general purpose I/O registers, which the runner
+ * watches:
+ *   GPIOR2 <- scenario  The runner prepares the scenario (injects its frame)
+ *   GPIOR0 <- scenario  Start of the measure (cycle count, stack pointer)
+ *   GPIOR1 <- scenario  End of the measure
+ *
+ * In each direction, scenarios go from the driver up to CoAP, so the cost of
+ * a layer is the difference with the previous scenario of the same group.
+ */
+
+#define AVRBENCH_W5500_SEND   1
+#define AVRBENCH_MAC_SEND     2
+#define AVRBENCH_IP6_SEND     3
+#define AVRBENCH_UDP_SEND     4
+#define AVRBENCH_COAP_SEND    5
+#define AVRBENCH_W5500_RECV   6
+#define AVRBENCH_MAC_RECV     7
+#define AVRBENCH_IP6_RECV     8
+#define AVRBENCH_UDP_RECV     9
+#define AVRBENCH_COAP_RECV    10
+#define AVRBENCH_NS_ANSWER    11
+#define AVRBENCH_CNT          12
+
+#define AVRBENCH_PAYLOAD      "0123456789abcdef0123456789abcdef"
+#define AVRBENCH_PAYLOADLEN   32
+
+/* Data space addresses of GPIOR0, GPIOR1 and GPIOR2 on the ATmega328p */
+#define AVRBENCH_ADDR_BEGIN   0x3E
+#define AVRBENCH_ADDR_END     0x4A
+#define AVRBENCH_ADDR_PREPARE 0x4B
+
+#ifdef __AVR__
+#include <avr/io.h>
+
+#define AVRBENCH_PREPARE(id) GPIOR2 = (id)
+#define AVRBENCH_BEGIN(id)   GPIOR0 = (id)
+#define AVRBENCH_END(id)     GPIOR1 = (id)
+#endif
+
+#endif
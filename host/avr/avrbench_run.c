@@ -0,0 +1,347 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/**
+ * Runner of the AVR benchmark firmware under simavr.
+ *
+ * The firmware is run on a simulated ATmega328p at 16 MHz, with the W5500
+ * model on its SPI bus. The frames it receives are built by the host stack.
+ * For each scenario (see avrbench.h), the cycles and the peak stack depth
+ * between the markers are reported.
+ *
+ * Must be built with -DNET_LINK_STUB, and linked with simavr.
+ */
+
+#include "config.h"
+#include "net_utils.h"
+#include "w5500_model.h"
+#include "avrbench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim_avr.h"
+#include "sim_elf.h"
+#include "sim_io.h"
+#include "avr_ioport.h"
+#include "avr_spi.h"
+
+#define AVRBENCH_FREQUENCY  16000000
+#define AVRBENCH_MAXCYCLES  (60ULL * AVRBENCH_FREQUENCY)
+#define FRAME_MAXLEN        1514
+
+
+struct result {
+	bool done;
+	uint64_t cycles;
+	uint16_t stack;
+	uint16_t txlen;
+	bool ok;
+};
+
+struct runner {
+	avr_t *avr;
+	avr_irq_t *spi_input;
+	struct w5500_model w5500;
+
+	uint8_t current;
+	uint64_t begin_cycle;
+	uint16_t begin_sp;
+	uint16_t min_sp;
+	uint16_t txlen;
+	uint8_t txframe[FRAME_MAXLEN];
+
+	struct result results[AVRBENCH_CNT];
+};
+
+static const char * const names[AVRBENCH_CNT] = {
+	[AVRBENCH_W5500_SEND] = "w5500_send",
+	[AVRBENCH_MAC_SEND]   = "mac_send",
+	[AVRBENCH_IP6_SEND]   = "ip6_send",
+	[AVRBENCH_UDP_SEND]   = "udp_send",
+	[AVRBENCH_COAP_SEND]  = "coap_send",
+	[AVRBENCH_W5500_RECV] = "w5500_recv",
+	[AVRBENCH_MAC_RECV]   = "mac_recv",
+	[AVRBENCH_IP6_RECV]   = "ip6_recv",
+	[AVRBENCH_UDP_RECV]   = "udp_recv",
+	[AVRBENCH_COAP_RECV]  = "coap_recv",
+	[AVRBENCH_NS_ANSWER]  = "ns_answer",
+};
+
+/* Same addresses as the firmware, seen from the peer */
+static uint8_t peer_l2addr[6] = {0x76, 0x88, 0x99, 0xAA, 0xBB, 0xCC};
+static uint8_t avr_l2addr[6] = {0x10, 0x22, 0x33, 0x44, 0x55, 0x66};
+static uint8_t peer_addr[16] = {0x20,0x01,0,0x01,0,0x02,0,0x03,0,0x0a,0,0x0b,0,0x0c,0,0x0d};
+static uint8_t avr_addr[16] = {0x20,0x01,0,0x01,0,0x02,0,0x03,0,0x0f,0,0x0e,0,0x0d,0,0x0c};
+static uint8_t l2_allnodes[6] = {0x33, 0x33, 0x00, 0x00, 0x00, 0x01};
+
+static uint8_t coap_frame[FRAME_MAXLEN];
+static uint16_t coap_framelen;
+static uint8_t ns_frame[FRAME_MAXLEN];
+static uint16_t ns_framelen;
+
+
+/*
+ * Frames received by the firmware, built by the host stack
+ */
+
+static uint8_t *capture;
+static uint16_t *capturelen;
+
+static uint16_t peer_send(struct hw_stub_ctx *stub, uint8_t *data, uint16_t len)
+{
+	memcpy(capture, data, len);
+	*capturelen = len;
+	return len;
+}
+
+static void build_frames(void)
+{
+	struct hw_stub_ctx hw = { .send_cback = peer_send };
+	struct net_mac_ctx mac = { .lower = &hw };
+	struct net_ip6_ctx ip6 = { .lower = &mac };
+	struct net_udp_ctx udp = { .lower = &ip6 };
+	uint8_t buffer[FRAME_MAXLEN];
+	uint8_t coap[5 + AVRBENCH_PAYLOADLEN] = {
+		(NET_COAP_VERSION << 6) | (NET_COAP_TYPE_NONCONFIRMABLE << 4) | 1,
+		NET_COAP_CODE_CONTENT, 0x00, 0x01, 0x12
+	};
+	uint8_t ns[32] = {135, 0, 0, 0, 0, 0, 0, 0};
+	uint8_t nslen[2] = {0, sizeof(ns)};
+	uint16_t dataoffset;
+	uint16_t sum;
+
+	net_mac_set_source_addr(&mac, peer_l2addr);
+	net_mac_set_destination_addr(&mac, avr_l2addr);
+	net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_IPV6);
+	net_ip6_set_source_addr(&ip6, peer_addr);
+	net_ip6_set_destination_addr(&ip6, avr_addr);
+
+	/* Non-confirmable CoAP response, with the token of the firmware */
+	net_ip6_set_nexthdr(&ip6, NET_IP6_NH_UDP);
+	net_udp_set_source_port(&udp, 5683);
+	net_udp_set_destination_port(&udp, 1234);
+	net_udp_connect(&udp);
+
+	coap[5] = 0xFF;
+	memcpy(&coap[6], AVRBENCH_PAYLOAD, AVRBENCH_PAYLOADLEN - 1);
+
+	capture = coap_frame;
+	capturelen = &coap_framelen;
+	dataoffset = net_udp_pload_pos(&udp);
+	memcpy(&buffer[dataoffset], coap, sizeof(coap));
+	net_udp_send(&udp, buffer, sizeof(buffer), dataoffset, sizeof(coap));
+
+	/* Neighbor Solicitation of the global address of the firmware */
+	net_mac_set_destination_addr(&mac, l2_allnodes);
+	net_ip6_set_nexthdr(&ip6, NET_IP6_NH_ICMPV6);
+	memcpy(&ns[8], avr_addr, 16);
+	ns[24] = 1;
+	ns[25] = 1;
+	memcpy(&ns[26], peer_l2addr, 6);
+
+	sum = net_ip6_get_l3_cksum(&ip6);
+	sum = _net_cksum_sum(sum, nslen, 2);
+	sum = _net_cksum_sum(sum, ns, sizeof(ns));
+	sum = _net_cksum_finalize(sum);
+	ns[2] = (sum & 0xFF00) >> 8;
+	ns[3] = sum & 0x00FF;
+
+	capture = ns_frame;
+	capturelen = &ns_framelen;
+	dataoffset = net_ip6_pload_pos(&ip6);
+	memcpy(&buffer[dataoffset], ns, sizeof(ns));
+	net_ip6_send(&ip6, buffer, sizeof(buffer), dataoffset, sizeof(ns));
+}
+
+
+/*
+ * Simulation hooks
+ */
+
+static uint16_t runner_sp(struct runner *runner)
+{
+	return runner->avr->data[R_SPL] | (runner->avr->data[R_SPH] << 8);
+}
+
+static void on_tx(struct w5500_model *model, const uint8_t *frame, uint16_t len)
+{
+	struct runner *runner = model->priv;
+
+	memcpy(runner->txframe, frame, len);
+	runner->txlen = len;
+}
+
+static void on_spi_byte(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+	struct runner *runner = param;
+	uint8_t reply;
+
+	reply = runner->w5500.spi.transfer(&runner->w5500.spi, value);
+	avr_raise_irq(runner->spi_input, reply);
+}
+
+static void on_chip_select(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+	struct runner *runner = param;
+
+	runner->w5500.spi.select(&runner->w5500.spi, value == 0);
+}
+
+static void on_prepare(struct avr_t *avr, avr_io_addr_t addr, uint8_t v, void *param)
+{
+	struct runner *runner = param;
+
+	runner->txlen = 0;
+
+	if ((v >= AVRBENCH_W5500_RECV) && (v <= AVRBENCH_COAP_RECV)) {
+		w5500_model_inject(&runner->w5500, coap_frame, coap_framelen);
+	} else if (v == AVRBENCH_NS_ANSWER) {
+		w5500_model_inject(&runner->w5500, ns_frame, ns_framelen);
+	}
+}
+
+static void on_begin(struct avr_t *avr, avr_io_addr_t addr, uint8_t v, void *param)
+{
+	struct runner *runner = param;
+
+	runner->current = v;
+	runner->begin_sp = runner_sp(runner);
+	runner->min_sp = runner->begin_sp;
+	runner->begin_cycle = avr->cycle;
+}
+
+static void on_end(struct avr_t *avr, avr_io_addr_t addr, uint8_t v, void *param)
+{
+	struct runner *runner = param;
+	struct result *result;
+
+	if ((v == 0) || (v >= AVRBENCH_CNT) || (v != runner->current)) {
+		return;
+	}
+
+	result = &runner->results[v];
+	result->done = true;
+	result->cycles = avr->cycle - runner->begin_cycle;
+	result->stack = runner->begin_sp - runner->min_sp;
+	result->txlen = runner->txlen;
+
+	/* Send scenarios must emit a frame, receive ones must consume theirs */
+	if (v <= AVRBENCH_COAP_SEND) {
+		result->ok = (runner->txlen > 0);
+	} else if (v == AVRBENCH_NS_ANSWER) {
+		result->ok = (runner->txlen >= 54 + 32) && (runner->txframe[54] == 136);
+	} else {
+		/* Sn_RX_RD caught up with Sn_RX_WR */
+		result->ok = (memcmp(&runner->w5500.socket0[0x28], &runner->w5500.socket0[0x2A], 2) == 0);
+	}
+
+	runner->current = 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+	struct runner runner;
+	elf_firmware_t firmware;
+	uint64_t previous;
+	uint16_t sp;
+	int state;
+	int failed = 0;
+	int i;
+
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s <firmware.elf>\n", argv[0]);
+		return 2;
+	}
+
+	memset(&runner, 0, sizeof(runner));
+	memset(&firmware, 0, sizeof(firmware));
+
+	build_frames();
+
+	if (elf_read_firmware(argv[1], &firmware) != 0) {
+		fprintf(stderr, "%s: cannot read the firmware\n", argv[1]);
+		return 1;
+	}
+
+	runner.avr = avr_make_mcu_by_name("atmega328p");
+	if (runner.avr == NULL) {
+		fprintf(stderr, "simavr: no atmega328p core\n");
+		return 1;
+	}
+	avr_init(runner.avr);
+	avr_load_firmware(runner.avr, &firmware);
+	runner.avr->frequency = AVRBENCH_FREQUENCY;
+
+	w5500_model_init(&runner.w5500);
+	runner.w5500.tx_cback = on_tx;
+	runner.w5500.priv = &runner;
+
+	runner.spi_input = avr_io_getirq(runner.avr, AVR_IOCTL_SPI_GETIRQ(0), SPI_IRQ_INPUT);
+	avr_irq_register_notify(avr_io_getirq(runner.avr, AVR_IOCTL_SPI_GETIRQ(0), SPI_IRQ_OUTPUT),
+	                        on_spi_byte, &runner);
+	avr_irq_register_notify(avr_io_getirq(runner.avr, AVR_IOCTL_IOPORT_GETIRQ('B'), 2),
+	                        on_chip_select, &runner);
+
+	avr_register_io_write(runner.avr, AVRBENCH_ADDR_PREPARE, on_prepare, &runner);
+	avr_register_io_write(runner.avr, AVRBENCH_ADDR_BEGIN, on_begin, &runner);
+	avr_register_io_write(runner.avr, AVRBENCH_ADDR_END, on_end, &runner);
+
+	/* Run instruction by instruction, to track the stack pointer */
+	state = cpu_Running;
+	while ((state != cpu_Done) && (state != cpu_Crashed)) {
+		state = avr_run(runner.avr);
+
+		if (runner.current != 0) {
+			sp = runner_sp(&runner);
+			if (sp < runner.min_sp) {
+				runner.min_sp = sp;
+			}
+		}
+
+		if (runner.avr->cycle > AVRBENCH_MAXCYCLES) {
+			fprintf(stderr, "simavr: firmware did not complete\n");
+			state = cpu_Crashed;
+		}
+	}
+
+	printf("%-12s %10s %10s %10s %8s %6s  %s\n",
+	       "scenario", "cycles", "us@16MHz", "layer", "stack", "tx", "status");
+
+	previous = 0;
+	for (i=1; i<AVRBENCH_CNT; i++) {
+		struct result *result = &runner.results[i];
+
+		if (!result->done) {
+			printf("%-12s %10s\n", names[i], "-");
+			failed++;
+			continue;
+		}
+
+		/* Layer cost relative to the layer below, within each direction */
+		if ((i == AVRBENCH_W5500_SEND) || (i == AVRBENCH_W5500_RECV) ||
+		    (i == AVRBENCH_NS_ANSWER)) {
+			previous = 0;
+		}
+
+		printf("%-12s %10llu %10.1f %10lld %8u %6u  %s\n", names[i],
+		       (unsigned long long) result->cycles,
+		       result->cycles * 1e6 / AVRBENCH_FREQUENCY,
+		       (long long) result->cycles - (long long) previous,
+		       result->stack, result->txlen, result->ok ? "OK" : "NOK");
+
+		previous = result->cycles;
+		if (!result->ok) {
+			failed++;
+		}
+	}
+
+	avr_terminate(runner.avr);
+
+	return (state == cpu_Crashed) || (failed > 0);
+}
@@ -0,0 +1,116 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/**
+ * Bare-metal implementation of platform.h for the ATmega328p, without the
+ * Arduino core, used by the AVR benchmark.
+ *
+ * SPI uses the hardware SPI in master mode at F_CPU/2, with the chip select
+ * on PB2 (pin 10 of the Arduino Uno, as the Ethernet shield). There is no
+ * serial line in the benchmark, the serial functions do nothing.
+ */
+
+#include "config.h"
+#include "platform.h"
+
+#include <avr/io.h>
+#include <util/delay.h>
+
+
+#define SPI_CS   PB2
+#define SPI_MOSI PB3
+#define SPI_MISO PB4
+#define SPI_SCK  PB5
+
+
+void msleep(uint16_t time_ms)
+{
+	while (time_ms-- > 0) {
+		_delay_ms(1);
+	}
+}
+
+/* No timer is running, the runner counts the cycles */
+uint32_t clock_us()
+{
+	return 0;
+}
+
+void spi_init()
+{
+	PORTB |= _BV(SPI_CS);
+	DDRB |= _BV(SPI_CS) | _BV(SPI_MOSI) | _BV(SPI_SCK);
+	DDRB &= ~_BV(SPI_MISO);
+
+	SPCR = _BV(SPE) | _BV(MSTR);
+	SPSR = _BV(SPI2X);
+}
+
+void spi_destroy()
+{
+	SPCR = 0;
+}
+
+void spi_start_transaction() {}
+void spi_stop_transaction() {}
+
+void spi_start_transfer()
+{
+	PORTB &= ~_BV(SPI_CS);
+}
+
+void spi_stop_transfer()
+{
+	PORTB |= _BV(SPI_CS);
+}
+
+static inline uint8_t _spi_transfer(uint8_t value)
+{
+	SPDR = value;
+	while (!(SPSR & _BV(SPIF))) {
+	}
+	return SPDR;
+}
+
+uint8_t spi_read_byte()
+{
+	return _spi_transfer(0x00);
+}
+
+void spi_read(uint8_t *buffer, uint16_t buflen)
+{
+	uint16_t i;
+
+	/* Full-duplex, as SPI.transfer(buffer, len) */
+	for (i=0; i<buflen; i++) {
+		buffer[i] = _spi_transfer(buffer[i]);
+	}
+}
+
+void spi_write(uint8_t *buffer, uint16_t buflen)
+{
+	uint16_t i;
+
+	for (i=0; i<buflen; i++) {
+		_spi_transfer(buffer[i]);
+	}
+}
+
+void serial_init() {}
+void serial_debug_beg() {}
+void serial_debug_end() {}
+void serial_debug(const char * const message) {}
+void serial_signal(uint8_t signal) {}
+void serial_poll() {}
+uint16_t serial_read(uint8_t *buffer, uint16_t buflen) { return 0; }
+uint8_t serial_read_signal() { return 0; }
+uint8_t serial_wait_for_signal(uint16_t timeout) { return 0; }
+uint16_t serial_write(uint8_t *buffer, uint16_t buflen) { return 0; }
+
+/* The stack is measured by the runner, from the stack pointer */
+void stack_paint() {}
+uint16_t stack_used() { return 0; }
+uint16_t stack_free() { return 0; }
@@ -0,0 +1,754 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/**
+ * Microbenchmarks of the protocol hot paths.
+ *
+ * Each benchmark runs a function over a given size, for a calibrated number
+ * of iterations, and keeps the best of several runs. Results are printed as
+ * a table (ns/op, MB/s, cycles/op of the time-stamp counter on x86,
+ * instructions/op when the perf counters are available) and optionally
+ * written as JSON, to be compared with host/bench_compare.py.
+ *
+ * The recv_* benchmarks feed the frames of a category of the corpus
+ * (host/corpus.h) in turn through the whole receive path, from the link to
+ * net_coap_recv(), and check beforehand that each frame has the outcome
+ * expected of its category, on a virtual clock for the rate limit of the
+ * ICMPv6 replies to let them all through. recv_flood mixes a CoAP response
+ * with solicitations at 10k frames/s. With -w, the corpus is written as a
+ * pcap instead, to be replayed by host/replay.
+ *
+ * Must be built with -DNET_LINK_STUB.
+ */
+
+#include "config.h"
+#include "platform.h"
+#include "platform_posix.h"
+#include "platform_serial.h"
+#include "net_utils.h"
+#include "corpus.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#ifndef NET_LINK_STUB
+#error "The benchmarks must be built with NET_LINK_STUB"
+#endif
+
+#define BENCH_RUNS 5
+#define FRAME_MAXLEN 1514
+
+
+struct bench {
+	const char *name;
+	uint16_t size;        /* Bytes processed by one operation */
+	void (*setup)(struct bench *bench);
+	void (*run)(struct bench *bench, uint32_t iterations);
+	uint8_t category;     /* Of the corpus, recv_* benchmarks */
+};
+
+struct bench_result {
+	double ns_per_op;
+	double cycles_per_op; /* Negative when not available */
+	double insns_per_op;  /* Negative when not available */
+};
+
+struct bench_stack {
+	struct hw_stub_ctx hw;
+	struct net_mac_ctx mac;
+	struct net_ip6_ctx ip6;
+	struct net_udp_ctx udp;
+	struct net_coap_ctx coap;
+};
+
+
+static uint8_t client_l2addr[6] = {0x10, 0x22, 0x33, 0x44, 0x55, 0x66};
+static uint8_t server_l2addr[6] = {0x76, 0x88, 0x99, 0xAA, 0xBB, 0xCC};
+static uint8_t client_addr[16] = {0x20,0x01,0,0x01,0,0x02,0,0x03,0,0x0f,0,0x0e,0,0x0d,0,0x0c};
+static uint8_t server_addr[16] = {0x20,0x01,0,0x01,0,0x02,0,0x03,0,0x0a,0,0x0b,0,0x0c,0,0x0d};
+static uint8_t token[] = {0x12, 0x34};
+static char * const uripath[] = { "sensors", "temp" };
+static char * const uriquery[] = { "id=42", "unit=c" };
+
+static struct bench_stack stack;
+static uint8_t buffer[FRAME_MAXLEN];
+static uint8_t frame[FRAME_MAXLEN];
+static uint16_t framelen;
+static char line[3 + 2*FRAME_MAXLEN + 1];
+static uint16_t linelen;
+
+static uint8_t corpus[CORPUS_VARIANTS][FRAME_MAXLEN];
+static uint16_t corpus_len[CORPUS_VARIANTS];
+static uint16_t corpus_next;
+static uint32_t corpus_sent;
+
+static uint16_t corpus_cnt;
+static uint32_t corpus_interval_us;  /* Of the virtual clock, between frames */
+static uint32_t corpus_us;
+
+/* Flood: solicitations, then a CoAP response */
+#define FLOOD_NS_CNT      10
+#define FLOOD_INTERVAL_US 100   /* 10k frames/s */
+
+static volatile uint32_t sink;
+static int perf_fd = -1;
+
+
+/*
+ * Stack
+ */
+
+static uint16_t stack_recv(struct hw_stub_ctx *stub, uint8_t *data, uint16_t len)
+{
+	if (framelen > len) {
+		return 0;
+	}
+	memcpy(data, frame, framelen);
+	return framelen;
+}
+
+static uint16_t stack_send(struct hw_stub_ctx *stub, uint8_t *data, uint16_t len)
+{
+	sink += data[len-1];
+	return len;
+}
+
+static uint16_t stack_capture(struct hw_stub_ctx *stub, uint8_t *data, uint16_t len)
+{
+	memcpy(frame, data, len);
+	framelen = len;
+	return len;
+}
+
+/* The frames of the corpus, in turn, on a virtual clock */
+static uint16_t corpus_recv(struct hw_stub_ctx *stub, uint8_t *data, uint16_t len)
+{
+	uint16_t i = corpus_next++ % corpus_cnt;
+
+	corpus_us += corpus_interval_us;
+	if (corpus_len[i] > len) {
+		return 0;
+	}
+	memcpy(data, corpus[i], corpus_len[i]);
+	return corpus_len[i];
+}
+
+static uint32_t corpus_now_us(struct clock_posix_source *source)
+{
+	return corpus_us;
+}
+
+static void corpus_sleep(struct clock_posix_source *source, uint16_t time_ms)
+{
+	corpus_us += (uint32_t) time_ms * 1000;
+}
+
+static struct clock_posix_source corpus_clock = { corpus_sleep, corpus_now_us };
+
+static uint16_t corpus_send(struct hw_stub_ctx *stub, uint8_t *data, uint16_t len)
+{
+	corpus_sent++;
+	return len;
+}
+
+static void stack_setup(struct bench_stack *s, uint8_t *l2src, uint8_t *l2dst,
+                        uint8_t *src, uint8_t *dst, uint16_t sport, uint16_t dport)
+{
+	net_mac_mcsuffix_t init[] = NET_IP6_L2_MCSUFFIXES(src);
+	static net_mac_mcsuffix_t mcsuffixes[NET_IP6_L2_MCSUFFIX_CNT];
+
+	memset(s, 0, sizeof(*s));
+	s->mac.lower = &s->hw;
+	s->ip6.lower = &s->mac;
+	s->udp.lower = &s->ip6;
+	s->coap.lower = &s->udp;
+
+	s->hw.recv_cback = stack_recv;
+	s->hw.send_cback = stack_send;
+
+	/* The MAC layer keeps a reference to the suffixes */
+	memcpy(mcsuffixes, init, sizeof(mcsuffixes));
+
+	net_mac_set_source_addr(&s->mac, l2src);
+	net_mac_set_destination_addr(&s->mac, l2dst);
+	net_mac_set_ethertype(&s->mac, NET_MAC_ETHERTYPE_IPV6);
+	net_mac_set_ip6mcast(&s->mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes);
+	net_ip6_set_source_addr(&s->ip6, src);
+	net_ip6_set_destination_addr(&s->ip6, dst);
+	net_ip6_set_nexthdr(&s->ip6, NET_IP6_NH_UDP);
+	net_udp_set_source_port(&s->udp, sport);
+	net_udp_set_destination_port(&s->udp, dport);
+	net_coap_connect(&s->coap);
+	net_coap_set_method(&s->coap, NET_COAP_TYPE_NONCONFIRMABLE, NET_COAP_CODE_POST);
+	net_coap_set_token(&s->coap, sizeof(token), token);
+	net_coap_set_uripath(&s->coap, 2, uripath);
+	net_coap_set_uriquery(&s->coap, 2, uriquery);
+	net_coap_set_contenttype(&s->coap, NET_COAP_CONTENTTYPE_JSON);
+}
+
+
+/*
+ * Benchmarks
+ */
+
+static void setup_buffer(struct bench *bench)
+{
+	uint16_t i;
+
+	for (i=0; i<sizeof(buffer); i++) {
+		buffer[i] = (uint8_t) (i * 7 + 3);
+	}
+}
+
+static void run_cksum(struct bench *bench, uint32_t iterations)
+{
+	uint32_t i;
+	uint16_t sum = 0;
+
+	for (i=0; i<iterations; i++) {
+		sum = _net_cksum_sum(sum, buffer, bench->size);
+	}
+	sink += sum;
+}
+
+static void setup_coap(struct bench *bench)
+{
+	stack_setup(&stack, client_l2addr, server_l2addr, client_addr, server_addr, 1234, 5683);
+	setup_buffer(bench);
+}
+
+static void run_coap_hdrsize(struct bench *bench, uint32_t iterations)
+{
+	uint32_t i;
+
+	for (i=0; i<iterations; i++) {
+		/* Invalidate the cached size, as setting an option does */
+		stack.coap.hdrsize = 0;
+		sink += net_coap_pload_pos(&stack.coap);
+	}
+}
+
+static void run_coap_send(struct bench *bench, uint32_t iterations)
+{
+	uint16_t dataoffset = net_coap_pload_pos(&stack.coap);
+	uint32_t i;
+
+	for (i=0; i<iterations; i++) {
+		net_coap_send(&stack.coap, buffer, sizeof(buffer), dataoffset, bench->size);
+	}
+}
+
+/* Receive a UDP datagram, built by a server stack, from the link */
+static void setup_ip6_recv(struct bench *bench)
+{
+	struct bench_stack server;
+	uint16_t dataoffset;
+
+	stack_setup(&server, server_l2addr, client_l2addr, server_addr, client_addr, 5683, 1234);
+	server.hw.send_cback = stack_capture;
+	net_udp_connect(&server.udp);
+
+	dataoffset = net_udp_pload_pos(&server.udp);
+	memset(&buffer[dataoffset], 0xA5, bench->size);
+	net_udp_send(&server.udp, buffer, sizeof(buffer), dataoffset, bench->size);
+
+	stack_setup(&stack, client_l2addr, server_l2addr, client_addr, server_addr, 1234, 5683);
+}
+
+static void run_ip6_recv(struct bench *bench, uint32_t iterations)
+{
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+	uint32_t i;
+
+	for (i=0; i<iterations; i++) {
+		net_ip6_recv(&stack.ip6, buffer, sizeof(buffer), &dataoffset, &datalen);
+	}
+	sink += datalen;
+}
+
+/* Baseline of run_ip6_recv: copy of the frame by the link only */
+static void run_link_copy(struct bench *bench, uint32_t iterations)
+{
+	uint32_t i;
+
+	for (i=0; i<iterations; i++) {
+		sink += stack_recv(&stack.hw, buffer, sizeof(buffer));
+	}
+}
+
+static void setup_serial(struct bench *bench)
+{
+	uint16_t i;
+
+	setup_buffer(bench);
+
+	linelen = 0;
+	line[linelen++] = 'P';
+	line[linelen++] = ':';
+	line[linelen++] = ' ';
+	for (i=0; i<bench->size; i++) {
+		line[linelen++] = serial_hexchr((buffer[i] & 0xF0) >> 4);
+		line[linelen++] = serial_hexchr(buffer[i] & 0x0F);
+	}
+	line[linelen++] = '\n';
+}
+
+static void run_serial_encode(struct bench *bench, uint32_t iterations)
+{
+	uint32_t i;
+
+	for (i=0; i<iterations; i++) {
+		serial_write(buffer, bench->size);
+	}
+}
+
+static void run_serial_decode(struct bench *bench, uint32_t iterations)
+{
+	struct serial_decoder dec;
+	uint32_t i;
+	uint16_t j;
+
+	memset(&dec, 0, sizeof(dec));
+
+	for (i=0; i<iterations; i++) {
+		for (j=0; j<linelen; j++) {
+			serial_decode(&dec, line[j], frame, sizeof(frame));
+		}
+	}
+	sink += dec.len;
+}
+
+static void setup_corpus(struct bench *bench)
+{
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+	uint8_t outcome;
+	int8_t errno;
+	uint16_t i;
+
+	stack_setup(&stack, client_l2addr, server_l2addr, client_addr, server_addr, 1234, 5683);
+	stack.hw.recv_cback = corpus_recv;
+	stack.hw.send_cback = corpus_send;
+
+	/* Frames far enough apart for all the requests to be answered */
+	clock_posix_set_source(&corpus_clock);
+	corpus_cnt = CORPUS_VARIANTS;
+	corpus_interval_us = NET_IP6_ICMPV6_INTERVAL_US;
+
+	for (i=0; i<CORPUS_VARIANTS; i++) {
+		corpus_len[i] = corpus_frame(bench->category, i, corpus[i], FRAME_MAXLEN);
+	}
+
+	/* A benchmark of frames dropped too early would be meaningless */
+	corpus_next = 0;
+	for (i=0; i<CORPUS_VARIANTS; i++) {
+		corpus_sent = 0;
+		errno = net_coap_recv(&stack.coap, buffer, sizeof(buffer), &dataoffset, &datalen);
+		/* Solicitations are answered afterwards */
+		net_ip6_service(&stack.ip6, buffer, sizeof(buffer));
+		if (errno == NET_STATUS_OK) {
+			outcome = CORPUS_DELIVER;
+		} else {
+			outcome = (corpus_sent > 0) ? CORPUS_REPLY : CORPUS_DROP;
+		}
+		if ((corpus_len[i] == 0) || (outcome != corpus_outcome(bench->category))) {
+			fprintf(stderr, "%s: unexpected outcome of variant %u (length %u, status %d)\n",
+			        bench->name, i, corpus_len[i], errno);
+			exit(1);
+		}
+	}
+}
+
+static void run_corpus(struct bench *bench, uint32_t iterations)
+{
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+	uint32_t i;
+
+	for (i=0; i<iterations; i++) {
+		net_coap_recv(&stack.coap, buffer, sizeof(buffer), &dataoffset, &datalen);
+		sink += datalen;
+	}
+}
+
+/*
+ * Data path under a flood of solicitations of our address, at 10k NS/s: an
+ * operation is the receive of a CoAP response, after 10 solicitations. The
+ * rate limit of the ICMPv6 replies leaves them the cost of their parsing.
+ */
+static void setup_flood(struct bench *bench)
+{
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+	uint16_t i;
+
+	stack_setup(&stack, client_l2addr, server_l2addr, client_addr, server_addr, 1234, 5683);
+	stack.hw.recv_cback = corpus_recv;
+	stack.hw.send_cback = corpus_send;
+	clock_posix_set_source(&corpus_clock);
+	corpus_cnt = FLOOD_NS_CNT + 1;
+	corpus_interval_us = FLOOD_INTERVAL_US;
+
+	for (i=0; i<FLOOD_NS_CNT; i++) {
+		corpus_len[i] = corpus_frame(CORPUS_NS, i, corpus[i], FRAME_MAXLEN);
+	}
+	corpus_len[i] = corpus_frame(CORPUS_COAP, 0, corpus[i], FRAME_MAXLEN);
+
+	/* The response is delivered after the solicitations, a burst of which is answered */
+	corpus_next = 0;
+	corpus_sent = 0;
+	for (i=0; i<FLOOD_NS_CNT; i++) {
+		if (net_coap_recv(&stack.coap, buffer, sizeof(buffer), &dataoffset, &datalen) != NET_EAGAIN) {
+			fprintf(stderr, "%s: solicitation %u not dropped\n", bench->name, i);
+			exit(1);
+		}
+	}
+	if ((net_coap_recv(&stack.coap, buffer, sizeof(buffer), &dataoffset, &datalen) != NET_STATUS_OK) ||
+	    (corpus_sent == 0)) {
+		fprintf(stderr, "%s: response not delivered, or no solicitation answered\n", bench->name);
+		exit(1);
+	}
+}
+
+static void run_flood(struct bench *bench, uint32_t iterations)
+{
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+	uint32_t i;
+
+	for (i=0; i<iterations; i++) {
+		while (net_coap_recv(&stack.coap, buffer, sizeof(buffer), &dataoffset, &datalen) != NET_STATUS_OK) {
+		}
+		sink += datalen;
+	}
+}
+
+/*
+ * Server of polling requests, in listening mode: an operation is the receive
+ * of a datagram, of any peer, and of its reply in the same buffer.
+ */
+static void setup_serve(struct bench *bench)
+{
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+	uint8_t *peer_addr = NULL;
+	uint16_t peer_port = 0;
+	uint16_t i;
+
+	stack_setup(&stack, client_l2addr, server_l2addr, client_addr, server_addr, 1234, 0);
+	stack.hw.recv_cback = corpus_recv;
+	stack.hw.send_cback = corpus_send;
+	net_udp_listen(&stack.udp);
+	corpus_cnt = CORPUS_VARIANTS;
+	corpus_interval_us = 0;
+
+	for (i=0; i<CORPUS_VARIANTS; i++) {
+		corpus_len[i] = corpus_frame(CORPUS_COAP, i, corpus[i], FRAME_MAXLEN);
+	}
+
+	corpus_next = 0;
+	corpus_sent = 0;
+	for (i=0; i<CORPUS_VARIANTS; i++) {
+		if ((net_udp_recv_from(&stack.udp, buffer, sizeof(buffer), &dataoffset, &datalen,
+		                       &peer_addr, &peer_port) != NET_STATUS_OK) ||
+		    (net_udp_send_to(&stack.udp, buffer, sizeof(buffer), dataoffset, 4,
+		                     peer_addr, peer_port) != NET_STATUS_OK)) {
+			fprintf(stderr, "%s: request %u not answered\n", bench->name, i);
+			exit(1);
+		}
+	}
+}
+
+static void run_serve(struct bench *bench, uint32_t iterations)
+{
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+	uint8_t *peer_addr = NULL;
+	uint16_t peer_port = 0;
+	uint32_t i;
+
+	for (i=0; i<iterations; i++) {
+		net_udp_recv_from(&stack.udp, buffer, sizeof(buffer), &dataoffset, &datalen,
+		                  &peer_addr, &peer_port);
+		net_udp_send_to(&stack.udp, buffer, sizeof(buffer), dataoffset, 4,
+		                peer_addr, peer_port);
+		sink += datalen;
+	}
+}
+
+#define BENCH_CORPUS(name, category) \
+	{ name, 0, setup_corpus, run_corpus, category }
+
+#define BENCH_SIZES(name, setup, run) \
+	{ name, 64, setup, run }, \
+	{ name, 256, setup, run }, \
+	{ name, 1280, setup, run }
+
+static struct bench benches[] = {
+	{ "cksum_sum", 40, setup_buffer, run_cksum },
+	BENCH_SIZES("cksum_sum", setup_buffer, run_cksum),
+	{ "coap_hdrsize", 0, setup_coap, run_coap_hdrsize },
+	{ "coap_send", 0, setup_coap, run_coap_send },
+	BENCH_SIZES("coap_send", setup_coap, run_coap_send),
+	{ "link_copy", 0, setup_ip6_recv, run_link_copy },
+	BENCH_SIZES("link_copy", setup_ip6_recv, run_link_copy),
+	{ "ip6_recv", 0, setup_ip6_recv, run_ip6_recv },
+	BENCH_SIZES("ip6_recv", setup_ip6_recv, run_ip6_recv),
+	BENCH_SIZES("serial_encode", setup_serial, run_serial_encode),
+	BENCH_SIZES("serial_decode", setup_serial, run_serial_decode),
+	BENCH_CORPUS("recv_coap", CORPUS_COAP),
+	BENCH_CORPUS("recv_coap_opts", CORPUS_COAP_OPTIONS),
+	BENCH_CORPUS("recv_coap_ext", CORPUS_COAP_EXTLEN),
+	BENCH_CORPUS("recv_truncated", CORPUS_TRUNCATED),
+	BENCH_CORPUS("recv_ns", CORPUS_NS),
+	BENCH_CORPUS("recv_ns_flood", CORPUS_NS_FLOOD),
+	BENCH_CORPUS("recv_echo", CORPUS_ECHO),
+	BENCH_CORPUS("recv_foreign", CORPUS_FOREIGN),
+	{ "recv_flood", 0, setup_flood, run_flood },
+	{ "udp_serve", 0, setup_serve, run_serve },
+};
+
+
+/*
+ * Measurement
+ */
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+/* Reference cycles, at the nominal frequency whatever the actual one */
+static int64_t cycles_now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return (int64_t) __rdtsc();
+#else
+	return -1;
+#endif
+}
+
+static void perf_open(void)
+{
+#ifdef __linux__
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(attr);
+	attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+
+	/* Not available in most containers and VMs */
+	perf_fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+}
+
+static void perf_start(void)
+{
+#ifdef __linux__
+	if (perf_fd >= 0) {
+		ioctl(perf_fd, PERF_EVENT_IOC_RESET, 0);
+		ioctl(perf_fd, PERF_EVENT_IOC_ENABLE, 0);
+	}
+#endif
+}
+
+static int64_t perf_stop(void)
+{
+	int64_t count = -1;
+
+#ifdef __linux__
+	if (perf_fd >= 0) {
+		ioctl(perf_fd, PERF_EVENT_IOC_DISABLE, 0);
+		if (read(perf_fd, &count, sizeof(count)) != sizeof(count)) {
+			count = -1;
+		}
+	}
+#endif
+
+	return count;
+}
+
+static void bench_measure(struct bench *bench, uint64_t target_ns,
+                          struct bench_result *result)
+{
+	uint32_t iterations = 1;
+	uint64_t elapsed = 0;
+	int64_t cycles;
+	int64_t insns;
+	double ns;
+	int run;
+
+	bench->setup(bench);
+
+	/* Calibrate the number of iterations to the target duration */
+	while (1) {
+		elapsed = now_ns();
+		bench->run(bench, iterations);
+		elapsed = now_ns() - elapsed;
+		if ((elapsed >= target_ns / 4) || (iterations >= (1U << 30))) {
+			break;
+		}
+		iterations *= 2;
+	}
+	iterations = (elapsed > 0) ? (uint32_t) ((double) iterations * target_ns / elapsed) : iterations;
+	if (iterations == 0) {
+		iterations = 1;
+	}
+
+	/* Keep the best run, the others were disturbed */
+	result->ns_per_op = -1;
+	result->cycles_per_op = -1;
+	result->insns_per_op = -1;
+	for (run=0; run<BENCH_RUNS; run++) {
+		perf_start();
+		elapsed = now_ns();
+		cycles = cycles_now();
+		bench->run(bench, iterations);
+		cycles = (cycles >= 0) ? cycles_now() - cycles : -1;
+		elapsed = now_ns() - elapsed;
+		insns = perf_stop();
+
+		ns = (double) elapsed / iterations;
+		if ((result->ns_per_op < 0) || (ns < result->ns_per_op)) {
+			result->ns_per_op = ns;
+		}
+		if ((cycles >= 0) && ((result->cycles_per_op < 0) ||
+		                      ((double) cycles / iterations < result->cycles_per_op))) {
+			result->cycles_per_op = (double) cycles / iterations;
+		}
+		if ((insns >= 0) && ((result->insns_per_op < 0) ||
+		                     ((double) insns / iterations < result->insns_per_op))) {
+			result->insns_per_op = (double) insns / iterations;
+		}
+	}
+}
+
+
+int main(int argc, char *argv[])
+{
+	struct bench_result results[sizeof(benches)/sizeof(benches[0])];
+	const char *output = NULL;
+	const char *filter = NULL;
+	const char *label = "";
+	const char *sep = "";
+	uint64_t target_ns = 100000000ULL;
+	FILE *json;
+	size_t i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "o:f:l:t:w:")) != -1) {
+		switch (opt) {
+		case 'o':
+			output = optarg;
+			break;
+		case 'f':
+			filter = optarg;
+			break;
+		case 'l':
+			label = optarg;
+			break;
+		case 't':
+			target_ns = strtoull(optarg, NULL, 0) * 1000000ULL;
+			break;
+		case 'w':
+			if (corpus_write_pcap(optarg) < 0) {
+				perror(optarg);
+				return 1;
+			}
+			return 0;
+		default:
+			fprintf(stderr, "usage: %s [-o json] [-f filter] [-l label] [-t ms] "
+			                "[-w corpus.pcap]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	/* serial_write output is discarded */
+	serial_posix_set_fd(-1, open("/dev/null", O_WRONLY));
+	perf_open();
+
+	printf("%-16s %6s %12s %12s %12s %12s\n", "benchmark", "size", "ns/op", "MB/s",
+	       "cycles/op", "insns/op");
+
+	for (i=0; i<sizeof(benches)/sizeof(benches[0]); i++) {
+		if ((filter != NULL) && (strstr(benches[i].name, filter) == NULL)) {
+			results[i].ns_per_op = -1;
+			continue;
+		}
+
+		bench_measure(&benches[i], target_ns, &results[i]);
+
+		printf("%-16s %6u %12.1f ", benches[i].name, benches[i].size, results[i].ns_per_op);
+		if (benches[i].size > 0) {
+			printf("%12.1f ", benches[i].size * 1000.0 / results[i].ns_per_op);
+		} else {
+			printf("%12s ", "-");
+		}
+		if (results[i].cycles_per_op >= 0) {
+			printf("%12.1f ", results[i].cycles_per_op);
+		} else {
+			printf("%12s ", "-");
+		}
+		if (results[i].insns_per_op >= 0) {
+			printf("%12.1f\n", results[i].insns_per_op);
+		} else {
+			printf("%12s\n", "-");
+		}
+	}
+
+	if (output == NULL) {
+		return 0;
+	}
+
+	json = fopen(output, "w");
+	if (json == NULL) {
+		perror(output);
+		return 1;
+	}
+
+	fprintf(json, "{\n  \"label\": \"%s\",\n  \"results\": [\n", label);
+	for (i=0; i<sizeof(benches)/sizeof(benches[0]); i++) {
+		if (results[i].ns_per_op < 0) {
+			continue;
+		}
+		fprintf(json, "%s    {\"name\": \"%s\", \"size\": %u, \"ns_per_op\": %.3f",
+		        sep, benches[i].name, benches[i].size, results[i].ns_per_op);
+		if (results[i].cycles_per_op >= 0) {
+			fprintf(json, ", \"cycles_per_op\": %.1f", results[i].cycles_per_op);
+		}
+		if (results[i].insns_per_op >= 0) {
+			fprintf(json, ", \"insns_per_op\": %.1f", results[i].insns_per_op);
+		}
+		fprintf(json, "}");
+		sep = ",\n";
+	}
+	fprintf(json, "\n  ]\n}\n");
+	fclose(json);
+
+	return 0;
+}
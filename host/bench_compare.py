@@ -0,0 +1,46 @@
+#!/usr/bin/env python
+#
+# Copyright (c) 2024 Emmanuel Thierry
+#
+# SPDX-License-Identifier: BSD-3-Clause
+#
+# Compare two JSON outputs of host/bench (e.g. before and after a commit).
+#   bench_compare.py <base.json> <new.json> [threshold_percent]
+
+from __future__ import print_function
+
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        data = json.load(f)
+    return data.get("label", path), \
+        dict(((r["name"], r["size"]), r) for r in data["results"])
+
+
+if len(sys.argv) < 3:
+    print("usage: %s <base.json> <new.json> [threshold_percent]" % sys.argv[0])
+    sys.exit(2)
+
+base_label, base = load(sys.argv[1])
+new_label, new = load(sys.argv[2])
+threshold = float(sys.argv[3]) if len(sys.argv) > 3 else 5.0
+
+print("%-16s %6s %12s %12s %8s" % ("benchmark", "size", base_label[:12], new_label[:12], "delta"))
+
+regressions = 0
+for key in sorted(set(base) & set(new)):
+    before = base[key]["ns_per_op"]
+    after = new[key]["ns_per_op"]
+    delta = (after - before) * 100.0 / before if before > 0 else 0.0
+    flag = ""
+    if delta > threshold:
+        flag = "  slower"
+        regressions += 1
+    elif delta < -threshold:
+        flag = "  faster"
+    print("%-16s %6u %12.1f %12.1f %+7.1f%%%s" % (key[0], key[1], before, after, delta, flag))
+
+sys.exit(1 if regressions > 0 else 0)
@@ -0,0 +1,635 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "corpus.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CORPUS_FRAME_MAXLEN 1514
+#define CORPUS_HDRSIZE      (14 + 40)   /* Ethernet + IPv6 */
+#define CORPUS_MSG_MAXLEN   (CORPUS_FRAME_MAXLEN - CORPUS_HDRSIZE - 8)
+
+#define ETHERTYPE_IPV4 0x0800
+#define ETHERTYPE_ARP  0x0806
+#define ETHERTYPE_IPV6 0x86DD
+
+#define NH_TCP    6
+#define NH_UDP    17
+#define NH_ICMPV6 58
+
+#define COAP_CON 0
+#define COAP_NON 1
+#define COAP_ACK 2
+
+#define COAP_CODE_CONTENT 0x45
+#define COAP_CODE_POST    0x02
+
+
+static const uint8_t local_l2addr[6] = {0x10, 0x22, 0x33, 0x44, 0x55, 0x66};
+static const uint8_t peer_l2addr[6] = {0x76, 0x88, 0x99, 0xAA, 0xBB, 0xCC};
+static const uint8_t other_l2addr[6] = {0x02, 0x00, 0x5E, 0x10, 0x00, 0x01};
+static const uint8_t broadcast_l2addr[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+static const uint8_t allnodes_l2addr[6] = {0x33, 0x33, 0x00, 0x00, 0x00, 0x01};
+static const uint8_t mdns_l2addr[6] = {0x33, 0x33, 0x00, 0x00, 0x00, 0xFB};
+static const uint8_t sn_l2addr[6] = {0x33, 0x33, 0xFF, 0x0D, 0x00, 0x0C};
+
+static const uint8_t local_addr[16] = {0x20,0x01,0,0x01,0,0x02,0,0x03,0,0x0f,0,0x0e,0,0x0d,0,0x0c};
+static const uint8_t local_lladdr[16] = {0xfe,0x80,0,0,0,0,0,0,0,0x0f,0,0x0e,0,0x0d,0,0x0c};
+static const uint8_t peer_addr[16] = {0x20,0x01,0,0x01,0,0x02,0,0x03,0,0x0a,0,0x0b,0,0x0c,0,0x0d};
+static const uint8_t unspec_addr[16] = {0};
+static const uint8_t allnodes_addr[16] = {0xff,0x02,0,0,0,0,0,0,0,0,0,0,0,0,0,0x01};
+static const uint8_t mdns_addr[16] = {0xff,0x02,0,0,0,0,0,0,0,0,0,0,0,0,0,0xfb};
+static const uint8_t sn_addr[16] = {0xff,0x02,0,0,0,0,0,0,0,0,0,0x01,0xff,0x0d,0,0x0c};
+
+static const uint8_t token[2] = {0x12, 0x34};
+static const uint16_t local_port = 1234;
+static const uint16_t peer_port = 5683;
+
+static const char *names[CORPUS_CATEGORY_CNT] = {
+	"coap",
+	"coap_options",
+	"coap_extlen",
+	"truncated",
+	"ns",
+	"ns_flood",
+	"echo",
+	"foreign",
+};
+
+static const uint8_t outcomes[CORPUS_CATEGORY_CNT] = {
+	CORPUS_DELIVER,
+	CORPUS_DELIVER,
+	CORPUS_DELIVER,
+	CORPUS_DROP,
+	CORPUS_REPLY,
+	CORPUS_DROP,
+	CORPUS_REPLY,
+	CORPUS_DROP,
+};
+
+/* Frames are built here, then copied to the buffer of the caller */
+static uint8_t scratch[CORPUS_FRAME_MAXLEN];
+static uint8_t msg[CORPUS_MSG_MAXLEN];
+
+
+/*
+ * Headers
+ */
+
+static uint16_t _corpus_put_short(uint8_t *p, uint16_t value)
+{
+	p[0] = value >> 8;
+	p[1] = value & 0xFF;
+	return 2;
+}
+
+static uint32_t _corpus_sum(uint32_t sum, const uint8_t *data, uint16_t len)
+{
+	uint16_t i;
+
+	for (i=0; i+1<len; i+=2) {
+		sum += (data[i] << 8) | data[i+1];
+	}
+	if (len & 1) {
+		sum += data[len-1] << 8;
+	}
+	return sum;
+}
+
+/* Checksum of an upper-layer packet, over the IPv6 pseudo-header */
+static uint16_t _corpus_cksum(const uint8_t *src, const uint8_t *dst, uint8_t nh,
+                              const uint8_t *data, uint16_t len)
+{
+	uint32_t sum = 0;
+
+	sum = _corpus_sum(sum, src, 16);
+	sum = _corpus_sum(sum, dst, 16);
+	sum += len;
+	sum += nh;
+	sum = _corpus_sum(sum, data, len);
+	while (sum >> 16) {
+		sum = (sum & 0xFFFF) + (sum >> 16);
+	}
+	sum = ~sum & 0xFFFF;
+
+	/* A zero UDP checksum means no checksum */
+	return (sum == 0) ? 0xFFFF : sum;
+}
+
+static uint16_t _corpus_eth(uint8_t *frame, const uint8_t *l2dst, uint16_t ethertype)
+{
+	memcpy(&frame[0], l2dst, 6);
+	memcpy(&frame[6], peer_l2addr, 6);
+	_corpus_put_short(&frame[12], ethertype);
+	return 14;
+}
+
+/* Ethernet and IPv6 headers followed by pload, of which the checksum is set */
+static uint16_t _corpus_ip6(const uint8_t *l2dst, const uint8_t *src, const uint8_t *dst,
+                            uint8_t nh, const uint8_t *pload, uint16_t plen)
+{
+	uint8_t *ip6 = &scratch[14];
+	uint8_t *l4 = &scratch[CORPUS_HDRSIZE];
+
+	if (plen > CORPUS_FRAME_MAXLEN - CORPUS_HDRSIZE) {
+		return 0;
+	}
+
+	_corpus_eth(scratch, l2dst, ETHERTYPE_IPV6);
+	ip6[0] = 0x60;
+	ip6[1] = 0;
+	ip6[2] = 0;
+	ip6[3] = 0;
+	_corpus_put_short(&ip6[4], plen);
+	ip6[6] = nh;
+	ip6[7] = (nh == NH_ICMPV6) ? 255 : 64;
+	memcpy(&ip6[8], src, 16);
+	memcpy(&ip6[24], dst, 16);
+	memmove(l4, pload, plen);
+
+	if ((nh == NH_UDP) && (plen >= 8)) {
+		_corpus_put_short(&l4[6], _corpus_cksum(src, dst, nh, l4, plen));
+	} else if ((nh == NH_ICMPV6) && (plen >= 4)) {
+		_corpus_put_short(&l4[2], _corpus_cksum(src, dst, nh, l4, plen));
+	}
+
+	return CORPUS_HDRSIZE + plen;
+}
+
+/* UDP datagram of the peer, carrying msg */
+static uint16_t _corpus_udp(const uint8_t *l2dst, const uint8_t *src, const uint8_t *dst,
+                            uint16_t sport, uint16_t dport, uint16_t msglen)
+{
+	uint8_t udp[8 + CORPUS_MSG_MAXLEN];
+
+	_corpus_put_short(&udp[0], sport);
+	_corpus_put_short(&udp[2], dport);
+	_corpus_put_short(&udp[4], 8 + msglen);
+	_corpus_put_short(&udp[6], 0);
+	memcpy(&udp[8], msg, msglen);
+
+	return _corpus_ip6(l2dst, src, dst, NH_UDP, udp, 8 + msglen);
+}
+
+static uint16_t _corpus_udp_to_us(uint16_t msglen)
+{
+	return _corpus_udp(local_l2addr, peer_addr, local_addr, peer_port, local_port, msglen);
+}
+
+/*
+ * CoAP
+ */
+
+static uint16_t _corpus_coap_hdr(uint8_t *p, uint8_t type, uint8_t code, uint16_t messageid,
+                                 const uint8_t *tok, uint8_t toklen)
+{
+	p[0] = 0x40 | (type << 4) | toklen;
+	p[1] = code;
+	_corpus_put_short(&p[2], messageid);
+	memcpy(&p[4], tok, toklen);
+	return 4 + toklen;
+}
+
+/* Nibble of an option delta or length, and its extension */
+static uint8_t _corpus_coap_nibble(uint16_t value, uint8_t *ext, uint16_t *extlen)
+{
+	if (value < 13) {
+		*extlen = 0;
+		return value;
+	} else if (value < 269) {
+		ext[0] = value - 13;
+		*extlen = 1;
+		return 13;
+	}
+	_corpus_put_short(ext, value - 269);
+	*extlen = 2;
+	return 14;
+}
+
+static uint16_t _corpus_coap_opt(uint8_t *p, uint16_t delta, uint16_t len, uint8_t fill)
+{
+	uint8_t delta_ext[2];
+	uint8_t len_ext[2];
+	uint16_t delta_extlen;
+	uint16_t len_extlen;
+	uint16_t pos = 1;
+	uint16_t i;
+
+	p[0] = (_corpus_coap_nibble(delta, delta_ext, &delta_extlen) << 4) |
+	       _corpus_coap_nibble(len, len_ext, &len_extlen);
+	memcpy(&p[pos], delta_ext, delta_extlen);
+	pos += delta_extlen;
+	memcpy(&p[pos], len_ext, len_extlen);
+	pos += len_extlen;
+	for (i=0; i<len; i++) {
+		p[pos++] = fill + i;
+	}
+
+	return pos;
+}
+
+static uint16_t _corpus_coap_pload(uint8_t *p, uint16_t len)
+{
+	uint16_t i;
+
+	p[0] = 0xFF;
+	for (i=0; i<len; i++) {
+		p[1+i] = 'a' + (i % 26);
+	}
+	return 1 + len;
+}
+
+/* NON response of the peer, with Content-Format and Max-Age */
+static uint16_t _corpus_coap(uint16_t variant)
+{
+	uint16_t pos = 0;
+
+	pos += _corpus_coap_hdr(&msg[pos], COAP_NON, COAP_CODE_CONTENT, variant, token, sizeof(token));
+	pos += _corpus_coap_opt(&msg[pos], 12, 1, 50);
+	pos += _corpus_coap_opt(&msg[pos], 2, 2, 0x0E);
+	pos += _corpus_coap_pload(&msg[pos], 8 + variant * 4);
+
+	return _corpus_udp_to_us(pos);
+}
+
+/* Many short options: ETag, Location-Path, Content-Format, Max-Age, Location-Query */
+static uint16_t _corpus_coap_options(uint16_t variant)
+{
+	uint16_t pos = 0;
+	uint16_t i;
+
+	pos += _corpus_coap_hdr(&msg[pos], COAP_NON, COAP_CODE_CONTENT, variant, token, sizeof(token));
+	pos += _corpus_coap_opt(&msg[pos], 4, 8, 0xE0);
+	for (i=0; i<8+variant*2; i++) {
+		pos += _corpus_coap_opt(&msg[pos], (i == 0) ? 4 : 0, 1 + (i % 6), 'p');
+	}
+	pos += _corpus_coap_opt(&msg[pos], 4, 1, 50);
+	pos += _corpus_coap_opt(&msg[pos], 2, 4, 0x01);
+	for (i=0; i<4+variant; i++) {
+		pos += _corpus_coap_opt(&msg[pos], (i == 0) ? 6 : 0, 1 + (i % 8), 'q');
+	}
+	pos += _corpus_coap_pload(&msg[pos], 4);
+
+	return _corpus_udp_to_us(pos);
+}
+
+/*
+ * Extended deltas and lengths: Location-Path of 13 to 261 bytes (1 byte
+ * extensions), Proxy-Uri of 269 bytes and more (2 bytes), and an option
+ * number above 269 (2 bytes of delta extension)
+ */
+static uint16_t _corpus_coap_extlen(uint16_t variant)
+{
+	uint16_t pos = 0;
+
+	pos += _corpus_coap_hdr(&msg[pos], COAP_NON, COAP_CODE_CONTENT, variant, token, sizeof(token));
+	pos += _corpus_coap_opt(&msg[pos], 4, 8, 0xE0);
+	pos += _corpus_coap_opt(&msg[pos], 4, 13 + variant * 8, 'l');
+	pos += _corpus_coap_opt(&msg[pos], 27, 269 + variant * 24, 'u');
+	pos += _corpus_coap_opt(&msg[pos], 2048 + variant - 35, 1, 0x01);
+	pos += _corpus_coap_pload(&msg[pos], 4);
+
+	return _corpus_udp_to_us(pos);
+}
+
+/* A valid frame, then truncated or corrupted at one of the layers */
+static uint16_t _corpus_truncated(uint16_t variant)
+{
+	uint8_t udp[8 + 64];
+	uint16_t msglen = 0;
+	uint16_t framelen;
+
+	msglen += _corpus_coap_hdr(&msg[msglen], COAP_NON, COAP_CODE_CONTENT, variant, token, sizeof(token));
+	msglen += _corpus_coap_opt(&msg[msglen], 4, 4, 0xE0);
+	msglen += _corpus_coap_opt(&msg[msglen], 4, 20, 'l');
+	msglen += _corpus_coap_pload(&msg[msglen], 8);
+	framelen = _corpus_udp_to_us(msglen);
+
+	switch (variant % 10) {
+	case 0:
+		/* Shorter than the Ethernet header */
+		return 10;
+	case 1:
+		/* Half of the IPv6 header */
+		return 14 + 20;
+	case 2:
+		/* IPv6 payload length beyond the frame */
+		_corpus_put_short(&scratch[14 + 4], framelen - CORPUS_HDRSIZE + 16);
+		return framelen;
+	case 3:
+		/* IPv4 version in an IPv6 packet */
+		scratch[14] = 0x40;
+		return framelen;
+	case 4:
+		/* Half of the UDP header */
+		memcpy(udp, &scratch[CORPUS_HDRSIZE], 4);
+		return _corpus_ip6(local_l2addr, peer_addr, local_addr, NH_UDP, udp, 4);
+	case 5:
+		/* Half of the CoAP header */
+		return _corpus_udp_to_us(2);
+	case 6:
+		/* Half of the token */
+		return _corpus_udp_to_us(4 + 1);
+	case 7:
+		/* Option of an extended length, without its extension */
+		return _corpus_udp_to_us(4 + 2 + 5 + 1);
+	case 8:
+		/* Option value shorter than its length */
+		return _corpus_udp_to_us(4 + 2 + 5 + 2 + 5);
+	default:
+		/* Payload marker, without payload */
+		return _corpus_udp_to_us(msglen - 8);
+	}
+}
+
+/*
+ * Neighbor Discovery
+ */
+
+static uint16_t _corpus_ns(const uint8_t *l2dst, const uint8_t *src, const uint8_t *dst,
+                           const uint8_t *target)
+{
+	uint8_t ns[4 + 20 + 8];
+	uint16_t len = 4 + 20;
+
+	memset(ns, 0, sizeof(ns));
+	ns[0] = 135;
+	memcpy(&ns[8], target, 16);
+
+	/* Source link-layer address option, except for DAD */
+	if (memcmp(src, unspec_addr, 16) != 0) {
+		ns[24] = 1;
+		ns[25] = 1;
+		memcpy(&ns[26], peer_l2addr, 6);
+		len += 8;
+	}
+
+	return _corpus_ip6(l2dst, src, dst, NH_ICMPV6, ns, len);
+}
+
+/*
+ * Resolution of our addresses (global or link-local) from various sources,
+ * Duplicate Address Detection, and unicast Neighbor Unreachability Detection
+ */
+static uint16_t _corpus_ns_ours(uint16_t variant)
+{
+	uint8_t src[16];
+	const uint8_t *target = (variant & 1) ? local_lladdr : local_addr;
+
+	memcpy(src, peer_addr, 16);
+	src[15] = variant;
+
+	switch (variant % 8) {
+	case 3:
+		return _corpus_ns(sn_l2addr, unspec_addr, sn_addr, target);
+	case 7:
+		return _corpus_ns(local_l2addr, src, local_addr, local_addr);
+	default:
+		return _corpus_ns(sn_l2addr, src, sn_addr, target);
+	}
+}
+
+/*
+ * Scan of the prefix: targets of other solicited-node groups, or of ours
+ * (same 24 lower bits) but of another address
+ */
+static uint16_t _corpus_ns_flood(uint16_t variant)
+{
+	uint8_t l2dst[6];
+	uint8_t dst[16];
+	uint8_t target[16];
+
+	memcpy(target, local_addr, 16);
+	memcpy(l2dst, sn_l2addr, 6);
+	memcpy(dst, sn_addr, 16);
+
+	if ((variant % 4) == 0) {
+		target[13] = variant;
+		l2dst[3] = variant;
+		dst[13] = variant;
+	} else {
+		target[8] = 0x80 | variant;
+		target[9] = variant * 7;
+	}
+
+	return _corpus_ns(l2dst, peer_addr, dst, target);
+}
+
+/*
+ * Echo Requests (ping) of our addresses, global or link-local, of growing
+ * sizes up to the MTU
+ */
+static uint16_t _corpus_echo(uint16_t variant)
+{
+	uint8_t src[16];
+	uint16_t len = 8 + variant * 40;
+
+	memset(msg, 0, 8);
+	msg[0] = 128;
+	_corpus_put_short(&msg[4], 0x0100 + variant);
+	_corpus_put_short(&msg[6], variant);
+	memset(&msg[8], 0x5A ^ variant, len - 8);
+
+	if (variant & 1) {
+		memcpy(src, local_lladdr, 16);
+		memcpy(&src[8], &peer_addr[8], 8);
+		return _corpus_ip6(local_l2addr, src, local_lladdr, NH_ICMPV6, msg, len);
+	}
+
+	return _corpus_ip6(local_l2addr, peer_addr, local_addr, NH_ICMPV6, msg, len);
+}
+
+/*
+ * Other traffic
+ */
+
+static uint16_t _corpus_foreign(uint16_t variant)
+{
+	uint8_t addr[16];
+	uint8_t pload[28];
+	uint16_t pos = 0;
+
+	pos += _corpus_coap_hdr(&msg[pos], COAP_NON, COAP_CODE_CONTENT, variant, token, sizeof(token));
+	pos += _corpus_coap_pload(&msg[pos], 16);
+	memcpy(addr, local_addr, 16);
+
+	switch (variant % 14) {
+	case 0:
+		/* Unicast to another host */
+		return _corpus_udp(other_l2addr, peer_addr, local_addr, peer_port, local_port, pos);
+	case 1:
+		/* IPv4 */
+		memset(pload, 0, sizeof(pload));
+		pload[0] = 0x45;
+		_corpus_put_short(&pload[2], sizeof(pload));
+		pload[8] = 64;
+		pload[9] = NH_UDP;
+		_corpus_eth(scratch, local_l2addr, ETHERTYPE_IPV4);
+		memcpy(&scratch[14], pload, sizeof(pload));
+		return 14 + sizeof(pload);
+	case 2:
+		/* ARP request */
+		memset(pload, 0, sizeof(pload));
+		_corpus_put_short(&pload[0], 1);
+		_corpus_put_short(&pload[2], ETHERTYPE_IPV4);
+		pload[4] = 6;
+		pload[5] = 4;
+		_corpus_put_short(&pload[6], 1);
+		memcpy(&pload[8], peer_l2addr, 6);
+		_corpus_eth(scratch, broadcast_l2addr, ETHERTYPE_ARP);
+		memcpy(&scratch[14], pload, sizeof(pload));
+		return 14 + sizeof(pload);
+	case 3:
+		/* Another destination, on our MAC address */
+		addr[15] = 0x01;
+		return _corpus_udp(local_l2addr, peer_addr, addr, peer_port, local_port, pos);
+	case 4:
+		/* Another source */
+		memcpy(addr, peer_addr, 16);
+		addr[15] = variant;
+		return _corpus_udp(local_l2addr, addr, local_addr, peer_port, local_port, pos);
+	case 5:
+		/* Another local port */
+		return _corpus_udp(local_l2addr, peer_addr, local_addr, peer_port, 5683, pos);
+	case 6:
+		/* Another peer port */
+		return _corpus_udp(local_l2addr, peer_addr, local_addr, 49152 + variant, local_port, pos);
+	case 7:
+		/* TCP SYN */
+		memset(pload, 0, 20);
+		_corpus_put_short(&pload[0], 49152 + variant);
+		_corpus_put_short(&pload[2], local_port);
+		pload[12] = 0x50;
+		pload[13] = 0x02;
+		return _corpus_ip6(local_l2addr, peer_addr, local_addr, NH_TCP, pload, 20);
+	case 8:
+		/* CoAP request, confirmable */
+		_corpus_coap_hdr(msg, COAP_CON, COAP_CODE_POST, variant, token, sizeof(token));
+		return _corpus_udp_to_us(pos);
+	case 9:
+		/* CoAP response of another token */
+		msg[5] = 0x35;
+		return _corpus_udp_to_us(pos);
+	case 10:
+		/* CoAP acknowledgement of another message */
+		_corpus_coap_hdr(msg, COAP_ACK, 0, 0x4200 + variant, token, 0);
+		return _corpus_udp_to_us(4);
+	case 11:
+		/* ICMPv6 Echo Reply, not solicited */
+		memset(pload, 0, sizeof(pload));
+		pload[0] = 129;
+		_corpus_put_short(&pload[4], 0x0100 + variant);
+		return _corpus_ip6(local_l2addr, peer_addr, local_addr, NH_ICMPV6, pload, sizeof(pload));
+	case 12:
+		/* Router Advertisement, to all nodes */
+		memset(pload, 0, 16);
+		pload[0] = 134;
+		pload[4] = 64;
+		_corpus_put_short(&pload[6], 1800);
+		memcpy(addr, local_lladdr, 16);
+		addr[15] = 0x01;
+		return _corpus_ip6(allnodes_l2addr, addr, allnodes_addr, NH_ICMPV6, pload, 16);
+	default:
+		/* mDNS */
+		return _corpus_udp(mdns_l2addr, peer_addr, mdns_addr, 5353, 5353, pos);
+	}
+}
+
+
+const char *corpus_name(uint8_t category)
+{
+	return (category < CORPUS_CATEGORY_CNT) ? names[category] : NULL;
+}
+
+uint8_t corpus_outcome(uint8_t category)
+{
+	return (category < CORPUS_CATEGORY_CNT) ? outcomes[category] : CORPUS_DROP;
+}
+
+uint16_t corpus_frame(uint8_t category, uint16_t variant, uint8_t *frame, uint16_t len)
+{
+	uint16_t framelen;
+
+	variant %= CORPUS_VARIANTS;
+
+	switch (category) {
+	case CORPUS_COAP:
+		framelen = _corpus_coap(variant);
+		break;
+	case CORPUS_COAP_OPTIONS:
+		framelen = _corpus_coap_options(variant);
+		break;
+	case CORPUS_COAP_EXTLEN:
+		framelen = _corpus_coap_extlen(variant);
+		break;
+	case CORPUS_TRUNCATED:
+		framelen = _corpus_truncated(variant);
+		break;
+	case CORPUS_NS:
+		framelen = _corpus_ns_ours(variant);
+		break;
+	case CORPUS_NS_FLOOD:
+		framelen = _corpus_ns_flood(variant);
+		break;
+	case CORPUS_ECHO:
+		framelen = _corpus_echo(variant);
+		break;
+	case CORPUS_FOREIGN:
+		framelen = _corpus_foreign(variant);
+		break;
+	default:
+		return 0;
+	}
+
+	if ((framelen == 0) || (framelen > len)) {
+		return 0;
+	}
+	memcpy(frame, scratch, framelen);
+
+	return framelen;
+}
+
+int corpus_write_pcap(const char *path)
+{
+	/* Classic pcap, host byte order, microseconds, Ethernet */
+	uint32_t header[6] = {0xA1B2C3D4, 0x00040002, 0, 0, 65535, 1};
+	uint32_t record[4];
+	uint8_t frame[CORPUS_FRAME_MAXLEN];
+	uint32_t count = 0;
+	uint16_t framelen;
+	uint8_t category;
+	uint16_t variant;
+	FILE *file;
+	bool ok;
+
+	file = fopen(path, "wb");
+	if (file == NULL) {
+		return -1;
+	}
+	ok = (fwrite(header, sizeof(header), 1, file) == 1);
+
+	/* One frame per millisecond */
+	for (category=0; ok && (category<CORPUS_CATEGORY_CNT); category++) {
+		for (variant=0; ok && (variant<CORPUS_VARIANTS); variant++) {
+			framelen = corpus_frame(category, variant, frame, sizeof(frame));
+			record[0] = count / 1000;
+			record[1] = (count % 1000) * 1000;
+			record[2] = framelen;
+			record[3] = framelen;
+			ok = (fwrite(record, sizeof(record), 1, file) == 1) &&
+			     ((framelen == 0) || (fwrite(frame, framelen, 1, file) == 1));
+			count++;
+		}
+	}
+
+	if (fclose(file) != 0) {
+		ok = false;
+	}
+
+	return ok ? 0 : -1;
+}
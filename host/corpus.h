@@ -0,0 +1,66 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _CORPUS_H
+#define _CORPUS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * Corpus of received frames, realistic and adversarial, for the receive
+ * paths of the stack.
+ *
+ * Frames are generated in categories, each of a given number of variants,
+ * and are addressed to a stack of the addresses of tests.c (MAC
+ * 10:22:33:44:55:66, address 2001:1:2:3:f:e:d:c, UDP port 1234), with the
+ * CoAP token 0x1234, from its peer (2001:1:2:3:a:b:c:d, port 5683).
+ * Checksums are valid, so that the corpus can be replayed to other stacks.
+ *
+ * The outcome of every frame of a category is the same, as expected by the
+ * benchmarks: delivered to the application, answered (Neighbor
+ * Advertisement or Echo Reply), or dropped by one of the layers.
+ */
+
+#define CORPUS_VARIANTS 32
+
+enum corpus_category {
+	CORPUS_COAP,           /* Responses with a few options and a payload */
+	CORPUS_COAP_OPTIONS,   /* Responses with as many options as possible */
+	CORPUS_COAP_EXTLEN,    /* Options of extended deltas and lengths, up to 269+ */
+	CORPUS_TRUNCATED,      /* Truncated or malformed headers, at each layer */
+	CORPUS_NS,             /* Neighbor Solicitations of our addresses */
+	CORPUS_NS_FLOOD,       /* Neighbor Solicitations of other targets */
+	CORPUS_ECHO,           /* Echo Requests of our addresses */
+	CORPUS_FOREIGN,        /* Traffic of other hosts, protocols or ports */
+	CORPUS_CATEGORY_CNT,
+};
+
+enum corpus_outcome {
+	CORPUS_DELIVER,
+	CORPUS_REPLY,
+	CORPUS_DROP,
+};
+
+extern const char *corpus_name(uint8_t category);
+extern uint8_t corpus_outcome(uint8_t category);
+
+/* Build a variant of a category. Returns its length, or 0 if it does not fit */
+extern uint16_t corpus_frame(uint8_t category, uint16_t variant,
+                             uint8_t *frame, uint16_t len);
+
+/* Write all the variants of all the categories as a pcap. Returns 0, or -1 */
+extern int corpus_write_pcap(const char *path);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,693 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/**
+ * Device fleet simulator, load-testing a CoAP back end with the real stack.
+ *
+ * Each simulated node is a full stack (net_mac_ctx to net_coap_ctx, on a
+ * hw_stub link) with its own MAC and IPv6 addresses, and the nodes are
+ * spread over a pool of worker threads. Every node posts telemetry at a given
+ * interval, waiting for the response (non-confirmable) or acknowledgement
+ * (confirmable) of each message before the next one.
+ *
+ * Workers exchange Ethernet frames with a stand-in server, which answers
+ * every request, either through shared-memory rings (one pair per worker) or
+ * over local UDP, each datagram carrying a frame. The server can also run
+ * alone (-S), for fleets of other processes (-x).
+ *
+ * Reports the messages per second and the latency percentiles.
+ *
+ * Must be built with -DNET_LINK_STUB.
+ */
+
+#include "config.h"
+#include "platform.h"
+#include "platform_posix.h"
+#include "net_utils.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef NET_LINK_STUB
+#error "The fleet simulator must be built with NET_LINK_STUB"
+#endif
+
+#define FRAME_MAXLEN  1514
+#define RING_SLOTS    256   /* Power of 2 */
+#define RX_BURST      64    /* Frames handled between two sending rounds */
+
+#define ETH_POS       0
+#define IP6_POS       14
+#define UDP_POS       54
+#define COAP_POS      62
+
+
+struct ring {
+	_Atomic uint32_t head;
+	_Atomic uint32_t tail;
+	struct {
+		uint16_t len;
+		uint8_t data[FRAME_MAXLEN];
+	} slots[RING_SLOTS];
+};
+
+struct worker;
+
+struct node {
+	struct hw_stub_ctx hw;
+	struct net_mac_ctx mac;
+	struct net_ip6_ctx ip6;
+	struct net_udp_ctx udp;
+	struct net_coap_ctx coap;
+	uint8_t l2addr[6];
+	uint8_t addr[16];
+	uint8_t token[4];
+	struct worker *worker;
+
+	uint64_t next_us;   /* Time of the next message */
+	uint64_t sent_us;   /* Time of the message waiting for its answer */
+	bool waiting;
+	uint32_t sent;
+};
+
+struct worker {
+	pthread_t thread;
+	struct node *nodes;
+	uint32_t first;     /* Index of the first node */
+	uint32_t nodecnt;
+	uint8_t buffer[FRAME_MAXLEN];
+
+	/* Frame given to the stack by the next hw_stub_recv() */
+	const uint8_t *rx_data;
+	uint16_t rx_len;
+
+	struct ring *up;    /* To the server, shared memory link */
+	struct ring *down;
+	int fd;             /* UDP link */
+
+	uint32_t *latencies;
+	uint32_t answered;
+	uint32_t timeouts;
+	uint32_t tx_drops;  /* Link full, sending retried */
+};
+
+static const uint8_t server_l2addr[6] = {0x02, 0xff, 0x00, 0x00, 0x00, 0x01};
+static const uint8_t server_addr[16] = {0x20,0x01,0x0d,0xb8,0,0,0,0,0,0,0,0,0,0,0,0x01};
+static char *uripath[] = {"telemetry"};
+
+static uint32_t nodecnt = 1000;
+static uint32_t workercnt = 4;
+static uint32_t count = 10;
+static uint32_t interval_us = 100000;
+static uint32_t timeout_us = 2000000;
+static uint16_t payloadlen = 32;
+static bool confirmable = false;
+static bool udp_link = false;
+static uint16_t udp_port = 5699;
+
+static struct worker *workers;
+static struct node *nodes;
+static atomic_bool stop = false;
+
+
+static uint64_t now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000000ULL) + ts.tv_nsec / 1000;
+}
+
+/*
+ * Links
+ */
+
+static bool ring_push(struct ring *ring, const uint8_t *data, uint16_t len)
+{
+	uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+	if (head - atomic_load_explicit(&ring->tail, memory_order_acquire) >= RING_SLOTS) {
+		return false;
+	}
+	ring->slots[head % RING_SLOTS].len = len;
+	memcpy(ring->slots[head % RING_SLOTS].data, data, len);
+	atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+	return true;
+}
+
+/* The frame stays valid until ring_release() */
+static uint16_t ring_peek(struct ring *ring, const uint8_t **data)
+{
+	uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+	if (tail == atomic_load_explicit(&ring->head, memory_order_acquire)) {
+		return 0;
+	}
+	*data = ring->slots[tail % RING_SLOTS].data;
+	return ring->slots[tail % RING_SLOTS].len;
+}
+
+static void ring_release(struct ring *ring)
+{
+	atomic_fetch_add_explicit(&ring->tail, 1, memory_order_release);
+}
+
+static int udp_socket(uint16_t port, bool bind_port)
+{
+	struct sockaddr_in sin = {
+		.sin_family = AF_INET,
+		.sin_port = htons(port),
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	int size = 4 * 1024 * 1024;
+	int fd;
+
+	fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (fd < 0) {
+		return -1;
+	}
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+	setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+
+	if ((bind_port ? bind(fd, (struct sockaddr *) &sin, sizeof(sin)) :
+	                 connect(fd, (struct sockaddr *) &sin, sizeof(sin))) < 0) {
+		close(fd);
+		return -1;
+	}
+	fcntl(fd, F_SETFL, O_NONBLOCK);
+
+	return fd;
+}
+
+static uint16_t node_recv(struct hw_stub_ctx *stub, uint8_t *buffer, uint16_t buflen)
+{
+	struct worker *worker = ((struct node *) stub->priv)->worker;
+	uint16_t len = worker->rx_len;
+
+	if ((len == 0) || (len > buflen)) {
+		return 0;
+	}
+	memcpy(buffer, worker->rx_data, len);
+	worker->rx_len = 0;
+
+	return len;
+}
+
+static uint16_t node_send(struct hw_stub_ctx *stub, uint8_t *buffer, uint16_t buflen)
+{
+	struct worker *worker = ((struct node *) stub->priv)->worker;
+
+	if (udp_link) {
+		if (send(worker->fd, buffer, buflen, 0) != buflen) {
+			worker->tx_drops++;
+			return 0;
+		}
+	} else if (!ring_push(worker->up, buffer, buflen)) {
+		worker->tx_drops++;
+		return 0;
+	}
+
+	return buflen;
+}
+
+/*
+ * Stand-in server
+ */
+
+static void server_cksum(uint8_t *frame, uint16_t udplen)
+{
+	uint8_t pseudo[4] = {(udplen & 0xFF00) >> 8, udplen & 0x00FF, 0x00, NET_IP6_NH_UDP};
+	uint16_t sum = 0;
+
+	frame[UDP_POS+6] = 0;
+	frame[UDP_POS+7] = 0;
+	sum = _net_cksum_sum(sum, &frame[IP6_POS+8], 32);
+	sum = _net_cksum_sum(sum, pseudo, 4);
+	sum = _net_cksum_sum(sum, &frame[UDP_POS], udplen);
+	sum = _net_cksum_finalize(sum);
+	frame[UDP_POS+6] = (sum & 0xFF00) >> 8;
+	frame[UDP_POS+7] = sum & 0x00FF;
+}
+
+/**
+ * Answer a request in place: empty acknowledgement of a confirmable request,
+ * 2.04 Changed response with the same token to a non-confirmable one.
+ * Returns the length of the answer, 0 if the frame is not a request.
+ */
+static uint16_t server_answer(uint8_t *frame, uint16_t len, uint16_t *messageid)
+{
+	uint8_t tmp[16];
+	uint8_t type;
+	uint8_t tokenlen;
+	uint16_t udplen;
+
+	if ((len < COAP_POS + 4) || (frame[IP6_POS+6] != NET_IP6_NH_UDP) ||
+	    ((frame[COAP_POS] >> 6) != 1)) {
+		return 0;
+	}
+	type = (frame[COAP_POS] >> 4) & 0x03;
+	tokenlen = frame[COAP_POS] & 0x0F;
+	if ((tokenlen > 8) || (len < COAP_POS + 4 + tokenlen)) {
+		return 0;
+	}
+
+	/* Swap the addresses and ports */
+	memcpy(tmp, &frame[ETH_POS], 6);
+	memcpy(&frame[ETH_POS], &frame[ETH_POS+6], 6);
+	memcpy(&frame[ETH_POS+6], tmp, 6);
+	memcpy(tmp, &frame[IP6_POS+8], 16);
+	memcpy(&frame[IP6_POS+8], &frame[IP6_POS+24], 16);
+	memcpy(&frame[IP6_POS+24], tmp, 16);
+	memcpy(tmp, &frame[UDP_POS], 2);
+	memcpy(&frame[UDP_POS], &frame[UDP_POS+2], 2);
+	memcpy(&frame[UDP_POS+2], tmp, 2);
+
+	if (type == NET_COAP_TYPE_CONFIRMABLE) {
+		frame[COAP_POS] = 0x40 | (NET_COAP_TYPE_ACKNOWLEDGE << 4);
+		frame[COAP_POS+1] = NET_COAP_CODE_EMPTY;
+		udplen = 8 + 4;
+	} else {
+		frame[COAP_POS] = 0x40 | (NET_COAP_TYPE_NONCONFIRMABLE << 4) | tokenlen;
+		frame[COAP_POS+1] = NET_COAP_CODE_CHANGED;
+		frame[COAP_POS+2] = (*messageid & 0xFF00) >> 8;
+		frame[COAP_POS+3] = *messageid & 0x00FF;
+		(*messageid)++;
+		udplen = 8 + 4 + tokenlen;
+	}
+
+	frame[IP6_POS+4] = (udplen & 0xFF00) >> 8;
+	frame[IP6_POS+5] = udplen & 0x00FF;
+	frame[UDP_POS+4] = (udplen & 0xFF00) >> 8;
+	frame[UDP_POS+5] = udplen & 0x00FF;
+	server_cksum(frame, udplen);
+
+	return UDP_POS + udplen;
+}
+
+static void *server_run_shm(void *arg)
+{
+	uint8_t frame[FRAME_MAXLEN];
+	const uint8_t *data;
+	uint16_t messageid = 0;
+	uint16_t len;
+	uint32_t i;
+	bool idle;
+
+	while (!atomic_load(&stop)) {
+		idle = true;
+		for (i=0; i<workercnt; i++) {
+			len = ring_peek(workers[i].up, &data);
+			if (len == 0) {
+				continue;
+			}
+			memcpy(frame, data, len);
+			ring_release(workers[i].up);
+			idle = false;
+
+			len = server_answer(frame, len, &messageid);
+			if (len > 0) {
+				while (!ring_push(workers[i].down, frame, len) && !atomic_load(&stop)) {
+					sched_yield();
+				}
+			}
+		}
+		if (idle) {
+			sched_yield();
+		}
+	}
+
+	return NULL;
+}
+
+static void *server_run_udp(void *arg)
+{
+	int fd = *(int *) arg;
+	uint8_t frame[FRAME_MAXLEN];
+	struct sockaddr_in from;
+	socklen_t fromlen;
+	uint16_t messageid = 0;
+	ssize_t len;
+
+	while (!atomic_load(&stop)) {
+		fromlen = sizeof(from);
+		len = recvfrom(fd, frame, sizeof(frame), 0, (struct sockaddr *) &from, &fromlen);
+		if (len <= 0) {
+			sched_yield();
+			continue;
+		}
+		len = server_answer(frame, len, &messageid);
+		if (len > 0) {
+			sendto(fd, frame, len, 0, (struct sockaddr *) &from, fromlen);
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Nodes
+ */
+
+/* Node n has the MAC address 02:00:n and the IPv6 address 2001:db8:1::n */
+static void node_init(struct node *node, uint32_t index, struct worker *worker)
+{
+	uint8_t i;
+
+	node->l2addr[0] = 0x02;
+	node->addr[0] = 0x20;
+	node->addr[1] = 0x01;
+	node->addr[2] = 0x0d;
+	node->addr[3] = 0xb8;
+	node->addr[5] = 0x01;
+	for (i=0; i<4; i++) {
+		node->l2addr[5-i] = (index >> (8*i)) & 0xFF;
+		node->addr[15-i] = (index >> (8*i)) & 0xFF;
+		node->token[i] = (index >> (8*i)) & 0xFF;
+	}
+	node->worker = worker;
+
+	node->hw.recv_cback = node_recv;
+	node->hw.send_cback = node_send;
+	node->hw.priv = node;
+	node->mac.lower = &node->hw;
+	node->ip6.lower = &node->mac;
+	node->udp.lower = &node->ip6;
+	node->coap.lower = &node->udp;
+
+	net_mac_set_source_addr(&node->mac, node->l2addr);
+	net_mac_set_destination_addr(&node->mac, (uint8_t *) server_l2addr);
+	net_mac_set_ethertype(&node->mac, NET_MAC_ETHERTYPE_IPV6);
+	net_ip6_set_source_addr(&node->ip6, node->addr);
+	net_ip6_set_destination_addr(&node->ip6, (uint8_t *) server_addr);
+	net_ip6_set_nexthdr(&node->ip6, NET_IP6_NH_UDP);
+	net_udp_set_source_port(&node->udp, 5683);
+	net_udp_set_destination_port(&node->udp, 5683);
+	net_udp_connect(&node->udp);
+	net_coap_set_method(&node->coap, confirmable ? NET_COAP_TYPE_CONFIRMABLE :
+	                                               NET_COAP_TYPE_NONCONFIRMABLE,
+	                    NET_COAP_CODE_POST);
+	net_coap_set_token(&node->coap, sizeof(node->token), node->token);
+	net_coap_set_uripath(&node->coap, 1, uripath);
+	net_coap_set_contenttype(&node->coap, NET_COAP_CONTENTTYPE_OCTETSTRING);
+}
+
+static void node_post(struct worker *worker, struct node *node, uint64_t now)
+{
+	uint16_t dataoffset = net_coap_pload_pos(&node->coap);
+	uint8_t *cursor;
+
+	/* The payload starts with the message number, the rest is filler */
+	memset(&worker->buffer[dataoffset], 'x', payloadlen);
+	NET_SET_CURSOR(worker->buffer, dataoffset);
+	NET_PUT_INT(node->sent);
+
+	if (net_coap_send(&node->coap, worker->buffer, FRAME_MAXLEN,
+	                  dataoffset, payloadlen) != NET_STATUS_OK) {
+		/* The link is full, the message is sent again in the next round */
+		return;
+	}
+	node->sent++;
+	node->sent_us = now;
+	node->waiting = true;
+}
+
+static void node_answer(struct worker *worker, const uint8_t *frame, uint16_t len)
+{
+	struct node *node;
+	uint32_t index;
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+	uint64_t now;
+	int8_t err;
+
+	/* The node is found from the destination MAC address */
+	index = ((uint32_t) frame[2] << 24) | ((uint32_t) frame[3] << 16) |
+	        ((uint32_t) frame[4] << 8) | frame[5];
+	if ((len < IP6_POS) || (index < worker->first) ||
+	    (index >= worker->first + worker->nodecnt)) {
+		return;
+	}
+	node = &nodes[index];
+
+	worker->rx_data = frame;
+	worker->rx_len = len;
+	err = net_coap_recv(&node->coap, worker->buffer, FRAME_MAXLEN, &dataoffset, &datalen);
+	worker->rx_len = 0;
+
+	if (!node->waiting ||
+	    ((err != NET_STATUS_OK) && (err != NET_COAP_STATUS_ACK))) {
+		return;
+	}
+
+	now = now_us();
+	worker->latencies[worker->answered++] = now - node->sent_us;
+	node->waiting = false;
+	node->next_us = node->sent_us + interval_us;
+}
+
+static void *worker_run(void *arg)
+{
+	struct worker *worker = arg;
+	struct node *node;
+	const uint8_t *data;
+	uint8_t frame[FRAME_MAXLEN];
+	uint32_t remaining;
+	uint32_t i;
+	uint64_t now;
+	ssize_t len;
+	bool idle;
+
+	do {
+		idle = true;
+		remaining = 0;
+		now = now_us();
+
+		for (i=0; i<worker->nodecnt; i++) {
+			node = &worker->nodes[i];
+			if (node->waiting && (now - node->sent_us >= timeout_us)) {
+				node->waiting = false;
+				node->next_us = now;
+				worker->timeouts++;
+			}
+			if (!node->waiting && (node->sent < count) && (now >= node->next_us)) {
+				node_post(worker, node, now);
+				idle = false;
+			}
+			if (node->waiting || (node->sent < count)) {
+				remaining++;
+			}
+		}
+
+		for (i=0; i<RX_BURST; i++) {
+			if (udp_link) {
+				len = recv(worker->fd, frame, sizeof(frame), 0);
+				if (len <= 0) {
+					break;
+				}
+				node_answer(worker, frame, len);
+			} else {
+				len = ring_peek(worker->down, &data);
+				if (len == 0) {
+					break;
+				}
+				node_answer(worker, data, len);
+				ring_release(worker->down);
+			}
+			idle = false;
+		}
+
+		if (idle) {
+			sched_yield();
+		}
+	} while (remaining > 0);
+
+	return NULL;
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *) a;
+	uint32_t y = *(const uint32_t *) b;
+
+	return (x > y) - (x < y);
+}
+
+static void report(double elapsed)
+{
+	uint32_t *latencies;
+	uint32_t answered = 0;
+	uint32_t timeouts = 0;
+	uint32_t tx_drops = 0;
+	uint32_t n = 0;
+	uint32_t i;
+
+	for (i=0; i<workercnt; i++) {
+		answered += workers[i].answered;
+		timeouts += workers[i].timeouts;
+		tx_drops += workers[i].tx_drops;
+	}
+
+	latencies = malloc((answered + 1) * sizeof(uint32_t));
+	for (i=0; i<workercnt; i++) {
+		memcpy(&latencies[n], workers[i].latencies, workers[i].answered * sizeof(uint32_t));
+		n += workers[i].answered;
+	}
+	qsort(latencies, n, sizeof(uint32_t), compare_u32);
+
+	printf("%u nodes on %u workers, %s link, %s messages\n", nodecnt, workercnt,
+	       udp_link ? "udp" : "shm", confirmable ? "confirmable" : "non-confirmable");
+	printf("%u answered in %.3f s, %.0f messages/s, %u timeouts, %u sends retried\n",
+	       answered, elapsed, answered / elapsed, timeouts, tx_drops);
+	if (n > 0) {
+		printf("latency us: min %u p50 %u p90 %u p99 %u max %u\n", latencies[0],
+		       latencies[n / 2], latencies[(uint64_t) n * 90 / 100],
+		       latencies[(uint64_t) n * 99 / 100], latencies[n - 1]);
+	}
+
+	free(latencies);
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-n nodes] [-w workers] [-m messages] [-i interval_ms]\n"
+	                "       [-t timeout_ms] [-s payload] [-c] [-u [-p port] [-x|-S]]\n", name);
+}
+
+int main(int argc, char *argv[])
+{
+	pthread_t server;
+	bool external = false;
+	bool serve = false;
+	int server_fd = -1;
+	uint64_t start;
+	uint32_t first;
+	uint32_t i, j;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:w:m:i:t:s:cup:xS")) != -1) {
+		switch (opt) {
+		case 'n':
+			nodecnt = strtoul(optarg, NULL, 0);
+			break;
+		case 'w':
+			workercnt = strtoul(optarg, NULL, 0);
+			break;
+		case 'm':
+			count = strtoul(optarg, NULL, 0);
+			break;
+		case 'i':
+			interval_us = strtoul(optarg, NULL, 0) * 1000;
+			break;
+		case 't':
+			timeout_us = strtoul(optarg, NULL, 0) * 1000;
+			break;
+		case 's':
+			payloadlen = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			confirmable = true;
+			break;
+		case 'u':
+			udp_link = true;
+			break;
+		case 'p':
+			udp_port = strtoul(optarg, NULL, 0);
+			break;
+		case 'x':
+			external = true;
+			break;
+		case 'S':
+			serve = true;
+			break;
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+	if ((nodecnt == 0) || (workercnt == 0) || (workercnt > nodecnt) ||
+	    (payloadlen < 4) || (payloadlen > 1024) || ((external || serve) && !udp_link)) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	if (udp_link && !external) {
+		server_fd = udp_socket(udp_port, true);
+		if (server_fd < 0) {
+			perror("server");
+			return 1;
+		}
+	}
+	if (serve) {
+		/* Stand-in server alone, until killed */
+		server_run_udp(&server_fd);
+		return 0;
+	}
+
+	workers = calloc(workercnt, sizeof(struct worker));
+	nodes = calloc(nodecnt, sizeof(struct node));
+	if ((workers == NULL) || (nodes == NULL)) {
+		perror("fleet");
+		return 1;
+	}
+
+	/* Contiguous blocks of nodes per worker, starts spread over an interval */
+	first = 0;
+	for (i=0; i<workercnt; i++) {
+		workers[i].nodes = &nodes[first];
+		workers[i].first = first;
+		workers[i].nodecnt = nodecnt / workercnt + ((i < nodecnt % workercnt) ? 1 : 0);
+		workers[i].latencies = calloc((uint64_t) workers[i].nodecnt * count + 1, sizeof(uint32_t));
+		if (udp_link) {
+			workers[i].fd = udp_socket(udp_port, false);
+		} else {
+			workers[i].up = calloc(1, sizeof(struct ring));
+			workers[i].down = calloc(1, sizeof(struct ring));
+		}
+		if ((workers[i].latencies == NULL) || (udp_link && (workers[i].fd < 0)) ||
+		    (!udp_link && ((workers[i].up == NULL) || (workers[i].down == NULL)))) {
+			perror("worker");
+			return 1;
+		}
+		for (j=0; j<workers[i].nodecnt; j++) {
+			node_init(&nodes[first + j], first + j, &workers[i]);
+		}
+		first += workers[i].nodecnt;
+	}
+
+	start = now_us();
+	for (i=0; i<nodecnt; i++) {
+		nodes[i].next_us = start + (uint64_t) interval_us * i / nodecnt;
+	}
+
+	if (!external) {
+		pthread_create(&server, NULL, udp_link ? server_run_udp : server_run_shm, &server_fd);
+	}
+	for (i=0; i<workercnt; i++) {
+		pthread_create(&workers[i].thread, NULL, worker_run, &workers[i]);
+	}
+	for (i=0; i<workercnt; i++) {
+		pthread_join(workers[i].thread, NULL);
+	}
+	atomic_store(&stop, true);
+	if (!external) {
+		pthread_join(server, NULL);
+	}
+
+	report((now_us() - start) / 1e6);
+
+	return 0;
+}
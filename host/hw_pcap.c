@@ -0,0 +1,203 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "config.h"
+#include "platform.h"
+#include "hw_pcap.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+#define PCAP_MAGIC_USEC     0xA1B2C3D4
+#define PCAP_MAGIC_NSEC     0xA1B23C4D
+#define PCAP_LINKTYPE_ETH   1
+#define PCAP_HDRSIZE        24
+#define PCAP_RECHDRSIZE     16
+#define PCAP_SNAPLEN        65535
+
+
+static uint32_t _hw_pcap_get32(struct hw_pcap_ctx *pcap, size_t pos)
+{
+	uint32_t value;
+
+	memcpy(&value, &pcap->map[pos], sizeof(value));
+	return pcap->swapped ? __builtin_bswap32(value) : value;
+}
+
+/* clock_us() wraps after 71 minutes, longer than some captures */
+static uint64_t _hw_pcap_now_us(struct hw_pcap_ctx *pcap)
+{
+	uint32_t now = clock_us();
+
+	if (now < pcap->clock_last) {
+		pcap->clock_high++;
+	}
+	pcap->clock_last = now;
+
+	return ((uint64_t) pcap->clock_high << 32) | now;
+}
+
+static int _hw_pcap_write(int fd, const void *data, size_t len)
+{
+	return (write(fd, data, len) == (ssize_t) len) ? 0 : -1;
+}
+
+int hw_pcap_open(struct hw_pcap_ctx *pcap, const char *in, const char *out, bool paced)
+{
+	uint32_t header[PCAP_HDRSIZE / 4] = {
+		PCAP_MAGIC_USEC, 0x00040002, 0, 0, PCAP_SNAPLEN, PCAP_LINKTYPE_ETH
+	};
+	struct stat st;
+	uint32_t magic;
+	int fd;
+
+	memset(pcap, 0, sizeof(*pcap));
+	pcap->out_fd = -1;
+	pcap->paced = paced;
+
+	fd = open(in, O_RDONLY);
+	if (fd < 0) {
+		return -1;
+	}
+	if ((fstat(fd, &st) < 0) || (st.st_size < PCAP_HDRSIZE)) {
+		close(fd);
+		errno = EINVAL;
+		return -1;
+	}
+	pcap->maplen = st.st_size;
+	pcap->map = mmap(NULL, pcap->maplen, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (pcap->map == MAP_FAILED) {
+		pcap->map = NULL;
+		return -1;
+	}
+	madvise((void *) pcap->map, pcap->maplen, MADV_SEQUENTIAL);
+
+	/* The magic tells the byte order and the timestamp resolution */
+	memcpy(&magic, pcap->map, sizeof(magic));
+	if ((magic == PCAP_MAGIC_USEC) || (magic == PCAP_MAGIC_NSEC)) {
+		pcap->swapped = false;
+	} else if ((__builtin_bswap32(magic) == PCAP_MAGIC_USEC) ||
+	           (__builtin_bswap32(magic) == PCAP_MAGIC_NSEC)) {
+		pcap->swapped = true;
+		magic = __builtin_bswap32(magic);
+	} else {
+		hw_pcap_close(pcap);
+		errno = EINVAL;
+		return -1;
+	}
+	pcap->nsec = (magic == PCAP_MAGIC_NSEC);
+
+	if ((_hw_pcap_get32(pcap, 20) & 0xFFFF) != PCAP_LINKTYPE_ETH) {
+		hw_pcap_close(pcap);
+		errno = EINVAL;
+		return -1;
+	}
+	pcap->pos = PCAP_HDRSIZE;
+
+	if (out != NULL) {
+		pcap->out_fd = open(out, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if ((pcap->out_fd < 0) || (_hw_pcap_write(pcap->out_fd, header, sizeof(header)) < 0)) {
+			hw_pcap_close(pcap);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+void hw_pcap_close(struct hw_pcap_ctx *pcap)
+{
+	if (pcap->map != NULL) {
+		munmap((void *) pcap->map, pcap->maplen);
+		pcap->map = NULL;
+	}
+	if (pcap->out_fd >= 0) {
+		close(pcap->out_fd);
+		pcap->out_fd = -1;
+	}
+}
+
+bool hw_pcap_eof(struct hw_pcap_ctx *pcap)
+{
+	return (pcap->map == NULL) || (pcap->pos + PCAP_RECHDRSIZE > pcap->maplen);
+}
+
+uint16_t hw_pcap_recv(struct hw_pcap_ctx *pcap, uint8_t *buffer, uint16_t buflen)
+{
+	uint64_t ts_us;
+	uint32_t caplen;
+	size_t pos;
+
+	while (!hw_pcap_eof(pcap)) {
+		pos = pcap->pos;
+		ts_us = (uint64_t) _hw_pcap_get32(pcap, pos) * 1000000ULL +
+		        _hw_pcap_get32(pcap, pos + 4) / (pcap->nsec ? 1000 : 1);
+		caplen = _hw_pcap_get32(pcap, pos + 8);
+
+		if (pos + PCAP_RECHDRSIZE + caplen > pcap->maplen) {
+			/* Truncated file */
+			pcap->pos = pcap->maplen;
+			return 0;
+		}
+
+		if (!pcap->started) {
+			pcap->first_ts_us = ts_us;
+			pcap->start_us = _hw_pcap_now_us(pcap);
+			pcap->started = true;
+		} else if (pcap->paced &&
+		           (_hw_pcap_now_us(pcap) - pcap->start_us < ts_us - pcap->first_ts_us)) {
+			/* Not yet */
+			return 0;
+		}
+
+		pcap->pos = pos + PCAP_RECHDRSIZE + caplen;
+		pcap->last_ts_us = ts_us;
+
+		if (caplen > buflen) {
+			pcap->oversized++;
+			continue;
+		}
+
+		memcpy(buffer, &pcap->map[pos + PCAP_RECHDRSIZE], caplen);
+		pcap->frames_in++;
+		return caplen;
+	}
+
+	return 0;
+}
+
+uint16_t hw_pcap_send(struct hw_pcap_ctx *pcap, uint8_t *buffer, uint16_t buflen)
+{
+	uint32_t header[PCAP_RECHDRSIZE / 4];
+	uint64_t ts_us = pcap->last_ts_us;
+
+	pcap->frames_out++;
+	if (pcap->out_fd < 0) {
+		return buflen;
+	}
+
+	/* Replies follow the frame they answer, on the timeline of the input */
+	if (pcap->paced) {
+		ts_us = pcap->first_ts_us + (_hw_pcap_now_us(pcap) - pcap->start_us);
+	}
+	header[0] = ts_us / 1000000ULL;
+	header[1] = ts_us % 1000000ULL;
+	header[2] = buflen;
+	header[3] = buflen;
+
+	if ((_hw_pcap_write(pcap->out_fd, header, sizeof(header)) < 0) ||
+	    (_hw_pcap_write(pcap->out_fd, buffer, buflen) < 0)) {
+		return 0;
+	}
+
+	return buflen;
+}
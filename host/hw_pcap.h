@@ -0,0 +1,68 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _HW_PCAP_H
+#define _HW_PCAP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Link driver replaying a pcap file, selected with NET_LINK_PCAP.
+ *
+ * Received frames are read from a memory-mapped pcap file (Ethernet,
+ * microsecond or nanosecond timestamps, either byte order), at full speed or
+ * paced to their original timestamps: a frame whose time has not come yet is
+ * not received. Sent frames are appended to an output pcap, when given,
+ * timestamped on the timeline of the input file.
+ *
+ * Frames larger than the buffer of the caller are skipped and counted.
+ */
+
+struct hw_pcap_ctx {
+	const uint8_t *map;
+	size_t maplen;
+	size_t pos;
+	bool swapped;        /* Input file of the other byte order */
+	bool nsec;           /* Input timestamps in nanoseconds */
+	bool paced;
+	bool started;
+	int out_fd;
+
+	uint64_t last_ts_us; /* Timestamp of the last received frame */
+	uint64_t first_ts_us;
+	uint64_t start_us;   /* clock_us() at the first frame, extended */
+	uint32_t clock_last;
+	uint32_t clock_high;
+
+	uint32_t frames_in;
+	uint32_t frames_out;
+	uint32_t oversized;
+};
+
+/* Returns 0, or -1 with errno set. out may be NULL */
+extern int hw_pcap_open(struct hw_pcap_ctx *pcap, const char *in, const char *out,
+                        bool paced);
+extern void hw_pcap_close(struct hw_pcap_ctx *pcap);
+/* All the frames of the input file have been received */
+extern bool hw_pcap_eof(struct hw_pcap_ctx *pcap);
+
+extern uint16_t hw_pcap_recv(struct hw_pcap_ctx *pcap,
+                             uint8_t *buffer, uint16_t buflen);
+extern uint16_t hw_pcap_send(struct hw_pcap_ctx *pcap,
+                             uint8_t *buffer, uint16_t buflen);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,274 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "config.h"
+#include "platform.h"
+#include "hw_vhub.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+#define HW_VHUB_MAGIC       0x76687562  /* "vhub" */
+
+#define PORT_FREE           0
+#define PORT_CLAIMED        1
+#define PORT_READY          2
+
+#define IS_MULTICAST(l2addr) ((l2addr)[0] & 0x01)
+
+/* Time comparisons survive the wrap of clock_us() */
+#define TIME_BEFORE(a, b)   ((int32_t) ((a) - (b)) < 0)
+
+
+static struct hw_vhub *_hw_vhub_map(int fd)
+{
+	struct hw_vhub *hub;
+
+	hub = mmap(NULL, sizeof(struct hw_vhub), PROT_READ | PROT_WRITE,
+	           (fd < 0) ? (MAP_SHARED | MAP_ANONYMOUS) : MAP_SHARED, fd, 0);
+
+	return (hub == MAP_FAILED) ? NULL : hub;
+}
+
+struct hw_vhub *hw_vhub_create(const char *name)
+{
+	struct hw_vhub *hub;
+	int fd = -1;
+
+	if (name != NULL) {
+		fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+		if (fd < 0) {
+			return NULL;
+		}
+		if (ftruncate(fd, sizeof(struct hw_vhub)) < 0) {
+			close(fd);
+			shm_unlink(name);
+			return NULL;
+		}
+	}
+
+	/* The memory is zeroed: every port is free and every ring is empty */
+	hub = _hw_vhub_map(fd);
+	if (fd >= 0) {
+		close(fd);
+	}
+	if (hub == NULL) {
+		return NULL;
+	}
+	hub->size = sizeof(struct hw_vhub);
+	hub->magic = HW_VHUB_MAGIC;
+
+	return hub;
+}
+
+struct hw_vhub *hw_vhub_open(const char *name)
+{
+	struct hw_vhub *hub;
+	int fd;
+
+	fd = shm_open(name, O_RDWR, 0);
+	if (fd < 0) {
+		return NULL;
+	}
+	hub = _hw_vhub_map(fd);
+	close(fd);
+	if (hub == NULL) {
+		return NULL;
+	}
+
+	/* Another build may have other sizes */
+	if ((hub->magic != HW_VHUB_MAGIC) || (hub->size != sizeof(struct hw_vhub))) {
+		hw_vhub_unmap(hub);
+		errno = EINVAL;
+		return NULL;
+	}
+
+	return hub;
+}
+
+void hw_vhub_unmap(struct hw_vhub *hub)
+{
+	munmap(hub, sizeof(struct hw_vhub));
+}
+
+void hw_vhub_unlink(const char *name)
+{
+	shm_unlink(name);
+}
+
+int hw_vhub_attach(struct hw_vhub_ctx *vhub, struct hw_vhub *hub, uint8_t port,
+                   const uint8_t *l2addr)
+{
+	struct hw_vhub_port *p;
+	uint8_t state = PORT_FREE;
+	uint8_t from;
+
+	if (port >= HW_VHUB_PORTS) {
+		return -1;
+	}
+	p = &hub->ports[port];
+	if (!atomic_compare_exchange_strong(&p->attached, &state, PORT_CLAIMED)) {
+		return -1;
+	}
+
+	/* Frames left by a previous owner of the port are discarded */
+	for (from=0; from<HW_VHUB_PORTS; from++) {
+		atomic_store(&hub->rings[from][port].tail, atomic_load(&hub->rings[from][port].head));
+	}
+
+	memcpy(p->l2addr, l2addr, sizeof(p->l2addr));
+	p->latency_us = 0;
+	p->loss = 0;
+	p->bandwidth = 0;
+	p->busy_until_us = clock_us();
+	p->random = 2654435761UL * (port + 1);
+	p->tx_frames = p->rx_frames = 0;
+	p->lost = p->overflows = p->unknown = 0;
+	atomic_store(&p->attached, PORT_READY);
+
+	vhub->hub = hub;
+	vhub->port = port;
+	vhub->next = 0;
+
+	return 0;
+}
+
+void hw_vhub_detach(struct hw_vhub_ctx *vhub)
+{
+	atomic_store(&vhub->hub->ports[vhub->port].attached, PORT_FREE);
+}
+
+void hw_vhub_set_link(struct hw_vhub_ctx *vhub, uint32_t latency_us, uint16_t loss,
+                      uint32_t bandwidth)
+{
+	struct hw_vhub_port *p = &vhub->hub->ports[vhub->port];
+
+	p->latency_us = latency_us;
+	p->loss = loss;
+	p->bandwidth = bandwidth;
+}
+
+struct hw_vhub_port *hw_vhub_get_port(struct hw_vhub_ctx *vhub)
+{
+	return &vhub->hub->ports[vhub->port];
+}
+
+uint16_t hw_vhub_recv(struct hw_vhub_ctx *vhub, uint8_t *buffer, uint16_t buflen)
+{
+	struct hw_vhub_ring *ring;
+	struct hw_vhub_slot *slot;
+	uint32_t now = clock_us();
+	uint32_t tail;
+	uint16_t len;
+	uint8_t from;
+	uint8_t i;
+
+	for (i=0; i<HW_VHUB_PORTS; i++) {
+		from = (vhub->next + i) % HW_VHUB_PORTS;
+		ring = &vhub->hub->rings[from][vhub->port];
+
+		tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+		if (tail == atomic_load_explicit(&ring->head, memory_order_acquire)) {
+			continue;
+		}
+
+		slot = &ring->slots[tail % HW_VHUB_SLOTS];
+		if (TIME_BEFORE(now, slot->deliver_us)) {
+			/* Frames of a ring are delivered in order */
+			continue;
+		}
+
+		len = slot->len;
+		if (len <= buflen) {
+			memcpy(buffer, slot->data, len);
+		}
+		atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+
+		vhub->next = (from + 1) % HW_VHUB_PORTS;
+		if (len > buflen) {
+			continue;
+		}
+		vhub->hub->ports[vhub->port].rx_frames++;
+		return len;
+	}
+
+	return 0;
+}
+
+static void _hw_vhub_forward(struct hw_vhub_ctx *vhub, uint8_t to, uint32_t deliver_us,
+                             const uint8_t *buffer, uint16_t buflen)
+{
+	struct hw_vhub_ring *ring = &vhub->hub->rings[vhub->port][to];
+	struct hw_vhub_slot *slot;
+	uint32_t head;
+
+	head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	if (head - atomic_load_explicit(&ring->tail, memory_order_acquire) >= HW_VHUB_SLOTS) {
+		vhub->hub->ports[vhub->port].overflows++;
+		return;
+	}
+
+	slot = &ring->slots[head % HW_VHUB_SLOTS];
+	slot->deliver_us = deliver_us;
+	slot->len = buflen;
+	memcpy(slot->data, buffer, buflen);
+	atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+uint16_t hw_vhub_send(struct hw_vhub_ctx *vhub, uint8_t *buffer, uint16_t buflen)
+{
+	struct hw_vhub *hub = vhub->hub;
+	struct hw_vhub_port *p = &hub->ports[vhub->port];
+	uint32_t now = clock_us();
+	uint32_t deliver_us;
+	uint8_t to;
+	bool found = false;
+
+	if ((buflen < 6) || (buflen > HW_VHUB_FRAME_MAXLEN)) {
+		return 0;
+	}
+	p->tx_frames++;
+
+	/* Serialization at the bandwidth of the link, after the previous frame */
+	deliver_us = now;
+	if (TIME_BEFORE(now, p->busy_until_us)) {
+		deliver_us = p->busy_until_us;
+	}
+	if (p->bandwidth > 0) {
+		deliver_us += (uint32_t) (((uint64_t) buflen * 8 * 1000000ULL) / p->bandwidth);
+	}
+	p->busy_until_us = deliver_us;
+	deliver_us += p->latency_us;
+
+	/* xorshift32, the loss is decided once for all the destinations */
+	p->random ^= p->random << 13;
+	p->random ^= p->random >> 17;
+	p->random ^= p->random << 5;
+	if ((p->random >> 16) < p->loss) {
+		p->lost++;
+		return buflen;
+	}
+
+	for (to=0; to<HW_VHUB_PORTS; to++) {
+		if ((to == vhub->port) ||
+		    (atomic_load_explicit(&hub->ports[to].attached, memory_order_acquire) != PORT_READY)) {
+			continue;
+		}
+		if (IS_MULTICAST(buffer) || (memcmp(buffer, hub->ports[to].l2addr, 6) == 0)) {
+			_hw_vhub_forward(vhub, to, deliver_us, buffer, buflen);
+			found = true;
+		}
+	}
+	if (!found && !IS_MULTICAST(buffer)) {
+		p->unknown++;
+	}
+
+	return buflen;
+}
@@ -0,0 +1,116 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _HW_VHUB_H
+#define _HW_VHUB_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/**
+ * Link driver to a virtual Ethernet hub in shared memory, selected with
+ * NET_LINK_VHUB.
+ *
+ * A hub has HW_VHUB_PORTS ports, each attached to one stack with its MAC
+ * address, by threads of a process or by processes mapping the same named
+ * hub. Every pair of ports is connected by a single-producer single-consumer
+ * ring of HW_VHUB_SLOTS frames, so that sending and receiving are lock-free.
+ *
+ * A sent frame is forwarded to the port of its destination MAC address, or
+ * to every other port for multicast (33:33:xx, ff:ff:...). Unknown unicast
+ * destinations are dropped. The link of each port can delay its frames
+ * (latency, bandwidth) and lose a share of them; frames are received once
+ * their delivery time, read with clock_us(), is reached.
+ */
+
+#ifndef HW_VHUB_PORTS
+#define HW_VHUB_PORTS 16
+#endif
+#ifndef HW_VHUB_SLOTS
+#define HW_VHUB_SLOTS 8  /* Power of 2 */
+#endif
+#define HW_VHUB_FRAME_MAXLEN 1514
+
+struct hw_vhub_slot {
+	uint32_t deliver_us;
+	uint16_t len;
+	uint8_t data[HW_VHUB_FRAME_MAXLEN];
+};
+
+struct hw_vhub_ring {
+	_Atomic uint32_t head;  /* Written by the sender only */
+	_Atomic uint32_t tail;  /* Written by the receiver only */
+	struct hw_vhub_slot slots[HW_VHUB_SLOTS];
+};
+
+struct hw_vhub_port {
+	_Atomic uint8_t attached;
+	uint8_t l2addr[6];
+
+	/* Link of the port, for the frames it sends */
+	uint32_t latency_us;
+	uint16_t loss;          /* Per 65536 */
+	uint32_t bandwidth;     /* Bits per second, 0 for no limit */
+	uint32_t busy_until_us; /* End of the transmission of the last frame */
+	uint32_t random;
+
+	/* Counters, written by the owner of the port */
+	uint32_t tx_frames;
+	uint32_t rx_frames;
+	uint32_t lost;          /* By the loss model */
+	uint32_t overflows;     /* Ring of a destination full */
+	uint32_t unknown;       /* Unicast destination not attached */
+};
+
+struct hw_vhub {
+	uint32_t magic;
+	uint32_t size;
+	struct hw_vhub_port ports[HW_VHUB_PORTS];
+	struct hw_vhub_ring rings[HW_VHUB_PORTS][HW_VHUB_PORTS];  /* [from][to] */
+};
+
+struct hw_vhub_ctx {
+	struct hw_vhub *hub;
+	uint8_t port;
+	uint8_t next;  /* Ring polled first, for fairness */
+};
+
+/**
+ * Create a hub, shared by name (shm_open) or, when name is NULL, in anonymous
+ * shared memory (threads, and processes forked afterwards). Returns NULL with
+ * errno set on failure.
+ */
+extern struct hw_vhub *hw_vhub_create(const char *name);
+/* Map a hub created by another process */
+extern struct hw_vhub *hw_vhub_open(const char *name);
+extern void hw_vhub_unmap(struct hw_vhub *hub);
+extern void hw_vhub_unlink(const char *name);
+
+/* Returns 0, or -1 if the port is out of range or already attached */
+extern int hw_vhub_attach(struct hw_vhub_ctx *vhub, struct hw_vhub *hub,
+                          uint8_t port, const uint8_t *l2addr);
+extern void hw_vhub_detach(struct hw_vhub_ctx *vhub);
+/* Link of the port: latency, loss per 65536 frames, bits per second */
+extern void hw_vhub_set_link(struct hw_vhub_ctx *vhub, uint32_t latency_us,
+                             uint16_t loss, uint32_t bandwidth);
+extern struct hw_vhub_port *hw_vhub_get_port(struct hw_vhub_ctx *vhub);
+
+extern uint16_t hw_vhub_recv(struct hw_vhub_ctx *vhub,
+                             uint8_t *buffer, uint16_t buflen);
+extern uint16_t hw_vhub_send(struct hw_vhub_ctx *vhub,
+                             uint8_t *buffer, uint16_t buflen);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,1932 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/**
+ * In-process loopback harness.
+ *
+ * Two full stacks are connected back-to-back through hw_stub callbacks: the
+ * client is the stack of tests.c, the peer is a second stack playing the role
+ * of tester.py. Every scenario of tests.c is run deterministically (msleep is
+ * virtual), then round trips are timed at each layer of the stack.
+ *
+ * With -T, the trace ring (NET_TRACE_ENABLE) is emptied into a file after
+ * each scenario and round trip, for host/trace_decode.py.
+ *
+ * With -P, the frames of both stacks (NET_TAP_ENABLE) are captured into a
+ * pcapng file: each frame appears twice, sent by a stack then received by
+ * the other, timestamped with the virtual clock.
+ *
+ * Must be built with -DNET_LINK_STUB.
+ */
+
+#include "config.h"
+#include "platform.h"
+#include "platform_posix.h"
+#include "net_utils.h"
+#include "net_tap.h"
+#include "net_trace.h"
+#include "tap_pcapng.h"
+#include "tests.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef NET_LINK_STUB
+#error "The loopback harness must be built with NET_LINK_STUB"
+#endif
+
+#define FRAME_MAXLEN  1514
+#define QUEUE_LEN     8
+
+#define ETH_POS   0
+#define IP6_POS   14
+#define L4_POS    54
+
+
+struct frame {
+	uint8_t data[FRAME_MAXLEN];
+	uint16_t len;
+};
+
+struct frame_queue {
+	struct frame frames[QUEUE_LEN];
+	uint8_t head;
+	uint8_t tail;
+};
+
+struct scenario {
+	uint8_t id;
+	void (*before)(void);    /* Frames sent by the peer before the test */
+	void (*reply)(void);     /* Called when the client waits for a frame */
+	void (*after)(void);     /* Checks of the frames sent by the client */
+	const char *xfail;       /* Reason of a known failure */
+};
+
+
+/* Client stack, from tests.c */
+extern struct hw_stub_ctx hw;
+extern struct net_mac_ctx mac;
+extern struct net_lowpan_ctx lowpan;
+extern struct net_ip6_ctx ip6;
+extern struct net_udp_ctx udp;
+extern struct net_coap_ctx coap;
+extern uint8_t buffer[1514];
+extern uint8_t src_addr[16];
+extern uint8_t dst_addr[16];
+extern uint8_t src_l2addr[6];
+extern uint8_t dst_l2addr[6];
+
+/* Peer stack */
+static struct hw_stub_ctx peer_hw;
+static struct net_mac_ctx peer_mac = { .lower = &peer_hw };
+#ifdef NET_LOWPAN_ENABLE
+static struct net_lowpan_ctx peer_lowpan = { .lower = &peer_hw };
+static struct net_ip6_ctx peer_ip6 = { .lower = &peer_lowpan };
+/* Scenario of the IPv6 contexts, their frames being compressed rather than of the MAC ones */
+static bool client_lowpan = false;
+#else
+static struct net_ip6_ctx peer_ip6 = { .lower = &peer_mac };
+#endif
+static struct net_udp_ctx peer_udp = { .lower = &peer_ip6 };
+static struct net_coap_ctx peer_coap = { .lower = &peer_udp };
+static uint8_t peer_buffer[FRAME_MAXLEN];
+
+static struct frame_queue client_to_peer;
+static struct frame_queue peer_to_client;
+
+static const struct scenario *current = NULL;
+static uint8_t peer_verdict = VERDICT_OK;
+static uint64_t virtual_ms = 0;
+static FILE *trace_file = NULL;
+static int capture_fd = -1;
+
+
+/*
+ * Link
+ */
+
+static bool queue_push(struct frame_queue *queue, const uint8_t *data, uint16_t len)
+{
+	struct frame *frame;
+
+	if ((uint8_t) (queue->head - queue->tail) >= QUEUE_LEN) {
+		return false;
+	}
+
+	frame = &queue->frames[queue->head % QUEUE_LEN];
+	memcpy(frame->data, data, len);
+	frame->len = len;
+	queue->head++;
+
+	return true;
+}
+
+static struct frame *queue_peek(struct frame_queue *queue)
+{
+	if (queue->head == queue->tail) {
+		return NULL;
+	}
+	return &queue->frames[queue->tail % QUEUE_LEN];
+}
+
+static struct frame *queue_last(struct frame_queue *queue)
+{
+	return &queue->frames[(uint8_t) (queue->head - 1) % QUEUE_LEN];
+}
+
+static uint16_t queue_pop(struct frame_queue *queue, uint8_t *data, uint16_t len)
+{
+	struct frame *frame = queue_peek(queue);
+
+	if ((frame == NULL) || (frame->len > len)) {
+		return 0;
+	}
+
+	memcpy(data, frame->data, frame->len);
+	queue->tail++;
+
+	return frame->len;
+}
+
+static uint16_t client_recv(struct hw_stub_ctx *stub, uint8_t *data, uint16_t len)
+{
+	/* Let the peer react to what the client sent so far */
+	if ((queue_peek(&peer_to_client) == NULL) && (current != NULL) &&
+	    (current->reply != NULL)) {
+		current->reply();
+	}
+	return queue_pop(&peer_to_client, data, len);
+}
+
+static uint16_t client_send(struct hw_stub_ctx *stub, uint8_t *data, uint16_t len)
+{
+	return queue_push(&client_to_peer, data, len) ? len : 0;
+}
+
+static uint16_t peer_recv(struct hw_stub_ctx *stub, uint8_t *data, uint16_t len)
+{
+	return queue_pop(&client_to_peer, data, len);
+}
+
+static uint16_t peer_send(struct hw_stub_ctx *stub, uint8_t *data, uint16_t len)
+{
+	return queue_push(&peer_to_client, data, len) ? len : 0;
+}
+
+static void virtual_sleep(struct clock_posix_source *source, uint16_t time_ms)
+{
+	virtual_ms += time_ms;
+}
+
+static struct clock_posix_source virtual_clock = {
+	.sleep = virtual_sleep,
+};
+
+
+/*
+ * Peer: frame building
+ */
+
+static const uint8_t l2_allnodes[6] = {0x33, 0x33, 0x00, 0x00, 0x00, 0x01};
+static const uint8_t l2_solnode[6] = {0x33, 0x33, 0xff, 0x0d, 0x00, 0x0c};
+static const uint8_t l2_baddst[6] = {0x10, 0x22, 0x33, 0x44, 0x55, 0x60};
+static const uint8_t l2_foreign[6] = {0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff};
+
+static const uint8_t addr_unspec[16] = {0};
+static const uint8_t addr_allnodes[16] = {0xff,0x02,0,0,0,0,0,0,0,0,0,0,0,0,0,0x01};
+static const uint8_t addr_solnode[16] = {0xff,0x02,0,0,0,0,0,0,0,0,0,0x01,0xff,0x0d,0x00,0x0c};
+static const uint8_t addr_peer_ll[16] = {0xfe,0x80,0,0,0,0,0,0,0,0x0a,0,0x0b,0,0x0c,0,0x0d};
+static const uint8_t addr_client_ll[16] = {0xfe,0x80,0,0,0,0,0,0,0,0x0f,0,0x0e,0,0x0d,0,0x0c};
+static const uint8_t addr_badsrc[16] = {0x20,0x01,0,0x01,0,0x02,0,0x03,0,0x0d,0,0x0c,0,0x0b,0,0x0a};
+static const uint8_t addr_baddst[16] = {0x20,0x01,0,0x01,0,0x02,0,0x03,0,0x0c,0,0x0d,0,0x0e,0,0x0f};
+static const uint8_t addr_peer2[16] = {0x20,0x01,0,0x01,0,0x02,0,0x03,0,0x0a,0,0x0b,0,0x0c,0,0x0e};
+
+/* Addresses of the autoconfiguration, by the router of 2001:db8:1:2::/64 */
+#ifdef NET_IP6_AUTOCONF_ENABLE
+static const uint8_t l2_allrouters[6] = {0x33, 0x33, 0x00, 0x00, 0x00, 0x02};
+static const uint8_t addr_allrouters[16] = {0xff,0x02,0,0,0,0,0,0,0,0,0,0,0,0,0,0x02};
+static const uint8_t addr_eui64_ll[16] = {0xfe,0x80,0,0,0,0,0,0,0x12,0x22,0x33,0xff,0xfe,0x44,0x55,0x66};
+static const uint8_t addr_eui64[16] = {0x20,0x01,0x0d,0xb8,0,0x01,0,0x02,0x12,0x22,0x33,0xff,0xfe,0x44,0x55,0x66};
+#ifdef NET_IP6_NC_ENABLE
+static const uint8_t addr_offlink[16] = {0x20,0x01,0x0d,0xb8,0xff,0xff,0,0,0,0,0,0,0,0,0,0x01};
+#endif
+#endif
+
+/* Solicited-node addresses of the peers, resolved by the client */
+#ifdef NET_IP6_NC_ENABLE
+static const uint8_t l2_solnode_peer[6] = {0x33, 0x33, 0xff, 0x0c, 0x00, 0x0d};
+static const uint8_t addr_solnode_peer[16] = {0xff,0x02,0,0,0,0,0,0,0,0,0,0x01,0xff,0x0c,0x00,0x0d};
+static const uint8_t l2_solnode_peer2[6] = {0x33, 0x33, 0xff, 0x0c, 0x00, 0x0e};
+static const uint8_t addr_solnode_peer2[16] = {0xff,0x02,0,0,0,0,0,0,0,0,0,0x01,0xff,0x0c,0x00,0x0e};
+#endif
+
+static void peer_send_eth(const uint8_t *l2dst, uint16_t ethertype,
+                     const void *payload, uint16_t len)
+{
+	uint16_t dataoffset;
+
+	net_mac_set_source_addr(&peer_mac, dst_l2addr);
+	net_mac_set_destination_addr(&peer_mac, (uint8_t *) l2dst);
+	net_mac_set_ethertype(&peer_mac, ethertype);
+
+	dataoffset = net_mac_pload_pos(&peer_mac);
+	memcpy(&peer_buffer[dataoffset], payload, len);
+	net_mac_send(&peer_mac, peer_buffer, sizeof(peer_buffer), dataoffset, len);
+}
+
+static void peer_setup_ip6(const uint8_t *l2dst, const uint8_t *src,
+                           const uint8_t *dst, uint8_t nh)
+{
+	net_mac_set_source_addr(&peer_mac, dst_l2addr);
+	net_mac_set_destination_addr(&peer_mac, (uint8_t *) l2dst);
+	net_mac_set_ethertype(&peer_mac, NET_MAC_ETHERTYPE_IPV6);
+
+	net_ip6_set_source_addr(&peer_ip6, (uint8_t *) src);
+	net_ip6_set_destination_addr(&peer_ip6, (uint8_t *) dst);
+	net_ip6_set_nexthdr(&peer_ip6, nh);
+}
+
+static void peer_send_ip6(const uint8_t *l2dst, const uint8_t *src, const uint8_t *dst,
+                     uint8_t nh, const void *payload, uint16_t len)
+{
+	uint16_t dataoffset;
+
+	peer_setup_ip6(l2dst, src, dst, nh);
+
+	dataoffset = net_ip6_pload_pos(&peer_ip6);
+	memcpy(&peer_buffer[dataoffset], payload, len);
+	net_ip6_send(&peer_ip6, peer_buffer, sizeof(peer_buffer), dataoffset, len);
+}
+
+static uint16_t l4_cksum(const uint8_t *src, const uint8_t *dst, uint8_t nh,
+                         const uint8_t *l4, uint16_t len)
+{
+	uint8_t pseudo[4] = {(len & 0xFF00) >> 8, len & 0x00FF, 0x00, nh};
+	uint16_t sum = 0;
+
+	sum = _net_cksum_sum(sum, (uint8_t *) src, 16);
+	sum = _net_cksum_sum(sum, (uint8_t *) dst, 16);
+	sum = _net_cksum_sum(sum, pseudo, 4);
+	sum = _net_cksum_sum(sum, (uint8_t *) l4, len);
+
+	return _net_cksum_finalize(sum);
+}
+
+static void peer_send_ns(const uint8_t *l2dst, const uint8_t *src, const uint8_t *dst,
+                    const uint8_t *tgt, const uint8_t *sllao)
+{
+	uint8_t ns[32] = {135, 0, 0, 0, 0, 0, 0, 0};
+	uint16_t sum;
+
+	memcpy(&ns[8], tgt, 16);
+	ns[24] = 1;
+	ns[25] = 1;
+	memcpy(&ns[26], sllao, 6);
+
+	sum = l4_cksum(src, dst, NET_IP6_NH_ICMPV6, ns, sizeof(ns));
+	ns[2] = (sum & 0xFF00) >> 8;
+	ns[3] = sum & 0x00FF;
+
+	peer_send_ip6(l2dst, src, dst, NET_IP6_NH_ICMPV6, ns, sizeof(ns));
+}
+
+/* Advertisements of the peer, for the neighbor cache or the detection */
+#if defined(NET_IP6_NC_ENABLE) || defined(NET_IP6_DAD_ENABLE)
+static void peer_send_na(const uint8_t *l2dst, const uint8_t *src, const uint8_t *dst,
+                         const uint8_t *tgt, uint8_t flags, const uint8_t *tllao)
+{
+	uint8_t na[32] = {136, 0, 0, 0, flags, 0, 0, 0};
+	uint16_t sum;
+
+	memcpy(&na[8], tgt, 16);
+	na[24] = 2;
+	na[25] = 1;
+	memcpy(&na[26], tllao, 6);
+
+	sum = l4_cksum(src, dst, NET_IP6_NH_ICMPV6, na, sizeof(na));
+	na[2] = (sum & 0xFF00) >> 8;
+	na[3] = sum & 0x00FF;
+
+	peer_send_ip6(l2dst, src, dst, NET_IP6_NH_ICMPV6, na, sizeof(na));
+}
+#endif
+
+#ifdef NET_IP6_AUTOCONF_ENABLE
+/* Router Advertisement of 2001:db8:1:2::/64, with a MTU of 1400 */
+static void peer_send_ra(const uint8_t *l2dst, const uint8_t *src, const uint8_t *dst)
+{
+	uint8_t ra[64] = {134, 0, 0, 0, 64, 0, 0x07, 0x08};
+	uint16_t sum;
+
+	/* Source link-layer address */
+	ra[16] = 1;
+	ra[17] = 1;
+	memcpy(&ra[18], dst_l2addr, 6);
+	/* MTU */
+	ra[24] = 5;
+	ra[25] = 1;
+	ra[30] = 0x05;
+	ra[31] = 0x78;
+	/* Prefix information, on-link and autonomous, valid 1 day, preferred 4 hours */
+	ra[32] = 3;
+	ra[33] = 4;
+	ra[34] = 64;
+	ra[35] = 0xc0;
+	ra[37] = 0x01;
+	ra[38] = 0x51;
+	ra[39] = 0x80;
+	ra[42] = 0x38;
+	ra[43] = 0x40;
+	memcpy(&ra[48], addr_eui64, 8);
+
+	sum = l4_cksum(src, dst, NET_IP6_NH_ICMPV6, ra, sizeof(ra));
+	ra[2] = (sum & 0xFF00) >> 8;
+	ra[3] = sum & 0x00FF;
+
+	peer_send_ip6(l2dst, src, dst, NET_IP6_NH_ICMPV6, ra, sizeof(ra));
+}
+#endif
+
+static void peer_send_udp_from(const uint8_t *src, uint16_t sport, uint16_t dport,
+                               const void *payload, uint16_t len)
+{
+	uint16_t dataoffset;
+
+	peer_setup_ip6(src_l2addr, src, src_addr, NET_IP6_NH_UDP);
+	net_udp_set_source_port(&peer_udp, sport);
+	net_udp_set_destination_port(&peer_udp, dport);
+	net_udp_connect(&peer_udp);
+
+	dataoffset = net_udp_pload_pos(&peer_udp);
+	memcpy(&peer_buffer[dataoffset], payload, len);
+	net_udp_send(&peer_udp, peer_buffer, sizeof(peer_buffer), dataoffset, len);
+}
+
+static void peer_send_udp(uint16_t sport, uint16_t dport,
+                              const void *payload, uint16_t len)
+{
+	peer_send_udp_from(dst_addr, sport, dport, payload, len);
+}
+
+static void peer_send_coap(uint8_t type, uint8_t code, uint16_t msgid, uint8_t token)
+{
+	uint8_t msg[5] = {
+		(NET_COAP_VERSION << 6) | (type << 4) | 1,
+		code, (msgid & 0xFF00) >> 8, msgid & 0x00FF, token
+	};
+
+	peer_send_udp(5683, 1234, msg, sizeof(msg));
+}
+
+#ifdef NET_LOWPAN_ENABLE
+/* Frames of the peer decompressed as by the client, for their elided fields */
+static struct frame *unpack_frame = NULL;
+
+static uint16_t unpack_recv(struct hw_stub_ctx *stub, uint8_t *data, uint16_t len)
+{
+	if ((unpack_frame == NULL) || (unpack_frame->len > len)) {
+		return 0;
+	}
+	memcpy(data, unpack_frame->data, unpack_frame->len);
+	return unpack_frame->len;
+}
+
+static struct hw_stub_ctx unpack_hw = { .recv_cback = unpack_recv };
+static struct net_lowpan_ctx unpack_lowpan = { .lower = &unpack_hw };
+#endif
+
+/* Overwrite a 16 bits field of the last frame sent by the peer, at its Ethernet offset */
+static void peer_patch_short(uint16_t pos, uint16_t value)
+{
+	struct frame *frame = queue_last(&peer_to_client);
+#ifdef NET_LOWPAN_ENABLE
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+
+	/* Lengths being elided by the compression, the packet is sent uncompressed */
+	if (client_lowpan) {
+		net_lowpan_set_source_addr(&unpack_lowpan, src_l2addr);
+		net_lowpan_set_destination_addr(&unpack_lowpan, dst_l2addr);
+		net_lowpan_set_context(&unpack_lowpan, src_addr);
+		unpack_frame = frame;
+		net_lowpan_recv(&unpack_lowpan, &peer_buffer[IP6_POS], sizeof(peer_buffer) - IP6_POS,
+		                &dataoffset, &datalen);
+		unpack_frame = NULL;
+
+		/* After the dispatch of the uncompressed IPv6 header */
+		peer_buffer[IP6_POS - 1] = 0x41;
+		memcpy(frame->data, &peer_buffer[IP6_POS - 1], 1 + datalen);
+		frame->len = 1 + datalen;
+		pos -= IP6_POS - 1;
+	}
+#endif
+
+	frame->data[pos] = (value & 0xFF00) >> 8;
+	frame->data[pos+1] = value & 0x00FF;
+}
+
+/* Frame of another layer than the MAC one, such as 6LoWPAN, sent as is */
+static void peer_send_raw(const uint8_t *data, uint16_t len)
+{
+	queue_push(&peer_to_client, data, len);
+}
+
+/*
+ * Peer: frame checking
+ */
+
+#define PEER_CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			peer_verdict = VERDICT_NOK; \
+			fprintf(stderr, "  peer check failed: %s\n", #cond); \
+			return NULL; \
+		} \
+	} while (0)
+
+#define GET_SHORT(data, pos) \
+	((uint16_t) (((data)[pos] << 8) | (data)[(pos)+1]))
+
+static struct frame received;
+
+/* Destination MAC address of the frames of the client, dst_l2addr unless resolved */
+static const uint8_t *client_l2dst = NULL;
+
+static struct frame *peer_expect(uint16_t ethertype)
+{
+#ifdef NET_LOWPAN_ENABLE
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+
+	/* Decompressed after the room of the Ethernet header, of no address to check */
+	if (client_lowpan) {
+		PEER_CHECK(ethertype == NET_MAC_ETHERTYPE_IPV6);
+		PEER_CHECK(net_lowpan_recv(&peer_lowpan, &received.data[IP6_POS], FRAME_MAXLEN - IP6_POS,
+		                           &dataoffset, &datalen) == NET_STATUS_OK);
+		received.len = IP6_POS + datalen;
+		return &received;
+	}
+#endif
+
+	received.len = queue_pop(&client_to_peer, received.data, FRAME_MAXLEN);
+
+	PEER_CHECK(received.len >= IP6_POS);
+	PEER_CHECK(memcmp(&received.data[ETH_POS], client_l2dst, 6) == 0);
+	PEER_CHECK(memcmp(&received.data[ETH_POS+6], src_l2addr, 6) == 0);
+	PEER_CHECK(GET_SHORT(received.data, ETH_POS+12) == ethertype);
+
+	return &received;
+}
+
+static struct frame *peer_expect_ip6(const uint8_t *src, const uint8_t *dst,
+                                     uint8_t nh, uint16_t plen)
+{
+	struct frame *frame = peer_expect(NET_MAC_ETHERTYPE_IPV6);
+	uint8_t *data;
+
+	if (frame == NULL) {
+		return NULL;
+	}
+	data = frame->data;
+
+	PEER_CHECK(frame->len >= L4_POS + plen);
+	PEER_CHECK((data[IP6_POS] >> 4) == 6);
+	PEER_CHECK(GET_SHORT(data, IP6_POS+4) == plen);
+	PEER_CHECK(data[IP6_POS+6] == nh);
+	PEER_CHECK((src == NULL) || (memcmp(&data[IP6_POS+8], src, 16) == 0));
+	PEER_CHECK(memcmp(&data[IP6_POS+24], dst, 16) == 0);
+
+	return frame;
+}
+
+static void peer_expect_na_flags(const uint8_t *dst, const uint8_t *tgt, uint8_t flags)
+{
+	struct frame *frame = peer_expect_ip6(NULL, dst, NET_IP6_NH_ICMPV6, 32);
+	uint8_t *na;
+
+	if (frame == NULL) {
+		return;
+	}
+	na = &frame->data[L4_POS];
+
+	if ((na[0] != 136) || (na[1] != 0) || (na[4] != flags) ||
+	    (na[5] != 0) || (na[6] != 0) || (na[7] != 0) ||
+	    (memcmp(&na[8], tgt, 16) != 0) ||
+	    (na[24] != 2) || (na[25] != 1) ||
+	    (memcmp(&na[26], src_l2addr, 6) != 0) ||
+	    (l4_cksum(&frame->data[IP6_POS+8], dst, NET_IP6_NH_ICMPV6, na, 32) != 0)) {
+		peer_verdict = VERDICT_NOK;
+	}
+}
+
+/* Solicited and overriding */
+static void peer_expect_na(const uint8_t *dst, const uint8_t *tgt)
+{
+	peer_expect_na_flags(dst, tgt, 0x60);
+}
+
+static void peer_expect_nothing(void)
+{
+	if (queue_peek(&client_to_peer) != NULL) {
+		peer_verdict = VERDICT_NOK;
+	}
+}
+
+static void peer_expect_raw(const uint8_t *data, uint16_t len)
+{
+	received.len = queue_pop(&client_to_peer, received.data, FRAME_MAXLEN);
+
+	if ((received.len != len) || (memcmp(received.data, data, len) != 0)) {
+		peer_verdict = VERDICT_NOK;
+	}
+}
+
+static struct frame *peer_expect_udp_to(const uint8_t *dst, uint16_t sport, uint16_t dport,
+                                        uint16_t len)
+{
+	struct frame *frame = peer_expect_ip6(src_addr, dst, NET_IP6_NH_UDP, len);
+
+	if (frame == NULL) {
+		return NULL;
+	}
+
+	PEER_CHECK(GET_SHORT(frame->data, L4_POS) == sport);
+	PEER_CHECK(GET_SHORT(frame->data, L4_POS+2) == dport);
+	PEER_CHECK(GET_SHORT(frame->data, L4_POS+4) == len);
+	PEER_CHECK(l4_cksum(src_addr, dst, NET_IP6_NH_UDP,
+	                    &frame->data[L4_POS], len) == 0);
+
+	return frame;
+}
+
+static struct frame *peer_expect_udp(uint16_t sport, uint16_t dport, uint16_t len)
+{
+	return peer_expect_udp_to(dst_addr, sport, dport, len);
+}
+
+/* Returns the message ID, payload is NULL when there is no payload marker */
+static int32_t peer_expect_coap(uint16_t udplen, uint8_t type, uint8_t token,
+                                const char *payload)
+{
+	struct frame *frame;
+	uint8_t *msg;
+	uint16_t len;
+	uint16_t pos;
+	uint16_t optlen;
+
+	frame = peer_expect_ip6(src_addr, dst_addr, NET_IP6_NH_UDP, udplen);
+	if ((frame == NULL) || (GET_SHORT(frame->data, L4_POS+4) != udplen)) {
+		peer_verdict = VERDICT_NOK;
+		return -1;
+	}
+
+	msg = &frame->data[L4_POS+8];
+	len = udplen - 8;
+
+	if ((len < 5) || (msg[0] != ((NET_COAP_VERSION << 6) | (type << 4) | 1)) ||
+	    (msg[1] != NET_COAP_CODE_POST) || (msg[4] != token)) {
+		peer_verdict = VERDICT_NOK;
+		return -1;
+	}
+
+	/* Skip options up to the payload marker */
+	pos = 5;
+	while ((pos < len) && (msg[pos] != 0xFF)) {
+		optlen = msg[pos] & 0x0F;
+		pos += 1 + (((msg[pos] & 0xF0) == 0xD0) ? 1 : 0);
+		if (optlen == 13) {
+			optlen = msg[pos] + 13;
+			pos += 1;
+		}
+		pos += optlen;
+	}
+
+	if (payload == NULL) {
+		if (pos != len) {
+			peer_verdict = VERDICT_NOK;
+		}
+	} else if ((pos + 1 + strlen(payload) != len) ||
+	           (memcmp(&msg[pos+1], payload, strlen(payload)) != 0)) {
+		peer_verdict = VERDICT_NOK;
+	}
+
+	return GET_SHORT(msg, 2);
+}
+
+
+/*
+ * Scenarios (see tester.py)
+ */
+
+static void test_mac_recv_nodata(void) { peer_send_eth(src_l2addr, NET_MAC_ETHERTYPE_LB, "", 0); }
+static void test_mac_recv_data_ucast(void) { peer_send_eth(src_l2addr, NET_MAC_ETHERTYPE_LB, "test", 4); }
+static void test_mac_recv_data_mcast(void) { peer_send_eth(l2_allnodes, NET_MAC_ETHERTYPE_LB, "test", 4); }
+static void test_mac_recv_badethtype(void) { peer_send_eth(src_l2addr, 0x0800, "test", 4); }
+static void test_mac_recv_baddst(void) { peer_send_eth(l2_baddst, 0x0800, "test", 4); }
+
+static void test_mac_send_nodata(void)
+{
+	struct frame *frame = peer_expect(NET_MAC_ETHERTYPE_LB);
+
+	if ((frame == NULL) || (frame->len != IP6_POS)) {
+		peer_verdict = VERDICT_NOK;
+	}
+}
+
+static void test_mac_send_data(void)
+{
+	struct frame *frame = peer_expect(NET_MAC_ETHERTYPE_LB);
+
+	if ((frame == NULL) || (frame->len != IP6_POS + 4) ||
+	    (memcmp(&frame->data[IP6_POS], "test", 4) != 0)) {
+		peer_verdict = VERDICT_NOK;
+	}
+}
+
+static void test_ip6_recv_nodata(void) { peer_send_ip6(src_l2addr, dst_addr, src_addr, 59, "", 0); }
+static void test_ip6_recv_data(void) { peer_send_ip6(src_l2addr, dst_addr, src_addr, 253, "test", 4); }
+static void test_ip6_recv_badnh(void) { peer_send_ip6(src_l2addr, dst_addr, src_addr, 6, "", 0); }
+static void test_ip6_recv_badsrc(void) { peer_send_ip6(src_l2addr, addr_badsrc, src_addr, 59, "", 0); }
+static void test_ip6_recv_baddst(void) { peer_send_ip6(src_l2addr, dst_addr, addr_baddst, 59, "", 0); }
+
+static void test_ip6_recv_badlen(void)
+{
+	peer_send_ip6(src_l2addr, dst_addr, addr_baddst, 253, "test", 4);
+	peer_patch_short(IP6_POS+4, 1550);
+}
+
+static void test_ip6_send_nodata(void)
+{
+	peer_expect_ip6(src_addr, dst_addr, NET_IP6_NH_NONXT, 0);
+}
+
+static void test_ip6_send_data(void)
+{
+	struct frame *frame = peer_expect_ip6(src_addr, dst_addr, 253, 4);
+
+	if ((frame == NULL) || (memcmp(&frame->data[L4_POS], "test", 4) != 0)) {
+		peer_verdict = VERDICT_NOK;
+	}
+}
+
+static void test_ip6_icmpv6_nsna_recv_uc(void)
+{
+	peer_send_ns(l2_allnodes, dst_addr, src_addr, src_addr, dst_l2addr);
+}
+
+static void test_ip6_icmpv6_nsna_check_uc(void)
+{
+	peer_expect_na(dst_addr, src_addr);
+}
+
+static void test_ip6_icmpv6_nsna_recv_lla(void)
+{
+	peer_send_ns(l2_allnodes, addr_peer_ll, addr_client_ll, addr_client_ll, dst_l2addr);
+}
+
+static void test_ip6_icmpv6_nsna_check_lla(void)
+{
+	peer_expect_na(addr_peer_ll, addr_client_ll);
+}
+
+static void test_ip6_icmpv6_nsna_recv_mcsn(void)
+{
+	peer_send_ns(l2_solnode, addr_peer_ll, addr_solnode, src_addr, dst_l2addr);
+}
+
+static void test_ip6_icmpv6_nsna_check_mcsn(void)
+{
+	peer_expect_na(addr_peer_ll, src_addr);
+}
+
+static void test_ip6_icmpv6_nsna_recv_dad(void)
+{
+	peer_send_ns(l2_allnodes, addr_unspec, src_addr, src_addr, dst_l2addr);
+}
+
+static void test_ip6_icmpv6_nsna_check_dad(void)
+{
+	/* To all nodes, not solicited (RFC 4861 7.2.4) */
+	client_l2dst = l2_allnodes;
+	peer_expect_na_flags(addr_allnodes, src_addr, 0x20);
+	client_l2dst = dst_l2addr;
+}
+
+static void test_ip6_icmpv6_nsna_recv_badtgt(void)
+{
+	peer_send_ns(l2_allnodes, addr_peer_ll, addr_allnodes, addr_baddst, l2_foreign);
+}
+
+#ifdef NET_IP6_NC_ENABLE
+/*
+ * Resolution of the peer: its Neighbor Solicitation is answered, then the
+ * packet is expected to its MAC address. Another neighbor then solicits the
+ * client, which must answer it and send to it without a resolution.
+ */
+static uint8_t nc_phase;
+
+static void test_ip6_icmpv6_nc_init(void)
+{
+	nc_phase = 0;
+}
+
+static void test_ip6_icmpv6_nc_resolve(void)
+{
+	struct frame *frame;
+	uint8_t *ns;
+
+	if (queue_peek(&client_to_peer) == NULL) {
+		return;
+	}
+
+	if (nc_phase == 0) {
+		client_l2dst = l2_solnode_peer;
+		frame = peer_expect_ip6(addr_client_ll, addr_solnode_peer, NET_IP6_NH_ICMPV6, 32);
+		client_l2dst = dst_l2addr;
+		if (frame == NULL) {
+			return;
+		}
+		ns = &frame->data[L4_POS];
+		if ((ns[0] != 135) || (ns[1] != 0) ||
+		    (memcmp(&ns[8], dst_addr, 16) != 0) ||
+		    (ns[24] != 1) || (ns[25] != 1) ||
+		    (memcmp(&ns[26], src_l2addr, 6) != 0) ||
+		    (l4_cksum(addr_client_ll, addr_solnode_peer, NET_IP6_NH_ICMPV6, ns, 32) != 0)) {
+			peer_verdict = VERDICT_NOK;
+			return;
+		}
+		peer_send_na(src_l2addr, dst_addr, addr_client_ll, dst_addr, 0x60, dst_l2addr);
+
+	} else if (nc_phase == 1) {
+		test_ip6_send_data();
+		peer_send_ns(src_l2addr, addr_badsrc, src_addr, src_addr, l2_foreign);
+	}
+	nc_phase++;
+}
+
+static void test_ip6_icmpv6_nc_check(void)
+{
+	struct frame *frame;
+
+	client_l2dst = l2_foreign;
+	peer_expect_na(addr_badsrc, src_addr);
+	frame = peer_expect_ip6(src_addr, addr_badsrc, 253, 4);
+	if ((frame == NULL) || (memcmp(&frame->data[L4_POS], "test", 4) != 0)) {
+		peer_verdict = VERDICT_NOK;
+	}
+	peer_expect_nothing();
+}
+#endif
+
+#ifdef NET_IP6_AUTOCONF_ENABLE
+/* Router Solicitation of the client, answered by an advertisement to all nodes */
+static void test_ip6_icmpv6_ra_reply(void)
+{
+	struct frame *frame;
+	uint8_t *rs;
+
+	if (queue_peek(&client_to_peer) == NULL) {
+		return;
+	}
+
+	client_l2dst = l2_allrouters;
+	frame = peer_expect_ip6(addr_eui64_ll, addr_allrouters, NET_IP6_NH_ICMPV6, 16);
+	client_l2dst = dst_l2addr;
+	if (frame == NULL) {
+		return;
+	}
+	rs = &frame->data[L4_POS];
+	if ((frame->data[IP6_POS+7] != 255) || (rs[0] != 133) || (rs[1] != 0) ||
+	    (rs[8] != 1) || (rs[9] != 1) || (memcmp(&rs[10], src_l2addr, 6) != 0) ||
+	    (l4_cksum(addr_eui64_ll, addr_allrouters, NET_IP6_NH_ICMPV6, rs, 16) != 0)) {
+		peer_verdict = VERDICT_NOK;
+		return;
+	}
+	peer_send_ra(l2_allnodes, addr_peer_ll, addr_allnodes);
+}
+
+#ifdef NET_IP6_NC_ENABLE
+static void test_ip6_icmpv6_ra_check(void)
+{
+	struct frame *frame = peer_expect_ip6(addr_eui64, addr_offlink, 253, 4);
+
+	if ((frame == NULL) || (memcmp(&frame->data[L4_POS], "test", 4) != 0)) {
+		peer_verdict = VERDICT_NOK;
+	}
+	peer_expect_nothing();
+}
+#endif
+
+/* Datagram of a context connected before the advertisement, from the global address */
+static void test_ip6_icmpv6_ra_udp_check(void)
+{
+	struct frame *frame = peer_expect_ip6(addr_eui64, dst_addr, NET_IP6_NH_UDP, 12);
+
+	if ((frame == NULL) ||
+	    (GET_SHORT(frame->data, L4_POS) != 1234) ||
+	    (GET_SHORT(frame->data, L4_POS+2) != 5678) ||
+	    (l4_cksum(addr_eui64, dst_addr, NET_IP6_NH_UDP, &frame->data[L4_POS], 12) != 0) ||
+	    (memcmp(&frame->data[L4_POS+8], "test", 4) != 0)) {
+		peer_verdict = VERDICT_NOK;
+	}
+	peer_expect_nothing();
+}
+#endif
+
+#ifdef NET_IP6_DAD_ENABLE
+/*
+ * Detection of the client address: solicitation from the unspecified address,
+ * announcement not overriding (optimistic), then the packet without waiting.
+ * The peer then claims the address.
+ */
+static void test_ip6_icmpv6_dad_reply(void)
+{
+	struct frame *frame;
+	uint8_t *icmp;
+
+	if (queue_peek(&client_to_peer) == NULL) {
+		return;
+	}
+
+	client_l2dst = l2_solnode;
+	frame = peer_expect_ip6(addr_unspec, addr_solnode, NET_IP6_NH_ICMPV6, 24);
+	if (frame == NULL) {
+		client_l2dst = dst_l2addr;
+		return;
+	}
+	icmp = &frame->data[L4_POS];
+	if ((icmp[0] != 135) || (memcmp(&icmp[8], src_addr, 16) != 0) ||
+	    (frame->len != L4_POS + 24) ||
+	    (l4_cksum(addr_unspec, addr_solnode, NET_IP6_NH_ICMPV6, icmp, 24) != 0)) {
+		peer_verdict = VERDICT_NOK;
+	}
+
+	client_l2dst = l2_allnodes;
+	frame = peer_expect_ip6(addr_client_ll, addr_allnodes, NET_IP6_NH_ICMPV6, 32);
+	client_l2dst = dst_l2addr;
+	if (frame == NULL) {
+		return;
+	}
+	icmp = &frame->data[L4_POS];
+	if ((icmp[0] != 136) || (icmp[4] != 0x00) ||
+	    (memcmp(&icmp[8], src_addr, 16) != 0) ||
+	    (icmp[24] != 2) || (memcmp(&icmp[26], src_l2addr, 6) != 0) ||
+	    (l4_cksum(addr_client_ll, addr_allnodes, NET_IP6_NH_ICMPV6, icmp, 32) != 0)) {
+		peer_verdict = VERDICT_NOK;
+	}
+
+	test_ip6_send_data();
+	peer_send_na(l2_allnodes, addr_peer_ll, addr_allnodes, src_addr, 0x20, dst_l2addr);
+}
+#endif
+
+#ifdef NET_IP6_NC_ENABLE
+/*
+ * Unreachability detection of the peer, announced beforehand: the first
+ * datagram is answered, which confirms the peer, after two datagrams of
+ * another address and another port which do not. The last one, once the
+ * confirmation has expired, comes with a unicast probe, then answered.
+ */
+static uint8_t nud_phase;
+
+static void test_ip6_icmpv6_nud_init(void)
+{
+	nud_phase = 0;
+	peer_send_na(l2_allnodes, dst_addr, addr_allnodes, dst_addr, 0x20, dst_l2addr);
+}
+
+static void test_ip6_icmpv6_nud_reply(void)
+{
+	struct frame *frame;
+	uint8_t *ns;
+
+	if (queue_peek(&client_to_peer) == NULL) {
+		return;
+	}
+
+	if (nud_phase == 0) {
+		peer_expect_udp(1234, 5678, 12);
+		peer_send_udp_from(addr_peer2, 5678, 1234, "no", 2);
+		peer_send_udp(5679, 1234, "no", 2);
+		peer_send_udp(5678, 1234, "ok", 2);
+
+	} else if (nud_phase == 1) {
+		peer_expect_udp(1234, 5678, 12);
+		frame = peer_expect_ip6(addr_client_ll, dst_addr, NET_IP6_NH_ICMPV6, 32);
+		if (frame == NULL) {
+			return;
+		}
+		ns = &frame->data[L4_POS];
+		if ((ns[0] != 135) || (memcmp(&ns[8], dst_addr, 16) != 0) ||
+		    (ns[24] != 1) || (memcmp(&ns[26], src_l2addr, 6) != 0) ||
+		    (l4_cksum(addr_client_ll, dst_addr, NET_IP6_NH_ICMPV6, ns, 32) != 0)) {
+			peer_verdict = VERDICT_NOK;
+			return;
+		}
+		peer_expect_udp(1234, 5678, 12);
+		peer_send_na(src_l2addr, dst_addr, addr_client_ll, dst_addr, 0x60, dst_l2addr);
+	}
+	nud_phase++;
+}
+#endif
+
+#ifdef NET_IP6_RATELIMIT_ENABLE
+/*
+ * Flood of solicitations: NET_IP6_ICMPV6_BURST are answered, the others
+ * dropped. Sent in two rounds, the queue being shorter than the burst.
+ */
+static uint8_t ratelimit_answered;
+
+static void peer_send_ns_flood(uint8_t count)
+{
+	uint8_t i;
+
+	for (i=0; i<count; i++) {
+		peer_send_ns(l2_allnodes, dst_addr, src_addr, src_addr, dst_l2addr);
+	}
+}
+
+static void test_ip6_icmpv6_ratelimit_init(void)
+{
+	ratelimit_answered = 0;
+	peer_send_ns_flood(6);
+}
+
+static void test_ip6_icmpv6_ratelimit_reply(void)
+{
+	while (queue_peek(&client_to_peer) != NULL) {
+		peer_expect_na(dst_addr, src_addr);
+		ratelimit_answered++;
+		if (ratelimit_answered == 6) {
+			peer_send_ns_flood(4);
+		}
+	}
+}
+
+static void test_ip6_icmpv6_ratelimit_check(void)
+{
+	test_ip6_icmpv6_ratelimit_reply();
+	if (ratelimit_answered != NET_IP6_ICMPV6_BURST) {
+		peer_verdict = VERDICT_NOK;
+	}
+}
+#endif
+
+/*
+ * Echo Requests to the global and link-local addresses, answered from the
+ * address they were sent to, of the same identifier, sequence and data
+ */
+static void peer_send_echo(const uint8_t *src, const uint8_t *dst, uint16_t seq)
+{
+	uint8_t echo[24] = {128, 0, 0, 0, 0x12, 0x34, (seq & 0xFF00) >> 8, seq & 0x00FF};
+	uint16_t sum;
+
+	memcpy(&echo[8], "abcdefghijklmnop", 16);
+
+	sum = l4_cksum(src, dst, NET_IP6_NH_ICMPV6, echo, sizeof(echo));
+	echo[2] = (sum & 0xFF00) >> 8;
+	echo[3] = sum & 0x00FF;
+
+	peer_send_ip6(src_l2addr, src, dst, NET_IP6_NH_ICMPV6, echo, sizeof(echo));
+}
+
+/* Echo Reply of the client, from its IPv6 header */
+static void peer_check_echo(const uint8_t *ip6hdr, const uint8_t *src, const uint8_t *dst,
+                            uint16_t seq)
+{
+	const uint8_t *echo = &ip6hdr[40];
+
+	if ((echo[0] != 129) || (echo[1] != 0) ||
+	    (echo[4] != 0x12) || (echo[5] != 0x34) ||
+	    (echo[6] != ((seq & 0xFF00) >> 8)) || (echo[7] != (seq & 0x00FF)) ||
+	    (memcmp(&echo[8], "abcdefghijklmnop", 16) != 0) ||
+	    (ip6hdr[7] != 255) ||
+	    (l4_cksum(src, dst, NET_IP6_NH_ICMPV6, echo, 24) != 0)) {
+		peer_verdict = VERDICT_NOK;
+	}
+}
+
+static void peer_expect_echo(const uint8_t *src, const uint8_t *dst, uint16_t seq)
+{
+	struct frame *frame = peer_expect_ip6(src, dst, NET_IP6_NH_ICMPV6, 24);
+
+	if (frame == NULL) {
+		return;
+	}
+	peer_check_echo(&frame->data[IP6_POS], src, dst, seq);
+}
+
+static void test_ip6_icmpv6_echo(void)
+{
+	peer_send_echo(dst_addr, src_addr, 1);
+	peer_send_echo(addr_peer_ll, addr_client_ll, 2);
+}
+
+static void test_ip6_icmpv6_echo_check(void)
+{
+	peer_expect_echo(src_addr, dst_addr, 1);
+	peer_expect_echo(addr_client_ll, addr_peer_ll, 2);
+	peer_expect_nothing();
+}
+
+/*
+ * 6LoWPAN frames of compressed headers, without MAC header, sent and
+ * received by the lowpan context of the client directly
+ */
+static void test_lowpan_send_udp(void)
+{
+	const uint8_t frame[] = {0x7f, 0x77, 0xf0, 0x04, 0xd2, 0x16, 0x33, 0x12, 0x34,
+	                         't', 'e', 's', 't'};
+
+	peer_expect_raw(frame, sizeof(frame));
+}
+
+static void test_lowpan_send_inline(void)
+{
+	const uint8_t frame[] = {0x7e, 0x55,
+	                         0x00, 0x0f, 0x00, 0x0e, 0x00, 0x0d, 0x00, 0x0c,
+	                         0x00, 0x0a, 0x00, 0x0b, 0x00, 0x0c, 0x00, 0x0d,
+	                         0xf3, 0x12, 0x12, 0x34, 't', 'e', 's', 't'};
+
+	peer_expect_raw(frame, sizeof(frame));
+}
+
+static void test_lowpan_send_mcast(void)
+{
+	const uint8_t frame[] = {0x7b, 0x3b, 0x3a, 0x01, 't', 'e', 's', 't'};
+
+	peer_expect_raw(frame, sizeof(frame));
+}
+
+static void test_lowpan_recv_udp(void)
+{
+	const uint8_t frame[] = {0x7f, 0x77, 0xf0, 0x16, 0x33, 0x04, 0xd2, 0x56, 0x78,
+	                         't', 'e', 's', 't'};
+
+	peer_send_raw(frame, sizeof(frame));
+}
+
+static void test_lowpan_recv_inline(void)
+{
+	const uint8_t frame[] = {0x6c, 0x29, 0x81, 0x23, 0x45, 0x20, 0x12, 0x34,
+	                         0x05, 0x00, 0x00, 0x01, 0x00, 0x03,
+	                         0xf1, 0x16, 0x33, 0xb1, 0x9a, 0xbc, 'o', 'k'};
+
+	peer_send_raw(frame, sizeof(frame));
+}
+
+static void test_lowpan_recv_bad(void)
+{
+	const uint8_t dispatch[] = {0x80, 0x00, 't', 'e', 's', 't'};
+	const uint8_t truncated[] = {0x7e, 0x55, 0x00, 0x0f, 0x00, 0x0e};
+	const uint8_t context[] = {0x7f, 0xf7, 0x00, 0xf0, 0x16, 0x33, 0x04, 0xd2, 0x56, 0x78};
+	uint8_t uncompressed[41] = {0x41, 0x60, 0x00, 0x00, 0x00, 0x00, 0x00, 59, 64};
+
+	memcpy(&uncompressed[9], dst_addr, 16);
+	memcpy(&uncompressed[25], src_addr, 16);
+
+	peer_send_raw(dispatch, sizeof(dispatch));
+	peer_send_raw(truncated, sizeof(truncated));
+	peer_send_raw(context, sizeof(context));
+	peer_send_raw(uncompressed, sizeof(uncompressed));
+}
+
+/* IPHC and UDP NHC of the frames of test_lowpan_modes(), in order */
+static const uint8_t lowpan_modes[][3] = {
+	{0x7f, 0x33, 0xf0},
+	{0x76, 0x77, 0xf1},
+	{0x6d, 0x22, 0xf2},
+	{0x64, 0x66, 0xf3},
+	{0x7b, 0x11, 0x00},
+	{0x7e, 0x55, 0xf0},
+	{0x7e, 0x00, 0xf0},
+	{0x7b, 0x4b, 0x00},
+	{0x7f, 0x3a, 0xf3},
+	{0x7f, 0x39, 0xf0},
+	{0x7f, 0x38, 0xf0},
+};
+
+static uint8_t lowpan_modes_cnt;
+
+static void test_lowpan_modes_init(void)
+{
+	lowpan_modes_cnt = 0;
+}
+
+/* Frames of the client sent back as is, once their modes checked */
+static void test_lowpan_modes_reply(void)
+{
+	const uint8_t ports_len[4] = {4, 3, 3, 1};
+	const uint8_t *modes = lowpan_modes[lowpan_modes_cnt];
+	struct frame *frame = queue_peek(&client_to_peer);
+	uint16_t nhcpos;
+
+	if (frame == NULL) {
+		return;
+	}
+	if (lowpan_modes_cnt >= sizeof(lowpan_modes)/sizeof(lowpan_modes[0])) {
+		peer_verdict = VERDICT_NOK;
+		return;
+	}
+
+	/* The UDP NHC before the ports, the checksum and the payload of 4 bytes */
+	nhcpos = frame->len - 4 - 2 - ports_len[modes[2] & 0x03] - 1;
+	if ((frame->data[0] != modes[0]) || (frame->data[1] != modes[1]) ||
+	    ((modes[2] != 0x00) && (frame->data[nhcpos] != modes[2]))) {
+		peer_verdict = VERDICT_NOK;
+	}
+
+	received.len = queue_pop(&client_to_peer, received.data, FRAME_MAXLEN);
+	peer_send_raw(received.data, received.len);
+	lowpan_modes_cnt++;
+}
+
+static void test_lowpan_modes_check(void)
+{
+	if (lowpan_modes_cnt != sizeof(lowpan_modes)/sizeof(lowpan_modes[0])) {
+		peer_verdict = VERDICT_NOK;
+	}
+	peer_expect_nothing();
+}
+
+static void test_lowpan_recv_unsupp(void)
+{
+	const uint8_t context0[] = {0x7f, 0x77, 0xf0, 0x16, 0x33, 0x04, 0xd2, 0x11, 0x11,
+	                            't', 'e', 's', 't'};
+	const uint8_t context1[] = {0x7f, 0xf7, 0x11, 0xf0, 0x16, 0x33, 0x04, 0xd2, 0x22, 0x22,
+	                            't', 'e', 's', 't'};
+	const uint8_t nocksum[] = {0x7f, 0x33, 0xf4, 0x16, 0x33, 0x04, 0xd2, 't', 'e', 's', 't'};
+	const uint8_t valid[] = {0x7f, 0x33, 0xf0, 0x16, 0x33, 0x04, 0xd2, 0x56, 0x78,
+	                         't', 'e', 's', 't'};
+
+	peer_send_raw(context0, sizeof(context0));
+	peer_send_raw(context1, sizeof(context1));
+	peer_send_raw(nocksum, sizeof(nocksum));
+	peer_send_raw(valid, sizeof(valid));
+}
+
+#ifdef NET_LOWPAN_ENABLE
+/*
+ * IPv6 over 6LoWPAN, between the stacks of the client and of the peer, each
+ * frame being compressed by one and decompressed by the other
+ */
+static void peer_setup_lowpan(void)
+{
+	net_lowpan_set_source_addr(&peer_lowpan, dst_l2addr);
+	net_lowpan_set_destination_addr(&peer_lowpan, src_l2addr);
+	net_lowpan_set_context(&peer_lowpan, src_addr);
+}
+
+/* IPv6 packet of the next frame of the client, decompressed in peer_buffer */
+static uint8_t *peer_expect_lowpan_ip6(const uint8_t *src, const uint8_t *dst,
+                                       uint8_t nh, uint16_t plen)
+{
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+	uint8_t *data;
+
+	PEER_CHECK(queue_peek(&client_to_peer) != NULL);
+	/* Compressed, of less than the 40 bytes of the IPv6 header alone */
+	PEER_CHECK(queue_peek(&client_to_peer)->len < 40 + plen);
+	PEER_CHECK(net_lowpan_recv(&peer_lowpan, peer_buffer, sizeof(peer_buffer),
+	                           &dataoffset, &datalen) == NET_STATUS_OK);
+	data = &peer_buffer[dataoffset];
+
+	PEER_CHECK(datalen == 40 + plen);
+	PEER_CHECK(GET_SHORT(data, 4) == plen);
+	PEER_CHECK(data[6] == nh);
+	PEER_CHECK(memcmp(&data[8], src, 16) == 0);
+	PEER_CHECK(memcmp(&data[24], dst, 16) == 0);
+
+	return data;
+}
+
+static uint8_t lowpan_phase;
+
+static void test_lowpan_udp_init(void)
+{
+	peer_setup_lowpan();
+	lowpan_phase = 0;
+}
+
+/* Datagram of the client, answered through the UDP context of the peer */
+static void test_lowpan_udp_reply(void)
+{
+	uint8_t *data;
+	uint16_t dataoffset;
+
+	if ((queue_peek(&client_to_peer) == NULL) || (lowpan_phase > 0)) {
+		return;
+	}
+	lowpan_phase++;
+
+	data = peer_expect_lowpan_ip6(src_addr, dst_addr, NET_IP6_NH_UDP, 12);
+	if ((data == NULL) ||
+	    (GET_SHORT(data, 40) != 1234) || (GET_SHORT(data, 42) != 5678) ||
+	    (l4_cksum(src_addr, dst_addr, NET_IP6_NH_UDP, &data[40], 12) != 0) ||
+	    (memcmp(&data[48], "test", 4) != 0)) {
+		peer_verdict = VERDICT_NOK;
+		return;
+	}
+
+	peer_setup_ip6(src_l2addr, dst_addr, src_addr, NET_IP6_NH_UDP);
+	net_udp_set_source_port(&peer_udp, 5678);
+	net_udp_set_destination_port(&peer_udp, 1234);
+	net_udp_connect(&peer_udp);
+	dataoffset = net_udp_pload_pos(&peer_udp);
+	memcpy(&peer_buffer[dataoffset], "ok", 2);
+	net_udp_send(&peer_udp, peer_buffer, sizeof(peer_buffer), dataoffset, 2);
+}
+
+static void test_lowpan_udp_check(void)
+{
+	if (lowpan_phase != 1) {
+		peer_verdict = VERDICT_NOK;
+	}
+	peer_expect_nothing();
+}
+
+static void test_lowpan_echo(void)
+{
+	peer_setup_lowpan();
+	peer_send_echo(dst_addr, src_addr, 1);
+	peer_send_echo(addr_peer_ll, addr_client_ll, 2);
+}
+
+static void test_lowpan_echo_check(void)
+{
+	uint8_t *data;
+
+	data = peer_expect_lowpan_ip6(src_addr, dst_addr, NET_IP6_NH_ICMPV6, 24);
+	if (data != NULL) {
+		peer_check_echo(data, src_addr, dst_addr, 1);
+	}
+	data = peer_expect_lowpan_ip6(addr_client_ll, addr_peer_ll, NET_IP6_NH_ICMPV6, 24);
+	if (data != NULL) {
+		peer_check_echo(data, addr_client_ll, addr_peer_ll, 2);
+	}
+	peer_expect_nothing();
+}
+#endif
+
+static void test_udp_recv_nodata(void) { peer_send_udp(5678, 1234, "", 0); }
+static void test_udp_recv_data(void) { peer_send_udp(5678, 1234, "test", 4); }
+static void test_udp_recv_badsrc(void) { peer_send_udp(5670, 1234, "test", 4); }
+static void test_udp_recv_baddst(void) { peer_send_udp(5678, 1230, "test", 4); }
+
+static void test_udp_recv_badlen(void)
+{
+	peer_send_udp(5678, 1234, "test", 4);
+	peer_patch_short(L4_POS+4, 1500);
+}
+
+static void test_udp_send_nodata(void)
+{
+	peer_expect_udp(1234, 5678, 8);
+}
+
+static void test_udp_send_data(void)
+{
+	struct frame *frame = peer_expect_udp(1234, 5678, 12);
+
+	if ((frame == NULL) || (memcmp(&frame->data[L4_POS+8], "test", 4) != 0)) {
+		peer_verdict = VERDICT_NOK;
+	}
+}
+
+static void test_udp_flows(void)
+{
+	peer_send_udp_from(addr_peer2, 5678, 1234, "b", 1);
+	peer_send_udp_from(dst_addr, 514, 1235, "c", 1);
+	peer_send_udp_from(dst_addr, 5679, 1234, "x", 1);
+	peer_send_udp_from(addr_badsrc, 5678, 1234, "w", 1);
+	peer_send_udp_from(dst_addr, 5678, 1234, "a", 1);
+	peer_send_udp_from(addr_peer2, 5678, 1234, "y", 1);
+	peer_send_udp_from(dst_addr, 5678, 1234, "z", 1);
+}
+
+#ifdef NET_IP6_NC_ENABLE
+/*
+ * Resolution of the second peer of a flow: its Neighbor Solicitation is
+ * answered, then the datagram is expected to its MAC address, and replied to.
+ */
+static uint8_t flows_phase;
+
+static void test_udp_flows_resolve_init(void)
+{
+	flows_phase = 0;
+}
+
+static void test_udp_flows_resolve_reply(void)
+{
+	struct frame *frame;
+	uint8_t *ns;
+
+	if (queue_peek(&client_to_peer) == NULL) {
+		return;
+	}
+
+	if (flows_phase == 0) {
+		client_l2dst = l2_solnode_peer2;
+		frame = peer_expect_ip6(addr_client_ll, addr_solnode_peer2, NET_IP6_NH_ICMPV6, 32);
+		client_l2dst = dst_l2addr;
+		if (frame == NULL) {
+			return;
+		}
+		ns = &frame->data[L4_POS];
+		if ((ns[0] != 135) || (memcmp(&ns[8], addr_peer2, 16) != 0) ||
+		    (l4_cksum(addr_client_ll, addr_solnode_peer2, NET_IP6_NH_ICMPV6, ns, 32) != 0)) {
+			peer_verdict = VERDICT_NOK;
+			return;
+		}
+		peer_send_na(src_l2addr, addr_peer2, addr_client_ll, addr_peer2, 0x60, l2_foreign);
+
+	} else if (flows_phase == 1) {
+		client_l2dst = l2_foreign;
+		frame = peer_expect_udp_to(addr_peer2, 1234, 5678, 12);
+		client_l2dst = dst_l2addr;
+		if ((frame == NULL) || (memcmp(&frame->data[L4_POS+8], "test", 4) != 0)) {
+			peer_verdict = VERDICT_NOK;
+			return;
+		}
+		peer_send_udp_from(addr_peer2, 5678, 1234, "ok", 2);
+	}
+	flows_phase++;
+}
+
+static void test_udp_flows_resolve_check(void)
+{
+	if (flows_phase != 2) {
+		peer_verdict = VERDICT_NOK;
+	}
+	peer_expect_nothing();
+}
+#endif
+
+static void test_udp_listen(void)
+{
+	peer_send_udp_from(dst_addr, 5678, 1234, "get1", 4);
+	peer_send_udp_from(addr_peer2, 6000, 1234, "get2", 4);
+	peer_send_udp_from(dst_addr, 5678, 1235, "get0", 4);
+	peer_send_udp_from(dst_addr, 5679, 1234, "get3", 4);
+}
+
+static void test_udp_listen_check(void)
+{
+	const uint8_t *dsts[] = {dst_addr, addr_peer2, dst_addr};
+	const uint16_t dports[] = {5678, 6000, 5679};
+	struct frame *frame;
+	uint8_t i;
+
+	for (i = 0; i < 3; i++) {
+		frame = peer_expect_udp_to(dsts[i], 1234, dports[i], 10);
+		if ((frame == NULL) || (memcmp(&frame->data[L4_POS+8], "ok", 2) != 0)) {
+			peer_verdict = VERDICT_NOK;
+		}
+	}
+	peer_expect_nothing();
+}
+
+static void test_coap_noncf_send_nodata(void)
+{
+	peer_expect_coap(13, NET_COAP_TYPE_NONCONFIRMABLE, 0x12, NULL);
+}
+
+static void test_coap_noncf_send_data(void)
+{
+	peer_expect_coap(28, NET_COAP_TYPE_NONCONFIRMABLE, 0x34, "test");
+}
+
+static void test_coap_noncf_send_data_resp(void)
+{
+	if (queue_peek(&client_to_peer) == NULL) {
+		return;
+	}
+	if (peer_expect_coap(28, NET_COAP_TYPE_NONCONFIRMABLE, 0x56, "test") >= 0) {
+		peer_send_coap(NET_COAP_TYPE_NONCONFIRMABLE, NET_COAP_CODE_CREATED, 0, 0x56);
+	}
+}
+
+static void test_coap_cf_send_nodata(void)
+{
+	int32_t msgid;
+
+	if (queue_peek(&client_to_peer) == NULL) {
+		return;
+	}
+	msgid = peer_expect_coap(23, NET_COAP_TYPE_CONFIRMABLE, 0x78, NULL);
+	if (msgid >= 0) {
+		peer_send_coap(NET_COAP_TYPE_ACKNOWLEDGE, NET_COAP_CODE_EMPTY, msgid, 0x78);
+	}
+}
+
+static void test_coap_cf_send_data(void)
+{
+	int32_t msgid;
+
+	if (queue_peek(&client_to_peer) == NULL) {
+		return;
+	}
+	msgid = peer_expect_coap(28, NET_COAP_TYPE_CONFIRMABLE, 0x9a, "test");
+	if (msgid >= 0) {
+		peer_send_coap(NET_COAP_TYPE_ACKNOWLEDGE, NET_COAP_CODE_EMPTY, msgid, 0x9a);
+	}
+}
+
+static void test_coap_cf_send_data_ackresp(void)
+{
+	int32_t msgid;
+
+	if (queue_peek(&client_to_peer) == NULL) {
+		return;
+	}
+	msgid = peer_expect_coap(28, NET_COAP_TYPE_CONFIRMABLE, 0xbc, "test");
+	if (msgid >= 0) {
+		peer_send_coap(NET_COAP_TYPE_ACKNOWLEDGE, NET_COAP_CODE_EMPTY, msgid, 0xbc);
+		peer_send_coap(NET_COAP_TYPE_CONFIRMABLE, NET_COAP_CODE_CREATED, 0, 0xbc);
+	}
+}
+
+static void test_coap_cf_send_data_piggybacked(void)
+{
+	int32_t msgid;
+
+	if (queue_peek(&client_to_peer) == NULL) {
+		return;
+	}
+	msgid = peer_expect_coap(28, NET_COAP_TYPE_CONFIRMABLE, 0xde, "test");
+	if (msgid >= 0) {
+		peer_send_coap(NET_COAP_TYPE_ACKNOWLEDGE, NET_COAP_CODE_CREATED, msgid, 0xde);
+	}
+}
+
+static void test_stats_drops(void)
+{
+	peer_send_eth(src_l2addr, 0x0800, "test", 4);
+	peer_send_ip6(src_l2addr, dst_addr, src_addr, 6, "", 0);
+	peer_send_udp(5670, 1234, "test", 4);
+	peer_send_udp(5678, 1234, "test", 4);
+}
+
+static void test_trace_check(void)
+{
+	peer_expect_udp(1234, 5678, 8);
+	peer_expect_udp(1234, 5678, 8);
+}
+
+static void test_tap_capture(void)
+{
+	peer_send_eth(src_l2addr, 0x0800, "test", 4);
+	peer_send_eth(src_l2addr, NET_MAC_ETHERTYPE_LB, "test", 4);
+}
+
+/* One frame of each kind of the load of tester.py, then the end of the load */
+static void test_load_send(void)
+{
+	const uint8_t echo[5] = {0x00, 0x00, 0x00, 0x00, 0x2a};
+	const uint8_t con[5] = {0x41, NET_COAP_CODE_POST, 0x12, 0x34, 0x9a};
+	const uint8_t non[5] = {0x51, NET_COAP_CODE_POST, 0x56, 0x78, 0x5b};
+
+	peer_send_udp(5678, 1234, echo, sizeof(echo));
+	peer_send_udp(5678, 1234, con, sizeof(con));
+	peer_send_udp(5678, 1234, non, sizeof(non));
+	peer_send_ns(l2_allnodes, dst_addr, src_addr, src_addr, dst_l2addr);
+	peer_send_udp(5678, 1234, "", 0);
+}
+
+static void test_load_check(void)
+{
+	const uint8_t echo[5] = {0x00, 0x00, 0x00, 0x00, 0x2a};
+	const uint8_t ack[4] = {0x60, NET_COAP_CODE_EMPTY, 0x12, 0x34};
+	const uint8_t resp[5] = {0x51, NET_COAP_CODE_CHANGED, 0x00, 0x00, 0x5b};
+	struct frame *frame;
+
+	frame = peer_expect_udp(1234, 5678, 8 + sizeof(echo));
+	if ((frame == NULL) || (memcmp(&frame->data[L4_POS+8], echo, sizeof(echo)) != 0)) {
+		peer_verdict = VERDICT_NOK;
+	}
+	frame = peer_expect_udp(1234, 5678, 8 + sizeof(ack));
+	if ((frame == NULL) || (memcmp(&frame->data[L4_POS+8], ack, sizeof(ack)) != 0)) {
+		peer_verdict = VERDICT_NOK;
+	}
+	frame = peer_expect_udp(1234, 5678, 8 + sizeof(resp));
+	if ((frame == NULL) || (memcmp(&frame->data[L4_POS+8], resp, sizeof(resp)) != 0)) {
+		peer_verdict = VERDICT_NOK;
+	}
+	peer_expect_na(dst_addr, src_addr);
+}
+
+/* Datagrams of three endpoints, then a datagram of no endpoint and a solicitation */
+static void test_poll_dispatch(void)
+{
+	peer_send_coap(NET_COAP_TYPE_NONCONFIRMABLE, NET_COAP_CODE_CREATED, 0, 0x56);
+	peer_send_udp_from(addr_peer2, 6000, 5684, "ping", 4);
+	peer_send_udp(514, 1235, "l1", 2);
+	peer_send_udp(514, 1235, "l2", 2);
+	peer_send_udp(514, 1235, "l3", 2);
+	peer_send_udp(514, 5685, "l0", 2);
+	peer_send_udp(514, 1235, "l4", 2);
+	peer_send_ns(l2_allnodes, dst_addr, src_addr, src_addr, dst_l2addr);
+}
+
+static void test_poll_dispatch_check(void)
+{
+	struct frame *frame;
+
+	frame = peer_expect_udp_to(addr_peer2, 5684, 6000, 10);
+	if ((frame == NULL) || (memcmp(&frame->data[L4_POS+8], "ok", 2) != 0)) {
+		peer_verdict = VERDICT_NOK;
+	}
+	peer_expect_na(dst_addr, src_addr);
+	peer_expect_nothing();
+}
+
+static const struct scenario scenarios[] = {
+	{ 0x11, test_mac_recv_nodata, NULL, NULL },
+	{ 0x12, test_mac_recv_data_ucast, NULL, NULL },
+	{ 0x13, test_mac_recv_data_mcast, NULL, NULL },
+	{ 0x14, test_mac_recv_badethtype, NULL, NULL },
+	{ 0x15, test_mac_recv_baddst, NULL, NULL },
+	{ 0x16, NULL, NULL, test_mac_send_nodata },
+	{ 0x17, NULL, NULL, test_mac_send_data },
+
+	{ 0x21, test_ip6_recv_nodata, NULL, NULL },
+	{ 0x22, test_ip6_recv_data, NULL, NULL },
+	{ 0x23, test_ip6_recv_badnh, NULL, NULL },
+	{ 0x24, test_ip6_recv_badsrc, NULL, NULL },
+	{ 0x25, test_ip6_recv_baddst, NULL, NULL },
+	{ 0x26, test_ip6_recv_badlen, NULL, NULL },
+	{ 0x27, NULL, NULL, test_ip6_send_nodata },
+	{ 0x28, NULL, NULL, test_ip6_send_data },
+
+	{ 0x31, test_ip6_icmpv6_nsna_recv_uc, NULL, test_ip6_icmpv6_nsna_check_uc },
+	{ 0x32, test_ip6_icmpv6_nsna_recv_lla, NULL, test_ip6_icmpv6_nsna_check_lla },
+	{ 0x33, test_ip6_icmpv6_nsna_recv_mcsn, NULL, test_ip6_icmpv6_nsna_check_mcsn },
+	{ 0x34, test_ip6_icmpv6_nsna_recv_dad, NULL, test_ip6_icmpv6_nsna_check_dad },
+	{ 0x35, test_ip6_icmpv6_nsna_recv_badtgt, NULL, peer_expect_nothing },
+#ifdef NET_IP6_NC_ENABLE
+	{ 0x36, test_ip6_icmpv6_nc_init, test_ip6_icmpv6_nc_resolve, test_ip6_icmpv6_nc_check },
+#endif
+#if defined(NET_IP6_NC_ENABLE) && defined(NET_IP6_AUTOCONF_ENABLE)
+	{ 0x37, NULL, test_ip6_icmpv6_ra_reply, test_ip6_icmpv6_ra_check },
+#endif
+#ifdef NET_IP6_DAD_ENABLE
+	{ 0x38, NULL, test_ip6_icmpv6_dad_reply, peer_expect_nothing },
+#endif
+#ifdef NET_IP6_NC_ENABLE
+	{ 0x39, test_ip6_icmpv6_nud_init, test_ip6_icmpv6_nud_reply, peer_expect_nothing },
+#endif
+	{ 0x3A, test_ip6_icmpv6_echo, NULL, test_ip6_icmpv6_echo_check },
+#ifdef NET_IP6_RATELIMIT_ENABLE
+	{ 0x3B, test_ip6_icmpv6_ratelimit_init, test_ip6_icmpv6_ratelimit_reply,
+	  test_ip6_icmpv6_ratelimit_check },
+#endif
+#ifdef NET_IP6_AUTOCONF_ENABLE
+	{ 0x3C, NULL, test_ip6_icmpv6_ra_reply, test_ip6_icmpv6_ra_udp_check },
+#endif
+
+	{ 0x41, NULL, NULL, test_lowpan_send_udp },
+	{ 0x42, NULL, NULL, test_lowpan_send_inline },
+	{ 0x43, NULL, NULL, test_lowpan_send_mcast },
+	{ 0x44, test_lowpan_recv_udp, NULL, NULL },
+	{ 0x45, test_lowpan_recv_inline, NULL, NULL },
+	{ 0x46, test_lowpan_recv_bad, NULL, NULL },
+#ifdef NET_LOWPAN_ENABLE
+	{ 0x47, test_lowpan_udp_init, test_lowpan_udp_reply, test_lowpan_udp_check },
+	{ 0x48, test_lowpan_echo, NULL, test_lowpan_echo_check },
+#endif
+	{ 0x49, test_lowpan_modes_init, test_lowpan_modes_reply, test_lowpan_modes_check },
+	{ 0x4A, test_lowpan_recv_unsupp, NULL, NULL },
+
+	{ 0x51, test_udp_recv_nodata, NULL, NULL },
+	{ 0x52, test_udp_recv_data, NULL, NULL },
+	{ 0x53, test_udp_recv_badsrc, NULL, NULL },
+	{ 0x54, test_udp_recv_baddst, NULL, NULL },
+	{ 0x55, test_udp_recv_badlen, NULL, NULL },
+	{ 0x56, NULL, NULL, test_udp_send_nodata },
+	{ 0x57, NULL, NULL, test_udp_send_data },
+	{ 0x58, test_udp_flows, NULL, NULL },
+	{ 0x59, test_udp_listen, NULL, test_udp_listen_check },
+#ifdef NET_IP6_NC_ENABLE
+	{ 0x5A, test_udp_flows_resolve_init, test_udp_flows_resolve_reply,
+	  test_udp_flows_resolve_check },
+#endif
+
+	{ 0x61, NULL, NULL, test_coap_noncf_send_nodata },
+	{ 0x62, NULL, NULL, test_coap_noncf_send_data },
+	{ 0x63, NULL, test_coap_noncf_send_data_resp, NULL },
+	{ 0x64, NULL, test_coap_cf_send_nodata, NULL },
+	{ 0x65, NULL, test_coap_cf_send_data, NULL },
+	{ 0x66, NULL, test_coap_cf_send_data_ackresp, NULL,
+	  "confirmable responses are not acknowledged yet" },
+	{ 0x67, NULL, test_coap_cf_send_data_piggybacked, NULL,
+	  "piggybacked responses are not supported yet" },
+
+	{ 0x71, NULL, NULL, NULL },
+	{ 0x72, test_stats_drops, NULL, NULL },
+	{ 0x73, NULL, NULL, test_trace_check },
+	{ 0x74, test_tap_capture, NULL, test_mac_send_data },
+	{ 0x75, test_load_send, NULL, test_load_check },
+	{ 0x76, test_poll_dispatch, NULL, test_poll_dispatch_check },
+};
+
+/*
+ * Trace
+ */
+
+static void trace_flush(void)
+{
+	struct net_trace_record records[32];
+	uint8_t bytes[NET_TRACE_RECORD_LEN];
+	uint8_t *cursor;
+	uint16_t cnt;
+	uint16_t i;
+
+	if (trace_file == NULL) {
+		return;
+	}
+
+	while ((cnt = net_trace_read(records, 32)) > 0) {
+		for (i=0; i<cnt; i++) {
+			NET_SET_CURSOR(bytes, 0);
+			NET_PUT_BYTE(records[i].event);
+			NET_PUT_INT(records[i].time_us);
+			NET_PUT_SHORT(records[i].len);
+			fwrite(bytes, 1, sizeof(bytes), trace_file);
+		}
+	}
+}
+
+static int run_scenarios(void)
+{
+	const struct scenario *scenario;
+	uint8_t verdict;
+	uint8_t failed = 0;
+	size_t i;
+
+	for (i=0; i<sizeof(scenarios)/sizeof(scenarios[0]); i++) {
+		scenario = &scenarios[i];
+
+#ifdef NET_LOWPAN_ENABLE
+		/* The peer of the other scenarios sends and expects Ethernet frames */
+		if ((scenario->id >> 4) >= 0x7) {
+			printf("test 0x%02x: [SKIP] of IPv6 over Ethernet\n", scenario->id);
+			continue;
+		}
+		client_lowpan = ((scenario->id >> 4) != 0x1) && ((scenario->id >> 4) != 0x4);
+		if (client_lowpan) {
+			peer_setup_lowpan();
+		}
+#endif
+
+		/* Flush the link between tests */
+		client_to_peer.head = client_to_peer.tail = 0;
+		peer_to_client.head = peer_to_client.tail = 0;
+		peer_verdict = VERDICT_OK;
+		client_l2dst = dst_l2addr;
+
+		current = scenario;
+		if (scenario->before) {
+			scenario->before();
+		}
+		verdict = tests_exec(scenario->id);
+		if (scenario->after) {
+			scenario->after();
+		}
+		current = NULL;
+		trace_flush();
+		if (capture_fd >= 0) {
+			/* Tests may have opened the tap with their own writer */
+			tap_pcapng_resume();
+		}
+
+		if ((verdict == VERDICT_OK) && (peer_verdict == VERDICT_OK)) {
+			printf("test 0x%02x: [OK]\n", scenario->id);
+		} else if (scenario->xfail) {
+			printf("test 0x%02x: [XFAIL] %s\n", scenario->id, scenario->xfail);
+		} else {
+			printf("test 0x%02x: [NOK]\n", scenario->id);
+			failed++;
+		}
+	}
+
+	printf("%u test(s) failed, %llu ms of virtual time\n", failed,
+	       (unsigned long long) virtual_ms);
+
+	return failed;
+}
+
+
+/*
+ * Round trip benchmarks
+ */
+
+static void setup_stacks(void)
+{
+	net_mac_mcsuffix_t client_init[] = NET_IP6_L2_MCSUFFIXES(src_addr);
+	net_mac_mcsuffix_t peer_init[] = NET_IP6_L2_MCSUFFIXES(dst_addr);
+	static net_mac_mcsuffix_t client_mcsuffixes[NET_IP6_L2_MCSUFFIX_CNT];
+	static net_mac_mcsuffix_t peer_mcsuffixes[NET_IP6_L2_MCSUFFIX_CNT];
+	static uint8_t token[] = {0x42};
+
+	/* The MAC layer keeps a reference to the suffixes */
+	memcpy(client_mcsuffixes, client_init, sizeof(client_mcsuffixes));
+	memcpy(peer_mcsuffixes, peer_init, sizeof(peer_mcsuffixes));
+
+	net_mac_set_source_addr(&mac, src_l2addr);
+	net_mac_set_destination_addr(&mac, dst_l2addr);
+	net_mac_set_ip6mcast(&mac, NET_IP6_L2_MCSUFFIX_CNT, client_mcsuffixes);
+	net_lowpan_set_source_addr(&lowpan, src_l2addr);
+	net_lowpan_set_destination_addr(&lowpan, dst_l2addr);
+	net_lowpan_set_context(&lowpan, src_addr);
+	net_ip6_set_source_addr(&ip6, src_addr);
+	net_ip6_set_destination_addr(&ip6, dst_addr);
+	net_udp_set_source_port(&udp, 1234);
+	net_udp_set_destination_port(&udp, 5683);
+	net_coap_set_method(&coap, NET_COAP_TYPE_NONCONFIRMABLE, NET_COAP_CODE_POST);
+	net_coap_set_token(&coap, 1, token);
+	net_coap_set_uripath(&coap, 0, NULL);
+	net_coap_set_uriquery(&coap, 0, NULL);
+
+	net_mac_set_source_addr(&peer_mac, dst_l2addr);
+	net_mac_set_destination_addr(&peer_mac, src_l2addr);
+	net_mac_set_ip6mcast(&peer_mac, NET_IP6_L2_MCSUFFIX_CNT, peer_mcsuffixes);
+#ifdef NET_LOWPAN_ENABLE
+	peer_setup_lowpan();
+#endif
+	net_ip6_set_source_addr(&peer_ip6, dst_addr);
+	net_ip6_set_destination_addr(&peer_ip6, src_addr);
+	net_udp_set_source_port(&peer_udp, 5683);
+	net_udp_set_destination_port(&peer_udp, 1234);
+	net_coap_set_method(&peer_coap, NET_COAP_TYPE_NONCONFIRMABLE, NET_COAP_CODE_CONTENT);
+	net_coap_set_token(&peer_coap, 1, token);
+	net_coap_set_uripath(&peer_coap, 0, NULL);
+	net_coap_set_uriquery(&peer_coap, 0, NULL);
+}
+
+#define ROUND_TRIP(layer, client_ctx, peer_ctx) \
+	do { \
+		dataoffset = layer##_pload_pos(client_ctx); \
+		memcpy(&buffer[dataoffset], "ping", 4); \
+		err |= layer##_send(client_ctx, buffer, sizeof(buffer), dataoffset, 4); \
+		err |= layer##_recv(peer_ctx, peer_buffer, sizeof(peer_buffer), &dataoffset, &datalen); \
+		dataoffset = layer##_pload_pos(peer_ctx); \
+		memcpy(&peer_buffer[dataoffset], "pong", 4); \
+		err |= layer##_send(peer_ctx, peer_buffer, sizeof(peer_buffer), dataoffset, 4); \
+		err |= layer##_recv(client_ctx, buffer, sizeof(buffer), &dataoffset, &datalen); \
+		trace_flush(); \
+	} while (0)
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+static void report(const char *name, uint32_t iterations, uint64_t elapsed, int8_t err)
+{
+	double ns = (double) elapsed / iterations;
+
+	printf("%-6s %10u round trips %10.1f ns/exchange %14.0f exchanges/s%s\n",
+	       name, iterations, ns, 1e9 / ns, (err != NET_STATUS_OK) ? "  [ERROR]" : "");
+}
+
+static void run_benchmarks(uint32_t iterations)
+{
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+	uint64_t start;
+	uint32_t i;
+	int8_t err;
+
+	client_to_peer.head = client_to_peer.tail = 0;
+	peer_to_client.head = peer_to_client.tail = 0;
+	setup_stacks();
+
+	/* MAC */
+	net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_LB);
+	net_mac_set_ethertype(&peer_mac, NET_MAC_ETHERTYPE_LB);
+	err = NET_STATUS_OK;
+	start = now_ns();
+	for (i=0; i<iterations; i++) {
+		ROUND_TRIP(net_mac, &mac, &peer_mac);
+	}
+	report("mac", iterations, now_ns() - start, err);
+
+	/* IPv6 */
+	net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_IPV6);
+	net_mac_set_ethertype(&peer_mac, NET_MAC_ETHERTYPE_IPV6);
+	net_ip6_set_nexthdr(&ip6, 253);
+	net_ip6_set_nexthdr(&peer_ip6, 253);
+	err = NET_STATUS_OK;
+	start = now_ns();
+	for (i=0; i<iterations; i++) {
+		ROUND_TRIP(net_ip6, &ip6, &peer_ip6);
+	}
+	report("ip6", iterations, now_ns() - start, err);
+
+	/* UDP */
+	net_ip6_set_nexthdr(&ip6, NET_IP6_NH_UDP);
+	net_ip6_set_nexthdr(&peer_ip6, NET_IP6_NH_UDP);
+	net_udp_connect(&udp);
+	net_udp_connect(&peer_udp);
+	err = NET_STATUS_OK;
+	start = now_ns();
+	for (i=0; i<iterations; i++) {
+		ROUND_TRIP(net_udp, &udp, &peer_udp);
+	}
+	report("udp", iterations, now_ns() - start, err);
+
+	/* CoAP (non-confirmable request and response) */
+	err = NET_STATUS_OK;
+	start = now_ns();
+	for (i=0; i<iterations; i++) {
+		ROUND_TRIP(net_coap, &coap, &peer_coap);
+	}
+	report("coap", iterations, now_ns() - start, err);
+}
+
+
+int main(int argc, char *argv[])
+{
+	uint32_t iterations = 100000;
+	bool verbose = false;
+	bool tests = true;
+	bool bench = true;
+	int failed = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:tbvT:P:")) != -1) {
+		switch (opt) {
+		case 'n':
+			iterations = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			bench = false;
+			break;
+		case 'b':
+			tests = false;
+			break;
+		case 'v':
+			verbose = true;
+			break;
+		case 'T':
+			trace_file = fopen(optarg, "wb");
+			if (trace_file == NULL) {
+				perror(optarg);
+				return 2;
+			}
+			break;
+		case 'P':
+			capture_fd = open(optarg, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+			if ((capture_fd < 0) || (tap_pcapng_open(capture_fd, 255, 0) < 0)) {
+				perror(optarg);
+				return 2;
+			}
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-t|-b] [-n iterations] [-v] [-T trace] [-P capture]\n",
+			        argv[0]);
+			return 2;
+		}
+	}
+
+	/* Debug lines of tests.c are only shown in verbose mode */
+	serial_posix_set_fd(-1, verbose ? STDERR_FILENO : open("/dev/null", O_WRONLY));
+	clock_posix_set_source(&virtual_clock);
+
+	hw.recv_cback = client_recv;
+	hw.send_cback = client_send;
+	peer_hw.recv_cback = peer_recv;
+	peer_hw.send_cback = peer_send;
+
+	tests_init();
+
+	if (tests) {
+		failed = run_scenarios();
+	}
+	if (bench && (iterations > 0)) {
+		run_benchmarks(iterations);
+	}
+	if (trace_file != NULL) {
+		if (net_trace_lost() > 0) {
+			fprintf(stderr, "%u trace records lost\n", net_trace_lost());
+		}
+		fclose(trace_file);
+	}
+	if (capture_fd >= 0) {
+		net_tap_close();
+		close(capture_fd);
+	}
+
+	return (failed == 0) ? 0 : 1;
+}
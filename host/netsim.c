@@ -0,0 +1,446 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/**
+ * Confirmable CoAP exchanges over simulated links, on a virtual clock.
+ *
+ * Pairs of stacks run on the discrete-event simulator (sim.h), each pair on
+ * its own segment. The client of a pair posts confirmable messages at an
+ * interval, retransmitted as in RFC 7252 (ACK_TIMEOUT randomized by a factor
+ * up to 1.5, doubled at each retransmission, up to MAX_RETRANSMIT times), and
+ * the server acknowledges them from its UDP layer. The links have the
+ * latency, jitter, loss and bandwidth given as options.
+ *
+ * With -N, the link-layer addresses are not configured but discovered: the
+ * stacks resolve their neighbors and detect their addresses optimistically
+ * (RFC 4429). The servers announce theirs at boot, which the clients learn
+ * from the unsolicited advertisements, and the clients announce theirs with
+ * their first message: no exchange waits for a resolution.
+ *
+ * Reports the exchanges, retransmissions and failures, the latency
+ * percentiles, and the virtual time simulated per second of real time. The
+ * results only depend on the options and the seed (-s).
+ *
+ * Must be built with -DNET_LINK_STUB.
+ */
+
+#include "config.h"
+#include "platform.h"
+#include "platform_posix.h"
+#include "net_utils.h"
+#include "sim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef NET_LINK_STUB
+#error "The network simulator must be built with NET_LINK_STUB"
+#endif
+
+#define FRAME_MAXLEN 1514
+#define PAYLOADLEN   16
+
+
+struct client {
+	struct sim_node node;
+	struct net_mac_ctx mac;
+	struct net_ip6_ctx ip6;
+	struct net_udp_ctx udp;
+	struct net_coap_ctx coap;
+	uint8_t l2addr[6];
+	uint8_t addr[16];
+	net_mac_mcsuffix_t mcsuffixes[NET_IP6_L2_MCSUFFIX_CNT];
+
+	uint32_t sent;
+	bool waiting;
+	uint8_t attempt;     /* Retransmissions of the current message */
+	uint64_t rto_us;
+	uint64_t deadline_us;
+	uint64_t first_us;   /* First transmission of the current message */
+};
+
+struct server {
+	struct sim_node node;
+	struct net_mac_ctx mac;
+	struct net_ip6_ctx ip6;
+	struct net_udp_ctx udp;
+	uint8_t l2addr[6];
+	uint8_t addr[16];
+	net_mac_mcsuffix_t mcsuffixes[NET_IP6_L2_MCSUFFIX_CNT];
+};
+
+struct pair {
+	struct sim_segment segment;
+	struct client client;
+	struct server server;
+};
+
+static char *uripath[] = {"telemetry"};
+static uint8_t buffer[FRAME_MAXLEN];
+
+static struct pair *pairs;
+static uint32_t paircnt = 10;
+static uint32_t count = 100;
+static uint32_t interval_us = 1000000;
+static uint32_t latency_us = 5000;
+static uint32_t jitter_us = 0;
+static uint16_t loss = 0;
+static uint32_t bandwidth = 0;
+static uint32_t ack_timeout_us = 2000000;
+static uint8_t max_retransmit = 4;
+static bool discovery = false;
+
+static uint32_t *latencies;
+static uint32_t acknowledged = 0;
+static uint32_t failed = 0;
+static uint32_t retransmissions = 0;
+
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+/* Node n has the MAC address 02:00:n and the IPv6 address 2001:db8::n */
+static void set_addresses(uint8_t *l2addr, uint8_t *addr, uint32_t index)
+{
+	uint8_t i;
+
+	l2addr[0] = 0x02;
+	addr[0] = 0x20;
+	addr[1] = 0x01;
+	addr[2] = 0x0d;
+	addr[3] = 0xb8;
+	for (i=0; i<4; i++) {
+		l2addr[5-i] = (index >> (8*i)) & 0xFF;
+		addr[15-i] = (index >> (8*i)) & 0xFF;
+	}
+}
+
+/* Neighbor discovery instead of the static destination of the link layer */
+static void set_discovery(struct net_mac_ctx *mac, struct net_ip6_ctx *ip6, uint8_t *addr,
+                          net_mac_mcsuffix_t *mcsuffixes)
+{
+	net_mac_mcsuffix_t suffixes[] = NET_IP6_L2_MCSUFFIXES(addr);
+	uint8_t no_l2addr[6] = {0};
+
+	memcpy(mcsuffixes, suffixes, sizeof(suffixes));
+	net_mac_set_destination_addr(mac, no_l2addr);
+	net_mac_set_ip6mcast(mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes);
+	net_ip6_set_resolution(ip6, 1);
+	net_ip6_set_dad(ip6, 1);
+}
+
+/*
+ * Client
+ */
+
+static void client_post(void *arg);
+static void client_timeout(void *arg);
+
+static void client_transmit(struct client *client)
+{
+	uint16_t dataoffset = net_coap_pload_pos(&client->coap);
+	uint8_t *cursor;
+
+	memset(&buffer[dataoffset], 'x', PAYLOADLEN);
+	NET_SET_CURSOR(buffer, dataoffset);
+	NET_PUT_INT(client->sent);
+	net_coap_send(&client->coap, buffer, FRAME_MAXLEN, dataoffset, PAYLOADLEN);
+
+	client->deadline_us = sim_now() + client->rto_us;
+	sim_timer(client->rto_us, client_timeout, client);
+}
+
+/* The next message is due an interval after the previous one */
+static void client_next(struct client *client)
+{
+	uint64_t next_us = client->first_us + interval_us;
+
+	client->waiting = false;
+	client->sent++;
+	if (client->sent < count) {
+		sim_timer((next_us > sim_now()) ? next_us - sim_now() : 0, client_post, client);
+	}
+}
+
+static void client_post(void *arg)
+{
+	struct client *client = arg;
+
+	client->waiting = true;
+	client->attempt = 0;
+	client->rto_us = ack_timeout_us + sim_random(ack_timeout_us / 2 + 1);
+	client->first_us = sim_now();
+	client_transmit(client);
+}
+
+static void client_timeout(void *arg)
+{
+	struct client *client = arg;
+
+	/* Timers of acknowledged messages are ignored */
+	if (!client->waiting || (sim_now() < client->deadline_us)) {
+		return;
+	}
+	if (client->attempt == max_retransmit) {
+		failed++;
+		client_next(client);
+		return;
+	}
+
+	/* Same message ID */
+	client->attempt++;
+	client->rto_us *= 2;
+	client->coap.last_messageid--;
+	retransmissions++;
+	client_transmit(client);
+}
+
+static void client_notify(struct sim_node *node)
+{
+	struct client *client = node->priv;
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+
+	while (node->rxq_head != node->rxq_tail) {
+		if ((net_coap_recv(&client->coap, buffer, FRAME_MAXLEN,
+		                   &dataoffset, &datalen) == NET_COAP_STATUS_ACK) && client->waiting) {
+			latencies[acknowledged++] = sim_now() - client->first_us;
+			client_next(client);
+		}
+	}
+
+	/* Idle, solicitations are answered */
+	net_ip6_service(&client->ip6, buffer, FRAME_MAXLEN);
+}
+
+static void client_init(struct client *client, struct server *server,
+                        struct sim_segment *segment)
+{
+	sim_node_init(&client->node, segment);
+	sim_set_link(&client->node, latency_us, jitter_us, loss, bandwidth);
+	client->node.notify = client_notify;
+	client->node.priv = client;
+
+	client->mac.lower = &client->node.hw;
+	client->ip6.lower = &client->mac;
+	client->udp.lower = &client->ip6;
+	client->coap.lower = &client->udp;
+
+	net_mac_set_source_addr(&client->mac, client->l2addr);
+	net_mac_set_destination_addr(&client->mac, server->l2addr);
+	net_mac_set_ethertype(&client->mac, NET_MAC_ETHERTYPE_IPV6);
+	if (discovery) {
+		set_discovery(&client->mac, &client->ip6, client->addr, client->mcsuffixes);
+	}
+	net_ip6_set_source_addr(&client->ip6, client->addr);
+	net_ip6_set_destination_addr(&client->ip6, server->addr);
+	net_ip6_set_nexthdr(&client->ip6, NET_IP6_NH_UDP);
+	net_udp_set_source_port(&client->udp, 1234);
+	net_udp_set_destination_port(&client->udp, 5683);
+	net_udp_connect(&client->udp);
+	net_coap_set_method(&client->coap, NET_COAP_TYPE_CONFIRMABLE, NET_COAP_CODE_POST);
+	net_coap_set_uripath(&client->coap, 1, uripath);
+	net_coap_set_contenttype(&client->coap, NET_COAP_CONTENTTYPE_OCTETSTRING);
+}
+
+/*
+ * Server
+ */
+
+/* Empty acknowledgement of every confirmable message */
+static void server_notify(struct sim_node *node)
+{
+	struct server *server = node->priv;
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+
+	while (node->rxq_head != node->rxq_tail) {
+		if ((net_udp_recv(&server->udp, buffer, FRAME_MAXLEN,
+		                  &dataoffset, &datalen) != NET_STATUS_OK) ||
+		    (datalen < 4) || ((buffer[dataoffset] & 0xF0) != 0x40)) {
+			continue;
+		}
+
+		buffer[dataoffset] = 0x40 | (NET_COAP_TYPE_ACKNOWLEDGE << 4);
+		buffer[dataoffset+1] = NET_COAP_CODE_EMPTY;
+		memmove(&buffer[net_udp_pload_pos(&server->udp)], &buffer[dataoffset], 4);
+		net_udp_send(&server->udp, buffer, FRAME_MAXLEN, net_udp_pload_pos(&server->udp), 4);
+	}
+
+	net_ip6_service(&server->ip6, buffer, FRAME_MAXLEN);
+}
+
+static void server_init(struct server *server, struct client *client,
+                        struct sim_segment *segment)
+{
+	sim_node_init(&server->node, segment);
+	sim_set_link(&server->node, latency_us, jitter_us, loss, bandwidth);
+	server->node.notify = server_notify;
+	server->node.priv = server;
+
+	server->mac.lower = &server->node.hw;
+	server->ip6.lower = &server->mac;
+	server->udp.lower = &server->ip6;
+
+	net_mac_set_source_addr(&server->mac, server->l2addr);
+	net_mac_set_destination_addr(&server->mac, client->l2addr);
+	net_mac_set_ethertype(&server->mac, NET_MAC_ETHERTYPE_IPV6);
+	if (discovery) {
+		set_discovery(&server->mac, &server->ip6, server->addr, server->mcsuffixes);
+	}
+	net_ip6_set_source_addr(&server->ip6, server->addr);
+	net_ip6_set_destination_addr(&server->ip6, client->addr);
+	net_ip6_set_nexthdr(&server->ip6, NET_IP6_NH_UDP);
+	net_udp_set_source_port(&server->udp, 5683);
+	net_udp_set_destination_port(&server->udp, 1234);
+	net_udp_connect(&server->udp);
+}
+
+/* Announcement of the address at boot */
+static void server_boot(void *arg)
+{
+	struct server *server = arg;
+
+	net_ip6_announce(&server->ip6, buffer, FRAME_MAXLEN);
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *) a;
+	uint32_t y = *(const uint32_t *) b;
+
+	return (x > y) - (x < y);
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-p pairs] [-n messages] [-i interval_ms] [-l latency_us]\n"
+	                "       [-j jitter_us] [-L loss%%] [-b bit/s] [-a ack_timeout_ms]\n"
+	                "       [-r max_retransmit] [-s seed] [-N]\n", name);
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t seed = 1;
+	uint32_t lost = 0;
+	uint32_t overflows = 0;
+	uint32_t frames = 0;
+	uint32_t n;
+	uint32_t i;
+	uint64_t start;
+	uint64_t boot_us = 0;
+	double elapsed;
+	double simulated;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "p:n:i:l:j:L:b:a:r:s:N")) != -1) {
+		switch (opt) {
+		case 'p':
+			paircnt = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			count = strtoul(optarg, NULL, 0);
+			break;
+		case 'i':
+			interval_us = strtoul(optarg, NULL, 0) * 1000;
+			break;
+		case 'l':
+			latency_us = strtoul(optarg, NULL, 0);
+			break;
+		case 'j':
+			jitter_us = strtoul(optarg, NULL, 0);
+			break;
+		case 'L':
+			loss = strtod(optarg, NULL) * 65535 / 100;
+			break;
+		case 'b':
+			bandwidth = strtoul(optarg, NULL, 0);
+			break;
+		case 'a':
+			ack_timeout_us = strtoul(optarg, NULL, 0) * 1000;
+			break;
+		case 'r':
+			max_retransmit = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			seed = strtoul(optarg, NULL, 0);
+			break;
+		case 'N':
+			discovery = true;
+			break;
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+	if ((paircnt == 0) || (count == 0)) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	pairs = calloc(paircnt, sizeof(struct pair));
+	latencies = calloc((uint64_t) paircnt * count, sizeof(uint32_t));
+	if ((pairs == NULL) || (latencies == NULL)) {
+		perror("netsim");
+		return 1;
+	}
+
+	sim_init(seed);
+	if (discovery) {
+		/* Time for the announcements of the servers to be received */
+		boot_us = 4 * latency_us + jitter_us;
+	}
+	for (i=0; i<paircnt; i++) {
+		set_addresses(pairs[i].client.l2addr, pairs[i].client.addr, 2*i);
+		set_addresses(pairs[i].server.l2addr, pairs[i].server.addr, 2*i + 1);
+		client_init(&pairs[i].client, &pairs[i].server, &pairs[i].segment);
+		server_init(&pairs[i].server, &pairs[i].client, &pairs[i].segment);
+		if (discovery) {
+			sim_timer(0, server_boot, &pairs[i].server);
+		}
+		/* First messages spread over an interval */
+		sim_timer(boot_us + (uint64_t) interval_us * i / paircnt, client_post, &pairs[i].client);
+	}
+
+	start = now_ns();
+	sim_run_all();
+	elapsed = (now_ns() - start) / 1e9;
+	simulated = sim_now() / 1e6;
+
+	for (i=0; i<paircnt; i++) {
+		lost += pairs[i].client.node.lost + pairs[i].server.node.lost;
+		overflows += pairs[i].client.node.overflows + pairs[i].server.node.overflows;
+		frames += pairs[i].client.node.tx_frames + pairs[i].server.node.tx_frames;
+	}
+	n = acknowledged;
+	qsort(latencies, n, sizeof(uint32_t), compare_u32);
+
+	printf("%u pairs, %u messages each, seed %u%s\n", paircnt, count, seed,
+	       discovery ? ", neighbor discovery" : "");
+	printf("%u acknowledged, %u failed, %u retransmissions, %u frames sent, %u frames lost, "
+	       "%u overflows\n", acknowledged, failed, retransmissions, frames, lost, overflows);
+	if (n > 0) {
+		printf("latency us: min %u p50 %u p90 %u p99 %u max %u\n", latencies[0],
+		       latencies[n / 2], latencies[(uint64_t) n * 90 / 100],
+		       latencies[(uint64_t) n * 99 / 100], latencies[n - 1]);
+	}
+	printf("%.3f s of virtual time in %.3f s of real time (x%.0f)\n", simulated, elapsed,
+	       (elapsed > 0) ? simulated / elapsed : 0.0);
+
+	sim_destroy();
+	free(latencies);
+	free(pairs);
+
+	return 0;
+}
@@ -0,0 +1,415 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#define _GNU_SOURCE
+
+#include "config.h"
+#include "platform.h"
+#include "platform_serial.h"
+#include "platform_posix.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+
+static struct clock_posix_source *clock_source = NULL;
+
+void clock_posix_set_source(struct clock_posix_source *source)
+{
+	clock_source = source;
+}
+
+void msleep(uint16_t time_ms)
+{
+	struct timespec ts;
+
+	if (clock_source != NULL) {
+		clock_source->sleep(clock_source, time_ms);
+		return;
+	}
+
+	ts.tv_sec = time_ms / 1000;
+	ts.tv_nsec = (long) (time_ms % 1000) * 1000000L;
+
+	/* Relative sleep on the monotonic clock, resumed when interrupted */
+	while (clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, &ts) == EINTR) {
+	}
+}
+
+uint32_t clock_us()
+{
+	struct timespec ts;
+
+	if ((clock_source != NULL) && (clock_source->now_us != NULL)) {
+		return clock_source->now_us(clock_source);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t) ts.tv_sec * 1000000UL + (uint32_t) (ts.tv_nsec / 1000);
+}
+
+#ifdef USE_SPI
+
+static uint8_t _spi_null_transfer(struct spi_posix_device *device, uint8_t value)
+{
+	return 0x00;
+}
+
+static struct spi_posix_device spi_null_device = {
+	.select = NULL,
+	.transfer = _spi_null_transfer,
+};
+
+static struct spi_posix_device *spi_device = &spi_null_device;
+
+void spi_posix_set_device(struct spi_posix_device *device)
+{
+	spi_device = (device != NULL) ? device : &spi_null_device;
+}
+
+void spi_init() {}
+void spi_destroy() {}
+void spi_start_transaction() {}
+void spi_stop_transaction() {}
+
+void spi_start_transfer()
+{
+	if (spi_device->select) {
+		spi_device->select(spi_device, true);
+	}
+}
+
+void spi_stop_transfer()
+{
+	if (spi_device->select) {
+		spi_device->select(spi_device, false);
+	}
+}
+
+uint8_t spi_read_byte()
+{
+	return spi_device->transfer(spi_device, 0x00);
+}
+
+void spi_read(uint8_t *buffer, uint16_t buflen)
+{
+	uint16_t i;
+
+	for (i=0; i<buflen; i++) {
+		buffer[i] = spi_device->transfer(spi_device, buffer[i]);
+	}
+}
+
+void spi_write(uint8_t *buffer, uint16_t buflen)
+{
+	uint16_t i;
+
+	for (i=0; i<buflen; i++) {
+		spi_device->transfer(spi_device, buffer[i]);
+	}
+}
+
+#else
+
+void spi_posix_set_device(struct spi_posix_device *device) {}
+void spi_init() {}
+void spi_destroy() {}
+void spi_start_transaction() {}
+void spi_stop_transaction() {}
+void spi_start_transfer() {}
+void spi_stop_transfer() {}
+uint8_t spi_read_byte() { return 0; }
+void spi_read(uint8_t *buffer, uint16_t buflen) {}
+void spi_write(uint8_t *buffer, uint16_t buflen) {}
+
+#endif
+
+#ifdef USE_SERIAL
+
+static int serial_fd_in = -1;
+static int serial_fd_out = -1;
+
+static struct serial_ring serial_rx;
+static struct serial_decoder serial_dec;
+static uint8_t serial_pending_signal;
+
+static void _serial_write_all(const uint8_t *data, size_t datalen)
+{
+	int fd = (serial_fd_out >= 0) ? serial_fd_out : STDERR_FILENO;
+	ssize_t written;
+
+	while (datalen > 0) {
+		written = write(fd, data, datalen);
+		if (written < 0) {
+			if ((errno == EINTR) || (errno == EAGAIN)) {
+				continue;
+			}
+			return;
+		}
+		data += written;
+		datalen -= written;
+	}
+}
+
+void serial_posix_set_fd(int fd_in, int fd_out)
+{
+	serial_fd_in = fd_in;
+	serial_fd_out = fd_out;
+
+	/* Reads are polled, they must never block */
+	if (fd_in >= 0) {
+		fcntl(fd_in, F_SETFL, fcntl(fd_in, F_GETFL) | O_NONBLOCK);
+	}
+
+	memset(&serial_rx, 0, sizeof(serial_rx));
+	memset(&serial_dec, 0, sizeof(serial_dec));
+	serial_pending_signal = 0;
+}
+
+int serial_posix_open_pty(char *name, size_t namelen)
+{
+	struct termios tio;
+	int fd;
+
+	fd = posix_openpt(O_RDWR | O_NOCTTY);
+	if ((fd < 0) || (grantpt(fd) < 0) || (unlockpt(fd) < 0)) {
+		return -1;
+	}
+
+	/* Raw mode, lines are framed by the serial decoder */
+	if (tcgetattr(fd, &tio) == 0) {
+		cfmakeraw(&tio);
+		tcsetattr(fd, TCSANOW, &tio);
+	}
+
+	if ((name != NULL) && (ptsname_r(fd, name, namelen) != 0)) {
+		close(fd);
+		return -1;
+	}
+
+	serial_posix_set_fd(fd, fd);
+
+	return fd;
+}
+
+void serial_init() {}
+
+void serial_debug_beg()
+{
+	_serial_write_all((const uint8_t *) "D: ", 3);
+}
+
+void serial_debug_end()
+{
+	_serial_write_all((const uint8_t *) "\n", 1);
+}
+
+void serial_debug(const char * const message)
+{
+	serial_debug_beg();
+	_serial_write_all((const uint8_t *) message, strlen(message));
+	serial_debug_end();
+}
+
+void serial_signal(uint8_t signal)
+{
+	char line[8];
+	int len;
+
+	len = snprintf(line, sizeof(line), "T: %u\n", signal);
+	_serial_write_all((const uint8_t *) line, len);
+}
+
+void serial_poll()
+{
+	uint8_t chunk[SERIAL_RING_SIZE];
+	ssize_t len;
+	ssize_t i;
+
+	if (serial_fd_in < 0) {
+		return;
+	}
+
+	/* Only read what fits in the ring, the rest stays in the kernel */
+	len = read(serial_fd_in, chunk, serial_ring_free(&serial_rx));
+	for (i=0; i<len; i++) {
+		serial_ring_push(&serial_rx, chunk[i]);
+	}
+}
+
+uint16_t serial_read(uint8_t *buffer, uint16_t buflen)
+{
+	uint8_t chr = 0;
+
+	serial_poll();
+
+	/* Decode what has been received so far, without waiting for the rest */
+	while (serial_ring_pop(&serial_rx, &chr)) {
+		switch (serial_decode(&serial_dec, chr, buffer, buflen)) {
+		case SERIAL_DECODE_FRAME:
+			return serial_dec.len;
+		case SERIAL_DECODE_SIGNAL:
+			serial_pending_signal = serial_dec.signal;
+			break;
+		default:
+			break;
+		}
+
+		/* Refill the ring as long as a line is being decoded */
+		if (serial_rx.head == serial_rx.tail) {
+			serial_poll();
+		}
+	}
+
+	return 0;
+}
+
+uint8_t serial_read_signal()
+{
+	uint8_t chr = 0;
+	uint8_t signal = serial_pending_signal;
+
+	if (signal != 0) {
+		serial_pending_signal = 0;
+		return signal;
+	}
+
+	serial_poll();
+
+	/* Frame lines received here are skipped, since there is no buffer */
+	while (serial_ring_pop(&serial_rx, &chr)) {
+		if (serial_decode(&serial_dec, chr, NULL, 0) == SERIAL_DECODE_SIGNAL) {
+			return serial_dec.signal;
+		}
+		if (serial_rx.head == serial_rx.tail) {
+			serial_poll();
+		}
+	}
+
+	return 0;
+}
+
+uint8_t serial_wait_for_signal(uint16_t timeout)
+{
+	uint8_t signal = 0;
+	uint16_t elapsed = 0;
+
+	while ((signal = serial_read_signal()) == 0) {
+		if (elapsed >= timeout) {
+			return 0;
+		}
+		msleep(1);
+		elapsed++;
+	}
+
+	return signal;
+}
+
+uint16_t serial_write(uint8_t *buffer, uint16_t buflen)
+{
+	uint8_t line[3 + 2*64 + 1];
+	uint16_t linelen = 0;
+	uint16_t i = 0;
+
+	line[linelen++] = 'P';
+	line[linelen++] = ':';
+	line[linelen++] = ' ';
+
+	/* Hex-encode by chunks to keep the stack usage bounded */
+	while (i < buflen) {
+		line[linelen++] = serial_hexchr((buffer[i] & 0xF0) >> 4);
+		line[linelen++] = serial_hexchr(buffer[i] & 0x0F);
+		i++;
+
+		if (linelen >= sizeof(line) - 2) {
+			_serial_write_all(line, linelen);
+			linelen = 0;
+		}
+	}
+
+	line[linelen++] = '\n';
+	_serial_write_all(line, linelen);
+
+	return i;
+}
+
+#else
+
+void serial_posix_set_fd(int fd_in, int fd_out) {}
+int serial_posix_open_pty(char *name, size_t namelen) { return -1; }
+void serial_init() {}
+void serial_debug_beg() {}
+void serial_debug_end() {}
+void serial_debug(const char * const message) {}
+void serial_signal(uint8_t signal) {}
+void serial_poll() {}
+uint16_t serial_read(uint8_t *buffer, uint16_t buflen) { return 0; }
+uint8_t serial_read_signal() { return 0; }
+uint8_t serial_wait_for_signal(uint16_t timeout) { return 0; }
+uint16_t serial_write(uint8_t *buffer, uint16_t buflen) { return 0; }
+
+#endif
+
+#ifdef NET_MEMSTATS_ENABLE
+
+#define STACK_PATTERN 0xC5
+#define STACK_PAINTLEN 32768
+#define STACK_MARGIN   16  /* Locals of stack_paint(), not painted */
+
+/**
+ * The painted area is below the frame of stack_paint(), as on the AVR, where
+ * the calls of its caller will run. The stack of the host has no fixed
+ * bottom, stack_free() is the part of the painted area never used.
+ */
+static uint8_t *stack_bottom = NULL;
+static uint8_t *stack_top = NULL;     /* Frame of stack_paint(), above the area */
+
+static uint8_t *_stack_deepest()
+{
+	uint8_t *p = stack_bottom;
+
+	while ((p < stack_top - STACK_MARGIN) && (*p == STACK_PATTERN)) {
+		p++;
+	}
+
+	return p;
+}
+
+__attribute__((noinline)) void stack_paint()
+{
+	/* Volatile, for the loop not to become a call to memset() over its own frame */
+	volatile uint8_t *p = NULL;
+
+	stack_top = (uint8_t *) __builtin_frame_address(0);
+	stack_bottom = stack_top - STACK_MARGIN - STACK_PAINTLEN;
+	for (p = stack_bottom; p < stack_top - STACK_MARGIN; p++) {
+		*p = STACK_PATTERN;
+	}
+}
+
+uint16_t stack_used()
+{
+	return stack_top - _stack_deepest();
+}
+
+uint16_t stack_free()
+{
+	return _stack_deepest() - stack_bottom;
+}
+
+#else
+
+void stack_paint() {}
+uint16_t stack_used() { return 0; }
+uint16_t stack_free() { return 0; }
+
+#endif
@@ -0,0 +1,51 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PLATFORM_POSIX_H
+#define _PLATFORM_POSIX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Host-specific configuration of the POSIX implementation of platform.h.
+ *
+ * The time functions use the monotonic clock, unless a clock source is set
+ * (harnesses and simulations running on a virtual time). The serial
+ * functions exchange lines over a pair of file descriptors (pty, socketpair,
+ * pipe or file). The SPI functions are forwarded to a device model, by
+ * default a device which reads back zeros.
+ */
+
+struct clock_posix_source {
+	void (*sleep)(struct clock_posix_source *source, uint16_t time_ms);
+	/* Optional, the monotonic clock is read when NULL */
+	uint32_t (*now_us)(struct clock_posix_source *source);
+};
+
+struct spi_posix_device {
+	/* Chip select (spi_start_transfer / spi_stop_transfer) */
+	void (*select)(struct spi_posix_device *device, bool selected);
+	/* Full-duplex transfer of one byte */
+	uint8_t (*transfer)(struct spi_posix_device *device, uint8_t value);
+};
+
+extern void clock_posix_set_source(struct clock_posix_source *source);
+extern void spi_posix_set_device(struct spi_posix_device *device);
+
+extern void serial_posix_set_fd(int fd_in, int fd_out);
+extern int serial_posix_open_pty(char *name, size_t namelen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,92 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/**
+ * Host target for tester.py, over a pseudo-terminal.
+ *
+ * Runs the tests of tests.c as the test_net sketch does, on the serial link
+ * (hw_serial): the name of the pty is printed, then each test signalled by
+ * tester.py is executed and its verdict signalled back. This runs both the
+ * functional tests and the load mode of tester.py against the host build:
+ *
+ *     host/build/pty_target -f host/build/pty &
+ *     ./tester.py -p $(cat host/build/pty) --load udp,coap,ns --rate 500
+ *
+ * With -f, the name of the pty is also written to a file.
+ */
+
+#include "config.h"
+#include "platform.h"
+#include "platform_posix.h"
+#include "tests.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#if defined(NET_LINK_STUB) || defined(NET_LINK_W5500)
+#error "The pty target must be built with the serial link"
+#endif
+
+
+int main(int argc, char *argv[])
+{
+	const char *namefile = NULL;
+	char name[64];
+	uint8_t test_id;
+	uint8_t verdict;
+	FILE *file;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "f:")) != -1) {
+		switch (opt) {
+		case 'f':
+			namefile = optarg;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-f namefile]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	if (serial_posix_open_pty(name, sizeof(name)) < 0) {
+		perror("pty");
+		return 1;
+	}
+	printf("%s\n", name);
+	fflush(stdout);
+	if (namefile != NULL) {
+		file = fopen(namefile, "w");
+		if (file == NULL) {
+			perror(namefile);
+			return 1;
+		}
+		fprintf(file, "%s\n", name);
+		fclose(file);
+	}
+
+	serial_init();
+	tests_init();
+
+	while (1) {
+		test_id = serial_wait_for_signal(1000);
+		if (test_id == 0) {
+			continue;
+		}
+
+		verdict = tests_exec(test_id);
+		if (verdict == VERDICT_OK) {
+			serial_debug("OK");
+		} else if (verdict == VERDICT_NOK) {
+			serial_debug("NOK");
+		}
+
+		msleep(100);
+		serial_signal(verdict);
+	}
+
+	return 0;
+}
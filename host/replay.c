@@ -0,0 +1,227 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/**
+ * Offline replay of a pcap file through the receive path of the stack.
+ *
+ * Frames are read by hw_pcap, at full speed or paced (-p), and received by
+ * net_coap_recv(), through the MAC, IPv6 and UDP layers. The frames sent by
+ * the stack (Neighbor Advertisements) are written to an output pcap (-o).
+ * The addresses, ports and CoAP token of the stack are given as options, the
+ * defaults being the addresses of tests.c, and no token.
+ *
+ * Reports the frames per second, the frames delivered to the application,
+ * the drop ratio and the replies produced; with NET_STATS_ENABLE, the
+ * counters of each layer are printed as well.
+ *
+ * Must be built with -DNET_LINK_PCAP.
+ */
+
+#include "config.h"
+#include "platform.h"
+#include "platform_posix.h"
+#include "net_stats.h"
+
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef NET_LINK_PCAP
+#error "The replay tool must be built with NET_LINK_PCAP"
+#endif
+
+#define FRAME_MAXLEN 1514
+
+
+static uint8_t buffer[FRAME_MAXLEN];
+
+static uint8_t l2addr[6] = {0x10, 0x22, 0x33, 0x44, 0x55, 0x66};
+static uint8_t local_addr[16] = {0x20,0x01,0,0x01,0,0x02,0,0x03,0,0x0f,0,0x0e,0,0x0d,0,0x0c};
+static uint8_t remote_addr[16] = {0x20,0x01,0,0x01,0,0x02,0,0x03,0,0x0a,0,0x0b,0,0x0c,0,0x0d};
+static uint16_t local_port = 1234;
+static uint16_t remote_port = 5683;
+static uint8_t token[8];
+static uint8_t tokenlen;
+static net_mac_mcsuffix_t mcsuffixes[NET_IP6_L2_MCSUFFIX_CNT];
+
+static struct hw_pcap_ctx hw;
+static struct net_mac_ctx mac = { .lower = &hw };
+static struct net_ip6_ctx ip6 = { .lower = &mac };
+static struct net_udp_ctx udp = { .lower = &ip6 };
+static struct net_coap_ctx coap = { .lower = &udp };
+
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+static int parse_l2addr(const char *str, uint8_t *addr)
+{
+	unsigned int bytes[6];
+	int i;
+
+	if (sscanf(str, "%x:%x:%x:%x:%x:%x", &bytes[0], &bytes[1], &bytes[2],
+	           &bytes[3], &bytes[4], &bytes[5]) != 6) {
+		return -1;
+	}
+	for (i=0; i<6; i++) {
+		addr[i] = bytes[i];
+	}
+
+	return 0;
+}
+
+static int parse_token(const char *str)
+{
+	unsigned int byte;
+
+	for (tokenlen=0; (str[2*tokenlen] != '\0') && (tokenlen < sizeof(token)); tokenlen++) {
+		if (sscanf(&str[2*tokenlen], "%2x", &byte) != 1) {
+			return -1;
+		}
+		token[tokenlen] = byte;
+	}
+
+	return (str[2*tokenlen] == '\0') ? 0 : -1;
+}
+
+static void setup_stack(void)
+{
+	net_mac_mcsuffix_t mcsuffixes_init[] = NET_IP6_L2_MCSUFFIXES(local_addr);
+
+	memcpy(mcsuffixes, mcsuffixes_init, sizeof(mcsuffixes));
+
+	net_mac_set_source_addr(&mac, l2addr);
+	net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_IPV6);
+	net_mac_set_ip6mcast(&mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes);
+	net_ip6_set_source_addr(&ip6, local_addr);
+	net_ip6_set_destination_addr(&ip6, remote_addr);
+	net_ip6_set_nexthdr(&ip6, NET_IP6_NH_UDP);
+	net_udp_set_source_port(&udp, local_port);
+	net_udp_set_destination_port(&udp, remote_port);
+	net_udp_connect(&udp);
+	net_coap_set_method(&coap, NET_COAP_TYPE_NONCONFIRMABLE, NET_COAP_CODE_GET);
+	net_coap_set_token(&coap, tokenlen, token);
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-p] [-o output] [-m mac] [-a local] [-r remote] "
+	                "[-u lport:rport] [-k token] <pcap>\n", name);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *output = NULL;
+	bool paced = false;
+	uint32_t delivered = 0;
+	uint32_t frames = 0;
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+	uint64_t start;
+	double elapsed;
+	int8_t err;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "po:m:a:r:u:k:")) != -1) {
+		switch (opt) {
+		case 'p':
+			paced = true;
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case 'm':
+			if (parse_l2addr(optarg, l2addr) < 0) {
+				usage(argv[0]);
+				return 2;
+			}
+			break;
+		case 'a':
+			if (inet_pton(AF_INET6, optarg, local_addr) != 1) {
+				usage(argv[0]);
+				return 2;
+			}
+			break;
+		case 'r':
+			if (inet_pton(AF_INET6, optarg, remote_addr) != 1) {
+				usage(argv[0]);
+				return 2;
+			}
+			break;
+		case 'u':
+			if (sscanf(optarg, "%hu:%hu", &local_port, &remote_port) != 2) {
+				usage(argv[0]);
+				return 2;
+			}
+			break;
+		case 'k':
+			if (parse_token(optarg) < 0) {
+				usage(argv[0]);
+				return 2;
+			}
+			break;
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+	if (optind != argc - 1) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	/* Debug lines (net_stats_dump) go to stdout */
+	serial_posix_set_fd(-1, STDOUT_FILENO);
+
+	if (hw_pcap_open(&hw, argv[optind], output, paced) < 0) {
+		perror(argv[optind]);
+		return 1;
+	}
+	setup_stack();
+
+	start = now_ns();
+	while (!hw_pcap_eof(&hw)) {
+		frames = hw.frames_in;
+		err = net_coap_recv(&coap, buffer, sizeof(buffer), &dataoffset, &datalen);
+		if (err >= 0) {
+			delivered++;
+		} else if (paced && (hw.frames_in == frames)) {
+			/* The next frame is not due yet */
+			msleep(1);
+		}
+	}
+	/* Answer to the last solicitation, if any */
+	net_ip6_service(&ip6, buffer, sizeof(buffer));
+	elapsed = (now_ns() - start) / 1e9;
+	frames = hw.frames_in;
+
+	printf("%u frames in %.3f s, %.0f frames/s\n", frames, elapsed,
+	       (elapsed > 0) ? frames / elapsed : 0.0);
+	printf("%u delivered, %u dropped (%.1f%%), %u oversized\n", delivered,
+	       frames - delivered, (frames > 0) ? 100.0 * (frames - delivered) / frames : 0.0,
+	       hw.oversized);
+	printf("%u replies\n", hw.frames_out);
+	fflush(stdout);
+
+#ifdef NET_STATS_ENABLE
+	net_stats_dump("mac", &mac.stats);
+	net_stats_dump("ip6", &ip6.stats);
+	net_stats_dump("udp", &udp.stats);
+	net_stats_dump("coap", &coap.stats);
+#endif
+
+	hw_pcap_close(&hw);
+
+	return 0;
+}
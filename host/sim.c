@@ -0,0 +1,375 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "sim.h"
+#include "platform_posix.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+struct sim_frame {
+	uint16_t refcnt;
+	uint16_t len;
+	uint8_t data[];
+};
+
+struct sim_event {
+	uint64_t at_us;
+	uint64_t seq;              /* Events at the same time run in order */
+	sim_event_callback callback;
+	void *arg;
+	struct sim_frame *frame;   /* Deliveries only */
+};
+
+struct sim_heap {
+	struct sim_event *events;
+	uint32_t count;
+	uint32_t size;
+};
+
+/*
+ * Deliveries and timers are kept apart, msleep() only running the former
+ */
+static struct sim_heap deliveries;
+static struct sim_heap timers;
+static uint64_t now_us;
+static uint64_t seq;
+static uint32_t random_state;
+
+static void _sim_deliver(struct sim_node *node, struct sim_frame *frame);
+
+
+/*
+ * Event queues, binary heaps ordered by time then sequence
+ */
+
+static bool _sim_before(struct sim_event *a, struct sim_event *b)
+{
+	return (a->at_us < b->at_us) || ((a->at_us == b->at_us) && (a->seq < b->seq));
+}
+
+static int _sim_heap_push(struct sim_heap *heap, struct sim_event *event)
+{
+	struct sim_event *events;
+	struct sim_event tmp;
+	uint32_t i;
+
+	if (heap->count == heap->size) {
+		events = realloc(heap->events, (heap->size + 256) * sizeof(struct sim_event));
+		if (events == NULL) {
+			return -1;
+		}
+		heap->events = events;
+		heap->size += 256;
+	}
+
+	event->seq = seq++;
+	i = heap->count++;
+	heap->events[i] = *event;
+	while ((i > 0) && _sim_before(&heap->events[i], &heap->events[(i-1)/2])) {
+		tmp = heap->events[i];
+		heap->events[i] = heap->events[(i-1)/2];
+		heap->events[(i-1)/2] = tmp;
+		i = (i-1)/2;
+	}
+
+	return 0;
+}
+
+static struct sim_event *_sim_heap_top(struct sim_heap *heap)
+{
+	return (heap->count > 0) ? &heap->events[0] : NULL;
+}
+
+static void _sim_heap_pop(struct sim_heap *heap, struct sim_event *event)
+{
+	struct sim_event tmp;
+	uint32_t i = 0;
+	uint32_t child;
+
+	*event = heap->events[0];
+	heap->events[0] = heap->events[--heap->count];
+	while ((child = 2*i + 1) < heap->count) {
+		if ((child + 1 < heap->count) &&
+		    _sim_before(&heap->events[child+1], &heap->events[child])) {
+			child++;
+		}
+		if (!_sim_before(&heap->events[child], &heap->events[i])) {
+			break;
+		}
+		tmp = heap->events[i];
+		heap->events[i] = heap->events[child];
+		heap->events[child] = tmp;
+		i = child;
+	}
+}
+
+static void _sim_heap_free(struct sim_heap *heap)
+{
+	uint32_t i;
+
+	for (i=0; i<heap->count; i++) {
+		if ((heap->events[i].frame != NULL) && (--heap->events[i].frame->refcnt == 0)) {
+			free(heap->events[i].frame);
+		}
+	}
+	free(heap->events);
+	memset(heap, 0, sizeof(*heap));
+}
+
+/* Run an event, the clock never going backwards */
+static void _sim_run_event(struct sim_heap *heap)
+{
+	struct sim_event event;
+
+	_sim_heap_pop(heap, &event);
+	if (event.at_us > now_us) {
+		now_us = event.at_us;
+	}
+	if (event.frame != NULL) {
+		_sim_deliver(event.arg, event.frame);
+		if (--event.frame->refcnt == 0) {
+			free(event.frame);
+		}
+	} else {
+		event.callback(event.arg);
+	}
+}
+
+/*
+ * Virtual clock
+ */
+
+static void _sim_sleep(struct clock_posix_source *source, uint16_t time_ms)
+{
+	uint64_t until_us = now_us + (uint64_t) time_ms * 1000;
+	struct sim_event *event;
+
+	while (((event = _sim_heap_top(&deliveries)) != NULL) && (event->at_us <= until_us)) {
+		_sim_run_event(&deliveries);
+	}
+	now_us = until_us;
+}
+
+static uint32_t _sim_now_us(struct clock_posix_source *source)
+{
+	return (uint32_t) now_us;
+}
+
+static struct clock_posix_source sim_clock = {
+	.sleep = _sim_sleep,
+	.now_us = _sim_now_us,
+};
+
+void sim_init(uint32_t seed)
+{
+	_sim_heap_free(&deliveries);
+	_sim_heap_free(&timers);
+	now_us = 0;
+	seq = 0;
+	random_state = (seed != 0) ? seed : 1;
+
+	clock_posix_set_source(&sim_clock);
+}
+
+void sim_destroy(void)
+{
+	_sim_heap_free(&deliveries);
+	_sim_heap_free(&timers);
+
+	clock_posix_set_source(NULL);
+}
+
+uint64_t sim_now(void)
+{
+	return now_us;
+}
+
+uint32_t sim_random(uint32_t range)
+{
+	/* xorshift32 */
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+
+	return (range > 0) ? random_state % range : 0;
+}
+
+int sim_timer(uint64_t delay_us, sim_event_callback callback, void *arg)
+{
+	struct sim_event event = {
+		.at_us = now_us + delay_us,
+		.callback = callback,
+		.arg = arg,
+	};
+
+	return _sim_heap_push(&timers, &event);
+}
+
+/*
+ * Nodes and links
+ */
+
+static void _sim_notify(void *arg)
+{
+	struct sim_node *node = arg;
+
+	node->notify(node);
+}
+
+static void _sim_deliver(struct sim_node *node, struct sim_frame *frame)
+{
+	if ((uint16_t) (node->rxq_head - node->rxq_tail) >= SIM_RXQ_SLOTS) {
+		node->overflows++;
+		return;
+	}
+
+	frame->refcnt++;
+	node->rxq[node->rxq_head++ % SIM_RXQ_SLOTS] = frame;
+	if (node->notify != NULL) {
+		sim_timer(0, _sim_notify, node);
+	}
+}
+
+static uint16_t _sim_node_recv(struct hw_stub_ctx *stub, uint8_t *buffer, uint16_t buflen)
+{
+	struct sim_node *node = stub->priv;
+	struct sim_frame *frame;
+	uint16_t len;
+
+	if (node->rxq_head == node->rxq_tail) {
+		return 0;
+	}
+	frame = node->rxq[node->rxq_tail++ % SIM_RXQ_SLOTS];
+
+	/* Frames larger than the buffer are dropped, as by the drivers */
+	len = (frame->len <= buflen) ? frame->len : 0;
+	memcpy(buffer, frame->data, len);
+	if (--frame->refcnt == 0) {
+		free(frame);
+	}
+	node->rx_frames++;
+
+	return len;
+}
+
+static uint16_t _sim_node_send(struct hw_stub_ctx *stub, uint8_t *buffer, uint16_t buflen)
+{
+	struct sim_node *node = stub->priv;
+	struct sim_node *peer;
+	struct sim_frame *frame;
+	struct sim_event event;
+	uint64_t start_us;
+
+	node->tx_frames++;
+
+	/* The transmission time is spent even by lost frames */
+	start_us = (node->busy_until_us > now_us) ? node->busy_until_us : now_us;
+	node->busy_until_us = start_us;
+	if (node->bandwidth > 0) {
+		node->busy_until_us += (uint64_t) buflen * 8 * 1000000 / node->bandwidth;
+	}
+
+	if (sim_random(65536) < node->loss) {
+		node->lost++;
+		return buflen;
+	}
+
+	frame = malloc(sizeof(struct sim_frame) + buflen);
+	if (frame == NULL) {
+		return 0;
+	}
+	frame->refcnt = 1;
+	frame->len = buflen;
+	memcpy(frame->data, buffer, buflen);
+
+	/* Jitter is drawn for each destination, frames may be reordered */
+	for (peer=node->segment->nodes; peer!=NULL; peer=peer->next) {
+		if (peer == node) {
+			continue;
+		}
+		event.at_us = node->busy_until_us + node->latency_us + sim_random(node->jitter_us + 1);
+		event.callback = NULL;
+		event.arg = peer;
+		event.frame = frame;
+		if (_sim_heap_push(&deliveries, &event) == 0) {
+			frame->refcnt++;
+		}
+	}
+	if (--frame->refcnt == 0) {
+		free(frame);
+	}
+
+	return buflen;
+}
+
+void sim_node_init(struct sim_node *node, struct sim_segment *segment)
+{
+	memset(node, 0, sizeof(*node));
+	node->hw.recv_cback = _sim_node_recv;
+	node->hw.send_cback = _sim_node_send;
+	node->hw.priv = node;
+
+	node->segment = segment;
+	node->next = segment->nodes;
+	segment->nodes = node;
+}
+
+void sim_set_link(struct sim_node *node, uint32_t latency_us, uint32_t jitter_us,
+                  uint16_t loss, uint32_t bandwidth)
+{
+	node->latency_us = latency_us;
+	node->jitter_us = jitter_us;
+	node->loss = loss;
+	node->bandwidth = bandwidth;
+}
+
+/*
+ * Scheduler
+ */
+
+/* Earliest queue, deliveries first at the same time */
+static struct sim_heap *_sim_next(void)
+{
+	struct sim_event *delivery = _sim_heap_top(&deliveries);
+	struct sim_event *timer = _sim_heap_top(&timers);
+
+	if ((delivery != NULL) && ((timer == NULL) || (delivery->at_us <= timer->at_us))) {
+		return &deliveries;
+	}
+	return (timer != NULL) ? &timers : NULL;
+}
+
+bool sim_step(void)
+{
+	struct sim_heap *heap = _sim_next();
+
+	if (heap == NULL) {
+		return false;
+	}
+	_sim_run_event(heap);
+
+	return true;
+}
+
+void sim_run(uint64_t until_us)
+{
+	struct sim_heap *heap;
+
+	while (((heap = _sim_next()) != NULL) && (_sim_heap_top(heap)->at_us <= until_us)) {
+		_sim_run_event(heap);
+	}
+	if (until_us > now_us) {
+		now_us = until_us;
+	}
+}
+
+void sim_run_all(void)
+{
+	while (sim_step()) {
+	}
+}
@@ -0,0 +1,107 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _SIM_H
+#define _SIM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "hw_stub.h"
+
+/**
+ * Discrete-event network simulator, on a virtual clock.
+ *
+ * Any number of stacks run in one thread, each on the hw_stub link of a
+ * sim_node. Nodes are attached to segments: a frame sent by a node is
+ * delivered to every other node of its segment (the MAC layers filter their
+ * destination address), after the delay of the link of the sender, given by
+ * its latency, a random jitter and its bandwidth, unless the loss model drops
+ * it. Delivered frames wait in the receive queue of the node until read by
+ * hw_stub_recv(), the notify callback of the node being called meanwhile.
+ *
+ * Time only advances from one event to the next: deliveries, and timers set
+ * by the applications with sim_timer(). sim_init() installs the virtual clock
+ * as the clock source of the POSIX platform, so clock_us() returns the
+ * virtual time, and msleep() advances it, delivering the frames due in the
+ * meantime (other events, timers and notifications, are run afterwards by
+ * sim_run()). Randomness comes from a seeded generator: a simulation is
+ * reproducible from its seed.
+ */
+
+#ifndef SIM_RXQ_SLOTS
+#define SIM_RXQ_SLOTS 16  /* Power of 2 */
+#endif
+
+typedef void (*sim_event_callback)(void *arg);
+
+struct sim_frame;
+struct sim_node;
+
+struct sim_segment {
+	struct sim_node *nodes;
+};
+
+struct sim_node {
+	struct hw_stub_ctx hw;     /* Lower layer of the MAC context */
+	struct sim_segment *segment;
+	struct sim_node *next;     /* In the segment */
+
+	/* Link of the node, for the frames it sends */
+	uint32_t latency_us;
+	uint32_t jitter_us;        /* Uniform, added to the latency */
+	uint16_t loss;             /* Per 65536 */
+	uint32_t bandwidth;        /* Bits per second, 0 for no limit */
+	uint64_t busy_until_us;    /* End of the transmission of the last frame */
+
+	/* Called when a frame is queued, optional */
+	void (*notify)(struct sim_node *node);
+	void *priv;
+
+	struct sim_frame *rxq[SIM_RXQ_SLOTS];
+	uint16_t rxq_head;
+	uint16_t rxq_tail;
+
+	uint32_t tx_frames;
+	uint32_t rx_frames;
+	uint32_t lost;             /* By the loss model of the node */
+	uint32_t overflows;        /* Receive queue full */
+};
+
+/* Reset the simulation to the time 0, and install the virtual clock */
+extern void sim_init(uint32_t seed);
+/* Free the pending events, and restore the monotonic clock */
+extern void sim_destroy(void);
+
+extern uint64_t sim_now(void);
+/* Uniform random value in [0, range) */
+extern uint32_t sim_random(uint32_t range);
+
+/* Call callback(arg) after a delay. Returns 0, or -1 when out of memory */
+extern int sim_timer(uint64_t delay_us, sim_event_callback callback, void *arg);
+
+extern void sim_node_init(struct sim_node *node, struct sim_segment *segment);
+/* Link of the node: latency, jitter, loss per 65536 frames, bits per second */
+extern void sim_set_link(struct sim_node *node, uint32_t latency_us, uint32_t jitter_us,
+                         uint16_t loss, uint32_t bandwidth);
+
+/* Run the next event. Returns false if there is none */
+extern bool sim_step(void);
+/* Run the events up to a time, then advance the clock to it */
+extern void sim_run(uint64_t until_us);
+/* Run the events until there are none left */
+extern void sim_run_all(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,38 @@
+#!/usr/bin/env python
+#
+# Copyright (c) 2024 Emmanuel Thierry
+#
+# SPDX-License-Identifier: BSD-3-Clause
+#
+# Print the stack frame of each function, from the .su files of -fstack-usage,
+# largest first.
+#   stack_usage.py <file.su>...
+
+from __future__ import print_function
+
+import os
+import sys
+
+
+if len(sys.argv) < 2:
+    print("usage: %s <file.su>..." % sys.argv[0])
+    sys.exit(2)
+
+rows = []
+for path in sys.argv[1:]:
+    with open(path) as f:
+        for line in f:
+            # <file>:<line>:<column>:<function>	<bytes>	<static|dynamic|bounded>
+            fields = line.rstrip("\n").split("\t")
+            if len(fields) != 3:
+                continue
+            location, size, kind = fields
+            function = location.rsplit(":", 1)[-1]
+            rows.append((int(size), os.path.basename(location.split(":", 1)[0]),
+                         function, kind))
+
+rows.sort(key=lambda r: (-r[0], r[1], r[2]))
+
+print("%6s  %-16s %-32s %s" % ("bytes", "file", "function", "kind"))
+for size, source, function, kind in rows:
+    print("%6d  %-16s %-32s %s" % (size, source, function, kind))
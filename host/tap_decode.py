@@ -0,0 +1,91 @@
+#!/usr/bin/env python
+#
+# Copyright (c) 2024 Emmanuel Thierry
+#
+# SPDX-License-Identifier: BSD-3-Clause
+#
+# Convert the frames captured by net_tap.h over serial into pcapng.
+#   tap_decode.py <serial log> <pcapng>
+#
+# The log contains the "D: tap ..." lines written by the serial writer of
+# the tap: each record is a 10 bytes header followed by the captured data.
+
+from __future__ import print_function
+
+import binascii
+import re
+import struct
+import sys
+
+
+RECORD_LEN = 10
+DIR_OUT = 0x80
+REASON_NONE = 0x7F
+
+# Indexed by NET_STATS_DROP_*
+REASONS = ["len", "proto", "type", "addr", "port", "token", "unsupp", "rate"]
+
+
+def load(path):
+    with open(path, "rb") as f:
+        data = f.read()
+
+    hexdata = b"".join(re.findall(rb"D: tap ([0-9A-F]+)\s*$", data, re.M))
+    data = binascii.unhexlify(hexdata)
+
+    records = []
+    pos = 0
+    while pos + RECORD_LEN <= len(data):
+        time_us, length, caplen, flags, skipped = struct.unpack(">IHBBH", data[pos:pos+RECORD_LEN])
+        pos += RECORD_LEN
+        records.append((time_us, length, flags, skipped, data[pos:pos+caplen]))
+        pos += caplen
+
+    return records
+
+
+def pad4(data):
+    return data + b"\0" * (-len(data) % 4)
+
+
+def block(kind, body):
+    length = 12 + len(body)
+    return struct.pack("<II", kind, length) + body + struct.pack("<I", length)
+
+
+def option(code, value):
+    return struct.pack("<HH", code, len(value)) + pad4(value)
+
+
+def write(path, records):
+    with open(path, "wb") as f:
+        f.write(block(0x0A0D0D0A, struct.pack("<IHHq", 0x1A2B3C4D, 1, 0, -1)))
+        f.write(block(0x00000001, struct.pack("<HHI", 1, 0, 255)))
+
+        high = 0
+        last = 0
+        for time_us, length, flags, skipped, data in records:
+            if time_us < last:
+                high += 1
+            last = time_us
+
+            opts = option(2, struct.pack("<I", 2 if flags & DIR_OUT else 1))
+            if skipped:
+                opts += option(4, struct.pack("<Q", skipped))
+            reason = flags & ~DIR_OUT
+            if reason != REASON_NONE:
+                name = REASONS[reason] if reason < len(REASONS) else str(reason)
+                opts += option(1, ("drop: " + name).encode())
+            opts += option(0, b"")
+
+            f.write(block(0x00000006, struct.pack("<IIIII", 0, high, time_us, len(data), length) +
+                          pad4(data) + opts))
+
+
+if len(sys.argv) != 3:
+    print("usage: %s <serial log> <pcapng>" % sys.argv[0])
+    sys.exit(2)
+
+records = load(sys.argv[1])
+write(sys.argv[2], records)
+print("%d frames, %d skipped" % (len(records), sum(r[3] for r in records)))
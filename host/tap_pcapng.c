@@ -0,0 +1,161 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "config.h"
+#include "net_tap.h"
+#include "tap_pcapng.h"
+
+#include <string.h>
+#include <unistd.h>
+
+
+#define PCAPNG_SHB          0x0A0D0D0A
+#define PCAPNG_IDB          0x00000001
+#define PCAPNG_EPB          0x00000006
+#define PCAPNG_MAGIC        0x1A2B3C4D
+#define PCAPNG_LINKTYPE_ETH 1
+
+#define OPT_ENDOFOPT        0
+#define OPT_COMMENT         1
+#define OPT_EPB_FLAGS       2
+#define OPT_EPB_DROPCOUNT   4
+
+#define EPB_FLAGS_INBOUND   0x00000001
+#define EPB_FLAGS_OUTBOUND  0x00000002
+
+#define PAD4(len)           (((len) + 3) & ~3)
+
+struct tap_pcapng {
+	int fd;
+	uint8_t snaplen;
+	uint16_t budget;
+	uint32_t high;       /* Upper 32 bits of the timestamps */
+	uint32_t last_us;
+};
+
+static struct tap_pcapng pcapng;
+
+/* Indexed by NET_STATS_DROP_* */
+static const char * const reasons[NET_STATS_DROP_CNT] = {
+	"len", "proto", "type", "addr", "port", "token", "unsupp", "rate",
+};
+
+
+/* Blocks are written in host order, as told by the byte-order magic */
+static uint16_t put16(uint8_t *block, uint16_t pos, uint16_t value)
+{
+	memcpy(&block[pos], &value, sizeof(value));
+	return pos + sizeof(value);
+}
+
+static uint16_t put32(uint8_t *block, uint16_t pos, uint32_t value)
+{
+	memcpy(&block[pos], &value, sizeof(value));
+	return pos + sizeof(value);
+}
+
+static uint16_t put_option(uint8_t *block, uint16_t pos, uint16_t code,
+                           const void *value, uint16_t len)
+{
+	pos = put16(block, pos, code);
+	pos = put16(block, pos, len);
+	if (len > 0) {
+		memcpy(&block[pos], value, len);
+		memset(&block[pos+len], 0, PAD4(len) - len);
+	}
+	return pos + PAD4(len);
+}
+
+static int write_block(uint8_t *block, uint16_t len)
+{
+	/* The total length is both after the type and at the end */
+	put32(block, 4, len + 4);
+	put32(block, len, len + 4);
+	len += 4;
+
+	return (write(pcapng.fd, block, len) == len) ? 0 : -1;
+}
+
+static void tap_pcapng_write(void *priv, const struct net_tap_record *record,
+                             const uint8_t *data)
+{
+	uint8_t block[28 + PAD4(255) + 12 + 12 + 20 + 4 + 4];
+	char comment[16] = "drop: ";
+	uint8_t reason = record->flags & ~NET_TAP_DIR_OUT;
+	uint32_t flags;
+	uint64_t dropcount;
+	uint16_t pos;
+
+	if (record->time_us < pcapng.last_us) {
+		pcapng.high++;
+	}
+	pcapng.last_us = record->time_us;
+
+	pos = put32(block, 0, PCAPNG_EPB);
+	pos = put32(block, pos + 4, 0);  /* Interface */
+	pos = put32(block, pos, pcapng.high);
+	pos = put32(block, pos, record->time_us);
+	pos = put32(block, pos, record->caplen);
+	pos = put32(block, pos, record->len);
+	memcpy(&block[pos], data, record->caplen);
+	memset(&block[pos + record->caplen], 0, PAD4(record->caplen) - record->caplen);
+	pos += PAD4(record->caplen);
+
+	flags = (record->flags & NET_TAP_DIR_OUT) ? EPB_FLAGS_OUTBOUND : EPB_FLAGS_INBOUND;
+	pos = put_option(block, pos, OPT_EPB_FLAGS, &flags, sizeof(flags));
+	if (record->skipped > 0) {
+		dropcount = record->skipped;
+		pos = put_option(block, pos, OPT_EPB_DROPCOUNT, &dropcount, sizeof(dropcount));
+	}
+	if (reason < NET_STATS_DROP_CNT) {
+		strcpy(&comment[6], reasons[reason]);
+		pos = put_option(block, pos, OPT_COMMENT, comment, strlen(comment));
+	}
+	pos = put_option(block, pos, OPT_ENDOFOPT, NULL, 0);
+
+	write_block(block, pos);
+}
+
+int tap_pcapng_open(int fd, uint8_t snaplen, uint16_t budget)
+{
+	uint8_t block[32];
+	uint16_t pos;
+
+	pcapng.fd = fd;
+	pcapng.snaplen = snaplen;
+	pcapng.budget = budget;
+	pcapng.high = 0;
+	pcapng.last_us = 0;
+
+	/* Section header, of unspecified length */
+	pos = put32(block, 0, PCAPNG_SHB);
+	pos = put32(block, pos + 4, PCAPNG_MAGIC);
+	pos = put16(block, pos, 1);  /* Version 1.0 */
+	pos = put16(block, pos, 0);
+	pos = put32(block, pos, 0xFFFFFFFF);
+	pos = put32(block, pos, 0xFFFFFFFF);
+	if (write_block(block, pos) < 0) {
+		return -1;
+	}
+
+	/* Ethernet interface, with the default resolution of microseconds */
+	pos = put32(block, 0, PCAPNG_IDB);
+	pos = put16(block, pos + 4, PCAPNG_LINKTYPE_ETH);
+	pos = put16(block, pos, 0);
+	pos = put32(block, pos, snaplen);
+	if (write_block(block, pos) < 0) {
+		return -1;
+	}
+
+	tap_pcapng_resume();
+
+	return 0;
+}
+
+void tap_pcapng_resume()
+{
+	net_tap_open(tap_pcapng_write, NULL, pcapng.snaplen, pcapng.budget);
+}
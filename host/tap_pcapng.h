@@ -0,0 +1,36 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _TAP_PCAPNG_H
+#define _TAP_PCAPNG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * pcapng writer of the frame tap (net_tap.h), for hosts.
+ *
+ * The file starts with a section header and an Ethernet interface, then
+ * each record is an enhanced packet block with its direction (epb_flags),
+ * the frames skipped before it (epb_dropcount) and, for the frames dropped
+ * by the MAC layer, a "drop: <reason>" comment. Timestamps are those of
+ * clock_us(), extended to 64 bits.
+ *
+ * Returns 0, or -1 if the headers cannot be written.
+ */
+extern int tap_pcapng_open(int fd, uint8_t snaplen, uint16_t budget);
+
+/* Capture to the same file again, after the tap was opened with another writer */
+extern void tap_pcapng_resume();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
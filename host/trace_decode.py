@@ -0,0 +1,121 @@
+#!/usr/bin/env python
+#
+# Copyright (c) 2024 Emmanuel Thierry
+#
+# SPDX-License-Identifier: BSD-3-Clause
+#
+# Decode the trace ring of net_trace.h into per-layer latency histograms.
+#   trace_decode.py <trace>
+#
+# The trace is either a binary file of records (host/loopback -T), or a
+# serial log containing the "D: trace ..." lines of net_trace_dump().
+
+from __future__ import print_function
+
+import binascii
+import re
+import struct
+import sys
+
+
+RECORD_LEN = 7
+EXIT = 0x01
+
+NAMES = {
+    0x02: "spi",
+    0x04: "link_recv",
+    0x06: "link_send",
+    0x08: "mac_recv",
+    0x0A: "mac_send",
+    0x0C: "ip6_recv",
+    0x0E: "ip6_send",
+    0x10: "udp_recv",
+    0x12: "udp_send",
+    0x14: "coap_recv",
+    0x16: "coap_send",
+    0x18: "lowpan_recv",
+    0x1A: "lowpan_send",
+}
+
+
+def load(path):
+    with open(path, "rb") as f:
+        data = f.read()
+
+    # Serial logs: hexadecimal records after "trace "
+    if b"D: trace " in data:
+        hexdata = b"".join(re.findall(rb"D: trace ([0-9A-F]+)\s*$", data, re.M))
+        data = binascii.unhexlify(hexdata)
+
+    return [struct.unpack(">BIH", data[i:i+RECORD_LEN])
+            for i in range(0, len(data) - RECORD_LEN + 1, RECORD_LEN)]
+
+
+def latencies(records):
+    """Match entries and exits, nested calls being on a stack"""
+    stack = []
+    total = {}
+    own = {}
+    unmatched = 0
+
+    for event, time_us, length in records:
+        if not event & EXIT:
+            stack.append([event, time_us, 0])
+            continue
+
+        # Drop the entries whose exit was lost (ring overwritten)
+        while stack and stack[-1][0] != event & ~EXIT:
+            stack.pop()
+            unmatched += 1
+        if not stack:
+            unmatched += 1
+            continue
+
+        kind, start, children = stack.pop()
+        elapsed = (time_us - start) & 0xFFFFFFFF
+        total.setdefault(kind, []).append(elapsed)
+        own.setdefault(kind, []).append(elapsed - children)
+        if stack:
+            stack[-1][2] += elapsed
+
+    return total, own, unmatched + len(stack)
+
+
+def percentile(values, p):
+    return values[min(len(values) - 1, int(len(values) * p / 100.0))]
+
+
+def histogram(values):
+    """Power of 2 buckets, in microseconds"""
+    buckets = {}
+    for v in values:
+        buckets[v.bit_length()] = buckets.get(v.bit_length(), 0) + 1
+    width = max(buckets.values())
+    for b in sorted(buckets):
+        low = (1 << (b - 1)) if b > 0 else 0
+        high = (1 << b) - 1
+        print("    %7d-%-7d us %8d %s" % (low, high, buckets[b],
+                                           "#" * max(1, 40 * buckets[b] // width)))
+
+
+if len(sys.argv) != 2:
+    print("usage: %s <trace>" % sys.argv[0])
+    sys.exit(2)
+
+records = load(sys.argv[1])
+total, own, unmatched = latencies(records)
+
+print("%d records, %d unmatched" % (len(records), unmatched))
+print("%-10s %8s %8s %8s %8s %8s %10s" %
+      ("layer", "calls", "min", "p50", "p90", "max", "p50 (own)"))
+for kind in sorted(total):
+    values = sorted(total[kind])
+    print("%-10s %8d %8d %8d %8d %8d %10d" %
+          (NAMES.get(kind, "0x%02x" % kind), len(values), values[0],
+           percentile(values, 50), percentile(values, 90), values[-1],
+           percentile(sorted(own[kind]), 50)))
+
+for kind in sorted(total):
+    print("")
+    print("%s:" % NAMES.get(kind, "0x%02x" % kind))
+    histogram(total[kind])
@@ -0,0 +1,271 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/**
+ * Request/response benchmark over the virtual hub.
+ *
+ * Pairs of stacks, each in its own thread, share one hub: the client of a
+ * pair sends UDP requests numbered by a sequence, retransmitted after a
+ * timeout, and the server echoes them. The hub forwards every frame to its
+ * pair by MAC address, all the pairs contending for the hub. The link of
+ * every port has the latency, loss and bandwidth given as options.
+ *
+ * Must be built with -DNET_LINK_VHUB.
+ */
+
+#include "config.h"
+#include "platform.h"
+#include "platform_posix.h"
+#include "net_utils.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef NET_LINK_VHUB
+#error "The hub benchmark must be built with NET_LINK_VHUB"
+#endif
+
+#define FRAME_MAXLEN 1514
+
+
+struct node {
+	struct hw_vhub_ctx hw;
+	struct net_mac_ctx mac;
+	struct net_ip6_ctx ip6;
+	struct net_udp_ctx udp;
+	net_mac_mcsuffix_t mcsuffixes[NET_IP6_L2_MCSUFFIX_CNT];
+	uint8_t l2addr[6];
+	uint8_t addr[16];
+	uint8_t buffer[FRAME_MAXLEN];
+
+	pthread_t thread;
+	uint32_t exchanges;
+	uint32_t retransmissions;
+};
+
+static struct hw_vhub *hub;
+static struct node *nodes;
+static uint8_t pairs = 4;
+static uint32_t count = 10000;
+static uint32_t latency_us = 0;
+static uint16_t loss = 0;
+static uint32_t bandwidth = 0;
+static uint32_t rto_us = 0;
+static atomic_bool stop = false;
+
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+/* Port n has the MAC address 02::n and the IPv6 address 2001:db8::n+1 */
+static void node_set_addresses(struct node *node, uint8_t port)
+{
+	node->l2addr[0] = 0x02;
+	node->l2addr[5] = port;
+	node->addr[0] = 0x20;
+	node->addr[1] = 0x01;
+	node->addr[2] = 0x0d;
+	node->addr[3] = 0xb8;
+	node->addr[15] = port + 1;
+}
+
+static void node_init(struct node *node, uint8_t port)
+{
+	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(node->addr);
+
+	memcpy(node->mcsuffixes, mcsuffixes, sizeof(node->mcsuffixes));
+
+	node->mac.lower = &node->hw;
+	node->ip6.lower = &node->mac;
+	node->udp.lower = &node->ip6;
+
+	if (hw_vhub_attach(&node->hw, hub, port, node->l2addr) < 0) {
+		fprintf(stderr, "port %u: cannot attach\n", port);
+		exit(1);
+	}
+	hw_vhub_set_link(&node->hw, latency_us, loss, bandwidth);
+
+	net_mac_set_source_addr(&node->mac, node->l2addr);
+	net_mac_set_ethertype(&node->mac, NET_MAC_ETHERTYPE_IPV6);
+	net_mac_set_ip6mcast(&node->mac, NET_IP6_L2_MCSUFFIX_CNT, node->mcsuffixes);
+	net_ip6_set_source_addr(&node->ip6, node->addr);
+	net_ip6_set_nexthdr(&node->ip6, NET_IP6_NH_UDP);
+}
+
+static void node_connect(struct node *node, struct node *peer, uint16_t port, uint16_t peer_port)
+{
+	net_mac_set_destination_addr(&node->mac, peer->l2addr);
+	net_ip6_set_destination_addr(&node->ip6, peer->addr);
+	net_udp_set_source_port(&node->udp, port);
+	net_udp_set_destination_port(&node->udp, peer_port);
+	net_udp_connect(&node->udp);
+}
+
+static void *client_run(void *arg)
+{
+	struct node *node = arg;
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+	bool answered;
+	uint32_t sent_us;
+	uint32_t seq;
+	uint8_t *cursor;
+	uint32_t value;
+
+	for (seq=0; seq<count; seq++) {
+		answered = false;
+		while (!answered) {
+			dataoffset = net_udp_pload_pos(&node->udp);
+			NET_SET_CURSOR(node->buffer, dataoffset);
+			NET_PUT_INT(seq);
+			net_udp_send(&node->udp, node->buffer, FRAME_MAXLEN, dataoffset, 4);
+			sent_us = clock_us();
+
+			/* Replies to a previous request are ignored */
+			while (!answered && ((uint32_t) (clock_us() - sent_us) < rto_us)) {
+				if ((net_udp_recv(&node->udp, node->buffer, FRAME_MAXLEN,
+				                  &dataoffset, &datalen) == NET_STATUS_OK) &&
+				    (datalen == 4)) {
+					NET_SET_CURSOR(node->buffer, dataoffset);
+					NET_GET_INT(value);
+					answered = (value == seq);
+				} else {
+					sched_yield();
+				}
+			}
+			if (!answered) {
+				node->retransmissions++;
+			}
+		}
+
+		node->exchanges++;
+	}
+
+	return NULL;
+}
+
+static void *server_run(void *arg)
+{
+	struct node *node = arg;
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+
+	while (!atomic_load(&stop)) {
+		if (net_udp_recv(&node->udp, node->buffer, FRAME_MAXLEN,
+		                 &dataoffset, &datalen) != NET_STATUS_OK) {
+			/* Idle threads leave the CPU to the others */
+			sched_yield();
+			continue;
+		}
+		net_udp_send(&node->udp, node->buffer, FRAME_MAXLEN, dataoffset, datalen);
+	}
+
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	struct hw_vhub_port *port;
+	uint32_t exchanges = 0;
+	uint32_t retransmissions = 0;
+	uint32_t lost = 0;
+	uint32_t overflows = 0;
+	uint64_t start;
+	double elapsed;
+	uint8_t i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "p:n:l:L:b:r:")) != -1) {
+		switch (opt) {
+		case 'p':
+			pairs = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			count = strtoul(optarg, NULL, 0);
+			break;
+		case 'l':
+			latency_us = strtoul(optarg, NULL, 0);
+			break;
+		case 'L':
+			loss = strtod(optarg, NULL) * 65536 / 100;
+			break;
+		case 'b':
+			bandwidth = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			rto_us = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-p pairs] [-n exchanges] [-l latency_us] "
+			                "[-L loss%%] [-b bit/s] [-r rto_us]\n", argv[0]);
+			return 2;
+		}
+	}
+	if ((pairs == 0) || (2 * pairs > HW_VHUB_PORTS)) {
+		fprintf(stderr, "1 to %u pairs\n", HW_VHUB_PORTS / 2);
+		return 2;
+	}
+	if (rto_us == 0) {
+		rto_us = 4 * latency_us + 10000;
+	}
+
+	hub = hw_vhub_create(NULL);
+	nodes = calloc(2 * pairs, sizeof(struct node));
+	if ((hub == NULL) || (nodes == NULL)) {
+		perror("hub");
+		return 1;
+	}
+	for (i=0; i<2*pairs; i++) {
+		node_set_addresses(&nodes[i], i);
+		node_init(&nodes[i], i);
+	}
+	for (i=0; i<pairs; i++) {
+		node_connect(&nodes[2*i], &nodes[2*i+1], 1234, 5683);
+		node_connect(&nodes[2*i+1], &nodes[2*i], 5683, 1234);
+	}
+
+	start = now_ns();
+	for (i=0; i<2*pairs; i++) {
+		pthread_create(&nodes[i].thread, NULL, (i % 2) ? server_run : client_run, &nodes[i]);
+	}
+	for (i=0; i<pairs; i++) {
+		pthread_join(nodes[2*i].thread, NULL);
+	}
+	elapsed = (now_ns() - start) / 1e9;
+	atomic_store(&stop, true);
+	for (i=0; i<pairs; i++) {
+		pthread_join(nodes[2*i+1].thread, NULL);
+	}
+
+	for (i=0; i<2*pairs; i++) {
+		port = hw_vhub_get_port(&nodes[i].hw);
+		exchanges += nodes[i].exchanges;
+		retransmissions += nodes[i].retransmissions;
+		lost += port->lost;
+		overflows += port->overflows;
+	}
+
+	printf("%u pairs, %u exchanges in %.3f s, %.0f exchanges/s\n", pairs, exchanges,
+	       elapsed, exchanges / elapsed);
+	printf("%u retransmissions, %u frames lost, %u ring overflows\n",
+	       retransmissions, lost, overflows);
+
+	hw_vhub_unmap(hub);
+	free(nodes);
+
+	return 0;
+}
@@ -0,0 +1,267 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "w5500_model.h"
+
+#include <string.h>
+
+
+#define PHASE_ADDR_H    0
+#define PHASE_ADDR_L    1
+#define PHASE_CONTROL   2
+#define PHASE_DATA      3
+
+#define BSB_COMMON_REG  0x00
+#define BSB_SOCKET0_REG 0x01
+#define BSB_SOCKET0_TXB 0x02
+#define BSB_SOCKET0_RXB 0x03
+
+#define RWB_WRITE       0x04
+
+#define CR_MR           0x00
+#define CR_PHYCFGR      0x2E
+#define CR_VERSIONR     0x39
+
+#define SR_SNMR         0x00
+#define SR_SNCR         0x01
+#define SR_SNSR         0x03
+#define SR_SNTXFSR      0x20
+#define SR_SNTXRD       0x22
+#define SR_SNTXWR       0x24
+#define SR_SNRXRSR      0x26
+#define SR_SNRXRD       0x28
+#define SR_SNRXWR       0x2A
+
+#define MR_RST          0x80
+#define PHYCFG_RST      0x80
+#define PHYCFG_OMPDC    0x38
+#define PHYCFG_POWER_DOWN 0x30
+#define PHYCFG_LINK_100FD 0x07
+
+#define SNMR_PROTO_MACRAW 0x04
+#define SNCR_OPEN       0x01
+#define SNCR_CLOSE      0x10
+#define SNCR_SEND       0x20
+#define SNCR_RECV       0x40
+#define SNSR_SOCK_CLOSED 0x00
+#define SNSR_SOCK_MACRAW 0x42
+
+#define BUFMASK (W5500_MODEL_BUFSIZE - 1)
+
+
+static uint16_t _get16(uint8_t *regs, uint8_t addr)
+{
+	return (regs[addr] << 8) | regs[addr+1];
+}
+
+static void _set16(uint8_t *regs, uint8_t addr, uint16_t value)
+{
+	regs[addr] = (value & 0xFF00) >> 8;
+	regs[addr+1] = value & 0x00FF;
+}
+
+static void _w5500_model_reset(struct w5500_model *model)
+{
+	memset(model->common, 0, sizeof(model->common));
+	memset(model->socket0, 0, sizeof(model->socket0));
+
+	model->common[CR_PHYCFGR] = PHYCFG_RST | PHYCFG_OMPDC | PHYCFG_LINK_100FD;
+	model->common[CR_VERSIONR] = 0x04;
+	model->socket0[0x1E] = 2;  /* Sn_RXBUF_SIZE, in KB */
+	model->socket0[0x1F] = 2;  /* Sn_TXBUF_SIZE, in KB */
+}
+
+static void _w5500_model_command(struct w5500_model *model, uint8_t command)
+{
+	uint8_t frame[W5500_MODEL_BUFSIZE];
+	uint16_t txrd, txwr, len, i;
+
+	switch (command) {
+	case SNCR_OPEN:
+		if ((model->socket0[SR_SNMR] & 0x0F) == SNMR_PROTO_MACRAW) {
+			model->socket0[SR_SNSR] = SNSR_SOCK_MACRAW;
+		}
+		break;
+
+	case SNCR_CLOSE:
+		model->socket0[SR_SNSR] = SNSR_SOCK_CLOSED;
+		break;
+
+	case SNCR_SEND:
+		/* In MACRAW mode, the frame is the data between TX_RD and TX_WR */
+		txrd = _get16(model->socket0, SR_SNTXRD);
+		txwr = _get16(model->socket0, SR_SNTXWR);
+		len = (uint16_t) (txwr - txrd) & BUFMASK;
+		for (i=0; i<len; i++) {
+			frame[i] = model->txbuf[(txrd + i) & BUFMASK];
+		}
+		_set16(model->socket0, SR_SNTXRD, txwr);
+		if ((len > 0) && (model->tx_cback != NULL)) {
+			model->tx_cback(model, frame, len);
+		}
+		break;
+
+	case SNCR_RECV:
+		/* RX_RSR is computed from RX_WR and RX_RD */
+	default:
+		break;
+	}
+}
+
+static uint8_t _w5500_model_read(struct w5500_model *model, uint8_t bsb, uint16_t addr)
+{
+	uint16_t value;
+
+	switch (bsb) {
+	case BSB_COMMON_REG:
+		if (addr == CR_MR) {
+			/* Reset completes immediately */
+			return model->common[CR_MR] & ~MR_RST;
+		}
+		return (addr < sizeof(model->common)) ? model->common[addr] : 0;
+
+	case BSB_SOCKET0_REG:
+		switch (addr) {
+		case SR_SNCR:
+			/* Commands complete immediately */
+			return 0;
+		case SR_SNTXFSR:
+		case SR_SNTXFSR+1:
+			value = W5500_MODEL_BUFSIZE - (uint16_t) (_get16(model->socket0, SR_SNTXWR) -
+			                                          _get16(model->socket0, SR_SNTXRD));
+			return (addr == SR_SNTXFSR) ? (value >> 8) : (value & 0xFF);
+		case SR_SNRXRSR:
+		case SR_SNRXRSR+1:
+			value = _get16(model->socket0, SR_SNRXWR) - _get16(model->socket0, SR_SNRXRD);
+			return (addr == SR_SNRXRSR) ? (value >> 8) : (value & 0xFF);
+		}
+		return (addr < sizeof(model->socket0)) ? model->socket0[addr] : 0;
+
+	case BSB_SOCKET0_TXB:
+		return model->txbuf[addr & BUFMASK];
+
+	case BSB_SOCKET0_RXB:
+		return model->rxbuf[addr & BUFMASK];
+	}
+
+	return 0;
+}
+
+static void _w5500_model_write(struct w5500_model *model, uint8_t bsb, uint16_t addr,
+                               uint8_t value)
+{
+	switch (bsb) {
+	case BSB_COMMON_REG:
+		if ((addr == CR_MR) && (value & MR_RST)) {
+			_w5500_model_reset(model);
+		} else if (addr == CR_PHYCFGR) {
+			/* PHY reset completes immediately, the link is up unless powered down */
+			model->common[addr] = (value & PHYCFG_OMPDC) | PHYCFG_RST;
+			if ((value & PHYCFG_OMPDC) != PHYCFG_POWER_DOWN) {
+				model->common[addr] |= PHYCFG_LINK_100FD;
+			}
+		} else if ((addr < sizeof(model->common)) && (addr != CR_VERSIONR)) {
+			model->common[addr] = value;
+		}
+		break;
+
+	case BSB_SOCKET0_REG:
+		if (addr == SR_SNCR) {
+			_w5500_model_command(model, value);
+		} else if ((addr == SR_SNSR) || (addr == SR_SNTXFSR) || (addr == SR_SNTXFSR+1) ||
+		           (addr == SR_SNRXRSR) || (addr == SR_SNRXRSR+1)) {
+			/* Read-only */
+		} else if (addr < sizeof(model->socket0)) {
+			model->socket0[addr] = value;
+		}
+		break;
+
+	case BSB_SOCKET0_TXB:
+		model->txbuf[addr & BUFMASK] = value;
+		break;
+
+	case BSB_SOCKET0_RXB:
+		model->rxbuf[addr & BUFMASK] = value;
+		break;
+	}
+}
+
+static void _w5500_model_select(struct spi_posix_device *device, bool selected)
+{
+	struct w5500_model *model = (struct w5500_model *) device;
+
+	/* A new frame starts at each chip select */
+	model->phase = PHASE_ADDR_H;
+}
+
+static uint8_t _w5500_model_transfer(struct spi_posix_device *device, uint8_t value)
+{
+	struct w5500_model *model = (struct w5500_model *) device;
+	uint8_t reply;
+
+	switch (model->phase) {
+	case PHASE_ADDR_H:
+		model->addr = value << 8;
+		model->phase = PHASE_ADDR_L;
+		return 0x01;
+
+	case PHASE_ADDR_L:
+		model->addr |= value;
+		model->phase = PHASE_CONTROL;
+		return 0x02;
+
+	case PHASE_CONTROL:
+		model->control = value;
+		model->phase = PHASE_DATA;
+		return 0x03;
+
+	default:
+		/* Written bytes are echoed, so that full-duplex writes keep the buffer intact */
+		if (model->control & RWB_WRITE) {
+			_w5500_model_write(model, model->control >> 3, model->addr, value);
+			reply = value;
+		} else {
+			reply = _w5500_model_read(model, model->control >> 3, model->addr);
+		}
+		model->addr++;
+		return reply;
+	}
+}
+
+void w5500_model_init(struct w5500_model *model)
+{
+	memset(model, 0, sizeof(*model));
+
+	model->spi.select = _w5500_model_select;
+	model->spi.transfer = _w5500_model_transfer;
+
+	_w5500_model_reset(model);
+}
+
+bool w5500_model_inject(struct w5500_model *model, const uint8_t *frame, uint16_t len)
+{
+	uint16_t rxrd = _get16(model->socket0, SR_SNRXRD);
+	uint16_t rxwr = _get16(model->socket0, SR_SNRXWR);
+	uint16_t i;
+
+	if (model->socket0[SR_SNSR] != SNSR_SOCK_MACRAW) {
+		return false;
+	}
+
+	/* Frames are prepended by their length, including the 2 bytes of length */
+	if (W5500_MODEL_BUFSIZE - (uint16_t) (rxwr - rxrd) < len + 2) {
+		return false;
+	}
+
+	model->rxbuf[rxwr & BUFMASK] = ((len + 2) & 0xFF00) >> 8;
+	model->rxbuf[(rxwr + 1) & BUFMASK] = (len + 2) & 0x00FF;
+	for (i=0; i<len; i++) {
+		model->rxbuf[(rxwr + 2 + i) & BUFMASK] = frame[i];
+	}
+	_set16(model->socket0, SR_SNRXWR, rxwr + len + 2);
+
+	return true;
+}
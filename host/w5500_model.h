@@ -0,0 +1,60 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _W5500_MODEL_H
+#define _W5500_MODEL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "platform_posix.h"
+
+/**
+ * Model of the W5500, as seen from its SPI bus.
+ *
+ * Only what hw_w5500.c relies on is modelled: variable length data mode,
+ * common registers (reset, PHY, MAC address, version) and socket 0 in MACRAW
+ * mode with 2 KB buffers. Frames sent by the driver are given to tx_cback,
+ * received frames are queued with w5500_model_inject().
+ *
+ * The model can be used as a SPI device of the POSIX platform (see
+ * spi_posix_set_device()), or driven by a simulator.
+ */
+
+#define W5500_MODEL_BUFSIZE 2048
+
+struct w5500_model;
+
+typedef void (*w5500_model_tx_callback)(struct w5500_model*, const uint8_t*, uint16_t);
+
+struct w5500_model {
+	struct spi_posix_device spi;  /* Must be the first member */
+
+	uint8_t phase;
+	uint16_t addr;
+	uint8_t control;
+
+	uint8_t common[0x40];
+	uint8_t socket0[0x30];
+	uint8_t txbuf[W5500_MODEL_BUFSIZE];
+	uint8_t rxbuf[W5500_MODEL_BUFSIZE];
+
+	w5500_model_tx_callback tx_cback;
+	void *priv;
+};
+
+extern void w5500_model_init(struct w5500_model *model);
+extern bool w5500_model_inject(struct w5500_model *model, const uint8_t *frame, uint16_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
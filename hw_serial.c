@@ -8,6 +8,7 @@
 #include "hw_serial.h"
 #include "platform.h"
 #include "net_utils.h"
+#include "net_trace.h"
 
 #include <stdlib.h>
 
@@ -23,12 +24,24 @@ uint8_t *hw_serial_get_l2_addr(struct hw_serial_ctx *serial)
 //                      uint16_t *dataoffset, uint16_t *datalen)
 uint16_t hw_serial_recv(struct hw_serial_ctx *serial, uint8_t *buffer, uint16_t buflen)
 {
-	return serial_read(buffer, buflen);
+	uint16_t len;
+
+	NET_TRACE(NET_TRACE_LINK_RECV, buflen);
+	len = serial_read(buffer, buflen);
+	NET_TRACE(NET_TRACE_LINK_RECV | NET_TRACE_EXIT, len);
+
+	return len;
 }
 
 //int8_t hw_serial_send(struct net_serial_ctx *serial, uint8_t *buffer, uint16_t buflen,
 //                      uint16_t dataoffset, uint16_t datalen)
 uint16_t hw_serial_send(struct hw_serial_ctx *serial, uint8_t *buffer, uint16_t buflen)
 {
-	return serial_write(buffer, buflen);
+	uint16_t len;
+
+	NET_TRACE(NET_TRACE_LINK_SEND, buflen);
+	len = serial_write(buffer, buflen);
+	NET_TRACE(NET_TRACE_LINK_SEND | NET_TRACE_EXIT, len);
+
+	return len;
 }
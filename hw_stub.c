@@ -0,0 +1,27 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "config.h"
+#include "hw_stub.h"
+
+#include <stdlib.h>
+
+
+uint16_t hw_stub_recv(struct hw_stub_ctx *stub, uint8_t *buffer, uint16_t buflen)
+{
+	if (stub->recv_cback == NULL) {
+		return 0;
+	}
+	return stub->recv_cback(stub, buffer, buflen);
+}
+
+uint16_t hw_stub_send(struct hw_stub_ctx *stub, uint8_t *buffer, uint16_t buflen)
+{
+	if (stub->send_cback == NULL) {
+		return 0;
+	}
+	return stub->send_cback(stub, buffer, buflen);
+}
@@ -0,0 +1,38 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _HW_STUB_H
+#define _HW_STUB_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+
+struct hw_stub_ctx;
+
+typedef uint16_t (*hw_stub_recv_callback)(struct hw_stub_ctx*, uint8_t*, uint16_t);
+typedef uint16_t (*hw_stub_send_callback)(struct hw_stub_ctx*, uint8_t*, uint16_t);
+
+struct hw_stub_ctx {
+	hw_stub_recv_callback recv_cback;
+	hw_stub_send_callback send_cback;
+	void *priv;
+};
+
+extern uint16_t hw_stub_recv(struct hw_stub_ctx *stub,
+                             uint8_t *buffer, uint16_t buflen);
+extern uint16_t hw_stub_send(struct hw_stub_ctx *stub,
+                             uint8_t *buffer, uint16_t buflen);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -7,6 +7,7 @@
 #include "config.h"
 #include "hw_w5500.h"
 #include "net_utils.h"
+#include "net_trace.h"
 #include "platform.h"
 
 
@@ -98,10 +99,12 @@ static void _hw_w5500_spi_do_command(uint8_t addr_h, uint8_t addr_l, uint8_t con
 {
 	uint8_t spi_command[3] = { addr_h, addr_l, control };
 
+	NET_TRACE(NET_TRACE_SPI, buflen);
 	spi_start_transfer();
 	spi_write(spi_command, 3);
 	spi_read(buffer, buflen);
 	spi_stop_transfer();
+	NET_TRACE(NET_TRACE_SPI | NET_TRACE_EXIT, buflen);
 }
 
 static void _hw_w5500_spi_command(uint8_t addr_h, uint8_t addr_l, uint8_t control,
@@ -331,6 +334,7 @@ uint16_t hw_w5500_recv(struct hw_w5500_ctx *w5500, uint8_t *buffer, uint16_t buf
 	uint16_t frame_length = 0;
 	uint8_t command = SNCR_RECV;
 
+	NET_TRACE_SCOPE(NET_TRACE_LINK_RECV, buflen, &frame_length);
 
 	/* Get the SPI port */
 	spi_start_transaction();
@@ -396,6 +400,7 @@ uint16_t hw_w5500_send(struct hw_w5500_ctx *w5500, uint8_t *buffer, uint16_t buf
 	uint16_t write_length = 0;
 	uint8_t command = SNCR_SEND;
 
+	NET_TRACE_SCOPE(NET_TRACE_LINK_SEND, buflen, &buflen);
 
 	/* Get the SPI port */
 	spi_start_transaction();
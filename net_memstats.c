@@ -0,0 +1,108 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "config.h"
+#include "platform.h"
+#include "platform_serial.h"
+#include "net_memstats.h"
+#include "net_utils.h"
+
+
+#ifdef NET_MEMSTATS_ENABLE
+
+static uint8_t memstats_depth = 0;
+static uint16_t memstats_stack[NET_MEMSTATS_CNT];
+static uint16_t memstats_free_min = UINT16_MAX;
+
+uint8_t _net_memstats_enter(uint8_t id)
+{
+	if (memstats_depth++ == 0) {
+		stack_paint();
+	}
+
+	return id;
+}
+
+void _net_memstats_leave(uint8_t *id)
+{
+	uint16_t used;
+	uint16_t free;
+
+	if (--memstats_depth > 0) {
+		return;
+	}
+
+	used = stack_used();
+	free = stack_free();
+	if (used > memstats_stack[*id]) {
+		memstats_stack[*id] = used;
+	}
+	if (free < memstats_free_min) {
+		memstats_free_min = free;
+	}
+}
+
+void net_memstats_reset()
+{
+	uint8_t i;
+
+	for (i=0; i<NET_MEMSTATS_CNT; i++) {
+		memstats_stack[i] = 0;
+	}
+	memstats_free_min = UINT16_MAX;
+}
+
+#else
+
+uint8_t _net_memstats_enter(uint8_t id) { return id; }
+void _net_memstats_leave(uint8_t *id) {}
+void net_memstats_reset() {}
+
+#endif
+
+void net_memstats_print(const char * const name, uint16_t value)
+{
+	char line[32];
+	uint8_t len = 0;
+
+	while ((name[len] != '\0') && (len < sizeof(line) - 7)) {
+		line[len] = name[len];
+		len++;
+	}
+	line[len++] = ' ';
+	len += _net_format_uint16(&line[len], value);
+	line[len] = '\0';
+
+	serial_debug(line);
+}
+
+void net_memstats_report()
+{
+	net_memstats_print("ctx.link", sizeof(struct NET_MAC_PROTO_LOWER(_ctx)));
+	net_memstats_print("ctx.mac", sizeof(struct net_mac_ctx));
+	net_memstats_print("ctx.lowpan", sizeof(struct net_lowpan_ctx));
+	net_memstats_print("ctx.ip6", sizeof(struct net_ip6_ctx));
+	net_memstats_print("ctx.udp", sizeof(struct net_udp_ctx));
+	net_memstats_print("ctx.coap", sizeof(struct net_coap_ctx));
+#ifdef USE_SERIAL
+	net_memstats_print("static.serial_ring", sizeof(struct serial_ring));
+	net_memstats_print("static.serial_dec", sizeof(struct serial_decoder));
+#endif
+
+#ifdef NET_MEMSTATS_ENABLE
+	net_memstats_print("stack.mac_recv", memstats_stack[NET_MEMSTATS_MAC_RECV]);
+	net_memstats_print("stack.mac_send", memstats_stack[NET_MEMSTATS_MAC_SEND]);
+	net_memstats_print("stack.lowpan_recv", memstats_stack[NET_MEMSTATS_LOWPAN_RECV]);
+	net_memstats_print("stack.lowpan_send", memstats_stack[NET_MEMSTATS_LOWPAN_SEND]);
+	net_memstats_print("stack.ip6_recv", memstats_stack[NET_MEMSTATS_IP6_RECV]);
+	net_memstats_print("stack.ip6_send", memstats_stack[NET_MEMSTATS_IP6_SEND]);
+	net_memstats_print("stack.udp_recv", memstats_stack[NET_MEMSTATS_UDP_RECV]);
+	net_memstats_print("stack.udp_send", memstats_stack[NET_MEMSTATS_UDP_SEND]);
+	net_memstats_print("stack.coap_recv", memstats_stack[NET_MEMSTATS_COAP_RECV]);
+	net_memstats_print("stack.coap_send", memstats_stack[NET_MEMSTATS_COAP_SEND]);
+	net_memstats_print("stack.free_min", memstats_free_min);
+#endif
+}
@@ -0,0 +1,59 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _NET_MEMSTATS_H
+#define _NET_MEMSTATS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * Memory instrumentation, enabled with NET_MEMSTATS_ENABLE.
+ *
+ * The outermost call to a recv or send function of a layer paints the unused
+ * stack (see stack_paint() in platform.h) and records, when it returns, the
+ * stack used below its caller. Calls made by the layers to each other are
+ * accounted to the function called by the application. The report prints the
+ * size of the contexts and of the static buffers of the platform, then the
+ * high-water mark of each function, over serial_debug().
+ */
+
+#define NET_MEMSTATS_MAC_RECV   0
+#define NET_MEMSTATS_MAC_SEND   1
+#define NET_MEMSTATS_IP6_RECV   2
+#define NET_MEMSTATS_IP6_SEND   3
+#define NET_MEMSTATS_UDP_RECV   4
+#define NET_MEMSTATS_UDP_SEND   5
+#define NET_MEMSTATS_COAP_RECV  6
+#define NET_MEMSTATS_COAP_SEND  7
+#define NET_MEMSTATS_LOWPAN_RECV 8
+#define NET_MEMSTATS_LOWPAN_SEND 9
+#define NET_MEMSTATS_CNT        10
+
+#ifdef NET_MEMSTATS_ENABLE
+/* Declares a variable whose cleanup runs on every return of the function */
+#define NET_MEMSTATS_SCOPE(id) \
+	uint8_t _net_memstats_scope __attribute__((cleanup(_net_memstats_leave))) = \
+		_net_memstats_enter(id)
+#else
+#define NET_MEMSTATS_SCOPE(id)
+#endif
+
+extern uint8_t _net_memstats_enter(uint8_t id);
+extern void _net_memstats_leave(uint8_t *id);
+
+extern void net_memstats_reset();
+extern void net_memstats_print(const char * const name, uint16_t value);
+extern void net_memstats_report();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
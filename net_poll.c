@@ -0,0 +1,105 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "config.h"
+#include "net_poll.h"
+#include "net_utils.h"
+
+#define NET_POLL_IDLE_LINK(...) NET_IP6_PROTO_LOWER(_idle)(__VA_ARGS__)
+
+#ifdef NET_HAS_RECV_FROM
+
+static int8_t _net_poll_add(struct net_poll_ctx *poll, struct net_udp_ctx *udp,
+                            struct net_coap_ctx *coap, net_poll_udp_cback udp_cback,
+                            net_poll_coap_cback coap_cback)
+{
+	int8_t errno = 0;
+	struct net_poll_endpoint *endpoint = NULL;
+
+	if (poll->endpointcnt >= NET_POLL_ENDPOINT_CNT) {
+		return NET_ENOMEM;
+	}
+
+	errno = net_udp_flows_add(poll->lower, udp);
+	if (errno != NET_STATUS_OK) {
+		return errno;
+	}
+
+	endpoint = &(poll->endpoints[poll->endpointcnt++]);
+	endpoint->udp = udp;
+	endpoint->coap = coap;
+	endpoint->udp_cback = udp_cback;
+	endpoint->coap_cback = coap_cback;
+
+	return NET_STATUS_OK;
+}
+
+int8_t net_poll_add_udp(struct net_poll_ctx *poll, struct net_udp_ctx *udp,
+                        net_poll_udp_cback cback)
+{
+	return _net_poll_add(poll, udp, NULL, cback, NULL);
+}
+
+int8_t net_poll_add_coap(struct net_poll_ctx *poll, struct net_coap_ctx *coap,
+                         net_poll_coap_cback cback)
+{
+	return _net_poll_add(poll, coap->lower, coap, NULL, cback);
+}
+
+int8_t net_poll(struct net_poll_ctx *poll, uint8_t *buffer, uint16_t buflen)
+{
+	int8_t errno = 0;
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+	struct net_udp_ctx *udp = NULL;
+	uint8_t *peer_addr = NULL;
+	uint16_t peer_port = 0;
+	struct net_poll_endpoint *endpoint = NULL;
+	uint8_t delivered = 0;
+	uint8_t frames = 0;
+	uint8_t i = 0;
+
+	for (frames = 0; frames < NET_POLL_BUDGET; frames++) {
+		errno = net_udp_flows_recv(poll->lower, buffer, buflen, &dataoffset, &datalen,
+		                           &udp, &peer_addr, &peer_port);
+		if (errno != NET_STATUS_OK) {
+			/* Frame dropped or of Neighbor Discovery, read nonetheless, unless there was none */
+			if ((errno == NET_EAGAIN) && NET_POLL_IDLE_LINK(poll->lower->lower->lower)) {
+				break;
+			}
+			continue;
+		}
+
+		/* Endpoint of the flow, if not added to the table directly */
+		endpoint = NULL;
+		for (i = 0; i < poll->endpointcnt; i++) {
+			if (poll->endpoints[i].udp == udp) {
+				endpoint = &(poll->endpoints[i]);
+				break;
+			}
+		}
+
+		if (endpoint == NULL) {
+			continue;
+		} else if (endpoint->coap == NULL) {
+			endpoint->udp_cback(udp, buffer, buflen, dataoffset, datalen, peer_addr, peer_port);
+			delivered++;
+		} else {
+			errno = net_coap_parse(endpoint->coap, buffer, buflen, &dataoffset, &datalen);
+			if (errno >= 0) {
+				endpoint->coap_cback(endpoint->coap, errno, buffer, buflen, dataoffset, datalen);
+				delivered++;
+			}
+		}
+	}
+
+	/* Neighbor Solicitations received meanwhile, out of the budget */
+	net_ip6_service(poll->lower->lower, buffer, buflen);
+
+	return (delivered > 0) ? delivered : NET_EAGAIN;
+}
+
+#endif
@@ -0,0 +1,80 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _NET_POLL_H
+#define _NET_POLL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#ifdef NET_HAS_RECV_FROM
+
+/**
+ * Receive loop of the applications of several endpoints over one link.
+ *
+ * Instead of each context pulling frames, and dropping the frames of the
+ * others, net_poll() receives the frames once for all, through a table of
+ * the UDP flows (see net_udp_flows_recv()), and hands each datagram to the
+ * callback of its endpoint: a UDP context, connected or listening, or a CoAP
+ * context, the message being parsed by net_coap_parse() first, as by
+ * net_coap_recv(). Neighbor Discovery is handled by the IPv6 context of the
+ * table, the solicitations recorded with NET_IP6_RATELIMIT_ENABLE being
+ * answered by net_ip6_service() at the end of the call.
+ *
+ * Each call reads up to NET_POLL_BUDGET frames, the ones not delivered to an
+ * endpoint (Neighbor Discovery, dropped) included, and returns once the link
+ * has no frame left. The callbacks are called with the buffer, where they may
+ * build and send their reply. Returns the number of datagrams delivered, or
+ * NET_EAGAIN.
+ */
+
+#ifndef NET_POLL_BUDGET
+#define NET_POLL_BUDGET 4
+#endif
+
+#ifndef NET_POLL_ENDPOINT_CNT
+#define NET_POLL_ENDPOINT_CNT 4
+#endif
+
+/* Datagram of a UDP endpoint, and its peer, the address pointing into the buffer */
+typedef void (*net_poll_udp_cback)(struct net_udp_ctx *udp, uint8_t *buffer, uint16_t buflen,
+                                   uint16_t dataoffset, uint16_t datalen,
+                                   uint8_t *peer_addr, uint16_t peer_port);
+/* Message of a CoAP endpoint, of status NET_STATUS_OK or NET_COAP_STATUS_* */
+typedef void (*net_poll_coap_cback)(struct net_coap_ctx *coap, int8_t status, uint8_t *buffer,
+                                    uint16_t buflen, uint16_t dataoffset, uint16_t datalen);
+
+struct net_poll_endpoint {
+	struct net_udp_ctx *udp;
+	struct net_coap_ctx *coap;       /* Upper context of udp, NULL for a UDP endpoint */
+	net_poll_udp_cback udp_cback;
+	net_poll_coap_cback coap_cback;
+};
+
+struct net_poll_ctx {
+	struct net_poll_endpoint endpoints[NET_POLL_ENDPOINT_CNT];
+	uint8_t endpointcnt;
+
+	struct net_udp_flows *lower;
+};
+
+/* Endpoints are added once connected or listening, and for the lifetime of the context */
+extern int8_t net_poll_add_udp(struct net_poll_ctx *poll, struct net_udp_ctx *udp,
+                               net_poll_udp_cback cback);
+extern int8_t net_poll_add_coap(struct net_poll_ctx *poll, struct net_coap_ctx *coap,
+                                net_poll_coap_cback cback);
+extern int8_t net_poll(struct net_poll_ctx *poll, uint8_t *buffer, uint16_t buflen);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
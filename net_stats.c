@@ -0,0 +1,58 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "config.h"
+#include "platform.h"
+#include "net_stats.h"
+#include "net_utils.h"
+
+
+void net_stats_snapshot(struct net_stats *stats, struct net_stats *snapshot, bool reset)
+{
+	memcpy(snapshot, stats, sizeof(*snapshot));
+	if (reset) {
+		memset(stats, 0, sizeof(*stats));
+	}
+}
+
+static uint8_t _net_stats_put(char *line, uint8_t len, const char * const label,
+                              net_stats_counter_t value)
+{
+	uint8_t i;
+
+	for (i=0; label[i] != '\0'; i++) {
+		line[len++] = label[i];
+	}
+	line[len++] = ' ';
+
+	return len + _net_format_uint16(&line[len], value);
+}
+
+void net_stats_dump(const char * const name, const struct net_stats *stats)
+{
+	char line[104];
+	uint8_t len = 0;
+	uint8_t i;
+
+	while ((name[len] != '\0') && (len < 8)) {
+		line[len] = name[len];
+		len++;
+	}
+
+	len = _net_stats_put(line, len, " rx", stats->rx_frames);
+	len = _net_stats_put(line, len, "", stats->rx_bytes);
+	len = _net_stats_put(line, len, " tx", stats->tx_frames);
+	len = _net_stats_put(line, len, "", stats->tx_bytes);
+	len = _net_stats_put(line, len, "", stats->tx_errors);
+	line[len++] = ' ';
+	len = _net_stats_put(line, len, "drop", stats->drops[0]);
+	for (i=1; i<NET_STATS_DROP_CNT; i++) {
+		len = _net_stats_put(line, len, "", stats->drops[i]);
+	}
+	line[len] = '\0';
+
+	serial_debug(line);
+}
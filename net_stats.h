@@ -0,0 +1,91 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _NET_STATS_H
+#define _NET_STATS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Packet counters, enabled with NET_STATS_ENABLE.
+ *
+ * Each layer context then holds a struct net_stats, counting the frames
+ * accepted (rx) and sent (tx) by the layer, with their length at this layer,
+ * the send failures and the frames dropped, by reason. A frame dropped by a
+ * layer is not seen by the layers above. Counters saturate at their maximum.
+ */
+
+#define NET_STATS_DROP_LEN      0  /* Truncated, or inconsistent length */
+#define NET_STATS_DROP_PROTO    1  /* Malformed header, unsupported version */
+#define NET_STATS_DROP_TYPE     2  /* Ethertype or next header not ours */
+#define NET_STATS_DROP_ADDR     3  /* Foreign source or destination address */
+#define NET_STATS_DROP_PORT     4  /* UDP ports do not match */
+#define NET_STATS_DROP_TOKEN    5  /* CoAP token or message ID do not match */
+#define NET_STATS_DROP_UNSUPP   6  /* Valid, but not handled (ICMPv6 type, CoAP CON) */
+#define NET_STATS_DROP_RATE     7  /* Over the rate limit of the ICMPv6 replies */
+#define NET_STATS_DROP_CNT      8
+
+typedef uint16_t net_stats_counter_t;
+
+struct net_stats {
+	net_stats_counter_t rx_frames;
+	net_stats_counter_t rx_bytes;
+	net_stats_counter_t tx_frames;
+	net_stats_counter_t tx_bytes;
+	net_stats_counter_t tx_errors;
+	net_stats_counter_t drops[NET_STATS_DROP_CNT];
+};
+
+inline static void _net_stats_add(net_stats_counter_t *counter, uint16_t value)
+{
+	if ((net_stats_counter_t) (*counter + value) < *counter) {
+		*counter = (net_stats_counter_t) ~0;
+	} else {
+		*counter += value;
+	}
+}
+
+#ifdef NET_STATS_ENABLE
+#define NET_STATS_RX(ctx, len) \
+	do { \
+		_net_stats_add(&((ctx)->stats.rx_frames), 1); \
+		_net_stats_add(&((ctx)->stats.rx_bytes), len); \
+	} while (0)
+#define NET_STATS_TX(ctx, len) \
+	do { \
+		_net_stats_add(&((ctx)->stats.tx_frames), 1); \
+		_net_stats_add(&((ctx)->stats.tx_bytes), len); \
+	} while (0)
+#define NET_STATS_TX_ERROR(ctx) \
+	_net_stats_add(&((ctx)->stats.tx_errors), 1)
+#define NET_STATS_DROP(ctx, reason) \
+	_net_stats_add(&((ctx)->stats.drops[NET_STATS_DROP_ ## reason]), 1)
+#else
+#define NET_STATS_RX(ctx, len)        do {} while (0)
+#define NET_STATS_TX(ctx, len)        do {} while (0)
+#define NET_STATS_TX_ERROR(ctx)       do {} while (0)
+#define NET_STATS_DROP(ctx, reason)   do {} while (0)
+#endif
+
+/* Copy the counters of a context (e.g. &mac.stats), then zero them if reset */
+extern void net_stats_snapshot(struct net_stats *stats, struct net_stats *snapshot, bool reset);
+
+/**
+ * Print one line over serial_debug():
+ *   <name> rx <frames> <bytes> tx <frames> <bytes> <errors> drop <by reason>
+ */
+extern void net_stats_dump(const char * const name, const struct net_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,134 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "config.h"
+#include "platform.h"
+#include "net_tap.h"
+#include "net_utils.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+
+#define NET_TAP_LINE_BYTES 24  /* Bytes per serial line */
+
+struct net_tap {
+	bool opened;
+	uint8_t snaplen;
+	uint16_t budget;
+	uint32_t tokens;
+	uint32_t last_us;
+	uint16_t skipped;
+	net_tap_writer writer;
+	void *priv;
+};
+
+static struct net_tap tap;
+
+
+uint8_t net_tap_put_record(uint8_t *buffer, const struct net_tap_record *record)
+{
+	uint8_t *cursor = NULL;
+
+	NET_SET_CURSOR(buffer, 0);
+	NET_PUT_INT(record->time_us);
+	NET_PUT_SHORT(record->len);
+	NET_PUT_BYTE(record->caplen);
+	NET_PUT_BYTE(record->flags);
+	NET_PUT_SHORT(record->skipped);
+
+	return NET_TAP_RECORD_LEN;
+}
+
+static void _net_tap_serial_line(const uint8_t *data, uint8_t datalen)
+{
+	char line[4 + 2 * NET_TAP_LINE_BYTES + 1] = "tap ";
+
+	_net_format_hex(&line[4], data, datalen);
+	line[4 + 2 * datalen] = '\0';
+	serial_debug(line);
+}
+
+static void _net_tap_serial_write(void *priv, const struct net_tap_record *record,
+                                  const uint8_t *data)
+{
+	uint8_t header[NET_TAP_RECORD_LEN];
+	uint8_t n = 0;
+	uint8_t i;
+
+	net_tap_put_record(header, record);
+	_net_tap_serial_line(header, NET_TAP_RECORD_LEN);
+
+	for (i=0; i<record->caplen; i+=n) {
+		n = ((record->caplen - i) > NET_TAP_LINE_BYTES) ? NET_TAP_LINE_BYTES :
+		                                                  (record->caplen - i);
+		_net_tap_serial_line(&data[i], n);
+	}
+}
+
+void net_tap_open(net_tap_writer writer, void *priv, uint8_t snaplen, uint16_t budget)
+{
+	tap.writer = (writer != NULL) ? writer : _net_tap_serial_write;
+	tap.priv = priv;
+	tap.snaplen = snaplen;
+	tap.budget = budget;
+	tap.tokens = budget;
+	tap.last_us = clock_us();
+	tap.skipped = 0;
+	tap.opened = true;
+}
+
+void net_tap_close()
+{
+	tap.opened = false;
+}
+
+void _net_tap_frame(uint8_t flags, const uint8_t *frame, uint16_t len)
+{
+	struct net_tap_record record;
+	uint32_t now;
+	uint32_t elapsed_ms;
+	uint32_t cost;
+
+	if (!tap.opened) {
+		return;
+	}
+
+	now = clock_us();
+	record.caplen = (len > tap.snaplen) ? tap.snaplen : len;
+
+	if (tap.budget > 0) {
+		/* Token bucket refilled at budget bytes per second, one second deep */
+		elapsed_ms = (now - tap.last_us) / 1000UL;
+		if (elapsed_ms >= 1000) {
+			tap.tokens = tap.budget;
+			tap.last_us = now;
+		} else if ((elapsed_ms * tap.budget) >= 1000) {
+			tap.tokens += (elapsed_ms * tap.budget) / 1000UL;
+			if (tap.tokens > tap.budget) {
+				tap.tokens = tap.budget;
+			}
+			tap.last_us += elapsed_ms * 1000UL;
+		}
+
+		cost = NET_TAP_RECORD_LEN + record.caplen;
+		if (tap.tokens < cost) {
+			if (tap.skipped < UINT16_MAX) {
+				tap.skipped++;
+			}
+			return;
+		}
+		tap.tokens -= cost;
+	}
+
+	record.time_us = now;
+	record.len = len;
+	record.flags = flags;
+	record.skipped = tap.skipped;
+	tap.skipped = 0;
+
+	tap.writer(tap.priv, &record, frame);
+}
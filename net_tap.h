@@ -0,0 +1,84 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _NET_TAP_H
+#define _NET_TAP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "net_stats.h"
+
+/**
+ * Frame capture at the MAC boundary, enabled with NET_TAP_ENABLE.
+ *
+ * net_mac_recv() and net_mac_send() hand every frame to the tap, including
+ * the received frames dropped by the MAC layer with their reason (see
+ * NET_STATS_DROP_* in net_stats.h). Once opened, the tap passes a record
+ * (timestamp, original length, captured length, direction and reason) and
+ * the first snaplen bytes of the frame to a writer.
+ *
+ * The overhead is bounded by the snaplen and by a budget of bytes per
+ * second (header and captured data), frames over the budget are skipped
+ * and their count is given with the next record.
+ *
+ * Without writer, records are written in hexadecimal over serial_debug(),
+ * as "tap <hex>" lines whose concatenation is the stream of serialized
+ * records; host/tap_decode.py converts them into pcapng. Hosts write pcapng
+ * directly (host/tap_pcapng.h).
+ */
+
+#define NET_TAP_DIR_IN       0x00
+#define NET_TAP_DIR_OUT      0x80
+#define NET_TAP_REASON_NONE  0x7F  /* Frame accepted */
+
+/* Serialized as 10 bytes, in network order, followed by the captured data */
+#define NET_TAP_RECORD_LEN   10
+
+struct net_tap_record {
+	uint32_t time_us;
+	uint16_t len;
+	uint8_t caplen;
+	uint8_t flags;       /* Direction | reason */
+	uint16_t skipped;    /* Frames skipped since the previous record */
+};
+
+typedef void (*net_tap_writer)(void *priv, const struct net_tap_record *record,
+                               const uint8_t *data);
+
+#ifdef NET_TAP_ENABLE
+#define NET_TAP_RX(frame, len) \
+	_net_tap_frame(NET_TAP_DIR_IN | NET_TAP_REASON_NONE, frame, len)
+#define NET_TAP_DROP(frame, len, reason) \
+	_net_tap_frame(NET_TAP_DIR_IN | NET_STATS_DROP_ ## reason, frame, len)
+#define NET_TAP_TX(frame, len) \
+	_net_tap_frame(NET_TAP_DIR_OUT | NET_TAP_REASON_NONE, frame, len)
+#else
+#define NET_TAP_RX(frame, len)            do {} while (0)
+#define NET_TAP_DROP(frame, len, reason)  do {} while (0)
+#define NET_TAP_TX(frame, len)            do {} while (0)
+#endif
+
+extern void _net_tap_frame(uint8_t flags, const uint8_t *frame, uint16_t len);
+
+/**
+ * Start capturing, writer NULL writing over serial_debug(). snaplen is at
+ * most 255, budget is in bytes per second, 0 for no limit.
+ */
+extern void net_tap_open(net_tap_writer writer, void *priv, uint8_t snaplen, uint16_t budget);
+extern void net_tap_close();
+
+/* Serialize the record header, returns NET_TAP_RECORD_LEN */
+extern uint8_t net_tap_put_record(uint8_t *buffer, const struct net_tap_record *record);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,128 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "config.h"
+#include "platform.h"
+#include "net_trace.h"
+#include "net_utils.h"
+
+
+#define NET_TRACE_DUMP_CNT 4  /* Records per debug line */
+
+#ifdef NET_TRACE_ENABLE
+
+static struct net_trace_record trace_ring[NET_TRACE_RING_SIZE];
+static uint16_t trace_head = 0;   /* Next record written */
+static uint16_t trace_count = 0;
+static uint16_t trace_lost = 0;
+
+void _net_trace_record(uint8_t event, uint16_t len)
+{
+	struct net_trace_record *record = &trace_ring[trace_head];
+
+	record->event = event;
+	record->time_us = clock_us();
+	record->len = len;
+
+	trace_head = (trace_head + 1) & (NET_TRACE_RING_SIZE - 1);
+	if (trace_count < NET_TRACE_RING_SIZE) {
+		trace_count++;
+	} else if (trace_lost < UINT16_MAX) {
+		trace_lost++;
+	}
+}
+
+struct net_trace_scope _net_trace_enter(uint8_t event, uint16_t len,
+                                        const uint16_t *exitlen)
+{
+	struct net_trace_scope scope = { event, exitlen };
+
+	_net_trace_record(event, len);
+
+	return scope;
+}
+
+void _net_trace_leave(struct net_trace_scope *scope)
+{
+	_net_trace_record(scope->event | NET_TRACE_EXIT,
+	                  (scope->exitlen != NULL) ? *scope->exitlen : 0);
+}
+
+void net_trace_reset()
+{
+	trace_count = 0;
+	trace_lost = 0;
+}
+
+uint16_t net_trace_read(struct net_trace_record *records, uint16_t maxcnt)
+{
+	uint16_t tail = (trace_head - trace_count) & (NET_TRACE_RING_SIZE - 1);
+	uint16_t n = 0;
+
+	while ((n < maxcnt) && (trace_count > 0)) {
+		records[n++] = trace_ring[tail];
+		tail = (tail + 1) & (NET_TRACE_RING_SIZE - 1);
+		trace_count--;
+	}
+
+	return n;
+}
+
+uint16_t net_trace_lost()
+{
+	return trace_lost;
+}
+
+#else
+
+void _net_trace_record(uint8_t event, uint16_t len) {}
+
+struct net_trace_scope _net_trace_enter(uint8_t event, uint16_t len,
+                                        const uint16_t *exitlen)
+{
+	struct net_trace_scope scope = { event, exitlen };
+
+	return scope;
+}
+
+void _net_trace_leave(struct net_trace_scope *scope) {}
+void net_trace_reset() {}
+uint16_t net_trace_read(struct net_trace_record *records, uint16_t maxcnt) { return 0; }
+uint16_t net_trace_lost() { return 0; }
+
+#endif
+
+void net_trace_dump()
+{
+	char line[6 + NET_TRACE_DUMP_CNT * NET_TRACE_RECORD_LEN * 2 + 1] = "trace ";
+	struct net_trace_record records[NET_TRACE_DUMP_CNT];
+	uint8_t bytes[NET_TRACE_RECORD_LEN];
+	uint8_t *cursor;
+	uint16_t cnt;
+	uint8_t len;
+	uint8_t i;
+
+	/* Reading first keeps the records traced while printing out of this dump */
+	while ((cnt = net_trace_read(records, NET_TRACE_DUMP_CNT)) > 0) {
+		len = 6;
+		for (i=0; i<cnt; i++) {
+			NET_SET_CURSOR(bytes, 0);
+			NET_PUT_BYTE(records[i].event);
+			NET_PUT_INT(records[i].time_us);
+			NET_PUT_SHORT(records[i].len);
+
+			_net_format_hex(&line[len], bytes, NET_TRACE_RECORD_LEN);
+			len += 2 * NET_TRACE_RECORD_LEN;
+		}
+		line[len] = '\0';
+		serial_debug(line);
+	}
+
+	memcpy(&line[6], "end ", 4);
+	len = 10 + _net_format_uint16(&line[10], net_trace_lost());
+	line[len] = '\0';
+	serial_debug(line);
+}
@@ -0,0 +1,100 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _NET_TRACE_H
+#define _NET_TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * Binary trace ring, enabled with NET_TRACE_ENABLE.
+ *
+ * Trace points at the entry and exit of the recv/send functions of each
+ * layer, of the link drivers and of each SPI transfer record an event, a
+ * timestamp (clock_us()) and a length into a fixed ring, the oldest records
+ * being overwritten. Recording does not format nor print anything: the ring
+ * is dumped later with net_trace_dump(), or read with net_trace_read() in
+ * host builds. host/trace_decode.py turns the records into latency
+ * histograms.
+ *
+ * The length is the buffer length at the entry of recv functions and the
+ * received length at their exit, the frame length at this layer for send
+ * functions, and the transfer length for SPI.
+ */
+
+#ifndef NET_TRACE_RING_SIZE
+#define NET_TRACE_RING_SIZE 32  /* Records of 7 bytes, must be a power of 2 */
+#endif
+
+#define NET_TRACE_EXIT       0x01  /* Or'ed to the event at exit */
+
+#define NET_TRACE_SPI        0x02
+#define NET_TRACE_LINK_RECV  0x04
+#define NET_TRACE_LINK_SEND  0x06
+#define NET_TRACE_MAC_RECV   0x08
+#define NET_TRACE_MAC_SEND   0x0A
+#define NET_TRACE_IP6_RECV   0x0C
+#define NET_TRACE_IP6_SEND   0x0E
+#define NET_TRACE_UDP_RECV   0x10
+#define NET_TRACE_UDP_SEND   0x12
+#define NET_TRACE_COAP_RECV  0x14
+#define NET_TRACE_COAP_SEND  0x16
+#define NET_TRACE_LOWPAN_RECV 0x18
+#define NET_TRACE_LOWPAN_SEND 0x1A
+
+/* Serialized as 7 bytes: event, time_us and len in network order */
+#define NET_TRACE_RECORD_LEN 7
+
+struct net_trace_record {
+	uint8_t event;
+	uint32_t time_us;
+	uint16_t len;
+};
+
+struct net_trace_scope {
+	uint8_t event;
+	const uint16_t *exitlen;
+};
+
+#ifdef NET_TRACE_ENABLE
+#define NET_TRACE(event, len) _net_trace_record(event, len)
+/* Records the entry now and the exit, with *exitlen, on every return */
+#define NET_TRACE_SCOPE(event, len, exitlen) \
+	struct net_trace_scope _net_trace_scope __attribute__((cleanup(_net_trace_leave))) = \
+		_net_trace_enter(event, len, exitlen)
+#else
+#define NET_TRACE(event, len)                 do {} while (0)
+#define NET_TRACE_SCOPE(event, len, exitlen)
+#endif
+
+extern void _net_trace_record(uint8_t event, uint16_t len);
+extern struct net_trace_scope _net_trace_enter(uint8_t event, uint16_t len,
+                                               const uint16_t *exitlen);
+extern void _net_trace_leave(struct net_trace_scope *scope);
+
+extern void net_trace_reset();
+
+/* Move up to maxcnt records, oldest first, out of the ring */
+extern uint16_t net_trace_read(struct net_trace_record *records, uint16_t maxcnt);
+
+/* Records overwritten before being read or dumped, since the last reset */
+extern uint16_t net_trace_lost();
+
+/**
+ * Empty the ring over serial_debug(), as lines of hexadecimal records
+ * "trace <records>", then "trace end <lost>".
+ */
+extern void net_trace_dump();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
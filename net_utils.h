@@ -127,6 +127,54 @@ inline static uint16_t _net_cksum_finalize(uint16_t sum)
 	return ~sum;
 }
 
+/**
+ * Checksum of a packet of which data of sum oldsum was replaced by data of
+ * sum newsum, without summing the rest again (RFC 1624)
+ */
+inline static uint16_t _net_cksum_update(uint16_t cksum, uint16_t oldsum, uint16_t newsum)
+{
+	uint32_t sum = (uint16_t) ~cksum;
+
+	sum += (uint16_t) ~oldsum;
+	sum += newsum;
+	sum = (sum & 0x0000FFFF) + (sum >> 16);
+	sum = (sum & 0x0000FFFF) + (sum >> 16);
+
+	return ~sum;
+}
+
+/* Write value in decimal, without terminating null, and return the length */
+inline static uint8_t _net_format_uint16(char *str, uint16_t value)
+{
+	char digits[5];
+	uint8_t n = 0;
+	uint8_t len = 0;
+
+	do {
+		digits[n++] = '0' + (value % 10);
+		value /= 10;
+	} while (value > 0);
+	while (n > 0) {
+		str[len++] = digits[--n];
+	}
+
+	return len;
+}
+
+/* Write data in uppercase hexadecimal, without terminating null */
+inline static void _net_format_hex(char *str, const uint8_t *data, uint8_t datalen)
+{
+	uint8_t nibble;
+	uint8_t i;
+
+	for (i=0; i<datalen; i++) {
+		nibble = data[i] >> 4;
+		str[2*i] = (nibble < 10) ? ('0' + nibble) : ('A' + nibble - 10);
+		nibble = data[i] & 0x0F;
+		str[2*i+1] = (nibble < 10) ? ('0' + nibble) : ('A' + nibble - 10);
+	}
+}
+
 
 #ifdef __cplusplus
 }
@@ -6,6 +6,7 @@
 
 #include "config.h"
 #include "platform.h"
+#include "platform_serial.h"
 
 #include <SPI.h>
 
@@ -18,6 +19,11 @@ void msleep(uint16_t time_ms)
 	delay(time_ms);
 }
 
+uint32_t clock_us()
+{
+	return micros();
+}
+
 #ifdef USE_SPI
 
 void spi_init()
@@ -83,7 +89,9 @@ void spi_write(uint8_t *buffer, uint16_t buflen) {}
 
 #ifdef USE_SERIAL
 
-#define PACKET_TIMEOUT 500
+static struct serial_ring serial_rx;
+static struct serial_decoder serial_dec;
+static uint8_t serial_pending_signal;
 
 void serial_init()
 {
@@ -145,169 +153,76 @@ void serial_signal(uint8_t signal)
 	Serial.flush();
 }
 
+void serial_poll()
+{
+	/* Move the characters received by the UART into the ring */
+	while ((serial_ring_free(&serial_rx) > 0) && (Serial.available() > 0)) {
+		serial_ring_push(&serial_rx, (uint8_t) Serial.read());
+	}
+}
+
 uint16_t serial_read(uint8_t *buffer, uint16_t buflen)
 {
-	uint8_t state = 0;
-	uint16_t i = 0;
 	uint8_t chr = 0;
-	uint8_t current_byte = 0;
-	uint16_t elapsed = 0;
 
-	while (i < buflen) {
-		if (Serial.available() <= 0) {
-			delay(1);
-			elapsed++;
-			if (elapsed < PACKET_TIMEOUT) {
-				continue;
-			} else {
-				return 0;
-			}
-		}
+	serial_poll();
 
-		chr = Serial.read();
-		if (chr == '\n') {
+	/* Decode what has been received so far, without waiting for the rest */
+	while (serial_ring_pop(&serial_rx, &chr)) {
+		switch (serial_decode(&serial_dec, chr, buffer, buflen)) {
+		case SERIAL_DECODE_FRAME:
+			return serial_dec.len;
+		case SERIAL_DECODE_SIGNAL:
+			serial_pending_signal = serial_dec.signal;
 			break;
-		}
-
-		switch (state) {
-		// First character of the line
-		case 0:
-			if (chr == 'P') {
-				state = 1;
-			} else {
-				state = 255;
-			}
+		default:
 			break;
+		}
 
-		// Matched 'P'acket mode
-		case 1:
-			if (chr == ':') {
-				state = 2;
-			} else {
-				state = 255;
-			}
-			break;
+		/* Refill the ring as long as a line is being decoded */
+		serial_poll();
+	}
 
-		// Matched ':'
-		case 2:
-			if (chr == ' ') {
-				state = 2;
-			} else if (((chr >= '0') && (chr <= '9')) || ((chr >= 'A') && (chr <= 'F'))) {
-				state = 3;
-				current_byte = (((chr >= '0') && (chr <= '9')) ? (chr - '0') : (chr - 'A') + 10) << 4;
-			} else {
-				state = 255;
-			}
-			break;
+	return 0;
+}
 
-		// Byte hexa low
-		case 3:
-			if (((chr >= '0') && (chr <= '9')) || ((chr >= 'A') && (chr <= 'F'))) {
-				state = 4;
-				current_byte += (((chr >= '0') && (chr <= '9')) ? (chr - '0') : (chr - 'A') + 10);
-				buffer[i] = current_byte;
-				i++;
-			} else {
-				state = 255;
-			}
-			break;
+uint8_t serial_read_signal()
+{
+	uint8_t chr = 0;
+	uint8_t signal = serial_pending_signal;
 
-		// Byte hexa high
-		case 4:
-			if (((chr >= '0') && (chr <= '9')) || ((chr >= 'A') && (chr <= 'F'))) {
-				state = 3;
-				current_byte = (((chr >= '0') && (chr <= '9')) ? (chr - '0') : (chr - 'A') + 10) << 4;
-			} else {
-				state = 255;
-			}
-			break;
+	if (signal != 0) {
+		serial_pending_signal = 0;
+		return signal;
+	}
 
-		// Skip the rest of the line
-		case 255:
-			break;
+	serial_poll();
 
-		default:
-			break;
+	/* Frame lines received here are skipped, since there is no buffer */
+	while (serial_ring_pop(&serial_rx, &chr)) {
+		if (serial_decode(&serial_dec, chr, NULL, 0) == SERIAL_DECODE_SIGNAL) {
+			return serial_dec.signal;
 		}
+		serial_poll();
 	}
 
-	return i;
+	return 0;
 }
 
 uint8_t serial_wait_for_signal(uint16_t timeout)
 {
-	uint8_t state = 0;
-	uint8_t chr = 0;
-	uint8_t current_byte = 0;
+	uint8_t signal = 0;
 	uint16_t elapsed = 0;
 
-	while (current_byte < 26) {
-		if (Serial.available() <= 0) {
-			delay(1);
-			elapsed++;
-			if (elapsed < timeout) {
-				continue;
-			} else {
-				return 0;
-			}
-		}
-
-		chr = Serial.read();
-		if (chr == '\n') {
-			break;
-		}
-
-		switch (state) {
-		// First character of the line
-		case 0:
-			if (chr == 'T') {
-				state = 1;
-			} else {
-				state = 255;
-			}
-			break;
-
-		// Matched 'T'est frame
-		case 1:
-			if (chr == ':') {
-				state = 2;
-			} else {
-				state = 255;
-			}
-			break;
-
-		// Matched ':'
-		case 2:
-			if (chr == ' ') {
-				state = 2;
-			} else if ((chr >= '0') && (chr <= '9')) {
-				state = 3;
-				current_byte = (chr - '0');
-			} else {
-				state = 255;
-			}
-			break;
-
-		// Next digit
-		case 3:
-			if ((chr >= '0') && (chr <= '9')) {
-				state = 3;
-				current_byte = (current_byte * 10) + (chr - '0');
-			} else {
-				state = 255;
-			}
-			break;
-
-		// Skip the rest of the line
-		case 255:
-			break;
-
-		default:
-			break;
+	while ((signal = serial_read_signal()) == 0) {
+		if (elapsed >= timeout) {
+			return 0;
 		}
+		delay(1);
+		elapsed++;
 	}
 
-	return current_byte;
+	return signal;
 }
 
 uint16_t serial_write(uint8_t *buffer, uint16_t buflen)
@@ -330,10 +245,10 @@ uint16_t serial_write(uint8_t *buffer, uint16_t buflen)
 		high = (buffer[i] & 0xF0) >> 4;
 		low = (buffer[i] & 0x0F);
 
-		value = ((high < 10) ? high + '0' : (high - 10) + 'A');
+		value = serial_hexchr(high);
 		Serial.write(&value, 1);
 
-		value = ((low < 10) ? low + '0' : (low - 10) + 'A');
+		value = serial_hexchr(low);
 		Serial.write(&value, 1);
 
 		i++;
@@ -355,8 +270,64 @@ void serial_debug_beg() {}
 void serial_debug_end() {}
 void serial_debug(const char * const message) {}
 void serial_signal(uint8_t signal) {}
+void serial_poll() {}
 uint16_t serial_read(uint8_t *buffer, uint16_t buflen) { return 0; }
+uint8_t serial_read_signal() { return 0; }
 uint8_t serial_wait_for_signal(uint16_t timeout) { return 0; }
 uint16_t serial_write(uint8_t *buffer, uint16_t buflen) {}
 
 #endif
+
+#ifdef NET_MEMSTATS_ENABLE
+
+#define STACK_PATTERN 0xC5
+#define STACK_MARGIN  8  /* Frame of stack_paint(), not painted */
+
+extern uint8_t __heap_start;
+extern void *__brkval;
+
+static uint8_t *stack_top = NULL;
+
+static uint8_t *_stack_bottom()
+{
+	return (__brkval != NULL) ? (uint8_t *) __brkval : &__heap_start;
+}
+
+static uint8_t *_stack_deepest()
+{
+	uint8_t *p = _stack_bottom();
+
+	while ((p < stack_top) && (*p == STACK_PATTERN)) {
+		p++;
+	}
+
+	return p;
+}
+
+void stack_paint()
+{
+	uint8_t *p = _stack_bottom();
+
+	stack_top = (uint8_t *) SP - STACK_MARGIN;
+	while (p < stack_top) {
+		*p++ = STACK_PATTERN;
+	}
+}
+
+uint16_t stack_used()
+{
+	return stack_top - _stack_deepest();
+}
+
+uint16_t stack_free()
+{
+	return _stack_deepest() - _stack_bottom();
+}
+
+#else
+
+void stack_paint() {}
+uint16_t stack_used() { return 0; }
+uint16_t stack_free() { return 0; }
+
+#endif
@@ -14,6 +14,8 @@ extern "C" {
 #include <stdint.h>
 
 extern void msleep(uint16_t time_ms);
+/* Microseconds from an arbitrary origin, wrapping around */
+extern uint32_t clock_us();
 
 extern void spi_init();
 extern void spi_destroy();
@@ -30,10 +32,30 @@ extern void serial_debug_beg();
 extern void serial_debug_end();
 extern void serial_debug(const char * const message);
 extern void serial_signal(uint8_t signal);
+
+/**
+ * Receiving never blocks: serial_poll() moves pending characters into the
+ * receive ring and may be called from the main loop at any time, while
+ * serial_read() and serial_read_signal() return 0 until a complete line has
+ * been received. A frame being received is decoded into the buffer given to
+ * serial_read(), which must not be modified until the frame is returned.
+ */
+extern void serial_poll();
 extern uint16_t serial_read(uint8_t *buffer, uint16_t buflen);
+extern uint8_t serial_read_signal();
 extern uint8_t serial_wait_for_signal(uint16_t timeout);
 extern uint16_t serial_write(uint8_t *buffer, uint16_t buflen);
 
+/**
+ * Stack high-water mark, used by NET_MEMSTATS_ENABLE. stack_paint() fills
+ * the unused stack below its caller with a pattern, stack_used() returns the
+ * bytes used below the caller of stack_paint() since then, and stack_free()
+ * the bytes that were never used, between the heap and the deepest call.
+ */
+extern void stack_paint();
+extern uint16_t stack_used();
+extern uint16_t stack_free();
+
 #ifdef __cplusplus
 }
 #endif
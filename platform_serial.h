@@ -0,0 +1,213 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PLATFORM_SERIAL_H
+#define _PLATFORM_SERIAL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Serial line framing shared by the platform implementations.
+ *
+ * Received characters are pushed into a single-producer/single-consumer ring
+ * (from an ISR or from serial_poll()), then fed one by one into an
+ * incremental decoder. Lines have the following formats:
+ *   "P: <hex bytes>\n"  Ethernet frame
+ *   "T: <decimal>\n"    Test signal
+ */
+
+#ifndef SERIAL_RING_SIZE
+#define SERIAL_RING_SIZE 32  /* Must be a power of 2, at most 128 */
+#endif
+
+#define SERIAL_DECODE_NONE    0  /* Line not complete yet */
+#define SERIAL_DECODE_FRAME   1  /* A frame was decoded, see dec->len */
+#define SERIAL_DECODE_SIGNAL  2  /* A signal was decoded, see dec->signal */
+
+#define SERIAL_STATE_START       0
+#define SERIAL_STATE_P_COLON     1
+#define SERIAL_STATE_P_SPACE     2
+#define SERIAL_STATE_P_LOW       3
+#define SERIAL_STATE_P_HIGH      4
+#define SERIAL_STATE_T_COLON     5
+#define SERIAL_STATE_T_SPACE     6
+#define SERIAL_STATE_T_DIGIT     7
+#define SERIAL_STATE_SKIP        255
+
+struct serial_ring {
+	volatile uint8_t head;  /* Only written by the producer */
+	volatile uint8_t tail;  /* Only written by the consumer */
+	uint8_t data[SERIAL_RING_SIZE];
+};
+
+struct serial_decoder {
+	uint8_t state;
+	uint8_t current_byte;
+	uint8_t signal;
+	uint16_t len;
+	uint8_t *buffer;
+};
+
+
+inline static bool serial_ring_push(struct serial_ring *ring, uint8_t chr)
+{
+	uint8_t head = ring->head;
+
+	/* Indexes are free-running, their difference is the fill level */
+	if ((uint8_t) (head - ring->tail) >= SERIAL_RING_SIZE) {
+		return false;
+	}
+
+	ring->data[head & (SERIAL_RING_SIZE - 1)] = chr;
+	ring->head = head + 1;
+
+	return true;
+}
+
+inline static bool serial_ring_pop(struct serial_ring *ring, uint8_t *chr)
+{
+	uint8_t tail = ring->tail;
+
+	if (tail == ring->head) {
+		return false;
+	}
+
+	*chr = ring->data[tail & (SERIAL_RING_SIZE - 1)];
+	ring->tail = tail + 1;
+
+	return true;
+}
+
+inline static uint8_t serial_ring_free(struct serial_ring *ring)
+{
+	return SERIAL_RING_SIZE - (uint8_t) (ring->head - ring->tail);
+}
+
+inline static uint8_t _serial_hexval(uint8_t chr)
+{
+	if ((chr >= '0') && (chr <= '9')) {
+		return chr - '0';
+	} else if ((chr >= 'A') && (chr <= 'F')) {
+		return (chr - 'A') + 10;
+	}
+	return 0xFF;
+}
+
+inline static uint8_t serial_hexchr(uint8_t value)
+{
+	return ((value < 10) ? value + '0' : (value - 10) + 'A');
+}
+
+/**
+ * Feed one character into the decoder.
+ *
+ * Frame bytes are decoded directly into buffer, which must be passed
+ * unchanged until SERIAL_DECODE_FRAME is returned. A NULL buffer (or a buffer
+ * change in the middle of a line) makes the current frame line skipped.
+ * Frames longer than buflen are dropped.
+ */
+inline static uint8_t serial_decode(struct serial_decoder *dec, uint8_t chr,
+                                    uint8_t *buffer, uint16_t buflen)
+{
+	uint8_t value;
+
+	if (chr == '\n') {
+		uint8_t state = dec->state;
+
+		dec->state = SERIAL_STATE_START;
+		if (state == SERIAL_STATE_P_LOW) {
+			return SERIAL_DECODE_FRAME;
+		} else if (state == SERIAL_STATE_T_DIGIT) {
+			return SERIAL_DECODE_SIGNAL;
+		}
+		return SERIAL_DECODE_NONE;
+	}
+
+	switch (dec->state) {
+	// First character of the line
+	case SERIAL_STATE_START:
+		dec->len = 0;
+		dec->signal = 0;
+		dec->buffer = buffer;
+		if (chr == 'P') {
+			dec->state = (buffer != NULL) ? SERIAL_STATE_P_COLON : SERIAL_STATE_SKIP;
+		} else if (chr == 'T') {
+			dec->state = SERIAL_STATE_T_COLON;
+		} else {
+			dec->state = SERIAL_STATE_SKIP;
+		}
+		break;
+
+	// Matched 'P'acket mode
+	case SERIAL_STATE_P_COLON:
+		dec->state = (chr == ':') ? SERIAL_STATE_P_SPACE : SERIAL_STATE_SKIP;
+		break;
+
+	// Matched ':', or byte hexa high after a complete byte
+	case SERIAL_STATE_P_SPACE:
+	case SERIAL_STATE_P_LOW:
+		if ((chr == ' ') && (dec->state == SERIAL_STATE_P_SPACE)) {
+			break;
+		}
+		value = _serial_hexval(chr);
+		if ((value == 0xFF) || (buffer != dec->buffer) || (dec->len >= buflen)) {
+			dec->state = SERIAL_STATE_SKIP;
+			break;
+		}
+		dec->current_byte = value << 4;
+		dec->state = SERIAL_STATE_P_HIGH;
+		break;
+
+	// Byte hexa low
+	case SERIAL_STATE_P_HIGH:
+		value = _serial_hexval(chr);
+		if ((value == 0xFF) || (buffer != dec->buffer)) {
+			dec->state = SERIAL_STATE_SKIP;
+			break;
+		}
+		buffer[dec->len++] = dec->current_byte + value;
+		dec->state = SERIAL_STATE_P_LOW;
+		break;
+
+	// Matched 'T'est frame
+	case SERIAL_STATE_T_COLON:
+		dec->state = (chr == ':') ? SERIAL_STATE_T_SPACE : SERIAL_STATE_SKIP;
+		break;
+
+	// Matched ':', or next digit
+	case SERIAL_STATE_T_SPACE:
+	case SERIAL_STATE_T_DIGIT:
+		if ((chr == ' ') && (dec->state == SERIAL_STATE_T_SPACE)) {
+			break;
+		} else if ((chr >= '0') && (chr <= '9')) {
+			dec->signal = (dec->signal * 10) + (chr - '0');
+			dec->state = SERIAL_STATE_T_DIGIT;
+		} else {
+			dec->state = SERIAL_STATE_SKIP;
+		}
+		break;
+
+	// Skip the rest of the line
+	case SERIAL_STATE_SKIP:
+	default:
+		break;
+	}
+
+	return SERIAL_DECODE_NONE;
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
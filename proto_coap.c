@@ -7,6 +7,8 @@
 #include "config.h"
 #include "proto_coap.h"
 #include "net_utils.h"
+#include "net_memstats.h"
+#include "net_trace.h"
 
 #include <stdlib.h>
 
@@ -166,6 +168,25 @@ int8_t net_coap_recv(struct net_coap_ctx *coap, uint8_t *buffer, uint16_t buflen
                      uint16_t *dataoffset, uint16_t *datalen)
 {
 	int8_t errno = 0;
+
+	NET_MEMSTATS_SCOPE(NET_MEMSTATS_COAP_RECV);
+	NET_TRACE_SCOPE(NET_TRACE_COAP_RECV, buflen, datalen);
+
+	/* Get the packet from the lower layer */
+	errno = NET_COAP_RECV_LOWER(coap->lower, buffer, buflen, dataoffset, datalen);
+	if (errno < 0) {
+		*dataoffset = 0;
+		*datalen = 0;
+		return errno;
+	}
+
+	return net_coap_parse(coap, buffer, buflen, dataoffset, datalen);
+}
+
+int8_t net_coap_parse(struct net_coap_ctx *coap, uint8_t *buffer, uint16_t buflen,
+                      uint16_t *dataoffset, uint16_t *datalen)
+{
+	int8_t errno = 0;
 	uint8_t *cursor = NULL;
 	uint8_t *cursor_before = NULL;
 	uint8_t vtt = 0;
@@ -177,18 +198,13 @@ int8_t net_coap_recv(struct net_coap_ctx *coap, uint8_t *buffer, uint16_t buflen
 	uint8_t opttypelen;
 	uint16_t optlen = 0;
 
-	/* Get the packet from the lower layer */
-	errno = NET_COAP_RECV_LOWER(coap->lower, buffer, buflen, dataoffset, datalen);
-	if (errno < 0) {
-		goto out_zerodata;
-	}
-
 	/* Set the cursor to the position of the coap header in the buffer */
 	NET_SET_CURSOR(buffer, *dataoffset);
 	cursor_before = cursor;
 
 	/* Check that buffer is big enough for coap header size */
 	if (!NET_CHECK_BUFLEN(cursor_before, *datalen, NET_COAP_BASEHDRSIZE)) {
+		NET_STATS_DROP(coap, LEN);
 		errno = NET_EOVERFLOW;
 		goto out_zerodata;
 	}
@@ -198,6 +214,7 @@ int8_t net_coap_recv(struct net_coap_ctx *coap, uint8_t *buffer, uint16_t buflen
 
 	/* Only version 1 is supported */
 	if ((vtt >> 6) != NET_COAP_VERSION) {
+		NET_STATS_DROP(coap, PROTO);
 		errno = NET_EPROTO;
 		goto out_zerodata;
 	}
@@ -214,6 +231,7 @@ int8_t net_coap_recv(struct net_coap_ctx *coap, uint8_t *buffer, uint16_t buflen
 	if (type & 0x02) {
 		if ((messageid == coap->last_messageid) && (response_code == NET_COAP_CODE_EMPTY)) {
 			/* This is a non-piggybacked acknowledgement */
+			NET_STATS_RX(coap, *datalen);
 			if (type == NET_COAP_TYPE_ACKNOWLEDGE) {
 				coap->response_code = response_code;
 				errno = NET_COAP_STATUS_ACK;
@@ -221,18 +239,21 @@ int8_t net_coap_recv(struct net_coap_ctx *coap, uint8_t *buffer, uint16_t buflen
 				errno = NET_COAP_STATUS_RST;
 			}
 		} else {
+			NET_STATS_DROP(coap, TOKEN);
 			errno = NET_EAGAIN;
 		}
 		goto out_zerodata;
 	} else if (type == NET_COAP_TYPE_NONCONFIRMABLE) {
 
 		if (!NET_CHECK_BUFLEN(cursor_before, *datalen, tokenlen)) {
+			NET_STATS_DROP(coap, LEN);
 			errno = NET_EOVERFLOW;
 			goto out_zerodata;
 		}
 
 		/* Make sure token length is the same as ours */
 		if (tokenlen != coap->tokenlen) {
+			NET_STATS_DROP(coap, TOKEN);
 			errno = NET_EAGAIN;
 			goto out_zerodata;
 		}
@@ -240,6 +261,7 @@ int8_t net_coap_recv(struct net_coap_ctx *coap, uint8_t *buffer, uint16_t buflen
 		/* Read and compare the token */
 		NET_GET_DATA(token, tokenlen);
 		if (memcmp(token, coap->token, coap->tokenlen) != 0) {
+			NET_STATS_DROP(coap, TOKEN);
 			errno = NET_EAGAIN;
 			goto out_zerodata;
 		}
@@ -254,6 +276,7 @@ int8_t net_coap_recv(struct net_coap_ctx *coap, uint8_t *buffer, uint16_t buflen
 			if (opttypelen == 0xFF) {
 				if (*datalen == 1) {
 					/* Payload mark but zero data */
+					NET_STATS_DROP(coap, LEN);
 					errno = NET_EOVERFLOW;
 					goto out_zerodata;
 				}
@@ -265,6 +288,7 @@ int8_t net_coap_recv(struct net_coap_ctx *coap, uint8_t *buffer, uint16_t buflen
 			case 0xD0:
 				/* Skip 1 byte of option type/length + 1 bytes of extended option type */
 				if (*datalen <= 1) {
+					NET_STATS_DROP(coap, LEN);
 					errno = NET_EOVERFLOW;
 					goto out_zerodata;
 				}
@@ -274,6 +298,7 @@ int8_t net_coap_recv(struct net_coap_ctx *coap, uint8_t *buffer, uint16_t buflen
 			case 0xE0:
 				/* Skip 1 byte of option type/length + 2 bytes of extended option type */
 				if (*datalen <= 2) {
+					NET_STATS_DROP(coap, LEN);
 					errno = NET_EOVERFLOW;
 					goto out_zerodata;
 				}
@@ -282,6 +307,7 @@ int8_t net_coap_recv(struct net_coap_ctx *coap, uint8_t *buffer, uint16_t buflen
 				break;
 			case 0xF0:
 				/* 0xFx is reserved for payload marker */
+				NET_STATS_DROP(coap, PROTO);
 				errno = NET_EPROTO;
 				goto out_zerodata;
 			default:
@@ -296,6 +322,7 @@ int8_t net_coap_recv(struct net_coap_ctx *coap, uint8_t *buffer, uint16_t buflen
 			case 0x0D:
 				/* Skip 1 bytes of option length */
 				if (*datalen <= 1) {
+					NET_STATS_DROP(coap, LEN);
 					errno = NET_EOVERFLOW;
 					goto out_zerodata;
 				}
@@ -306,6 +333,7 @@ int8_t net_coap_recv(struct net_coap_ctx *coap, uint8_t *buffer, uint16_t buflen
 			case 0x0E:
 				/* Skip 2 bytes of option type */
 				if (*datalen <= 2) {
+					NET_STATS_DROP(coap, LEN);
 					errno = NET_EOVERFLOW;
 					goto out_zerodata;
 				}
@@ -315,11 +343,13 @@ int8_t net_coap_recv(struct net_coap_ctx *coap, uint8_t *buffer, uint16_t buflen
 				break;
 			case 0x0F:
 				/* 0xF0 is reserved for payload mark */
+				NET_STATS_DROP(coap, PROTO);
 				errno = NET_EPROTO;
 				goto out_zerodata;
 			}
 
 			if (*datalen < optlen) {
+				NET_STATS_DROP(coap, LEN);
 				errno = NET_EOVERFLOW;
 				goto out_zerodata;
 			}
@@ -330,12 +360,14 @@ int8_t net_coap_recv(struct net_coap_ctx *coap, uint8_t *buffer, uint16_t buflen
 
 		/* Adjust the dataoffset */
 		*dataoffset += (cursor - cursor_before);
+		NET_STATS_RX(coap, (cursor - cursor_before) + *datalen);
 
 		coap->response_code = response_code;
 		errno = NET_STATUS_OK;
 		goto out_data;
 	} else {
 		/* Confirmable message, we cannot send ack to these messages yet */
+		NET_STATS_DROP(coap, UNSUPP);
 		errno = NET_EINVAL;
 		goto out_zerodata;
 	}
@@ -350,6 +382,7 @@ out_data:
 int8_t net_coap_send(struct net_coap_ctx *coap, uint8_t *buffer, uint16_t buflen,
                      uint16_t dataoffset, uint16_t datalen)
 {
+	int8_t errno = 0;
 	uint8_t *cursor = NULL;
 	uint8_t header_pos = 0;
 	uint16_t actual_hdrsize = 0;
@@ -357,6 +390,9 @@ int8_t net_coap_send(struct net_coap_ctx *coap, uint8_t *buffer, uint16_t buflen
 	uint8_t options_delta = 0;
 	uint8_t n = 0;
 
+	NET_MEMSTATS_SCOPE(NET_MEMSTATS_COAP_SEND);
+	NET_TRACE_SCOPE(NET_TRACE_COAP_SEND, datalen, &datalen);
+
 	coap->response_code = 0;
 
 	/* Retrieve the start of header from lower layers */
@@ -419,6 +455,13 @@ int8_t net_coap_send(struct net_coap_ctx *coap, uint8_t *buffer, uint16_t buflen
 	}
 
 	/* Pass to the lower layer */
-	return NET_COAP_SEND_LOWER(coap->lower, buffer, buflen,
-	                           header_pos, actual_hdrsize + datalen);
+	errno = NET_COAP_SEND_LOWER(coap->lower, buffer, buflen,
+	                            header_pos, actual_hdrsize + datalen);
+	if (errno == NET_STATUS_OK) {
+		NET_STATS_TX(coap, actual_hdrsize + datalen);
+	} else {
+		NET_STATS_TX_ERROR(coap);
+	}
+
+	return errno;
 }
@@ -13,6 +13,8 @@ extern "C" {
 
 #include <stdint.h>
 
+#include "net_stats.h"
+
 #define NET_COAP_STATUS_ACK          1
 #define NET_COAP_STATUS_RST          2
 
@@ -79,6 +81,10 @@ struct net_coap_ctx {
 	char * const *uriquery;
 	uint8_t uriquerycnt;
 
+#ifdef NET_STATS_ENABLE
+	struct net_stats stats;
+#endif
+
 	struct NET_COAP_PROTO_LOWER(_ctx) *lower;
 };
 
@@ -94,6 +100,9 @@ extern int8_t net_coap_connect(struct net_coap_ctx *coap);
 extern uint16_t net_coap_pload_pos(struct net_coap_ctx *coap);
 extern int8_t net_coap_recv(struct net_coap_ctx *coap, uint8_t *buffer, uint16_t buflen,
                             uint16_t *dataoffset, uint16_t *datalen);
+/* Message already received by the lower layer, at dataoffset, see net_poll() */
+extern int8_t net_coap_parse(struct net_coap_ctx *coap, uint8_t *buffer, uint16_t buflen,
+                             uint16_t *dataoffset, uint16_t *datalen);
 extern int8_t net_coap_send(struct net_coap_ctx *coap, uint8_t *buffer, uint16_t buflen,
                             uint16_t dataoffset, uint16_t datalen);
 
@@ -7,6 +7,9 @@
 #include "config.h"
 #include "proto_ip6.h"
 #include "net_utils.h"
+#include "net_memstats.h"
+#include "net_trace.h"
+#include "platform.h"
 
 #include <stdlib.h>
 #include <stdbool.h>
@@ -17,6 +20,8 @@
 #define NET_IP6_PLOAD_POS_LOWER(...)  NET_IP6_PROTO_LOWER(_pload_pos)(__VA_ARGS__)
 #define NET_IP6_RECV_LOWER(...)       NET_IP6_PROTO_LOWER(_recv)(__VA_ARGS__)
 #define NET_IP6_SEND_LOWER(...)       NET_IP6_PROTO_LOWER(_send)(__VA_ARGS__)
+#define NET_IP6_SET_L2_DST_LOWER(...) NET_IP6_PROTO_LOWER(_set_destination_addr)(__VA_ARGS__)
+#define NET_IP6_GET_L2_DST_LOWER(...) NET_IP6_PROTO_LOWER(_get_destination_addr)(__VA_ARGS__)
 
 #define NET_IP6_PUT_HEADER_COMMON(len, nh, hl) \
 	do { \
@@ -116,27 +121,103 @@
 #define NET_ICMPV6_HDRSIZE     4
 #define NET_ICMPV6_NS_HDRSIZE  20
 #define NET_ICMPV6_NA_HDRSIZE  20
+#define NET_ICMPV6_RS_HDRSIZE  4
+#define NET_ICMPV6_RA_HDRSIZE  12
+#define NET_ICMPV6_ECHO_HDRSIZE 4
 #define NET_ICMPV6_NDP_OPT_LLA_HDRSIZE 8
+#define NET_ICMPV6_NDP_OPT_PREFIX_HDRSIZE 32
+#define NET_ICMPV6_NDP_OPT_MTU_HDRSIZE 8
 
 #define NET_IP6_VERSION 0x06
 #define NET_IP6_HOPLIMIT 255
 
-#define NET_ICMPV6_TYPE_RA 133
+#define NET_ICMPV6_TYPE_ECHO_REQUEST 128
+#define NET_ICMPV6_TYPE_ECHO_REPLY   129
+#define NET_ICMPV6_TYPE_RS 133
+#define NET_ICMPV6_TYPE_RA 134
 #define NET_ICMPV6_TYPE_NS 135
 #define NET_ICMPV6_TYPE_NA 136
+#define NET_ICMPV6_NDP_OPT_SRCLLADDR 1
 #define NET_ICMPV6_NDP_OPT_TGTLLADDR 2
+#define NET_ICMPV6_NDP_OPT_PREFIX    3
+#define NET_ICMPV6_NDP_OPT_MTU       5
+
+#define NET_ICMPV6_PREFIX_FLAG_AUTONOMOUS 0x40
+
+/* Minimum MTU of IPv6 links */
+#define NET_IP6_MIN_MTU 1280
+
+#define NET_ICMPV6_NA_FLAG_SOLICITED 0x40
+#define NET_ICMPV6_NA_FLAG_OVERRIDE  0x20
+
+#ifdef NET_IP6_RATELIMIT_ENABLE
+/* Solicited advertisement waiting for net_ip6_service(), na_pending field */
+#define NET_IP6_NA_PENDING  0x01
+#define NET_IP6_NA_LLTARGET 0x02  /* Of our link-local address */
+#endif
+
+/* Address resolution enabled, only with the neighbor cache */
+#ifdef NET_IP6_NC_ENABLE
+#define NET_IP6_RESOLUTION(ip6) ((ip6)->resolution)
+#else
+#define NET_IP6_RESOLUTION(ip6) 0
+#endif
+
+/* Detection state of the source address, only with the detection */
+#ifdef NET_IP6_DAD_ENABLE
+#define NET_IP6_DAD_STATE(ip6) ((ip6)->dad)
+#else
+#define NET_IP6_DAD_STATE(ip6) NET_IP6_DAD_OFF
+#endif
+
+/* Address announced and not yet known to be unique */
+#define NET_IP6_DAD_TENTATIVE(ip6) \
+	((NET_IP6_DAD_STATE(ip6) == NET_IP6_DAD_PENDING) || (NET_IP6_DAD_STATE(ip6) == NET_IP6_DAD_OPTIMISTIC))
+
+/* RetransTimer, MAX_MULTICAST_SOLICIT and MAX_UNICAST_SOLICIT of RFC 4861 */
+#define NET_IP6_RETRANS_TIMER_US      1000000UL
+#define NET_IP6_MAX_MULTICAST_SOLICIT 3
+#define NET_IP6_MAX_UNICAST_SOLICIT   3
 
 
 static int8_t _net_ip6_process_icmpv6(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen,
                                       uint16_t *dataoffset, uint16_t *datalen,
                                       uint8_t *src_addr, uint8_t *dst_addr);
-static int8_t _net_icmpv6_send_na(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen, uint16_t dataoffset,
-                                  uint8_t *dst_addr, uint8_t *tgt_addr, bool solicited);
+#if defined(NET_IP6_RATELIMIT_ENABLE) || (defined(NET_IP6_DAD_ENABLE) && defined(NET_HAS_SET_L2_DST))
+static int8_t _net_icmpv6_send_na(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen,
+                                  uint8_t *dst_addr, bool lltarget, bool solicited);
+#endif
+#ifdef NET_HAS_SET_L2_DST
+#if defined(NET_IP6_NC_ENABLE) || defined(NET_IP6_DAD_ENABLE)
+static int8_t _net_icmpv6_send_ns(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen,
+                                  uint8_t *tgt_addr, uint8_t *l2dst, bool dad);
+#endif
+#ifdef NET_IP6_AUTOCONF_ENABLE
+static int8_t _net_icmpv6_send_rs(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen);
+#endif
+#ifdef NET_IP6_DAD_ENABLE
+static int8_t _net_ip6_dad(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen);
+#endif
+#endif
 
 
+/* A new source address is to be announced, and its pseudo-header summed again */
+static void _net_ip6_addr_changed(struct net_ip6_ctx *ip6)
+{
+	ip6->addr_gen++;
+#ifdef NET_IP6_DAD_ENABLE
+	if (ip6->dad != NET_IP6_DAD_OFF) {
+		ip6->dad = NET_IP6_DAD_PENDING;
+	}
+#endif
+}
+
 int8_t net_ip6_set_source_addr(struct net_ip6_ctx *ip6, uint8_t *src_addr)
 {
-	memcpy(ip6->src_addr, src_addr, 16);
+	if (memcmp(ip6->src_addr, src_addr, 16) != 0) {
+		memcpy(ip6->src_addr, src_addr, 16);
+		_net_ip6_addr_changed(ip6);
+	}
 	return NET_STATUS_OK;
 }
 
@@ -152,19 +233,497 @@ int8_t net_ip6_set_nexthdr(struct net_ip6_ctx *ip6, uint8_t nh)
 	return NET_STATUS_OK;
 }
 
+int8_t net_ip6_set_resolution(struct net_ip6_ctx *ip6, uint8_t enable)
+{
+#if defined(NET_IP6_NC_ENABLE) && defined(NET_HAS_SET_L2_DST)
+	ip6->resolution = enable;
+	return NET_STATUS_OK;
+#else
+	/* No neighbor cache, or no destination link-layer address on the lower layer */
+	return enable ? NET_ECONFIG : NET_STATUS_OK;
+#endif
+}
+
+int8_t net_ip6_autoconf(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen)
+{
+#if defined(NET_IP6_AUTOCONF_ENABLE) && defined(NET_HAS_GET_L2_ADDR) && defined(NET_HAS_SET_L2_DST)
+	uint8_t *l2addr = NET_IP6_GET_L2_ADDR_LOWER(ip6->lower);
+
+	/* Link-local address, of the modified EUI-64 of the MAC address */
+	memset(ip6->src_addr, 0, 8);
+	ip6->src_addr[0] = 0xFE;
+	ip6->src_addr[1] = 0x80;
+	ip6->src_addr[8] = l2addr[0] ^ 0x02;
+	ip6->src_addr[9] = l2addr[1];
+	ip6->src_addr[10] = l2addr[2];
+	ip6->src_addr[11] = 0xFF;
+	ip6->src_addr[12] = 0xFE;
+	ip6->src_addr[13] = l2addr[3];
+	ip6->src_addr[14] = l2addr[4];
+	ip6->src_addr[15] = l2addr[5];
+
+	ip6->autoconf = NET_IP6_AUTOCONF_ENABLED;
+	ip6->mtu = 0;
+	_net_ip6_addr_changed(ip6);
+
+	return _net_icmpv6_send_rs(ip6, buffer, buflen);
+#else
+	/* Not built in, or the lower layer has no link-layer address */
+	return NET_ECONFIG;
+#endif
+}
+
+int8_t net_ip6_set_dad(struct net_ip6_ctx *ip6, uint8_t enable)
+{
+#if defined(NET_IP6_DAD_ENABLE) && defined(NET_HAS_SET_L2_DST)
+	ip6->dad = enable ? NET_IP6_DAD_PENDING : NET_IP6_DAD_OFF;
+	return NET_STATUS_OK;
+#else
+	/* Not built in, or announcements are sent to multicast link-layer addresses */
+	return enable ? NET_ECONFIG : NET_STATUS_OK;
+#endif
+}
+
+int8_t net_ip6_announce(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen)
+{
+#if defined(NET_IP6_DAD_ENABLE) && defined(NET_HAS_SET_L2_DST)
+	return _net_ip6_dad(ip6, buffer, buflen);
+#else
+	return NET_STATUS_OK;
+#endif
+}
+
+int8_t net_ip6_service(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen)
+{
+#ifdef NET_IP6_RATELIMIT_ENABLE
+	uint8_t pending = ip6->na_pending;
+
+	if (!(pending & NET_IP6_NA_PENDING)) {
+		return NET_EAGAIN;
+	}
+	ip6->na_pending = 0;
+
+	/* To the unicast source of the solicitation, or to all nodes, unsolicited (RFC 4861 7.2.4) */
+	return _net_icmpv6_send_na(ip6, buffer, buflen,
+	                           NET_IP6_CMP_UNSPEC(ip6->na_dst_addr) ? NULL : ip6->na_dst_addr,
+	                           (pending & NET_IP6_NA_LLTARGET), !NET_IP6_CMP_UNSPEC(ip6->na_dst_addr));
+#else
+	/* Solicitations already answered while receiving */
+	return NET_EAGAIN;
+#endif
+}
+
+uint8_t net_ip6_get_addr_gen(struct net_ip6_ctx *ip6)
+{
+	return ip6->addr_gen;
+}
+
 uint16_t net_ip6_get_l3_cksum(struct net_ip6_ctx *ip6)
+{
+	return net_ip6_get_l3_cksum_to(ip6, ip6->dst_addr);
+}
+
+uint16_t net_ip6_get_l3_cksum_to(struct net_ip6_ctx *ip6, uint8_t *dst_addr)
 {
 	uint16_t sum = 0;
 	uint8_t nh[] = {0x00, ip6->nh};
 
 	sum = _net_cksum_sum(sum, ip6->src_addr, 16);
-	sum = _net_cksum_sum(sum, ip6->dst_addr, 16);
+	sum = _net_cksum_sum(sum, dst_addr, 16);
 	sum = _net_cksum_sum(sum, nh, 2);
 
 	return sum;
 }
 
 
+/*
+ * Neighbor cache
+ */
+
+#ifdef NET_IP6_NC_ENABLE
+
+/* Find the entry of an address, and make it the most recently used */
+static struct net_ip6_neighbor *_net_ip6_nc_find(struct net_ip6_ctx *ip6, uint8_t *addr)
+{
+	struct net_ip6_neighbor found;
+	uint8_t i;
+
+	for (i=0; i<NET_IP6_NC_SIZE; i++) {
+		if ((ip6->neighbors[i].state != NET_IP6_NC_FREE) &&
+		    (memcmp(ip6->neighbors[i].iid, &(addr[8]), 8) == 0)) {
+			break;
+		}
+	}
+	if (i == NET_IP6_NC_SIZE) {
+		return NULL;
+	}
+
+	if (i > 0) {
+		found = ip6->neighbors[i];
+		memmove(&(ip6->neighbors[1]), &(ip6->neighbors[0]), i * sizeof(struct net_ip6_neighbor));
+		ip6->neighbors[0] = found;
+	}
+
+	return &(ip6->neighbors[0]);
+}
+
+/* New incomplete entry, in place of the least recently used one */
+static struct net_ip6_neighbor *_net_ip6_nc_add(struct net_ip6_ctx *ip6, uint8_t *addr)
+{
+	struct net_ip6_neighbor *neighbor = &(ip6->neighbors[0]);
+
+	memmove(&(ip6->neighbors[1]), &(ip6->neighbors[0]),
+	        (NET_IP6_NC_SIZE - 1) * sizeof(struct net_ip6_neighbor));
+	memcpy(neighbor->iid, &(addr[8]), 8);
+	memset(neighbor->l2addr, 0, 6);
+	neighbor->state = NET_IP6_NC_INCOMPLETE;
+	neighbor->solicits = 0;
+
+	return neighbor;
+}
+
+/* Free entries are kept last, to be evicted first */
+static void _net_ip6_nc_remove(struct net_ip6_ctx *ip6, uint8_t index)
+{
+	memmove(&(ip6->neighbors[index]), &(ip6->neighbors[index+1]),
+	        (NET_IP6_NC_SIZE - 1 - index) * sizeof(struct net_ip6_neighbor));
+	memset(&(ip6->neighbors[NET_IP6_NC_SIZE-1]), 0, sizeof(struct net_ip6_neighbor));
+}
+
+/* Source link-layer address of a solicitation or of a router, the entry is created if needed */
+static void _net_ip6_nc_source(struct net_ip6_ctx *ip6, uint8_t *addr, uint8_t *l2addr)
+{
+	struct net_ip6_neighbor *neighbor = _net_ip6_nc_find(ip6, addr);
+
+	if (neighbor == NULL) {
+		neighbor = _net_ip6_nc_add(ip6, addr);
+	}
+	if ((neighbor->state == NET_IP6_NC_INCOMPLETE) ||
+	    (memcmp(neighbor->l2addr, l2addr, 6) != 0)) {
+		memcpy(neighbor->l2addr, l2addr, 6);
+		neighbor->state = NET_IP6_NC_STALE;
+	}
+}
+
+static void _net_ip6_nc_reachable(struct net_ip6_neighbor *neighbor)
+{
+	neighbor->state = NET_IP6_NC_REACHABLE;
+	neighbor->solicits = 0;
+	neighbor->time_us = clock_us();
+}
+
+/* Off-link destinations are reached through the default router */
+static bool _net_ip6_offlink(struct net_ip6_ctx *ip6, uint8_t *addr)
+{
+#ifdef NET_IP6_AUTOCONF_ENABLE
+	return (ip6->autoconf & NET_IP6_AUTOCONF_ROUTER) &&
+	       !((addr[0] == 0xFE) && (addr[1] == 0x80)) &&
+	       (memcmp(addr, ip6->src_addr, 8) != 0);
+#else
+	/* Without router, every destination is a neighbor */
+	return false;
+#endif
+}
+
+/**
+ * Advertisement of a target, only known neighbors are updated, but
+ * unsolicited announcements of new neighbors are learned as stale (as in
+ * RFC 9131), sparing a resolution once they are reached.
+ */
+static bool _net_ip6_nc_advertised(struct net_ip6_ctx *ip6, uint8_t *tgt_addr, uint8_t *l2addr,
+                                   uint8_t flags)
+{
+	struct net_ip6_neighbor *neighbor = _net_ip6_nc_find(ip6, tgt_addr);
+
+	if (neighbor == NULL) {
+		if ((flags & NET_ICMPV6_NA_FLAG_SOLICITED) || (l2addr == NULL)) {
+			return false;
+		}
+		neighbor = _net_ip6_nc_add(ip6, tgt_addr);
+		memcpy(neighbor->l2addr, l2addr, 6);
+		neighbor->state = NET_IP6_NC_STALE;
+		return true;
+	}
+
+	if (neighbor->state == NET_IP6_NC_INCOMPLETE) {
+		if (l2addr == NULL) {
+			return false;
+		}
+		memcpy(neighbor->l2addr, l2addr, 6);
+		if (flags & NET_ICMPV6_NA_FLAG_SOLICITED) {
+			_net_ip6_nc_reachable(neighbor);
+		} else {
+			neighbor->state = NET_IP6_NC_STALE;
+			neighbor->solicits = 0;
+		}
+	} else if ((l2addr != NULL) && (memcmp(neighbor->l2addr, l2addr, 6) != 0)) {
+		/* Another link-layer address replaces ours only if it overrides it */
+		if (flags & NET_ICMPV6_NA_FLAG_OVERRIDE) {
+			memcpy(neighbor->l2addr, l2addr, 6);
+			if (flags & NET_ICMPV6_NA_FLAG_SOLICITED) {
+				_net_ip6_nc_reachable(neighbor);
+			} else {
+				neighbor->state = NET_IP6_NC_STALE;
+			}
+		} else if (neighbor->state == NET_IP6_NC_REACHABLE) {
+			neighbor->state = NET_IP6_NC_STALE;
+		}
+	} else if (flags & NET_ICMPV6_NA_FLAG_SOLICITED) {
+		/* Answer to a probe, or to a solicitation of another node */
+		_net_ip6_nc_reachable(neighbor);
+	}
+
+	return true;
+}
+
+int8_t net_ip6_confirm_to(struct net_ip6_ctx *ip6, uint8_t *dst_addr)
+{
+	struct net_ip6_neighbor *neighbor;
+
+	/* The router is not an entry of the cache, nor multicast destinations */
+	if ((dst_addr[0] == 0xFF) || _net_ip6_offlink(ip6, dst_addr)) {
+		return NET_STATUS_OK;
+	}
+
+	neighbor = _net_ip6_nc_find(ip6, dst_addr);
+	if ((neighbor != NULL) && (neighbor->state != NET_IP6_NC_INCOMPLETE)) {
+		_net_ip6_nc_reachable(neighbor);
+	}
+
+	return NET_STATUS_OK;
+}
+
+uint8_t *net_ip6_get_neighbor(struct net_ip6_ctx *ip6, uint8_t *addr)
+{
+	struct net_ip6_neighbor *neighbor = _net_ip6_nc_find(ip6, addr);
+
+	if ((neighbor == NULL) || (neighbor->state == NET_IP6_NC_INCOMPLETE)) {
+		return NULL;
+	}
+	return neighbor->l2addr;
+}
+
+#else
+
+/* Without neighbor cache, advertisements only matter to the detection */
+static void _net_ip6_nc_source(struct net_ip6_ctx *ip6, uint8_t *addr, uint8_t *l2addr)
+{
+}
+
+static bool _net_ip6_nc_advertised(struct net_ip6_ctx *ip6, uint8_t *tgt_addr, uint8_t *l2addr,
+                                   uint8_t flags)
+{
+	return false;
+}
+
+int8_t net_ip6_confirm_to(struct net_ip6_ctx *ip6, uint8_t *dst_addr)
+{
+	return NET_STATUS_OK;
+}
+
+uint8_t *net_ip6_get_neighbor(struct net_ip6_ctx *ip6, uint8_t *addr)
+{
+	return NULL;
+}
+
+#endif
+
+int8_t net_ip6_confirm(struct net_ip6_ctx *ip6)
+{
+	return net_ip6_confirm_to(ip6, ip6->dst_addr);
+}
+
+#ifdef NET_HAS_SET_L2_DST
+
+#if defined(NET_IP6_NC_ENABLE) || defined(NET_IP6_DAD_ENABLE)
+/* Multicast link-layer address of a multicast address (RFC 2464) */
+static void _net_ip6_l2_mcast(uint8_t *l2addr, uint8_t *addr)
+{
+	l2addr[0] = 0x33;
+	l2addr[1] = 0x33;
+	memcpy(&(l2addr[2]), &(addr[12]), 4);
+}
+#endif
+
+#ifdef NET_IP6_NC_ENABLE
+
+/**
+ * Unreachability detection of a neighbor sent to, its probes being built at
+ * freepos. Returns false once the neighbor is unreachable.
+ */
+static bool _net_ip6_nud(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen,
+                         uint16_t freepos, struct net_ip6_neighbor *neighbor, uint8_t *addr)
+{
+	uint32_t elapsed = clock_us() - neighbor->time_us;
+
+	switch (neighbor->state) {
+	case NET_IP6_NC_REACHABLE:
+		if (elapsed < NET_IP6_REACHABLE_TIME_US) {
+			return true;
+		}
+		/* Not confirmed in time, stale */
+		/* fall through */
+	case NET_IP6_NC_STALE:
+		neighbor->state = NET_IP6_NC_DELAY;
+		neighbor->time_us = clock_us();
+		return true;
+	case NET_IP6_NC_DELAY:
+		/* Waiting for the upper layers to confirm it */
+		if (elapsed < NET_IP6_DELAY_FIRST_PROBE_US) {
+			return true;
+		}
+		neighbor->state = NET_IP6_NC_PROBE;
+		neighbor->solicits = 0;
+		break;
+	case NET_IP6_NC_PROBE:
+		if (elapsed < NET_IP6_RETRANS_TIMER_US) {
+			return true;
+		}
+		if (neighbor->solicits >= NET_IP6_MAX_UNICAST_SOLICIT) {
+			return false;
+		}
+		break;
+	}
+
+	/* Probes go to the cached link-layer address */
+	if ((freepos <= buflen) &&
+	    (_net_icmpv6_send_ns(ip6, &(buffer[freepos]), buflen - freepos,
+	                         addr, neighbor->l2addr, false) == NET_STATUS_OK)) {
+		neighbor->solicits++;
+	}
+	neighbor->time_us = clock_us();
+
+	return true;
+}
+
+/**
+ * Set the destination link-layer address of a packet to addr. freepos is the
+ * end of the packet in the buffer, a solicitation being built after it.
+ */
+static int8_t _net_ip6_resolve(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen,
+                               uint16_t freepos, uint8_t *addr)
+{
+	struct net_ip6_neighbor *neighbor;
+	uint8_t l2addr[6];
+	int8_t errno = 0;
+	uint8_t i;
+
+	if (addr[0] == 0xFF) {
+		_net_ip6_l2_mcast(l2addr, addr);
+		return NET_IP6_SET_L2_DST_LOWER(ip6->lower, l2addr);
+	}
+
+#ifdef NET_IP6_AUTOCONF_ENABLE
+	if (_net_ip6_offlink(ip6, addr)) {
+		return NET_IP6_SET_L2_DST_LOWER(ip6->lower, ip6->router_l2addr);
+	}
+#endif
+
+	neighbor = _net_ip6_nc_find(ip6, addr);
+	if ((neighbor != NULL) && (neighbor->state != NET_IP6_NC_INCOMPLETE)) {
+		if (_net_ip6_nud(ip6, buffer, buflen, freepos, neighbor, addr)) {
+			return NET_IP6_SET_L2_DST_LOWER(ip6->lower, neighbor->l2addr);
+		}
+		/* Unreachable, resolved again */
+		_net_ip6_nc_remove(ip6, 0);
+		neighbor = NULL;
+	}
+
+	if (neighbor == NULL) {
+		/* A single address is resolved at a time, the previous one is given up */
+		for (i=0; i<NET_IP6_NC_SIZE; i++) {
+			if (ip6->neighbors[i].state == NET_IP6_NC_INCOMPLETE) {
+				_net_ip6_nc_remove(ip6, i);
+				break;
+			}
+		}
+		neighbor = _net_ip6_nc_add(ip6, addr);
+	} else if ((uint32_t) (clock_us() - ip6->solicit_time_us) < NET_IP6_RETRANS_TIMER_US) {
+		/* Waiting for the advertisement */
+		return NET_EAGAIN;
+	} else if (neighbor->solicits >= NET_IP6_MAX_MULTICAST_SOLICIT) {
+		/* Unreachable, resolution starts again with the next packet */
+		_net_ip6_nc_remove(ip6, 0);
+		return NET_EAGAIN;
+	}
+
+	if (freepos > buflen) {
+		return NET_EOVERFLOW;
+	}
+	errno = _net_icmpv6_send_ns(ip6, &(buffer[freepos]), buflen - freepos, addr, NULL, false);
+	if (errno != NET_STATUS_OK) {
+		return errno;
+	}
+	neighbor->solicits++;
+	ip6->solicit_time_us = clock_us();
+
+	return NET_EAGAIN;
+}
+
+#endif
+
+#ifdef NET_IP6_DAD_ENABLE
+/**
+ * Announce the source address if changed, and end its detection once no
+ * other node has claimed it in time. Returns NET_ECONFIG if duplicate.
+ */
+static int8_t _net_ip6_dad(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen)
+{
+	if (ip6->dad == NET_IP6_DAD_PENDING) {
+		if (_net_icmpv6_send_ns(ip6, buffer, buflen, ip6->src_addr, NULL, true) == NET_STATUS_OK) {
+			/* Optimistic from now on, for the advertisement not to override */
+			ip6->dad = NET_IP6_DAD_OPTIMISTIC;
+			ip6->dad_time_us = clock_us();
+			_net_icmpv6_send_na(ip6, buffer, buflen, NULL, false, false);
+		}
+	} else if ((ip6->dad == NET_IP6_DAD_OPTIMISTIC) &&
+	           ((uint32_t) (clock_us() - ip6->dad_time_us) >= NET_IP6_RETRANS_TIMER_US)) {
+		ip6->dad = NET_IP6_DAD_PREFERRED;
+	}
+
+	return (ip6->dad == NET_IP6_DAD_DUPLICATE) ? NET_ECONFIG : NET_STATUS_OK;
+}
+#endif
+
+#endif
+
+/**
+ * Pass a packet of ours to the lower layer, to a given link-layer address if
+ * not NULL. Without address resolution, the destination of the lower layer is
+ * then restored, being the one of all the other packets.
+ */
+static int8_t _net_ip6_send_l2(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen,
+                               uint16_t dataoffset, uint16_t datalen, uint8_t *l2addr)
+{
+	int8_t errno = 0;
+#ifdef NET_HAS_SET_L2_DST
+	uint8_t l2addr_saved[6];
+
+	if (l2addr != NULL) {
+		if (!NET_IP6_RESOLUTION(ip6)) {
+			memcpy(l2addr_saved, NET_IP6_GET_L2_DST_LOWER(ip6->lower), 6);
+		}
+		NET_IP6_SET_L2_DST_LOWER(ip6->lower, l2addr);
+	}
+#endif
+
+	errno = NET_IP6_SEND_LOWER(ip6->lower, buffer, buflen, dataoffset, datalen);
+	if (errno == NET_STATUS_OK) {
+		NET_STATS_TX(ip6, datalen);
+	} else {
+		NET_STATS_TX_ERROR(ip6);
+	}
+
+#ifdef NET_HAS_SET_L2_DST
+	if ((l2addr != NULL) && !NET_IP6_RESOLUTION(ip6)) {
+		NET_IP6_SET_L2_DST_LOWER(ip6->lower, l2addr_saved);
+	}
+#endif
+
+	return errno;
+}
+
+
 int8_t net_ip6_connect(struct net_ip6_ctx *ip6)
 {
 	return NET_STATUS_OK;
@@ -175,8 +734,8 @@ uint8_t net_ip6_pload_pos(struct net_ip6_ctx *ip6)
 	return NET_IP6_PLOAD_POS_LOWER(ip6->lower) + NET_IP6_HDRSIZE;
 }
 
-int8_t net_ip6_recv(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen,
-                    uint16_t *dataoffset, uint16_t *datalen)
+static int8_t _net_ip6_recv(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen,
+                            uint16_t *dataoffset, uint16_t *datalen, uint8_t **peer_addr)
 {
 	int8_t errno = 0;
 	uint8_t *cursor = NULL;
@@ -186,6 +745,16 @@ int8_t net_ip6_recv(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen,
 	uint8_t *dst_addr;
 	uint16_t length = 0;
 
+	NET_MEMSTATS_SCOPE(NET_MEMSTATS_IP6_RECV);
+	NET_TRACE_SCOPE(NET_TRACE_IP6_RECV, buflen, datalen);
+
+#if defined(NET_IP6_DAD_ENABLE) && defined(NET_HAS_SET_L2_DST)
+	/* Announce a new source address, the buffer is not filled yet */
+	if (ip6->dad != NET_IP6_DAD_OFF) {
+		_net_ip6_dad(ip6, buffer, buflen);
+	}
+#endif
+
 	/* Get the packet from the lower layer */
 	errno = NET_IP6_RECV_LOWER(ip6->lower, buffer, buflen, dataoffset, datalen);
 	if (errno < 0) {
@@ -197,6 +766,7 @@ int8_t net_ip6_recv(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen,
 
 	/* Check that buffer is big enough for parsing ipv6 header size */
 	if (!NET_CHECK_BUFLEN(cursor, *datalen, NET_IP6_HDRSIZE)) {
+		NET_STATS_DROP(ip6, LEN);
 		errno = NET_EOVERFLOW;
 		goto out_zerodata;
 	}
@@ -224,12 +794,14 @@ int8_t net_ip6_recv(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen,
 
 	/* Check version */
 	if ((version >> 4) != NET_IP6_VERSION) {
+		NET_STATS_DROP(ip6, PROTO);
 		errno = NET_EPROTO;
 		goto out_zerodata;
 	}
 
 	/* Check IPv6 data length fits in buffer */
 	if (length > (*datalen - NET_IP6_HDRSIZE)) {
+		NET_STATS_DROP(ip6, LEN);
 		errno = NET_EOVERFLOW;
 		goto out_zerodata;
 	}
@@ -247,22 +819,29 @@ int8_t net_ip6_recv(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen,
 
 	} else if (nh == ip6->nh) {
 
-		/* Check that source and destination addresses match our connection */
-		if (NET_IP6_CMP_ADDR(src_addr, ip6->dst_addr) &&
+		/* Check that source and destination addresses match our connection,
+		 * or only the destination for the flows, the source being returned */
+		if (((peer_addr != NULL) || NET_IP6_CMP_ADDR(src_addr, ip6->dst_addr)) &&
 		    NET_IP6_CMP_ADDR(dst_addr, ip6->src_addr)) {
 
 			/* This is a data packet, return it to the upper layer */
+			if (peer_addr != NULL) {
+				*peer_addr = src_addr;
+			}
+			NET_STATS_RX(ip6, NET_IP6_HDRSIZE + length);
 			*dataoffset += NET_IP6_HDRSIZE;
 			*datalen = length;
 			errno = NET_STATUS_OK;
 			goto out_data;
 
 		} else {
+			NET_STATS_DROP(ip6, ADDR);
 			errno = NET_EAGAIN;
 		}
 
 	} else {
 		/* Traffic is not relevant for us */
+		NET_STATS_DROP(ip6, TYPE);
 		errno = NET_EAGAIN;
 	}
 
@@ -273,13 +852,43 @@ out_data:
 	return errno;
 }
 
-int8_t net_ip6_send(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen,
-                    uint16_t dataoffset, uint16_t datalen)
+int8_t net_ip6_recv(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen,
+                    uint16_t *dataoffset, uint16_t *datalen)
+{
+	return _net_ip6_recv(ip6, buffer, buflen, dataoffset, datalen, NULL);
+}
+
+int8_t net_ip6_recv_from(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen,
+                         uint16_t *dataoffset, uint16_t *datalen, uint8_t **peer_addr)
+{
+	return _net_ip6_recv(ip6, buffer, buflen, dataoffset, datalen, peer_addr);
+}
+
+uint8_t net_ip6_flow_hash(struct net_ip6_ctx *ip6, uint8_t *peer_addr)
+{
+	uint8_t *addr = (peer_addr != NULL) ? peer_addr : ip6->dst_addr;
+
+	/* Peers of a link differ by their interface identifier */
+	return addr[8] ^ addr[9] ^ addr[10] ^ addr[11] ^
+	       addr[12] ^ addr[13] ^ addr[14] ^ addr[15];
+}
+
+bool net_ip6_flow_match(struct net_ip6_ctx *ip6, uint8_t *addr, uint8_t *peer_addr)
+{
+	return NET_IP6_CMP_ADDR(addr, (peer_addr != NULL) ? peer_addr : ip6->dst_addr);
+}
+
+static int8_t _net_ip6_send(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen,
+                            uint16_t dataoffset, uint16_t datalen, uint8_t *dst_addr)
 {
+	int8_t errno = 0;
 	uint8_t *cursor = NULL;
 	uint8_t *cursor_before = NULL;
 	uint8_t header_pos = 0;
 
+	NET_MEMSTATS_SCOPE(NET_MEMSTATS_IP6_SEND);
+	NET_TRACE_SCOPE(NET_TRACE_IP6_SEND, datalen, &datalen);
+
 	/* Retrieve the start of header from lower layers */
 	header_pos = NET_IP6_PLOAD_POS_LOWER(ip6->lower);
 
@@ -289,21 +898,73 @@ int8_t net_ip6_send(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen,
 
 	/* Check that buffer is big enough for the IPv6 header size */
 	if (!NET_CHECK_BUFLEN(buffer, dataoffset, NET_IP6_HDRSIZE)) {
+		NET_STATS_TX_ERROR(ip6);
+		return NET_EOVERFLOW;
+	}
+
+#ifdef NET_IP6_AUTOCONF_ENABLE
+	/* Check that the packet fits in the MTU advertised for the link */
+	if ((ip6->mtu != 0) && ((uint32_t) datalen + NET_IP6_HDRSIZE > ip6->mtu)) {
+		NET_STATS_TX_ERROR(ip6);
 		return NET_EOVERFLOW;
 	}
+#endif
+
+#if defined(NET_IP6_DAD_ENABLE) && defined(NET_HAS_SET_L2_DST)
+	/* Announce a new source address before the packet, after it in the buffer */
+	if ((ip6->dad != NET_IP6_DAD_OFF) && (dataoffset + datalen <= buflen)) {
+		errno = _net_ip6_dad(ip6, &(buffer[dataoffset + datalen]), buflen - dataoffset - datalen);
+		if (errno != NET_STATUS_OK) {
+			NET_STATS_TX_ERROR(ip6);
+			return errno;
+		}
+	}
+#endif
+
+#if defined(NET_IP6_NC_ENABLE) && defined(NET_HAS_SET_L2_DST)
+	/* Look up the destination link-layer address, or solicit it */
+	if (ip6->resolution) {
+		errno = _net_ip6_resolve(ip6, buffer, buflen, dataoffset + datalen, dst_addr);
+		if (errno != NET_STATUS_OK) {
+			return errno;
+		}
+	}
+#endif
 
 	/* Put common parts of the IP6 header */
 	NET_IP6_PUT_HEADER_COMMON(datalen, ip6->nh, NET_IP6_HOPLIMIT);
 
-	/* Put source and destination addresses */
+	/* Put destination and source addresses, the destination first: it may be
+	 * the source of the packet received in the buffer */
+	NET_SET_CURSOR(cursor_before, 24);
+	NET_PUT_DATA(dst_addr, 16);
+	NET_SET_CURSOR(cursor_before, 8);
 	NET_PUT_DATA(ip6->src_addr, 16);
-	NET_PUT_DATA(ip6->dst_addr, 16);
 
 	dataoffset -= NET_IP6_HDRSIZE;
 	datalen += NET_IP6_HDRSIZE;
 
 	/* Pass to the lower layer */
-	return NET_IP6_SEND_LOWER(ip6->lower, buffer, buflen, dataoffset, datalen);
+	errno = NET_IP6_SEND_LOWER(ip6->lower, buffer, buflen, dataoffset, datalen);
+	if (errno == NET_STATUS_OK) {
+		NET_STATS_TX(ip6, datalen);
+	} else {
+		NET_STATS_TX_ERROR(ip6);
+	}
+
+	return errno;
+}
+
+int8_t net_ip6_send(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen,
+                    uint16_t dataoffset, uint16_t datalen)
+{
+	return _net_ip6_send(ip6, buffer, buflen, dataoffset, datalen, ip6->dst_addr);
+}
+
+int8_t net_ip6_send_to(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen,
+                       uint16_t dataoffset, uint16_t datalen, uint8_t *dst_addr)
+{
+	return _net_ip6_send(ip6, buffer, buflen, dataoffset, datalen, dst_addr);
 }
 
 
@@ -358,6 +1019,30 @@ static int8_t _net_icmpv6_match_addr(struct net_ip6_ctx *ip6, uint8_t *dst_addr)
 	}
 }
 
+/* Data of the first option of a given type and minimum length, NULL if absent */
+static uint8_t *_net_icmpv6_get_opt(uint8_t *cursor, uint8_t *end, uint8_t type, uint16_t minlen)
+{
+	uint16_t optlen;
+
+	while ((cursor + 2) <= end) {
+		optlen = ((uint16_t) cursor[1]) * 8;
+		if ((optlen == 0) || ((cursor + optlen) > end)) {
+			/* Malformed, the whole message should be discarded */
+			return NULL;
+		}
+		if ((cursor[0] == type) && (optlen >= minlen)) {
+			return &(cursor[2]);
+		}
+		cursor += optlen;
+	}
+
+	return NULL;
+}
+
+/* Messages built from scratch, the replies in place being updated instead */
+#if defined(NET_IP6_RATELIMIT_ENABLE) || \
+    (defined(NET_HAS_SET_L2_DST) && (defined(NET_IP6_NC_ENABLE) || defined(NET_IP6_DAD_ENABLE) || \
+                                     defined(NET_IP6_AUTOCONF_ENABLE)))
 static void _net_icmpv6_fix_cksum(uint8_t *ip6hdr, uint16_t payloadlen)
 {
 	uint16_t sum = 0;
@@ -373,9 +1058,277 @@ static void _net_icmpv6_fix_cksum(uint8_t *ip6hdr, uint16_t payloadlen)
 		sum = 0xFFFF;
 	}
 
-	/* Rewrite the ICMPv6 checksum field */
-	ip6hdr[NET_IP6_HDRSIZE+2] = (uint8_t) ((sum & 0x0000FF00) >> 8);
-	ip6hdr[NET_IP6_HDRSIZE+3] = (uint8_t) (sum & 0x000000FF);
+	/* Rewrite the ICMPv6 checksum field */
+	ip6hdr[NET_IP6_HDRSIZE+2] = (uint8_t) ((sum & 0x0000FF00) >> 8);
+	ip6hdr[NET_IP6_HDRSIZE+3] = (uint8_t) (sum & 0x000000FF);
+}
+#endif
+
+
+#ifdef NET_IP6_AUTOCONF_ENABLE
+/* Options of a Router Advertisement, the router lifetime being in seconds */
+static void _net_ip6_process_ra(struct net_ip6_ctx *ip6, uint8_t *cursor, uint8_t *end,
+                                uint8_t *src_addr, uint16_t lifetime)
+{
+	uint8_t *opt;
+	uint32_t value;
+
+	/* Default router, a lifetime of 0 meaning it is not anymore */
+	opt = _net_icmpv6_get_opt(cursor, end, NET_ICMPV6_NDP_OPT_SRCLLADDR, NET_ICMPV6_NDP_OPT_LLA_HDRSIZE);
+	if (opt != NULL) {
+		_net_ip6_nc_source(ip6, src_addr, opt);
+	}
+	if (lifetime == 0) {
+		ip6->autoconf &= ~NET_IP6_AUTOCONF_ROUTER;
+	} else if (opt != NULL) {
+		memcpy(ip6->router_l2addr, opt, 6);
+		ip6->autoconf |= NET_IP6_AUTOCONF_ROUTER;
+#ifdef NET_HAS_SET_L2_DST
+		if (!NET_IP6_RESOLUTION(ip6)) {
+			NET_IP6_SET_L2_DST_LOWER(ip6->lower, ip6->router_l2addr);
+		}
+#endif
+	}
+
+	/**
+	 * MTU option
+	 * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+	 * |     Type      |    Length     |           Reserved            |
+	 * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+	 * |                              MTU                              |
+	 * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+	 */
+	opt = _net_icmpv6_get_opt(cursor, end, NET_ICMPV6_NDP_OPT_MTU, NET_ICMPV6_NDP_OPT_MTU_HDRSIZE);
+	if (opt != NULL) {
+		value = ((uint32_t) opt[2] << 24) | ((uint32_t) opt[3] << 16) |
+		        ((uint32_t) opt[4] << 8) | (uint32_t) opt[5];
+		if (value >= NET_IP6_MIN_MTU) {
+			ip6->mtu = (value > 0xFFFF) ? 0xFFFF : (uint16_t) value;
+		}
+	}
+
+	/**
+	 * Prefix Information option
+	 * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+	 * |     Type      |    Length     | Prefix Length |L|A| Reserved1 |
+	 * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+	 * |                         Valid Lifetime                        |
+	 * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+	 * |                       Preferred Lifetime                      |
+	 * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+	 * |                           Reserved2                           |
+	 * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+	 * |                                                               |
+	 * +                            Prefix                             +
+	 * |                                                               |
+	 */
+	opt = _net_icmpv6_get_opt(cursor, end, NET_ICMPV6_NDP_OPT_PREFIX, NET_ICMPV6_NDP_OPT_PREFIX_HDRSIZE);
+	if ((opt != NULL) && (opt[0] == 64) && (opt[1] & NET_ICMPV6_PREFIX_FLAG_AUTONOMOUS) &&
+	    !((opt[14] == 0xFE) && (opt[15] == 0x80))) {
+		/* Lifetimes are not tracked, the prefix is kept until another one is advertised */
+		value = ((uint32_t) opt[2] << 24) | ((uint32_t) opt[3] << 16) |
+		        ((uint32_t) opt[4] << 8) | (uint32_t) opt[5];
+		if ((value != 0) && (memcmp(ip6->src_addr, &(opt[14]), 8) != 0)) {
+			memcpy(ip6->src_addr, &(opt[14]), 8);
+			_net_ip6_addr_changed(ip6);
+		}
+		if (value != 0) {
+			ip6->autoconf |= NET_IP6_AUTOCONF_PREFIX;
+		}
+	}
+}
+#endif
+
+
+/**
+ * Token bucket of the ICMPv6 replies: up to NET_IP6_ICMPV6_BURST in a row,
+ * then one per NET_IP6_ICMPV6_INTERVAL_US. Returns true if over the limit,
+ * otherwise takes a token.
+ */
+static bool _net_icmpv6_ratelimit(struct net_ip6_ctx *ip6)
+{
+#ifdef NET_IP6_RATELIMIT_ENABLE
+	uint32_t now_us = clock_us();
+	uint32_t elapsed_us = now_us - ip6->icmpv6_time_us;
+	uint32_t refill = 0;
+
+	/* Divided only once an interval has elapsed, not for each packet of a flood */
+	if (elapsed_us >= NET_IP6_ICMPV6_INTERVAL_US) {
+		refill = elapsed_us / NET_IP6_ICMPV6_INTERVAL_US;
+		if (refill >= ip6->icmpv6_spent) {
+			ip6->icmpv6_spent = 0;
+			ip6->icmpv6_time_us = now_us;
+		} else {
+			ip6->icmpv6_spent -= refill;
+			ip6->icmpv6_time_us += refill * NET_IP6_ICMPV6_INTERVAL_US;
+		}
+	}
+
+	if (ip6->icmpv6_spent >= NET_IP6_ICMPV6_BURST) {
+		return true;
+	}
+	ip6->icmpv6_spent++;
+#endif
+
+	return false;
+}
+
+#ifndef NET_IP6_RATELIMIT_ENABLE
+/**
+ * Answer a Neighbor Solicitation in place, the IPv6 packet at dataoffset
+ * being turned into the advertisement: the source of the solicitation
+ * becomes the destination (or all nodes if unspecified), our link-local
+ * address the source, and the options a target link-layer address. The
+ * checksum is updated from the replaced fields only (RFC 1624).
+ */
+static int8_t _net_icmpv6_reply_na(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen,
+                                   uint16_t dataoffset, uint16_t icmplen)
+{
+	uint8_t *cursor = NULL;
+	uint8_t *ip6hdr = &(buffer[dataoffset]);
+	uint8_t *icmp = &(ip6hdr[NET_IP6_HDRSIZE]);
+	uint8_t *l2addr = NULL;
+	uint16_t oldsum = 0;
+	uint16_t newsum = 0;
+	uint16_t cksum = 0;
+	bool unspec = NET_IP6_CMP_UNSPEC(&(ip6hdr[8]));
+#ifdef NET_HAS_SET_L2_DST
+	uint8_t l2allnodes[6] = {0x33, 0x33, 0x00, 0x00, 0x00, 0x01};
+#endif
+
+	NET_SET_CURSOR(buffer, dataoffset);
+
+	/* Check that buffer is big enough for the Neighbor Advertisement */
+	if (!NET_CHECK_BUFLEN(buffer, buflen,
+	                      NET_IP6_HDRSIZE + NET_ICMPV6_HDRSIZE + NET_ICMPV6_NA_HDRSIZE + NET_ICMPV6_NDP_OPT_LLA_HDRSIZE)) {
+		NET_STATS_TX_ERROR(ip6);
+		return NET_EOVERFLOW;
+	}
+
+	/* Sum of the fields to be replaced: destination, length, type, flags and options */
+	oldsum = _net_cksum_sum(oldsum, &(ip6hdr[24]), 16);
+	oldsum = _net_cksum_sum(oldsum, &(ip6hdr[4]), 2);
+	oldsum = _net_cksum_sum(oldsum, icmp, 2);
+	oldsum = _net_cksum_sum(oldsum, &(icmp[4]), 4);
+	oldsum = _net_cksum_sum(oldsum, &(icmp[NET_ICMPV6_HDRSIZE + NET_ICMPV6_NS_HDRSIZE]),
+	                        icmplen - NET_ICMPV6_HDRSIZE - NET_ICMPV6_NS_HDRSIZE);
+
+	/* Put common parts of the IP6 header */
+	NET_IP6_PUT_HEADER_COMMON(NET_ICMPV6_HDRSIZE + NET_ICMPV6_NA_HDRSIZE + NET_ICMPV6_NDP_OPT_LLA_HDRSIZE,
+	                          NET_IP6_NH_ICMPV6, NET_IP6_HOPLIMIT);
+
+	/* Destination address, source of the solicitation or multicast all-nodes */
+	if (unspec) {
+		memset(&(ip6hdr[24]), 0, 16);
+		ip6hdr[24] = 0xFF;
+		ip6hdr[25] = 0x02;
+		ip6hdr[39] = 0x01;
+	} else {
+		memcpy(&(ip6hdr[24]), &(ip6hdr[8]), 16);
+	}
+
+	/* Put source address (link-local unicast addr) */
+	NET_PUT_SHORT(0xFE80);
+	NET_PUT_SHORT(0x0000);
+	NET_PUT_SHORT(0x0000);
+	NET_PUT_SHORT(0x0000);
+	NET_PUT_DATA(&(ip6->src_addr[8]), 8);
+
+	/* Type, code and flags, optimistic addresses not overriding others (RFC 4429),
+	 * answers to all nodes not being solicited (RFC 4861 7.2.4) */
+	icmp[0] = NET_ICMPV6_TYPE_NA;
+	icmp[1] = 0x00;
+	icmp[4] = (unspec ? 0x00 : NET_ICMPV6_NA_FLAG_SOLICITED) |
+	          ((NET_IP6_DAD_STATE(ip6) != NET_IP6_DAD_OPTIMISTIC) ? NET_ICMPV6_NA_FLAG_OVERRIDE : 0x00);
+	icmp[5] = 0x00;
+	icmp[6] = 0x00;
+	icmp[7] = 0x00;
+
+	/* The target is left as solicited, followed by the Target Link-Layer address Option */
+	NET_SET_CURSOR(icmp, NET_ICMPV6_HDRSIZE + NET_ICMPV6_NA_HDRSIZE);
+	NET_PUT_BYTE(NET_ICMPV6_NDP_OPT_TGTLLADDR);
+	NET_PUT_BYTE(0x01);
+#ifdef NET_HAS_GET_L2_ADDR
+	NET_PUT_DATA(NET_IP6_GET_L2_ADDR_LOWER(ip6->lower), 6);
+#else
+	NET_PUT_SHORT(0x0000);
+	NET_PUT_SHORT(0x0000);
+	NET_PUT_SHORT(0x0000);
+#endif
+
+	/* Sum of the new fields, the former source being now the destination */
+	newsum = _net_cksum_sum(newsum, &(ip6hdr[8]), unspec ? 32 : 16);
+	newsum = _net_cksum_sum(newsum, &(ip6hdr[4]), 2);
+	newsum = _net_cksum_sum(newsum, icmp, 2);
+	newsum = _net_cksum_sum(newsum, &(icmp[4]), 4);
+	newsum = _net_cksum_sum(newsum, &(icmp[NET_ICMPV6_HDRSIZE + NET_ICMPV6_NA_HDRSIZE]),
+	                        NET_ICMPV6_NDP_OPT_LLA_HDRSIZE);
+
+	cksum = _net_cksum_update((icmp[2] << 8) | icmp[3], oldsum, newsum);
+	icmp[2] = (uint8_t) ((cksum & 0xFF00) >> 8);
+	icmp[3] = (uint8_t) (cksum & 0x00FF);
+
+#ifdef NET_HAS_SET_L2_DST
+	/* Send to the soliciting node if known, otherwise to all nodes */
+	if (unspec) {
+		l2addr = l2allnodes;
+	} else if (NET_IP6_RESOLUTION(ip6)) {
+		l2addr = net_ip6_get_neighbor(ip6, &(ip6hdr[24]));
+		if (l2addr == NULL) {
+			l2addr = l2allnodes;
+		}
+	}
+#endif
+
+	return _net_ip6_send_l2(ip6, buffer, buflen, dataoffset,
+	                        NET_IP6_HDRSIZE + NET_ICMPV6_HDRSIZE + NET_ICMPV6_NA_HDRSIZE + NET_ICMPV6_NDP_OPT_LLA_HDRSIZE,
+	                        l2addr);
+}
+#endif
+
+/**
+ * Answer an Echo Request in place. The addresses being swapped, the sum of
+ * the pseudo-header is unchanged and only the type is accounted for in the
+ * checksum.
+ */
+static int8_t _net_icmpv6_reply_echo(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen,
+                                     uint16_t dataoffset, uint16_t icmplen)
+{
+	uint8_t *ip6hdr = &(buffer[dataoffset]);
+	uint8_t *icmp = &(ip6hdr[NET_IP6_HDRSIZE]);
+	uint16_t cksum = 0;
+	uint8_t swap = 0;
+	uint8_t i = 0;
+#if defined(NET_IP6_NC_ENABLE) && defined(NET_HAS_SET_L2_DST)
+	int8_t errno = 0;
+#endif
+
+	for (i=8; i<24; i++) {
+		swap = ip6hdr[i];
+		ip6hdr[i] = ip6hdr[i+16];
+		ip6hdr[i+16] = swap;
+	}
+	ip6hdr[7] = NET_IP6_HOPLIMIT;
+
+	cksum = _net_cksum_update((icmp[2] << 8) | icmp[3],
+	                          (NET_ICMPV6_TYPE_ECHO_REQUEST << 8) | icmp[1],
+	                          (NET_ICMPV6_TYPE_ECHO_REPLY << 8) | icmp[1]);
+	icmp[0] = NET_ICMPV6_TYPE_ECHO_REPLY;
+	icmp[2] = (uint8_t) ((cksum & 0xFF00) >> 8);
+	icmp[3] = (uint8_t) (cksum & 0x00FF);
+
+#if defined(NET_IP6_NC_ENABLE) && defined(NET_HAS_SET_L2_DST)
+	/* Unknown neighbors are solicited after the packet, the request being dropped */
+	if (ip6->resolution) {
+		errno = _net_ip6_resolve(ip6, buffer, buflen, dataoffset + NET_IP6_HDRSIZE + icmplen,
+		                         &(ip6hdr[24]));
+		if (errno != NET_STATUS_OK) {
+			return errno;
+		}
+	}
+#endif
+
+	return _net_ip6_send_l2(ip6, buffer, buflen, dataoffset, NET_IP6_HDRSIZE + icmplen, NULL);
 }
 
 
@@ -400,8 +1353,12 @@ int8_t _net_ip6_process_icmpv6(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_
 	int8_t errno = 0;
 	uint8_t *cursor = NULL;
 	uint8_t type = 0;
-	uint8_t src_addr_copy[16];
-	uint8_t tgt_addr[16];
+	uint8_t *tgt_addr;
+	uint8_t *l2addr;
+	uint8_t flags;
+#ifdef NET_IP6_AUTOCONF_ENABLE
+	uint16_t lifetime;
+#endif
 	int8_t dst_match;
 
 	/* Set the cursor to the position of the ipv6 header in the buffer */
@@ -409,6 +1366,7 @@ int8_t _net_ip6_process_icmpv6(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_
 
 	/* Check the ICMPV6 header fits in the packet length */
 	if (!NET_CHECK_BUFLEN(cursor, *datalen, NET_ICMPV6_HDRSIZE)) {
+		NET_STATS_DROP(ip6, LEN);
 		errno = NET_EOVERFLOW;
 		goto out_end;
 	}
@@ -425,6 +1383,7 @@ int8_t _net_ip6_process_icmpv6(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_
 		dst_match = _net_icmpv6_match_addr(ip6, dst_addr);
 		if (dst_match == MATCH_NONE) {
 			/* Not for us */
+			NET_STATS_DROP(ip6, ADDR);
 			errno = NET_EAGAIN;
 			goto out_end;
 		}
@@ -452,6 +1411,7 @@ int8_t _net_ip6_process_icmpv6(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_
 		/* Check the ICMPV6 NS header fits in the packet length */
 		if (!NET_CHECK_BUFLEN(cursor, *datalen,
 		                      NET_ICMPV6_HDRSIZE + NET_ICMPV6_NS_HDRSIZE)) {
+			NET_STATS_DROP(ip6, LEN);
 			errno = NET_EOVERFLOW;
 			goto out_end;
 		}
@@ -459,52 +1419,228 @@ int8_t _net_ip6_process_icmpv6(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_
 		/* Skip reserved field */
 		NET_SKIP_DATA(4);
 
-		/* Read target address, need a copy because buffer will be reused */
-		NET_GET_COPY(tgt_addr, 16);
+		/* Read target address */
+		NET_GET_DATA(tgt_addr, 16);
 
 		/* Compare the target address with our unicast and link-local addresses */
 		if (!NET_IP6_CMP_ADDR(tgt_addr, ip6->src_addr) &&
 		    !NET_IP6_CMP_LLADDR(tgt_addr, ip6->src_addr)) {
 
 			/* Not for us */
+			NET_STATS_DROP(ip6, ADDR);
+			errno = NET_EAGAIN;
+			goto out_end;
+		}
+
+#ifdef NET_IP6_DAD_ENABLE
+		/* Another node detecting our address while we are, none of us may use it */
+		if (NET_IP6_CMP_UNSPEC(src_addr) && NET_IP6_DAD_TENTATIVE(ip6)) {
+			NET_STATS_RX(ip6, NET_IP6_HDRSIZE + *datalen);
+			ip6->dad = NET_IP6_DAD_DUPLICATE;
+			errno = NET_EAGAIN;
+			goto out_end;
+		}
+#endif
+
+#ifdef NET_IP6_RATELIMIT_ENABLE
+		/* One advertisement at a time, within the rate limit, otherwise dropped */
+		if ((ip6->na_pending & NET_IP6_NA_PENDING) || _net_icmpv6_ratelimit(ip6)) {
+			NET_STATS_DROP(ip6, RATE);
 			errno = NET_EAGAIN;
 			goto out_end;
 		}
+#endif
+
+		NET_STATS_RX(ip6, NET_IP6_HDRSIZE + *datalen);
 
 		/* NS from non-unspec addresses will be replied to the unicast source */
 		if (!NET_IP6_CMP_UNSPEC(src_addr)) {
-			src_addr_copy[0] = src_addr[0];
-			src_addr_copy[1] = src_addr[1];
-			src_addr_copy[2] = src_addr[2];
-			src_addr_copy[3] = src_addr[3];
-			src_addr_copy[4] = src_addr[4];
-			src_addr_copy[5] = src_addr[5];
-			src_addr_copy[6] = src_addr[6];
-			src_addr_copy[7] = src_addr[7];
-			src_addr_copy[8] = src_addr[8];
-			src_addr_copy[9] = src_addr[9];
-			src_addr_copy[10] = src_addr[10];
-			src_addr_copy[11] = src_addr[11];
-			src_addr_copy[12] = src_addr[12];
-			src_addr_copy[13] = src_addr[13];
-			src_addr_copy[14] = src_addr[14];
-			src_addr_copy[15] = src_addr[15];
-
-			/* Do send the neighbor advertisement to the unicast address */
-			_net_icmpv6_send_na(ip6, buffer, buflen, *dataoffset - NET_IP6_HDRSIZE,
-			                    src_addr_copy, tgt_addr, true);
-		} else {
-			/* Do send the neighbor advertisement to the all-nodes address */
-			_net_icmpv6_send_na(ip6, buffer, buflen, *dataoffset - NET_IP6_HDRSIZE,
-			                    NULL, tgt_addr, true);
+			/* Learn the link-layer address of the soliciting node */
+			l2addr = _net_icmpv6_get_opt(cursor, &(buffer[*dataoffset + *datalen]),
+			                             NET_ICMPV6_NDP_OPT_SRCLLADDR, NET_ICMPV6_NDP_OPT_LLA_HDRSIZE);
+			if (l2addr != NULL) {
+				_net_ip6_nc_source(ip6, src_addr, l2addr);
+			}
 		}
 
+#ifdef NET_IP6_RATELIMIT_ENABLE
+		/* Advertisement left to net_ip6_service(), out of the receive path */
+		memcpy(ip6->na_dst_addr, src_addr, 16);
+		ip6->na_pending = NET_IP6_NA_PENDING |
+		                  (NET_IP6_CMP_ADDR(tgt_addr, ip6->src_addr) ? 0 : NET_IP6_NA_LLTARGET);
+#else
+		/* Advertisement to the unicast source, or to all nodes, in place */
+		_net_icmpv6_reply_na(ip6, buffer, buflen, *dataoffset - NET_IP6_HDRSIZE, *datalen);
+#endif
+
 	} else if (type == NET_ICMPV6_TYPE_NA) {
+		/* Answer to our solicitations, or update of a neighbor */
+
+		dst_match = _net_icmpv6_match_addr(ip6, dst_addr);
+		if (dst_match == MATCH_NONE) {
+			/* Not for us */
+			NET_STATS_DROP(ip6, ADDR);
+			errno = NET_EAGAIN;
+			goto out_end;
+		}
+
+		/**
+		 * 0                   1                   2                   3
+		 *  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+		 * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+		 * |     Type      |     Code      |          Checksum             |
+		 * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+		 * |R|S|O|                     Reserved                            |
+		 * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+		 * |                                                               |
+		 * +                                                               +
+		 * |                                                               |
+		 * +                       Target Address                          +
+		 * |                                                               |
+		 * +                                                               +
+		 * |                                                               |
+		 * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+		 * |   Options ...
+		 * +-+-+-+-+-+-+-+-+-+-+-+-
+		 */
+
+		/* Check the ICMPV6 NA header fits in the packet length */
+		if (!NET_CHECK_BUFLEN(cursor, *datalen,
+		                      NET_ICMPV6_HDRSIZE + NET_ICMPV6_NA_HDRSIZE)) {
+			NET_STATS_DROP(ip6, LEN);
+			errno = NET_EOVERFLOW;
+			goto out_end;
+		}
+
+		/* Read flags and skip reserved field */
+		NET_GET_BYTE(flags);
+		NET_SKIP_DATA(3);
+
+		/* Read target address, the options follow it */
+		NET_GET_DATA(tgt_addr, 16);
+		l2addr = _net_icmpv6_get_opt(cursor, &(buffer[*dataoffset + *datalen]),
+		                             NET_ICMPV6_NDP_OPT_TGTLLADDR, NET_ICMPV6_NDP_OPT_LLA_HDRSIZE);
+
+		/* Our address advertised by another node */
+		if (NET_IP6_CMP_ADDR(tgt_addr, ip6->src_addr) ||
+		    NET_IP6_CMP_LLADDR(tgt_addr, ip6->src_addr)) {
+#ifdef NET_IP6_DAD_ENABLE
+			if (NET_IP6_DAD_TENTATIVE(ip6)) {
+				ip6->dad = NET_IP6_DAD_DUPLICATE;
+			}
+#endif
+			NET_STATS_RX(ip6, NET_IP6_HDRSIZE + *datalen);
+			errno = NET_EAGAIN;
+			goto out_end;
+		}
+
+		if (!_net_ip6_nc_advertised(ip6, tgt_addr, l2addr, flags)) {
+			/* Not a neighbor of ours */
+			NET_STATS_DROP(ip6, ADDR);
+			errno = NET_EAGAIN;
+			goto out_end;
+		}
+
+		NET_STATS_RX(ip6, NET_IP6_HDRSIZE + *datalen);
 
+#ifdef NET_IP6_AUTOCONF_ENABLE
 	} else if (type == NET_ICMPV6_TYPE_RA) {
-		/* Not implemented yet */
+		/* Only of interest for the autoconfiguration */
+
+		if (!(ip6->autoconf & NET_IP6_AUTOCONF_ENABLED)) {
+			NET_STATS_DROP(ip6, UNSUPP);
+			errno = NET_EAGAIN;
+			goto out_end;
+		}
+
+		/* Routers advertise from their link-local address */
+		dst_match = _net_icmpv6_match_addr(ip6, dst_addr);
+		if ((dst_match == MATCH_NONE) || (src_addr[0] != 0xFE) || (src_addr[1] != 0x80)) {
+			NET_STATS_DROP(ip6, ADDR);
+			errno = NET_EAGAIN;
+			goto out_end;
+		}
+
+		/**
+		 * 0                   1                   2                   3
+		 *  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+		 * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+		 * |     Type      |     Code      |          Checksum             |
+		 * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+		 * | Cur Hop Limit |M|O|  Reserved |       Router Lifetime         |
+		 * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+		 * |                         Reachable Time                        |
+		 * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+		 * |                          Retrans Timer                        |
+		 * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+		 * |   Options ...
+		 * +-+-+-+-+-+-+-+-+-+-+-+-
+		 */
+
+		/* Check the ICMPV6 RA header fits in the packet length */
+		if (!NET_CHECK_BUFLEN(cursor, *datalen,
+		                      NET_ICMPV6_HDRSIZE + NET_ICMPV6_RA_HDRSIZE)) {
+			NET_STATS_DROP(ip6, LEN);
+			errno = NET_EOVERFLOW;
+			goto out_end;
+		}
+
+		/* Skip hop limit and flags, read the router lifetime, skip the timers */
+		NET_SKIP_DATA(2);
+		NET_GET_SHORT(lifetime);
+		NET_SKIP_DATA(8);
+
+		_net_ip6_process_ra(ip6, cursor, &(buffer[*dataoffset + *datalen]),
+		                    src_addr, lifetime);
+
+		NET_STATS_RX(ip6, NET_IP6_HDRSIZE + *datalen);
+#endif
+
+	} else if (type == NET_ICMPV6_TYPE_ECHO_REQUEST) {
+		/* Answered from our unicast address it was sent to */
+
+		dst_match = _net_icmpv6_match_addr(ip6, dst_addr);
+		if (((dst_match != MATCH_UNICAST) && (dst_match != MATCH_LLADDR)) ||
+		    (src_addr[0] == 0xFF) || NET_IP6_CMP_UNSPEC(src_addr)) {
+			NET_STATS_DROP(ip6, ADDR);
+			errno = NET_EAGAIN;
+			goto out_end;
+		}
+
+		/**
+		 * 0                   1                   2                   3
+		 *  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+		 * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+		 * |     Type      |     Code      |          Checksum             |
+		 * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+		 * |           Identifier          |        Sequence Number        |
+		 * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+		 * |     Data ...
+		 * +-+-+-+-+-
+		 */
+
+		/* Check the ICMPV6 Echo header fits in the packet length */
+		if (!NET_CHECK_BUFLEN(cursor, *datalen,
+		                      NET_ICMPV6_HDRSIZE + NET_ICMPV6_ECHO_HDRSIZE)) {
+			NET_STATS_DROP(ip6, LEN);
+			errno = NET_EOVERFLOW;
+			goto out_end;
+		}
+
+		if (_net_icmpv6_ratelimit(ip6)) {
+			NET_STATS_DROP(ip6, RATE);
+			errno = NET_EAGAIN;
+			goto out_end;
+		}
+
+		NET_STATS_RX(ip6, NET_IP6_HDRSIZE + *datalen);
+
+		_net_icmpv6_reply_echo(ip6, buffer, buflen, *dataoffset - NET_IP6_HDRSIZE, *datalen);
+
+	} else {
+		/* Other ICMPv6 messages are of no interest for us */
+		NET_STATS_DROP(ip6, UNSUPP);
 	}
-	/* Other ICMPv6 messages are of no interest for us */
 
 	errno = NET_EAGAIN;
 
@@ -512,12 +1648,21 @@ out_end:
 	return errno;
 }
 
-int8_t _net_icmpv6_send_na(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen, uint16_t dataoffset,
-                           uint8_t *dst_addr, uint8_t *tgt_addr, bool solicited)
+#if defined(NET_IP6_RATELIMIT_ENABLE) || (defined(NET_IP6_DAD_ENABLE) && defined(NET_HAS_SET_L2_DST))
+/**
+ * Neighbor Advertisement of our global or link-local address, solicited from
+ * dst_addr, or unsolicited, to all nodes (dst_addr NULL)
+ */
+int8_t _net_icmpv6_send_na(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen,
+                           uint8_t *dst_addr, bool lltarget, bool solicited)
 {
 	uint8_t *cursor = NULL;
 	uint8_t *cursor_before = NULL;
-	uint8_t header_pos = 0;
+	uint8_t *l2addr = NULL;
+	uint16_t dataoffset = NET_IP6_PLOAD_POS_LOWER(ip6->lower);
+#ifdef NET_HAS_SET_L2_DST
+	uint8_t l2allnodes[6] = {0x33, 0x33, 0x00, 0x00, 0x00, 0x01};
+#endif
 
 	/* Set the cursor to the position of the ipv6 header in the buffer */
 	NET_SET_CURSOR(buffer, dataoffset);
@@ -525,7 +1670,8 @@ int8_t _net_icmpv6_send_na(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t bu
 
 	/* Check that buffer is big enough for the Neighbor Advertisement header size */
 	if (!NET_CHECK_BUFLEN(buffer, buflen,
-	                      NET_IP6_HDRSIZE + NET_ICMPV6_NA_HDRSIZE + NET_ICMPV6_NDP_OPT_LLA_HDRSIZE)) {
+	                      NET_IP6_HDRSIZE + NET_ICMPV6_HDRSIZE + NET_ICMPV6_NA_HDRSIZE + NET_ICMPV6_NDP_OPT_LLA_HDRSIZE)) {
+		NET_STATS_TX_ERROR(ip6);
 		return NET_EOVERFLOW;
 	}
 
@@ -540,10 +1686,11 @@ int8_t _net_icmpv6_send_na(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t bu
 	NET_PUT_SHORT(0x0000);
 	NET_PUT_DATA(&(ip6->src_addr[8]), 8);
 
-	/* Put destination address (source address of the sollicitation, or multicast all-nodes) */
-	if (dst_addr) {
+	if (dst_addr != NULL) {
+		/* Put destination address (unicast addr) */
 		NET_PUT_DATA(dst_addr, 16);
 	} else {
+		/* Put destination address (multicast all-nodes) */
 		NET_PUT_SHORT(0xFF02);
 		NET_PUT_SHORT(0x0000);
 		NET_PUT_SHORT(0x0000);
@@ -563,16 +1710,22 @@ int8_t _net_icmpv6_send_na(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t bu
 	/* Put the Checksum field (to be computed later) */
 	NET_PUT_SHORT(0x0000);
 
-	/* Put options + reserved */
-	if (solicited) {
-		NET_PUT_SHORT(0x6000);
-	} else {
-		NET_PUT_SHORT(0x2000);
-	}
+	/* Put flags + reserved, optimistic addresses not overriding others (RFC 4429) */
+	NET_PUT_BYTE((solicited ? NET_ICMPV6_NA_FLAG_SOLICITED : 0x00) |
+	             ((NET_IP6_DAD_STATE(ip6) != NET_IP6_DAD_OPTIMISTIC) ? NET_ICMPV6_NA_FLAG_OVERRIDE : 0x00));
+	NET_PUT_BYTE(0x00);
 	NET_PUT_SHORT(0x0000);
 
 	/* Put the Target field */
-	NET_PUT_DATA(tgt_addr, 16);
+	if (lltarget) {
+		NET_PUT_SHORT(0xFE80);
+		NET_PUT_SHORT(0x0000);
+		NET_PUT_SHORT(0x0000);
+		NET_PUT_SHORT(0x0000);
+		NET_PUT_DATA(&(ip6->src_addr[8]), 8);
+	} else {
+		NET_PUT_DATA(ip6->src_addr, 16);
+	}
 
 	/* Put the Target Link-Layer address Option */
 	NET_PUT_BYTE(NET_ICMPV6_NDP_OPT_TGTLLADDR);
@@ -589,11 +1742,196 @@ int8_t _net_icmpv6_send_na(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t bu
 	_net_icmpv6_fix_cksum(cursor_before,
 	                      NET_ICMPV6_HDRSIZE + NET_ICMPV6_NA_HDRSIZE + NET_ICMPV6_NDP_OPT_LLA_HDRSIZE);
 
-	/**
-	 * Pass to the lower layer
-	 * Note: we don't touch to dataoffset since it is already positionned at the beginning of the packet
-	 */
-	/* TODO send to the soliciting node */
-	return NET_IP6_SEND_LOWER(ip6->lower, buffer, buflen, dataoffset,
-	                          NET_IP6_HDRSIZE + NET_ICMPV6_HDRSIZE + NET_ICMPV6_NA_HDRSIZE + NET_ICMPV6_NDP_OPT_LLA_HDRSIZE);
+#ifdef NET_HAS_SET_L2_DST
+	/* Announcements to all nodes, answers to the soliciting node if known */
+	if (!solicited) {
+		l2addr = l2allnodes;
+	} else if (NET_IP6_RESOLUTION(ip6)) {
+		l2addr = (dst_addr != NULL) ? net_ip6_get_neighbor(ip6, dst_addr) : NULL;
+		if (l2addr == NULL) {
+			l2addr = l2allnodes;
+		}
+	}
+#endif
+
+	return _net_ip6_send_l2(ip6, buffer, buflen, dataoffset,
+	                        NET_IP6_HDRSIZE + NET_ICMPV6_HDRSIZE + NET_ICMPV6_NA_HDRSIZE + NET_ICMPV6_NDP_OPT_LLA_HDRSIZE,
+	                        l2addr);
+}
+#endif
+
+#ifdef NET_HAS_SET_L2_DST
+#if defined(NET_IP6_NC_ENABLE) || defined(NET_IP6_DAD_ENABLE)
+/**
+ * Neighbor Solicitation of a target, or of our address for its detection
+ * (dad), from the unspecified address. Optimistic addresses solicit without
+ * their link-layer address, not to override the one of another node.
+ * Solicitations are multicast, unless probing a neighbor known at l2dst.
+ */
+int8_t _net_icmpv6_send_ns(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen,
+                           uint8_t *tgt_addr, uint8_t *l2dst, bool dad)
+{
+	uint8_t *cursor = NULL;
+	uint8_t *cursor_before = NULL;
+	uint8_t l2addr[6];
+	uint16_t dataoffset = NET_IP6_PLOAD_POS_LOWER(ip6->lower);
+	bool sllao = !dad && (NET_IP6_DAD_STATE(ip6) != NET_IP6_DAD_OPTIMISTIC);
+	uint16_t len = NET_ICMPV6_HDRSIZE + NET_ICMPV6_NS_HDRSIZE +
+	               (sllao ? NET_ICMPV6_NDP_OPT_LLA_HDRSIZE : 0);
+
+	/* Set the cursor to the position of the ipv6 header in the buffer */
+	NET_SET_CURSOR(buffer, dataoffset);
+	cursor_before = cursor;
+
+	/* Check that buffer is big enough for the Neighbor Solicitation header size */
+	if (!NET_CHECK_BUFLEN(buffer, buflen, NET_IP6_HDRSIZE + len)) {
+		NET_STATS_TX_ERROR(ip6);
+		return NET_EOVERFLOW;
+	}
+
+	/* Put common parts of the IP6 header */
+	NET_IP6_PUT_HEADER_COMMON(len, NET_IP6_NH_ICMPV6, NET_IP6_HOPLIMIT);
+
+	/* Put source address (link-local unicast addr, or unspecified) */
+	if (dad) {
+		memset(cursor, 0, 16);
+		NET_SKIP_DATA(16);
+	} else {
+		NET_PUT_SHORT(0xFE80);
+		NET_PUT_SHORT(0x0000);
+		NET_PUT_SHORT(0x0000);
+		NET_PUT_SHORT(0x0000);
+		NET_PUT_DATA(&(ip6->src_addr[8]), 8);
+	}
+
+	/* Put destination address (target, or its solicited-node multicast address) */
+	if (l2dst != NULL) {
+		NET_PUT_DATA(tgt_addr, 16);
+	} else {
+		NET_PUT_SHORT(0xFF02);
+		NET_PUT_SHORT(0x0000);
+		NET_PUT_SHORT(0x0000);
+		NET_PUT_SHORT(0x0000);
+		NET_PUT_SHORT(0x0000);
+		NET_PUT_SHORT(0x0001);
+		NET_PUT_BYTE(0xFF);
+		NET_PUT_DATA(&(tgt_addr[13]), 3);
+	}
+
+	/* Put the Type field */
+	NET_PUT_BYTE(NET_ICMPV6_TYPE_NS);
+
+	/* Put the Code field */
+	NET_PUT_BYTE(0x00);
+
+	/* Put the Checksum field (to be computed later) */
+	NET_PUT_SHORT(0x0000);
+
+	/* Put reserved */
+	NET_PUT_SHORT(0x0000);
+	NET_PUT_SHORT(0x0000);
+
+	/* Put the Target field */
+	NET_PUT_DATA(tgt_addr, 16);
+
+	/* Put the Source Link-Layer address Option */
+	if (sllao) {
+		NET_PUT_BYTE(NET_ICMPV6_NDP_OPT_SRCLLADDR);
+		NET_PUT_BYTE(0x01);
+#ifdef NET_HAS_GET_L2_ADDR
+		NET_PUT_DATA(NET_IP6_GET_L2_ADDR_LOWER(ip6->lower), 6);
+#else
+		NET_PUT_SHORT(0x0000);
+		NET_PUT_SHORT(0x0000);
+		NET_PUT_SHORT(0x0000);
+#endif
+	}
+
+	/* Fix the checksum in the packet */
+	_net_icmpv6_fix_cksum(cursor_before, len);
+
+	/* Send to the multicast link-layer address of the solicited-node address */
+	if (l2dst == NULL) {
+		_net_ip6_l2_mcast(l2addr, &(cursor_before[24]));
+		l2dst = l2addr;
+	}
+
+	return _net_ip6_send_l2(ip6, buffer, buflen, dataoffset, NET_IP6_HDRSIZE + len, l2dst);
+}
+#endif
+
+#ifdef NET_IP6_AUTOCONF_ENABLE
+int8_t _net_icmpv6_send_rs(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen)
+{
+	uint8_t *cursor = NULL;
+	uint8_t *cursor_before = NULL;
+	uint8_t l2addr[6] = {0x33, 0x33, 0x00, 0x00, 0x00, 0x02};
+	uint16_t dataoffset = NET_IP6_PLOAD_POS_LOWER(ip6->lower);
+
+	/* Set the cursor to the position of the ipv6 header in the buffer */
+	NET_SET_CURSOR(buffer, dataoffset);
+	cursor_before = cursor;
+
+	/* Check that buffer is big enough for the Router Solicitation header size */
+	if (!NET_CHECK_BUFLEN(buffer, buflen,
+	                      NET_IP6_HDRSIZE + NET_ICMPV6_HDRSIZE + NET_ICMPV6_RS_HDRSIZE + NET_ICMPV6_NDP_OPT_LLA_HDRSIZE)) {
+		NET_STATS_TX_ERROR(ip6);
+		return NET_EOVERFLOW;
+	}
+
+	/* Put common parts of the IP6 header */
+	NET_IP6_PUT_HEADER_COMMON(NET_ICMPV6_HDRSIZE + NET_ICMPV6_RS_HDRSIZE + NET_ICMPV6_NDP_OPT_LLA_HDRSIZE,
+	                          NET_IP6_NH_ICMPV6, NET_IP6_HOPLIMIT);
+
+	/* Put source address (link-local unicast addr) */
+	NET_PUT_SHORT(0xFE80);
+	NET_PUT_SHORT(0x0000);
+	NET_PUT_SHORT(0x0000);
+	NET_PUT_SHORT(0x0000);
+	NET_PUT_DATA(&(ip6->src_addr[8]), 8);
+
+	/* Put destination address (multicast all-routers) */
+	NET_PUT_SHORT(0xFF02);
+	NET_PUT_SHORT(0x0000);
+	NET_PUT_SHORT(0x0000);
+	NET_PUT_SHORT(0x0000);
+	NET_PUT_SHORT(0x0000);
+	NET_PUT_SHORT(0x0000);
+	NET_PUT_SHORT(0x0000);
+	NET_PUT_SHORT(0x0002);
+
+	/* Put the Type field */
+	NET_PUT_BYTE(NET_ICMPV6_TYPE_RS);
+
+	/* Put the Code field */
+	NET_PUT_BYTE(0x00);
+
+	/* Put the Checksum field (to be computed later) */
+	NET_PUT_SHORT(0x0000);
+
+	/* Put reserved */
+	NET_PUT_SHORT(0x0000);
+	NET_PUT_SHORT(0x0000);
+
+	/* Put the Source Link-Layer address Option */
+	NET_PUT_BYTE(NET_ICMPV6_NDP_OPT_SRCLLADDR);
+	NET_PUT_BYTE(0x01);
+#ifdef NET_HAS_GET_L2_ADDR
+	NET_PUT_DATA(NET_IP6_GET_L2_ADDR_LOWER(ip6->lower), 6);
+#else
+	NET_PUT_SHORT(0x0000);
+	NET_PUT_SHORT(0x0000);
+	NET_PUT_SHORT(0x0000);
+#endif
+
+	/* Fix the checksum in the packet */
+	_net_icmpv6_fix_cksum(cursor_before,
+	                      NET_ICMPV6_HDRSIZE + NET_ICMPV6_RS_HDRSIZE + NET_ICMPV6_NDP_OPT_LLA_HDRSIZE);
+
+	/* Send to the multicast link-layer address of all-routers */
+	return _net_ip6_send_l2(ip6, buffer, buflen, dataoffset,
+	                        NET_IP6_HDRSIZE + NET_ICMPV6_HDRSIZE + NET_ICMPV6_RS_HDRSIZE + NET_ICMPV6_NDP_OPT_LLA_HDRSIZE,
+	                        l2addr);
 }
+#endif
+#endif
@@ -11,9 +11,15 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
 #include <stdint.h>
 
+#include "net_stats.h"
+
 #define NET_HAS_GET_L3_CKSUM  1
+#define NET_HAS_CONFIRM       1
+#define NET_HAS_RECV_FROM     1  /* And send to */
+#define NET_HAS_ADDR_GEN      1
 
 #define NET_IP6_NH_UDP    17
 #define NET_IP6_NH_ICMPV6 58
@@ -26,10 +32,103 @@ extern "C" {
 }
 #define NET_IP6_L2_MCSUFFIX_CNT 2
 
+/**
+ * Neighbor cache, of the link-layer addresses of the on-link neighbors. Its
+ * entries are keyed by interface identifier only, the same for all the
+ * on-link prefixes (link-local and global), and kept from the most to the
+ * least recently used, the latter being evicted first.
+ */
+#ifndef NET_IP6_NC_SIZE
+#define NET_IP6_NC_SIZE 4
+#endif
+
+#define NET_IP6_NC_FREE       0
+#define NET_IP6_NC_INCOMPLETE 1  /* Neighbor Solicitation sent */
+#define NET_IP6_NC_REACHABLE  2  /* Confirmed by an advertisement or the upper layers */
+#define NET_IP6_NC_STALE      3  /* Learnt from an unsolicited message, or expired */
+#define NET_IP6_NC_DELAY      4  /* Stale and sent to, probed unless confirmed */
+#define NET_IP6_NC_PROBE      5  /* Unicast Neighbor Solicitations sent */
+
+/**
+ * Neighbor Unreachability Detection (RFC 4861): reachable entries expire
+ * after NET_IP6_REACHABLE_TIME_US without confirmation. The next packet sent
+ * to the neighbor then starts a delay of NET_IP6_DELAY_FIRST_PROBE_US, after
+ * which it is probed with up to 3 unicast solicitations, and removed if none
+ * is answered.
+ */
+#ifndef NET_IP6_REACHABLE_TIME_US
+#define NET_IP6_REACHABLE_TIME_US    30000000UL
+#endif
+#ifndef NET_IP6_DELAY_FIRST_PROBE_US
+#define NET_IP6_DELAY_FIRST_PROBE_US 5000000UL
+#endif
+
+/**
+ * Rate limit of the ICMPv6 replies (Neighbor Advertisements, Echo Replies),
+ * as a token bucket: up to NET_IP6_ICMPV6_BURST replies in a row, then one
+ * per NET_IP6_ICMPV6_INTERVAL_US. Requests over the limit are dropped. Only
+ * with NET_IP6_RATELIMIT_ENABLE.
+ */
+#ifndef NET_IP6_ICMPV6_BURST
+#define NET_IP6_ICMPV6_BURST       8
+#endif
+#ifndef NET_IP6_ICMPV6_INTERVAL_US
+#define NET_IP6_ICMPV6_INTERVAL_US 100000UL
+#endif
+
+struct net_ip6_neighbor {
+	uint8_t iid[8];
+	uint8_t l2addr[6];
+	uint8_t state;
+	uint8_t solicits;            /* Neighbor Solicitations sent while incomplete or probing */
+	uint32_t time_us;            /* Last confirmation, or start of delay or probe */
+};
+
+/* Stateless address autoconfiguration, flags of the autoconf field */
+#define NET_IP6_AUTOCONF_ENABLED 0x01
+#define NET_IP6_AUTOCONF_PREFIX  0x02  /* Prefix learnt, source address global */
+#define NET_IP6_AUTOCONF_ROUTER  0x04  /* Default router known */
+
+/* Duplicate Address Detection of the source address, dad field */
+#define NET_IP6_DAD_OFF        0
+#define NET_IP6_DAD_PENDING    1  /* Address changed, to be announced */
+#define NET_IP6_DAD_OPTIMISTIC 2  /* Announced, used while being detected */
+#define NET_IP6_DAD_PREFERRED  3
+#define NET_IP6_DAD_DUPLICATE  4  /* Used by another node, not sent from */
+
 struct net_ip6_ctx {
 	uint8_t src_addr[16];
 	uint8_t dst_addr[16];
 	uint8_t nh;
+	uint8_t addr_gen;            /* Changes of the source address */
+
+#ifdef NET_IP6_NC_ENABLE
+	uint8_t resolution;
+	uint32_t solicit_time_us;    /* Last Neighbor Solicitation sent */
+	struct net_ip6_neighbor neighbors[NET_IP6_NC_SIZE];
+#endif
+
+#ifdef NET_IP6_AUTOCONF_ENABLE
+	uint8_t autoconf;
+	uint8_t router_l2addr[6];    /* Default router */
+	uint16_t mtu;                /* Link MTU advertised, 0 if none */
+#endif
+
+#ifdef NET_IP6_DAD_ENABLE
+	uint8_t dad;
+	uint32_t dad_time_us;        /* Announcement of the source address */
+#endif
+
+#ifdef NET_IP6_RATELIMIT_ENABLE
+	uint8_t icmpv6_spent;        /* Tokens taken from the bucket of the ICMPv6 replies */
+	uint32_t icmpv6_time_us;     /* Last refill of the bucket */
+	uint8_t na_pending;          /* Solicited advertisement to be sent */
+	uint8_t na_dst_addr[16];     /* Source of the solicitation */
+#endif
+
+#ifdef NET_STATS_ENABLE
+	struct net_stats stats;
+#endif
 
 	struct NET_IP6_PROTO_LOWER(_ctx) *lower;
 };
@@ -38,6 +137,74 @@ extern int8_t net_ip6_set_source_addr(struct net_ip6_ctx *ip6, uint8_t *src_addr
 extern int8_t net_ip6_set_destination_addr(struct net_ip6_ctx *ip6, uint8_t *dst_addr);
 extern int8_t net_ip6_set_nexthdr(struct net_ip6_ctx *ip6, uint8_t nh);
 extern uint16_t net_ip6_get_l3_cksum(struct net_ip6_ctx *ip6);
+extern uint16_t net_ip6_get_l3_cksum_to(struct net_ip6_ctx *ip6, uint8_t *dst_addr);
+/**
+ * Generation of the source address, changed with it, by the Router
+ * Advertisements as well: sums of the pseudo-header computed beforehand are
+ * to be computed again.
+ */
+extern uint8_t net_ip6_get_addr_gen(struct net_ip6_ctx *ip6);
+
+/**
+ * Address resolution, off by default: the destination link-layer address of
+ * the lower layer is then left as configured. When enabled, it is looked up
+ * in the neighbor cache for each packet sent. On a miss, a Neighbor
+ * Solicitation is sent instead, built after the packet in the buffer, and
+ * NET_EAGAIN is returned: the packet is sent again by the caller once the
+ * advertisement has been received, by any recv function of the stack. One
+ * address is resolved at a time, and given up after 3 solicitations.
+ * The cache is filled from the advertisements and from the source link-layer
+ * address of the solicitations, whether resolution is enabled or not. Both
+ * need NET_IP6_NC_ENABLE, otherwise NET_ECONFIG is returned.
+ */
+extern int8_t net_ip6_set_resolution(struct net_ip6_ctx *ip6, uint8_t enable);
+/* Link-layer address of a neighbor, NULL if unknown or being resolved */
+extern uint8_t *net_ip6_get_neighbor(struct net_ip6_ctx *ip6, uint8_t *addr);
+/**
+ * Reachability hint of the upper layers: the destination has been heard from
+ * in answer to our packets, its neighbor entry needs no probe for another
+ * NET_IP6_REACHABLE_TIME_US. The UDP layer confirms its replies, CoAP
+ * acknowledgements and responses included.
+ */
+extern int8_t net_ip6_confirm(struct net_ip6_ctx *ip6);
+/* Same, of another destination than the one of the context */
+extern int8_t net_ip6_confirm_to(struct net_ip6_ctx *ip6, uint8_t *dst_addr);
+
+/**
+ * Stateless address autoconfiguration: the interface identifier of the source
+ * address is derived from the MAC address of the lower layer (modified
+ * EUI-64), its prefix set to fe80::/64, and a Router Solicitation is sent in
+ * the buffer. The Router Advertisements then received set the prefix of the
+ * source address (first prefix option, if autonomous and of 64 bits), the
+ * default router and the MTU of the link. Off-link packets are sent to the
+ * MAC address of the router, or all the packets if address resolution is not
+ * enabled. The multicast suffixes of the MAC layer must be set after this
+ * call, from the new source address. Needs NET_IP6_AUTOCONF_ENABLE, otherwise
+ * NET_ECONFIG is returned and the Router Advertisements are ignored.
+ */
+extern int8_t net_ip6_autoconf(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen);
+
+/**
+ * Optimistic Duplicate Address Detection (RFC 4429), off by default. When
+ * enabled, and each time the source address changes, a Neighbor Solicitation
+ * of the address and an unsolicited Neighbor Advertisement to all nodes, for
+ * the neighbors to learn our link-layer address, are sent by
+ * net_ip6_announce(), or else by the next send or recv call. The address is
+ * used meanwhile. If another node uses it, as detected within a second, the
+ * address is duplicate and net_ip6_send() returns NET_ECONFIG until another
+ * one is set. Needs NET_IP6_DAD_ENABLE, otherwise NET_ECONFIG is returned.
+ */
+extern int8_t net_ip6_set_dad(struct net_ip6_ctx *ip6, uint8_t enable);
+extern int8_t net_ip6_announce(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen);
+
+/**
+ * Neighbor Solicitations are answered while receiving, in place. With
+ * NET_IP6_RATELIMIT_ENABLE, they are only recorded while receiving, and
+ * answered out of the receive path, by net_ip6_service() when the application
+ * is idle: one solicitation is recorded at a time, others are dropped
+ * meanwhile. Returns NET_EAGAIN if there was no solicitation to answer.
+ */
+extern int8_t net_ip6_service(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen);
 
 extern int8_t net_ip6_connect(struct net_ip6_ctx *ip6);
 extern uint8_t net_ip6_pload_pos(struct net_ip6_ctx *ip6);
@@ -46,6 +213,25 @@ extern int8_t net_ip6_recv(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t bu
 extern int8_t net_ip6_send(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen,
                            uint16_t dataoffset, uint16_t datalen);
 
+/**
+ * Receive of the flows of several peers, see net_udp_flows_recv(): the data
+ * packets are accepted from any source, to the source address of the context,
+ * and the address of their source is returned in peer_addr, pointing into the
+ * buffer. The other packets are processed as by net_ip6_recv(), the flows
+ * sharing the context, its neighbor cache included. A flow is identified by
+ * the address of its peer, or the destination address of the context if
+ * NULL, given to net_ip6_flow_hash() and net_ip6_flow_match() along with the
+ * address received.
+ * Packets are sent to another destination than the one of the context with
+ * net_ip6_send_to(), which may be the address received, in the same buffer.
+ */
+extern int8_t net_ip6_recv_from(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen,
+                                uint16_t *dataoffset, uint16_t *datalen, uint8_t **peer_addr);
+extern int8_t net_ip6_send_to(struct net_ip6_ctx *ip6, uint8_t *buffer, uint16_t buflen,
+                              uint16_t dataoffset, uint16_t datalen, uint8_t *dst_addr);
+extern uint8_t net_ip6_flow_hash(struct net_ip6_ctx *ip6, uint8_t *peer_addr);
+extern bool net_ip6_flow_match(struct net_ip6_ctx *ip6, uint8_t *addr, uint8_t *peer_addr);
+
 #ifdef __cplusplus
 }
 #endif
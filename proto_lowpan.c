@@ -0,0 +1,628 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "config.h"
+#include "proto_lowpan.h"
+#include "net_utils.h"
+#include "net_memstats.h"
+#include "net_trace.h"
+
+#include <stdbool.h>
+
+
+#define NET_LOWPAN_RECV_LOWER(...)    NET_LOWPAN_PROTO_LOWER(_recv)(__VA_ARGS__)
+#define NET_LOWPAN_SEND_LOWER(...)    NET_LOWPAN_PROTO_LOWER(_send)(__VA_ARGS__)
+
+/**
+ * LOWPAN_IPHC header
+ *
+ *   0                                       1
+ *   0   1   2   3   4   5   6   7   8   9   0   1   2   3   4   5
+ * +---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+
+ * | 0 | 1 | 1 |  TF   |NH | HLIM  |CID|SAC|  SAM  | M |DAC|  DAM  |
+ * +---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+
+ *
+ * Followed by the fields carried inline, in the order of the IPv6 header,
+ * then by the UDP NHC header if NH is set:
+ *
+ * +---+---+---+---+---+---+---+---+
+ * | 1 | 1 | 1 | 1 | 0 | C |   P   |  Ports, then checksum
+ * +---+---+---+---+---+---+---+---+
+ */
+
+#define NET_LOWPAN_DISPATCH_IPV6  0x41
+#define NET_LOWPAN_DISPATCH_IPHC  0x60
+#define NET_LOWPAN_DISPATCH_MASK  0xE0
+
+#define NET_LOWPAN_IPHC_TF        0x18
+#define NET_LOWPAN_IPHC_NH        0x04
+#define NET_LOWPAN_IPHC_HLIM      0x03
+#define NET_LOWPAN_IPHC_CID       0x80
+#define NET_LOWPAN_IPHC_SAM       0x70  /* With SAC */
+#define NET_LOWPAN_IPHC_M         0x08
+#define NET_LOWPAN_IPHC_DAM       0x07  /* With DAC */
+
+#define NET_LOWPAN_NHC_UDP        0xF0
+#define NET_LOWPAN_NHC_UDP_MASK   0xF8
+#define NET_LOWPAN_NHC_UDP_C      0x04
+#define NET_LOWPAN_NHC_UDP_P      0x03
+
+/* Address modes, of SAC and SAM, or of DAC and DAM */
+#define NET_LOWPAN_MODE_CTX       0x04
+#define NET_LOWPAN_MODE_UNSPEC    0x04  /* Context, nothing inline */
+#define NET_LOWPAN_MODE_EUI64     0x03
+
+#define NET_LOWPAN_IP6_VERSION    0x06
+#define NET_LOWPAN_IP6_HDRSIZE    40
+#define NET_LOWPAN_UDP_HDRSIZE    8
+
+/* Received frames are read after the room of their headers decompressed */
+#define NET_LOWPAN_HEADROOM       (NET_LOWPAN_IP6_HDRSIZE + NET_LOWPAN_UDP_HDRSIZE)
+
+/* Put before the cursor, headers being compressed backwards */
+#define NET_LOWPAN_PUSH_BYTE(value) \
+	do { \
+		cursor = ((uint8_t*) cursor) - 1; \
+		((uint8_t*) cursor)[0] = value; \
+	} while (0)
+
+#define NET_LOWPAN_PUSH_SHORT(value) \
+	do { \
+		cursor = ((uint8_t*) cursor) - 2; \
+		((uint8_t*) cursor)[0] = (value & 0xFF00) >> 8; \
+		((uint8_t*) cursor)[1] = (value & 0x00FF); \
+	} while (0)
+
+/* Inline lengths, by TF, by unicast and multicast address mode, and by P */
+static const uint8_t net_lowpan_tf_len[4] = {4, 3, 1, 0};
+static const uint8_t net_lowpan_addr_len[8] = {16, 8, 2, 0, 0, 8, 2, 0};
+static const uint8_t net_lowpan_mcast_len[4] = {16, 6, 4, 1};
+static const uint8_t net_lowpan_ports_len[4] = {4, 3, 3, 1};
+
+
+uint8_t *net_lowpan_get_l2_addr(struct net_lowpan_ctx *lowpan)
+{
+	return lowpan->src_l2addr;
+}
+
+int8_t net_lowpan_set_source_addr(struct net_lowpan_ctx *lowpan, uint8_t *src_l2addr)
+{
+	memcpy(lowpan->src_l2addr, src_l2addr, 6);
+	return NET_STATUS_OK;
+}
+
+uint8_t *net_lowpan_get_destination_addr(struct net_lowpan_ctx *lowpan)
+{
+	return lowpan->dst_l2addr;
+}
+
+int8_t net_lowpan_set_destination_addr(struct net_lowpan_ctx *lowpan, uint8_t *dst_l2addr)
+{
+	memcpy(lowpan->dst_l2addr, dst_l2addr, 6);
+	return NET_STATUS_OK;
+}
+
+int8_t net_lowpan_set_context(struct net_lowpan_ctx *lowpan, uint8_t *prefix)
+{
+	if (prefix != NULL) {
+		memcpy(lowpan->context, prefix, 8);
+	}
+	lowpan->context_valid = (prefix != NULL);
+	return NET_STATUS_OK;
+}
+
+static bool _net_lowpan_is_zero(uint8_t *data, uint8_t datalen)
+{
+	uint8_t i;
+
+	for (i=0; i<datalen; i++) {
+		if (data[i] != 0x00) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Modified EUI-64 interface identifier of a link-layer address */
+static void _net_lowpan_put_eui64(uint8_t *iid, uint8_t *l2addr)
+{
+	iid[0] = l2addr[0] ^ 0x02;
+	iid[1] = l2addr[1];
+	iid[2] = l2addr[2];
+	iid[3] = 0xFF;
+	iid[4] = 0xFE;
+	iid[5] = l2addr[3];
+	iid[6] = l2addr[4];
+	iid[7] = l2addr[5];
+}
+
+/* Mode of a unicast address, the interface identifier being the one of l2addr or not */
+static uint8_t _net_lowpan_addr_mode(struct net_lowpan_ctx *lowpan, uint8_t *addr,
+                                     uint8_t *l2addr)
+{
+	uint8_t mode = 0;
+	uint8_t iid[8];
+
+	if (_net_lowpan_is_zero(addr, 16)) {
+		return NET_LOWPAN_MODE_UNSPEC;
+	} else if ((addr[0] == 0xFE) && (addr[1] == 0x80) && _net_lowpan_is_zero(&addr[2], 6)) {
+		mode = 0;
+	} else if (lowpan->context_valid && (memcmp(addr, lowpan->context, 8) == 0)) {
+		mode = NET_LOWPAN_MODE_CTX;
+	} else {
+		/* Full address inline */
+		return 0;
+	}
+
+	_net_lowpan_put_eui64(iid, l2addr);
+	if (memcmp(&addr[8], iid, 8) == 0) {
+		return mode | NET_LOWPAN_MODE_EUI64;
+	} else if (_net_lowpan_is_zero(&addr[8], 3) && (addr[11] == 0xFF) &&
+	           (addr[12] == 0xFE) && (addr[13] == 0x00)) {
+		/* 0000:00ff:fe00:XXXX */
+		return mode | 0x02;
+	}
+	return mode | 0x01;
+}
+
+/* Mode of a multicast address, of DAM */
+static uint8_t _net_lowpan_mcast_mode(uint8_t *addr)
+{
+	if ((addr[1] == 0x02) && _net_lowpan_is_zero(&addr[2], 13)) {
+		/* ff02::00XX */
+		return 0x03;
+	} else if (_net_lowpan_is_zero(&addr[2], 11)) {
+		/* ffXX::00XX:XXXX */
+		return 0x02;
+	} else if (_net_lowpan_is_zero(&addr[2], 9)) {
+		/* ffXX::00XX:XXXX:XXXX */
+		return 0x01;
+	}
+	return 0;
+}
+
+/**
+ * Put the inline part of an address, of len bytes, before end: its last
+ * bytes, after the flags and scope for the multicast addresses of 6 and 4
+ * bytes. The address may be overwritten. Returns the start of the part.
+ */
+static uint8_t *_net_lowpan_put_addr(uint8_t *end, uint8_t *addr, uint8_t len, bool mcast)
+{
+	uint8_t flags = addr[1];
+
+	if (mcast && (len > 1) && (len < 16)) {
+		memmove(end - len + 1, &addr[16 - len + 1], len - 1);
+		end[-len] = flags;
+	} else {
+		memmove(end - len, &addr[16 - len], len);
+	}
+	return end - len;
+}
+
+/* Address of the mode, from its inline part at cursor. Returns the end of the part */
+static uint8_t *_net_lowpan_get_addr(struct net_lowpan_ctx *lowpan, uint8_t *addr,
+                                     uint8_t *cursor, uint8_t mode, uint8_t *l2addr)
+{
+	uint8_t len = net_lowpan_addr_len[mode];
+
+	memset(addr, 0, 16);
+	if (mode == NET_LOWPAN_MODE_UNSPEC) {
+		return cursor;
+	} else if (mode & NET_LOWPAN_MODE_CTX) {
+		memcpy(addr, lowpan->context, 8);
+	} else if (mode != 0) {
+		addr[0] = 0xFE;
+		addr[1] = 0x80;
+	}
+
+	if ((mode & NET_LOWPAN_MODE_EUI64) == NET_LOWPAN_MODE_EUI64) {
+		_net_lowpan_put_eui64(&addr[8], l2addr);
+	} else if ((mode & NET_LOWPAN_MODE_EUI64) == 0x02) {
+		addr[11] = 0xFF;
+		addr[12] = 0xFE;
+	}
+
+	memcpy(&addr[16 - len], cursor, len);
+	return cursor + len;
+}
+
+static uint8_t *_net_lowpan_get_mcast(uint8_t *addr, uint8_t *cursor, uint8_t mode)
+{
+	uint8_t len = net_lowpan_mcast_len[mode];
+
+	memset(addr, 0, 16);
+	if (len == 16) {
+		memcpy(addr, cursor, 16);
+	} else if (len == 1) {
+		addr[0] = 0xFF;
+		addr[1] = 0x02;
+		addr[15] = cursor[0];
+	} else {
+		addr[0] = 0xFF;
+		addr[1] = cursor[0];
+		memcpy(&addr[16 - len + 1], cursor + 1, len - 1);
+	}
+	return cursor + len;
+}
+
+int8_t net_lowpan_connect(struct net_lowpan_ctx *lowpan)
+{
+	return NET_STATUS_OK;
+}
+
+uint8_t net_lowpan_pload_pos(struct net_lowpan_ctx *lowpan)
+{
+	/* The IPv6 header is built at the start, and compressed in place */
+	return 0;
+}
+
+int8_t net_lowpan_recv(struct net_lowpan_ctx *lowpan, uint8_t *buffer, uint16_t buflen,
+                       uint16_t *dataoffset, uint16_t *datalen)
+{
+	int8_t errno = NET_EAGAIN;
+	uint8_t *cursor = NULL;
+	uint8_t *frame = NULL;
+	uint16_t frame_length = 0;
+	uint8_t iphc0 = 0;
+	uint8_t iphc1 = 0;
+	uint8_t srcmode = 0;
+	uint8_t dstmode = 0;
+	uint8_t byte = 0;
+	uint8_t tc = 0;
+	uint32_t flow = 0;
+	uint8_t nh = 0;
+	uint8_t hlim = 0;
+	uint8_t nhc = 0;
+	uint16_t source_port = 0;
+	uint16_t destination_port = 0;
+	uint16_t cksum = 0;
+	uint16_t hdrlen = NET_LOWPAN_IP6_HDRSIZE;
+	uint16_t length = 0;
+
+	NET_MEMSTATS_SCOPE(NET_MEMSTATS_LOWPAN_RECV);
+	NET_TRACE_SCOPE(NET_TRACE_LOWPAN_RECV, buflen, datalen);
+
+	if (buflen <= NET_LOWPAN_HEADROOM) {
+		errno = NET_EOVERFLOW;
+		goto out_zerodata;
+	}
+
+	/* The headers are decompressed before the frame, at the start of the buffer */
+	frame_length = NET_LOWPAN_RECV_LOWER(lowpan->lower, &(buffer[NET_LOWPAN_HEADROOM]),
+	                                     buflen - NET_LOWPAN_HEADROOM);
+	lowpan->idle = (frame_length == 0);
+	if (frame_length == 0) {
+		errno = NET_EAGAIN;
+		goto out_zerodata;
+	}
+
+	NET_SET_CURSOR(buffer, NET_LOWPAN_HEADROOM);
+	frame = cursor;
+
+	/* Uncompressed IPv6 header, only moved */
+	if (frame[0] == NET_LOWPAN_DISPATCH_IPV6) {
+		length = frame_length - 1;
+		memmove(buffer, &(frame[1]), length);
+		errno = NET_STATUS_OK;
+		goto out_data;
+	}
+
+	if (!NET_CHECK_BUFLEN(frame, frame_length, 2)) {
+		NET_STATS_DROP(lowpan, LEN);
+		errno = NET_EOVERFLOW;
+		goto out_zerodata;
+	} else if ((frame[0] & NET_LOWPAN_DISPATCH_MASK) != NET_LOWPAN_DISPATCH_IPHC) {
+		NET_STATS_DROP(lowpan, PROTO);
+		errno = NET_EPROTO;
+		goto out_zerodata;
+	}
+
+	NET_GET_BYTE(iphc0);
+	NET_GET_BYTE(iphc1);
+	srcmode = (iphc1 & NET_LOWPAN_IPHC_SAM) >> 4;
+	dstmode = iphc1 & NET_LOWPAN_IPHC_DAM;
+
+	/* DAC without DAM is reserved */
+	if (!(iphc1 & NET_LOWPAN_IPHC_M) && (dstmode == NET_LOWPAN_MODE_CTX)) {
+		NET_STATS_DROP(lowpan, PROTO);
+		errno = NET_EPROTO;
+		goto out_zerodata;
+	}
+
+	/* Only the context 0 is known, and no unicast-prefix based multicast address */
+	if ((iphc1 & NET_LOWPAN_IPHC_CID) ||
+	    ((iphc1 & NET_LOWPAN_IPHC_M) && (dstmode & NET_LOWPAN_MODE_CTX)) ||
+	    (!lowpan->context_valid &&
+	     (((srcmode & NET_LOWPAN_MODE_CTX) && (srcmode != NET_LOWPAN_MODE_UNSPEC)) ||
+	      (!(iphc1 & NET_LOWPAN_IPHC_M) && (dstmode & NET_LOWPAN_MODE_CTX))))) {
+		NET_STATS_DROP(lowpan, UNSUPP);
+		errno = NET_EAGAIN;
+		goto out_zerodata;
+	}
+
+	/* Check that the frame holds the fields inline */
+	length = net_lowpan_tf_len[(iphc0 & NET_LOWPAN_IPHC_TF) >> 3] +
+	         ((iphc0 & NET_LOWPAN_IPHC_NH) ? 0 : 1) +
+	         ((iphc0 & NET_LOWPAN_IPHC_HLIM) ? 0 : 1) +
+	         net_lowpan_addr_len[srcmode] +
+	         ((iphc1 & NET_LOWPAN_IPHC_M) ? net_lowpan_mcast_len[dstmode] :
+	                                        net_lowpan_addr_len[dstmode]);
+	if (!NET_CHECK_BUFLEN(frame, frame_length, length)) {
+		NET_STATS_DROP(lowpan, LEN);
+		errno = NET_EOVERFLOW;
+		goto out_zerodata;
+	}
+
+	/* Traffic class and flow label, ECN and DSCP being swapped */
+	switch ((iphc0 & NET_LOWPAN_IPHC_TF) >> 3) {
+	case 0:
+		NET_GET_BYTE(byte);
+		tc = (byte << 2) | (byte >> 6);
+		NET_GET_BYTE(byte);
+		NET_GET_SHORT(flow);
+		flow |= (uint32_t) (byte & 0x0F) << 16;
+		break;
+	case 1:
+		NET_GET_BYTE(byte);
+		tc = byte >> 6;
+		NET_GET_SHORT(flow);
+		flow |= (uint32_t) (byte & 0x0F) << 16;
+		break;
+	case 2:
+		NET_GET_BYTE(byte);
+		tc = (byte << 2) | (byte >> 6);
+		break;
+	}
+
+	if (!(iphc0 & NET_LOWPAN_IPHC_NH)) {
+		NET_GET_BYTE(nh);
+	}
+
+	switch (iphc0 & NET_LOWPAN_IPHC_HLIM) {
+	case 0: NET_GET_BYTE(hlim); break;
+	case 1: hlim = 1; break;
+	case 2: hlim = 64; break;
+	case 3: hlim = 255; break;
+	}
+
+	/* Addresses, the source being the peer */
+	cursor = _net_lowpan_get_addr(lowpan, &(buffer[8]), cursor, srcmode, lowpan->dst_l2addr);
+	if (iphc1 & NET_LOWPAN_IPHC_M) {
+		cursor = _net_lowpan_get_mcast(&(buffer[24]), cursor, dstmode);
+	} else {
+		cursor = _net_lowpan_get_addr(lowpan, &(buffer[24]), cursor, dstmode, lowpan->src_l2addr);
+	}
+
+	if (iphc0 & NET_LOWPAN_IPHC_NH) {
+		if (!NET_CHECK_BUFLEN(frame, frame_length, 1)) {
+			NET_STATS_DROP(lowpan, LEN);
+			errno = NET_EOVERFLOW;
+			goto out_zerodata;
+		}
+		NET_GET_BYTE(nhc);
+
+		/* The checksum is needed, the UDP payload not being ours */
+		if (((nhc & NET_LOWPAN_NHC_UDP_MASK) != NET_LOWPAN_NHC_UDP) ||
+		    (nhc & NET_LOWPAN_NHC_UDP_C)) {
+			NET_STATS_DROP(lowpan, UNSUPP);
+			errno = NET_EAGAIN;
+			goto out_zerodata;
+		}
+
+		if (!NET_CHECK_BUFLEN(frame, frame_length,
+		                      net_lowpan_ports_len[nhc & NET_LOWPAN_NHC_UDP_P] + 2)) {
+			NET_STATS_DROP(lowpan, LEN);
+			errno = NET_EOVERFLOW;
+			goto out_zerodata;
+		}
+
+		switch (nhc & NET_LOWPAN_NHC_UDP_P) {
+		case 0:
+			NET_GET_SHORT(source_port);
+			NET_GET_SHORT(destination_port);
+			break;
+		case 1:
+			NET_GET_SHORT(source_port);
+			NET_GET_BYTE(byte);
+			destination_port = 0xF000 | byte;
+			break;
+		case 2:
+			NET_GET_BYTE(byte);
+			source_port = 0xF000 | byte;
+			NET_GET_SHORT(destination_port);
+			break;
+		case 3:
+			NET_GET_BYTE(byte);
+			source_port = 0xF0B0 | (byte >> 4);
+			destination_port = 0xF0B0 | (byte & 0x0F);
+			break;
+		}
+		NET_GET_SHORT(cksum);
+
+		nh = NET_IP6_NH_UDP;
+		hdrlen += NET_LOWPAN_UDP_HDRSIZE;
+	}
+
+	/* Payload after the headers decompressed, then the IPv6 payload length */
+	length = frame_length - (cursor - frame);
+	memmove(&(buffer[hdrlen]), cursor, length);
+	length += hdrlen - NET_LOWPAN_IP6_HDRSIZE;
+
+	NET_SET_CURSOR(buffer, 0);
+	NET_PUT_BYTE((NET_LOWPAN_IP6_VERSION << 4) | (tc >> 4));
+	NET_PUT_BYTE((uint8_t) (tc << 4) | (uint8_t) (flow >> 16));
+	NET_PUT_SHORT(flow);
+	NET_PUT_SHORT(length);
+	NET_PUT_BYTE(nh);
+	NET_PUT_BYTE(hlim);
+
+	if (hdrlen > NET_LOWPAN_IP6_HDRSIZE) {
+		NET_SET_CURSOR(buffer, NET_LOWPAN_IP6_HDRSIZE);
+		NET_PUT_SHORT(source_port);
+		NET_PUT_SHORT(destination_port);
+		NET_PUT_SHORT(length);
+		NET_PUT_SHORT(cksum);
+	}
+
+	length += NET_LOWPAN_IP6_HDRSIZE;
+	errno = NET_STATUS_OK;
+	goto out_data;
+
+out_zerodata:
+	*datalen = 0;
+	*dataoffset = 0;
+	return errno;
+
+out_data:
+	NET_STATS_RX(lowpan, frame_length);
+	*dataoffset = 0;
+	*datalen = length;
+	return errno;
+}
+
+int8_t net_lowpan_send(struct net_lowpan_ctx *lowpan, uint8_t *buffer, uint16_t buflen,
+                       uint16_t dataoffset, uint16_t datalen)
+{
+	uint8_t *cursor = NULL;
+	uint8_t *header = NULL;
+	uint8_t iphc0 = NET_LOWPAN_DISPATCH_IPHC;
+	uint8_t iphc1 = 0;
+	uint8_t mode = 0;
+	uint8_t tc = 0;
+	uint32_t flow = 0;
+	uint8_t nh = 0;
+	uint8_t hlim = 0;
+	uint8_t nhc = NET_LOWPAN_NHC_UDP;
+	uint16_t source_port = 0;
+	uint16_t destination_port = 0;
+	uint16_t length = 0;
+	uint16_t cksum = 0;
+	uint16_t hdrlen = NET_LOWPAN_IP6_HDRSIZE;
+	uint16_t sent = 0;
+
+	NET_MEMSTATS_SCOPE(NET_MEMSTATS_LOWPAN_SEND);
+	NET_TRACE_SCOPE(NET_TRACE_LOWPAN_SEND, datalen, &datalen);
+
+	/* Set the cursor to the position of the IPv6 header in the buffer */
+	NET_SET_CURSOR(buffer, dataoffset);
+	header = cursor;
+
+	if (!NET_CHECK_BUFLEN(header, datalen, NET_LOWPAN_IP6_HDRSIZE)) {
+		NET_STATS_TX_ERROR(lowpan);
+		return NET_EOVERFLOW;
+	}
+
+	/* Read the fields, before the headers are overwritten */
+	tc = (header[0] << 4) | (header[1] >> 4);
+	flow = ((uint32_t) (header[1] & 0x0F) << 16) | (header[2] << 8) | header[3];
+	nh = header[6];
+	hlim = header[7];
+
+	NET_SET_CURSOR(header, NET_LOWPAN_IP6_HDRSIZE);
+	if ((nh == NET_IP6_NH_UDP) && NET_CHECK_BUFLEN(header, datalen, NET_LOWPAN_UDP_HDRSIZE)) {
+		NET_GET_SHORT(source_port);
+		NET_GET_SHORT(destination_port);
+		NET_GET_SHORT(length);
+		NET_GET_SHORT(cksum);
+		if (length == datalen - NET_LOWPAN_IP6_HDRSIZE) {
+			hdrlen += NET_LOWPAN_UDP_HDRSIZE;
+		}
+	}
+
+	/**
+	 * The compressed headers are built backwards from the payload, over the
+	 * headers: no field is longer compressed, and none is overwritten before
+	 * it is read.
+	 */
+	NET_SET_CURSOR(header, hdrlen);
+
+	if (hdrlen > NET_LOWPAN_IP6_HDRSIZE) {
+		NET_LOWPAN_PUSH_SHORT(cksum);
+		if (((source_port & 0xFFF0) == 0xF0B0) && ((destination_port & 0xFFF0) == 0xF0B0)) {
+			NET_LOWPAN_PUSH_BYTE(((source_port & 0x0F) << 4) | (destination_port & 0x0F));
+			nhc |= 0x03;
+		} else if ((destination_port & 0xFF00) == 0xF000) {
+			NET_LOWPAN_PUSH_BYTE(destination_port & 0x00FF);
+			NET_LOWPAN_PUSH_SHORT(source_port);
+			nhc |= 0x01;
+		} else if ((source_port & 0xFF00) == 0xF000) {
+			NET_LOWPAN_PUSH_SHORT(destination_port);
+			NET_LOWPAN_PUSH_BYTE(source_port & 0x00FF);
+			nhc |= 0x02;
+		} else {
+			NET_LOWPAN_PUSH_SHORT(destination_port);
+			NET_LOWPAN_PUSH_SHORT(source_port);
+		}
+		NET_LOWPAN_PUSH_BYTE(nhc);
+		iphc0 |= NET_LOWPAN_IPHC_NH;
+	}
+
+	/* Destination then source address, the destination being the peer */
+	if (header[24] == 0xFF) {
+		mode = _net_lowpan_mcast_mode(&(header[24]));
+		cursor = _net_lowpan_put_addr(cursor, &(header[24]), net_lowpan_mcast_len[mode], true);
+		iphc1 |= NET_LOWPAN_IPHC_M | mode;
+	} else {
+		mode = _net_lowpan_addr_mode(lowpan, &(header[24]), lowpan->dst_l2addr);
+		if (mode == NET_LOWPAN_MODE_UNSPEC) {
+			/* Reserved for the destination */
+			mode = 0;
+		}
+		cursor = _net_lowpan_put_addr(cursor, &(header[24]), net_lowpan_addr_len[mode], false);
+		iphc1 |= mode;
+	}
+
+	mode = _net_lowpan_addr_mode(lowpan, &(header[8]), lowpan->src_l2addr);
+	cursor = _net_lowpan_put_addr(cursor, &(header[8]), net_lowpan_addr_len[mode], false);
+	iphc1 |= mode << 4;
+
+	switch (hlim) {
+	case 255: iphc0 |= 0x03; break;
+	case 64: iphc0 |= 0x02; break;
+	case 1: iphc0 |= 0x01; break;
+	default: NET_LOWPAN_PUSH_BYTE(hlim); break;
+	}
+
+	if (!(iphc0 & NET_LOWPAN_IPHC_NH)) {
+		NET_LOWPAN_PUSH_BYTE(nh);
+	}
+
+	/* Traffic class and flow label, ECN and DSCP being swapped */
+	tc = (tc >> 2) | (tc << 6);
+	if ((flow == 0) && (tc == 0)) {
+		iphc0 |= 0x18;
+	} else if (flow == 0) {
+		NET_LOWPAN_PUSH_BYTE(tc);
+		iphc0 |= 0x10;
+	} else if ((tc & 0x3F) == 0) {
+		NET_LOWPAN_PUSH_SHORT(flow);
+		NET_LOWPAN_PUSH_BYTE((tc & 0xC0) | (uint8_t) (flow >> 16));
+		iphc0 |= 0x08;
+	} else {
+		NET_LOWPAN_PUSH_SHORT(flow);
+		NET_LOWPAN_PUSH_BYTE((uint8_t) (flow >> 16));
+		NET_LOWPAN_PUSH_BYTE(tc);
+	}
+
+	NET_LOWPAN_PUSH_BYTE(iphc1);
+	NET_LOWPAN_PUSH_BYTE(iphc0);
+
+	datalen -= (cursor - header);
+
+	sent = NET_LOWPAN_SEND_LOWER(lowpan->lower, cursor, datalen);
+	if (sent == datalen) {
+		NET_STATS_TX(lowpan, datalen);
+		return NET_STATUS_OK;
+	} else {
+		NET_STATS_TX_ERROR(lowpan);
+		return NET_EAGAIN;
+	}
+}
+
+bool net_lowpan_idle(struct net_lowpan_ctx *lowpan)
+{
+	return lowpan->idle;
+}
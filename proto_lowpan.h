@@ -0,0 +1,78 @@
+/*-
+ * Copyright (c) 2024 Emmanuel Thierry
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PROTO_LOWPAN_H
+#define _PROTO_LOWPAN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "net_stats.h"
+
+/**
+ * 6LoWPAN header compression (RFC 6282), in place of the MAC layer on the
+ * links where each byte counts, such as the serial link: selected for the IPv6
+ * layer with NET_LOWPAN_ENABLE in config.h. Frames carry no link-layer
+ * header, the IPv6 header is compressed with IPHC and the UDP header with the
+ * UDP NHC, the lengths being elided and the checksum carried inline.
+ *
+ * Addresses are compressed against the link-local prefix, or the prefix of the
+ * context 0, our site prefix set with net_lowpan_set_context(). Their
+ * interface identifier is elided when it is the modified EUI-64 of the
+ * link-layer address of its end, as the one of net_ip6_autoconf(): the link
+ * being point-to-point, the ends are the source and destination addresses of
+ * the context, ours and the one of the peer, for the frames sent and received
+ * alike. A UDP datagram between such addresses takes 9 bytes of headers,
+ * instead of 62 with Ethernet.
+ *
+ * Only the context 0 is known, and the frames of other contexts, of other
+ * next headers compressed than UDP, or with the UDP checksum elided are
+ * dropped. Frames of uncompressed IPv6 headers are received as well.
+ */
+
+#define NET_HAS_GET_L2_ADDR 1
+#define NET_HAS_SET_L2_DST  1  /* And get */
+
+struct net_lowpan_ctx {
+	uint8_t src_l2addr[6];
+	uint8_t dst_l2addr[6];
+	uint8_t context[8];          /* Prefix of the context 0, if context_valid */
+	uint8_t context_valid;
+	uint8_t idle;                /* No frame at the last recv */
+
+#ifdef NET_STATS_ENABLE
+	struct net_stats stats;
+#endif
+
+	struct NET_LOWPAN_PROTO_LOWER(_ctx) *lower;
+};
+
+extern uint8_t *net_lowpan_get_l2_addr(struct net_lowpan_ctx *lowpan);
+extern int8_t net_lowpan_set_source_addr(struct net_lowpan_ctx *lowpan, uint8_t *src_l2addr);
+extern uint8_t *net_lowpan_get_destination_addr(struct net_lowpan_ctx *lowpan);
+extern int8_t net_lowpan_set_destination_addr(struct net_lowpan_ctx *lowpan, uint8_t *dst_l2addr);
+/* Prefix of 64 bits, or NULL for none */
+extern int8_t net_lowpan_set_context(struct net_lowpan_ctx *lowpan, uint8_t *prefix);
+
+extern int8_t net_lowpan_connect(struct net_lowpan_ctx *lowpan);
+extern uint8_t net_lowpan_pload_pos(struct net_lowpan_ctx *lowpan);
+extern int8_t net_lowpan_recv(struct net_lowpan_ctx *lowpan, uint8_t *buffer, uint16_t buflen,
+                              uint16_t *dataoffset, uint16_t *datalen);
+extern int8_t net_lowpan_send(struct net_lowpan_ctx *lowpan, uint8_t *buffer, uint16_t buflen,
+                              uint16_t dataoffset, uint16_t datalen);
+/* Whether the last recv found no frame to read, rather than dropping the one read */
+extern bool net_lowpan_idle(struct net_lowpan_ctx *lowpan);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
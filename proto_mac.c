@@ -7,6 +7,9 @@
 #include "config.h"
 #include "proto_mac.h"
 #include "net_utils.h"
+#include "net_memstats.h"
+#include "net_trace.h"
+#include "net_tap.h"
 
 
 #define NET_MAC_RECV_LOWER(...)       NET_MAC_PROTO_LOWER(_recv)(__VA_ARGS__)
@@ -20,6 +23,13 @@
 	 ((theirs)[4] == (ours)[4]) && \
 	 ((theirs)[5] == (ours)[5]))
 
+/* Count and capture a received frame dropped for reason */
+#define NET_MAC_DROP(reason) \
+	do { \
+		NET_STATS_DROP(mac, reason); \
+		NET_TAP_DROP(buffer, frame_length, reason); \
+	} while (0)
+
 #define NET_MAC_IS_IP6MCAST(l2addr) \
 	(((l2addr)[0] == 0x33) && ((l2addr)[1] == 0x33))
 
@@ -42,6 +52,11 @@ int8_t net_mac_set_source_addr(struct net_mac_ctx *mac, uint8_t *src_l2addr)
 	return NET_STATUS_OK;
 }
 
+uint8_t *net_mac_get_destination_addr(struct net_mac_ctx *mac)
+{
+	return mac->dst_l2addr;
+}
+
 int8_t net_mac_set_destination_addr(struct net_mac_ctx *mac, uint8_t *dst_l2addr)
 {
 	memcpy(mac->dst_l2addr, dst_l2addr, 6);
@@ -75,16 +90,25 @@ int8_t net_mac_recv(struct net_mac_ctx *mac, uint8_t *buffer, uint16_t buflen,
 	uint16_t frame_length = 0;
 	int8_t errno = NET_EAGAIN;
 
+	NET_MEMSTATS_SCOPE(NET_MEMSTATS_MAC_RECV);
+	NET_TRACE_SCOPE(NET_TRACE_MAC_RECV, buflen, datalen);
+
 	/**
 	 * Note: The prototype of hw_w5500_recv is different from other *_recv
 	 * functions. Will be fixed when the buffer structure will be changed.
 	 */
 	frame_length = NET_MAC_RECV_LOWER(mac->lower, buffer, buflen);
-	if (frame_length < NET_MAC_HDRSIZE) {
+	mac->idle = (frame_length == 0);
+	if (frame_length == 0) {
+		errno = NET_EAGAIN;
+		goto out_zerodata;
+	} else if (frame_length < NET_MAC_HDRSIZE) {
+		NET_MAC_DROP(LEN);
 		errno = NET_EAGAIN;
 		goto out_zerodata;
 	} else if ((buffer[12] != mac->ethertype[0]) ||
 	           (buffer[13] != mac->ethertype[1])) {
+		NET_MAC_DROP(TYPE);
 		errno = NET_EAGAIN;
 		goto out_zerodata;
 	}
@@ -102,12 +126,17 @@ int8_t net_mac_recv(struct net_mac_ctx *mac, uint8_t *buffer, uint16_t buflen,
 		}
 	}
 
+	/* Not for us */
+	NET_MAC_DROP(ADDR);
+
 out_zerodata:
 	*datalen = 0;
 	*dataoffset = 0;
 	return errno;
 
 out_data:
+	NET_STATS_RX(mac, frame_length);
+	NET_TAP_RX(buffer, frame_length);
 	*dataoffset = NET_MAC_HDRSIZE;
 	*datalen = frame_length - NET_MAC_HDRSIZE;
 	return errno;
@@ -119,11 +148,15 @@ int8_t net_mac_send(struct net_mac_ctx *mac, uint8_t *buffer, uint16_t buflen,
 	uint8_t *cursor = NULL;
 	uint16_t sent = 0;
 
+	NET_MEMSTATS_SCOPE(NET_MEMSTATS_MAC_SEND);
+	NET_TRACE_SCOPE(NET_TRACE_MAC_SEND, datalen, &datalen);
+
 	/* Set the cursor to the position of the mac header in the buffer */
 	NET_SET_CURSOR(buffer, 0);
 
 	/* Check that buffer is big enough for the MAC header size */
 	if (!NET_CHECK_BUFLEN(buffer, dataoffset, NET_MAC_HDRSIZE)) {
+		NET_STATS_TX_ERROR(mac);
 		return NET_EOVERFLOW;
 	}
 
@@ -136,14 +169,23 @@ int8_t net_mac_send(struct net_mac_ctx *mac, uint8_t *buffer, uint16_t buflen,
 
 	datalen += NET_MAC_HDRSIZE;
 
+	NET_TAP_TX(buffer, datalen);
+
 	/**
 	 * Note: The prototype of hw_w5500_send is different from other *_send
 	 * functions. Will be fixed when the buffer structure will be changed.
 	 */
 	sent = NET_MAC_SEND_LOWER(mac->lower, buffer, datalen);
 	if (sent == datalen) {
+		NET_STATS_TX(mac, datalen);
 		return NET_STATUS_OK;
 	} else {
+		NET_STATS_TX_ERROR(mac);
 		return NET_EAGAIN;
 	}
 }
+
+bool net_mac_idle(struct net_mac_ctx *mac)
+{
+	return mac->idle;
+}
@@ -11,9 +11,13 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
 #include <stdint.h>
 
+#include "net_stats.h"
+
 #define NET_HAS_GET_L2_ADDR 1
+#define NET_HAS_SET_L2_DST  1  /* And get */
 
 #define NET_MAC_ETHERTYPE_IPV6 0x86DD
 #define NET_MAC_ETHERTYPE_LB   0x9000
@@ -26,12 +30,18 @@ struct net_mac_ctx {
 	uint8_t ethertype[2];
 	uint8_t ip6mcast_suffix_cnt;
 	net_mac_mcsuffix_t *ip6mcast_suffix;
+	uint8_t idle;                /* No frame at the last recv */
+
+#ifdef NET_STATS_ENABLE
+	struct net_stats stats;
+#endif
 
 	struct NET_MAC_PROTO_LOWER(_ctx) *lower;
 };
 
 extern uint8_t *net_mac_get_l2_addr(struct net_mac_ctx *mac);
 extern int8_t net_mac_set_source_addr(struct net_mac_ctx *mac, uint8_t *src_l2addr);
+extern uint8_t *net_mac_get_destination_addr(struct net_mac_ctx *mac);
 extern int8_t net_mac_set_destination_addr(struct net_mac_ctx *mac, uint8_t *dst_l2addr);
 extern int8_t net_mac_set_ethertype(struct net_mac_ctx *mac, uint16_t ethertype);
 extern int8_t net_mac_set_ip6mcast(struct net_mac_ctx *mac,
@@ -43,6 +53,8 @@ extern int8_t net_mac_recv(struct net_mac_ctx *mac, uint8_t *buffer, uint16_t bu
                            uint16_t *dataoffset, uint16_t *datalen);
 extern int8_t net_mac_send(struct net_mac_ctx *mac, uint8_t *buffer, uint16_t buflen,
                            uint16_t dataoffset, uint16_t datalen);
+/* Whether the last recv found no frame to read, rather than dropping the one read */
+extern bool net_mac_idle(struct net_mac_ctx *mac);
 
 
 #ifdef __cplusplus
@@ -7,12 +7,22 @@
 #include "config.h"
 #include "proto_udp.h"
 #include "net_utils.h"
+#include "net_memstats.h"
+#include "net_trace.h"
 
 #define NET_UDP_GET_L3_CKSUM(...)     NET_UDP_PROTO_LOWER(_get_l3_cksum)(__VA_ARGS__)
 #define NET_UDP_CONNECT_LOWER(...)    NET_UDP_PROTO_LOWER(_connect)(__VA_ARGS__)
 #define NET_UDP_PLOAD_POS_LOWER(...)  NET_UDP_PROTO_LOWER(_pload_pos)(__VA_ARGS__)
 #define NET_UDP_RECV_LOWER(...)       NET_UDP_PROTO_LOWER(_recv)(__VA_ARGS__)
 #define NET_UDP_SEND_LOWER(...)       NET_UDP_PROTO_LOWER(_send)(__VA_ARGS__)
+#define NET_UDP_CONFIRM_LOWER(...)    NET_UDP_PROTO_LOWER(_confirm)(__VA_ARGS__)
+#define NET_UDP_CONFIRM_TO_LOWER(...) NET_UDP_PROTO_LOWER(_confirm_to)(__VA_ARGS__)
+#define NET_UDP_GET_L3_CKSUM_TO(...)  NET_UDP_PROTO_LOWER(_get_l3_cksum_to)(__VA_ARGS__)
+#define NET_UDP_RECV_FROM_LOWER(...)  NET_UDP_PROTO_LOWER(_recv_from)(__VA_ARGS__)
+#define NET_UDP_SEND_TO_LOWER(...)    NET_UDP_PROTO_LOWER(_send_to)(__VA_ARGS__)
+#define NET_UDP_FLOW_HASH_LOWER(...)  NET_UDP_PROTO_LOWER(_flow_hash)(__VA_ARGS__)
+#define NET_UDP_FLOW_MATCH_LOWER(...) NET_UDP_PROTO_LOWER(_flow_match)(__VA_ARGS__)
+#define NET_UDP_ADDR_GEN_LOWER(...)   NET_UDP_PROTO_LOWER(_get_addr_gen)(__VA_ARGS__)
 
 
 /**
@@ -31,6 +41,11 @@
 
 #define NET_UDP_HDRSIZE 8
 
+/* Slot of a flow, probed from there onwards */
+#define NET_UDP_FLOW_HASH(l3hash, local_port, peer_port) \
+	(((l3hash) ^ (local_port) ^ ((local_port) >> 8) ^ \
+	  (peer_port) ^ ((peer_port) >> 8)) & (NET_UDP_FLOW_CNT - 1))
+
 static void _net_udp_fix_cksum(uint16_t cksum_pre_compute, uint8_t *udpbuf, uint16_t udplen)
 {
 	uint16_t sum = cksum_pre_compute;
@@ -51,6 +66,67 @@ static void _net_udp_fix_cksum(uint16_t cksum_pre_compute, uint8_t *udpbuf, uint
 	udpbuf[7] = (uint8_t) (sum & 0x000000FF);
 }
 
+#ifdef NET_HAS_CONFIRM
+/* Datagram of the peer sent to, its address being checked below unless returned */
+static bool _net_udp_from_peer(struct net_udp_ctx *udp, uint8_t *peer_addr, uint16_t peer_port)
+{
+	if ((udp->destination_port == 0) || (peer_port != udp->destination_port)) {
+		return false;
+	}
+#ifdef NET_HAS_RECV_FROM
+	if (peer_addr != NULL) {
+		return NET_UDP_FLOW_MATCH_LOWER(udp->lower, peer_addr, udp->peer_addr);
+	}
+#endif
+	return true;
+}
+#endif
+
+static void _net_udp_deliver(struct net_udp_ctx *udp, uint16_t *dataoffset, uint16_t *datalen,
+                             uint8_t *peer_addr, uint16_t peer_port)
+{
+	NET_STATS_RX(udp, *datalen);
+
+#ifdef NET_HAS_CONFIRM
+	/* A reply of the peer confirms it is reachable, datagrams of others do not */
+	if (udp->sent && _net_udp_from_peer(udp, peer_addr, peer_port)) {
+		udp->sent = 0;
+#ifdef NET_HAS_RECV_FROM
+		if (udp->peer_addr != NULL) {
+			NET_UDP_CONFIRM_TO_LOWER(udp->lower, udp->peer_addr);
+		} else
+#endif
+		{
+			NET_UDP_CONFIRM_LOWER(udp->lower);
+		}
+	}
+#endif
+
+	*dataoffset += NET_UDP_HDRSIZE;
+	*datalen -= NET_UDP_HDRSIZE;
+}
+
+/* Sum of the L3 pseudo-header to the peer, but for the payload length */
+static void _net_udp_pre_compute(struct net_udp_ctx *udp)
+{
+#ifdef NET_HAS_ADDR_GEN
+	udp->addr_gen = NET_UDP_ADDR_GEN_LOWER(udp->lower);
+#endif
+
+#ifdef NET_HAS_RECV_FROM
+	if (udp->peer_addr != NULL) {
+		udp->cksum_pre_compute = NET_UDP_GET_L3_CKSUM_TO(udp->lower, udp->peer_addr);
+		return;
+	}
+#endif
+
+#ifdef NET_HAS_GET_L3_CKSUM
+	udp->cksum_pre_compute = NET_UDP_GET_L3_CKSUM(udp->lower);
+#else
+	udp->cksum_pre_compute = 0;
+#endif
+}
+
 int8_t net_udp_set_source_port(struct net_udp_ctx *udp, uint16_t source_port)
 {
 	udp->source_port = source_port;
@@ -78,12 +154,7 @@ int8_t net_udp_connect(struct net_udp_ctx *udp)
 	}
 
 	errno = NET_UDP_CONNECT_LOWER(udp->lower);
-
-#ifdef NET_HAS_GET_L3_CKSUM
-	udp->cksum_pre_compute = NET_UDP_GET_L3_CKSUM(udp->lower);
-#else
-	udp->cksum_pre_compute = 0;
-#endif
+	_net_udp_pre_compute(udp);
 
 	return errno;
 }
@@ -93,8 +164,9 @@ uint8_t net_udp_pload_pos(struct net_udp_ctx *udp)
 	return NET_UDP_PLOAD_POS_LOWER(udp->lower) + NET_UDP_HDRSIZE;
 }
 
-int8_t net_udp_recv(struct net_udp_ctx *udp, uint8_t *buffer, uint16_t buflen,
-                    uint16_t *dataoffset, uint16_t *datalen)
+static int8_t _net_udp_recv(struct net_udp_ctx *udp, uint8_t *buffer, uint16_t buflen,
+                            uint16_t *dataoffset, uint16_t *datalen,
+                            uint8_t **peer_addr, uint16_t *peer_port)
 {
 	int8_t errno = 0;
 	uint8_t *cursor = NULL;
@@ -102,8 +174,18 @@ int8_t net_udp_recv(struct net_udp_ctx *udp, uint8_t *buffer, uint16_t buflen,
 	uint16_t destination_port = 0;
 	uint16_t length = 0;
 
-	/* Get the packet from the lower layer */
-	errno = NET_UDP_RECV_LOWER(udp->lower, buffer, buflen, dataoffset, datalen);
+	NET_MEMSTATS_SCOPE(NET_MEMSTATS_UDP_RECV);
+	NET_TRACE_SCOPE(NET_TRACE_UDP_RECV, buflen, datalen);
+
+	/* Get the packet from the lower layer, of any peer when listening */
+#ifdef NET_HAS_RECV_FROM
+	if (peer_addr != NULL) {
+		errno = NET_UDP_RECV_FROM_LOWER(udp->lower, buffer, buflen, dataoffset, datalen, peer_addr);
+	} else
+#endif
+	{
+		errno = NET_UDP_RECV_LOWER(udp->lower, buffer, buflen, dataoffset, datalen);
+	}
 	if (errno < 0) {
 		goto out_zerodata;
 	}
@@ -113,6 +195,7 @@ int8_t net_udp_recv(struct net_udp_ctx *udp, uint8_t *buffer, uint16_t buflen,
 
 	/* Check that buffer is big enough for coap header size */
 	if (!NET_CHECK_BUFLEN(cursor, *datalen, NET_UDP_HDRSIZE)) {
+		NET_STATS_DROP(udp, LEN);
 		errno = NET_EOVERFLOW;
 		goto out_zerodata;
 	}
@@ -123,9 +206,10 @@ int8_t net_udp_recv(struct net_udp_ctx *udp, uint8_t *buffer, uint16_t buflen,
 	/* Read the destination port */
 	NET_GET_SHORT(destination_port);
 
-	/* Check that ports match */
-	if ((source_port != udp->destination_port) ||
+	/* Check that ports match, or only ours when listening */
+	if (((peer_addr == NULL) && (source_port != udp->destination_port)) ||
 	    (destination_port != udp->source_port)) {
+		NET_STATS_DROP(udp, PORT);
 		errno = NET_EAGAIN;
 		goto out_zerodata;
 	}
@@ -135,12 +219,14 @@ int8_t net_udp_recv(struct net_udp_ctx *udp, uint8_t *buffer, uint16_t buflen,
 
 	/* Check that length fits in the remaining packet length */
 	if (*datalen < length) {
+		NET_STATS_DROP(udp, LEN);
 		return NET_EOVERFLOW;
 	}
 
-
-	*dataoffset += NET_UDP_HDRSIZE;
-	*datalen -= NET_UDP_HDRSIZE;
+	_net_udp_deliver(udp, dataoffset, datalen, (peer_addr != NULL) ? *peer_addr : NULL, source_port);
+	if (peer_port != NULL) {
+		*peer_port = source_port;
+	}
 
 	return NET_STATUS_OK;
 
@@ -151,14 +237,24 @@ out_data:
 	return errno;
 }
 
-int8_t net_udp_send(struct net_udp_ctx *udp, uint8_t *buffer, uint16_t buflen,
-                    uint16_t dataoffset, uint16_t datalen)
+int8_t net_udp_recv(struct net_udp_ctx *udp, uint8_t *buffer, uint16_t buflen,
+                    uint16_t *dataoffset, uint16_t *datalen)
 {
+	return _net_udp_recv(udp, buffer, buflen, dataoffset, datalen, NULL, NULL);
+}
+
+static int8_t _net_udp_send(struct net_udp_ctx *udp, uint8_t *buffer, uint16_t buflen,
+                            uint16_t dataoffset, uint16_t datalen,
+                            uint8_t *peer_addr, uint16_t peer_port)
+{
+	int8_t errno = 0;
 	uint8_t *cursor = NULL;
 	uint8_t *cursor_before = NULL;
 	uint8_t header_pos = 0;
 	uint16_t checksum = 0;
 
+	NET_MEMSTATS_SCOPE(NET_MEMSTATS_UDP_SEND);
+	NET_TRACE_SCOPE(NET_TRACE_UDP_SEND, datalen, &datalen);
 
 	/* Retrieve the start of header from lower layers */
 	header_pos = NET_UDP_PLOAD_POS_LOWER(udp->lower);
@@ -169,6 +265,7 @@ int8_t net_udp_send(struct net_udp_ctx *udp, uint8_t *buffer, uint16_t buflen,
 
 	/* Check that buffer is big enough for udp header size */
 	if (!NET_CHECK_BUFLEN(buffer, dataoffset, NET_UDP_HDRSIZE)) {
+		NET_STATS_TX_ERROR(udp);
 		return NET_EOVERFLOW;
 	}
 
@@ -176,7 +273,7 @@ int8_t net_udp_send(struct net_udp_ctx *udp, uint8_t *buffer, uint16_t buflen,
 	NET_PUT_SHORT(udp->source_port);
 
 	/* Set the destination port */
-	NET_PUT_SHORT(udp->destination_port);
+	NET_PUT_SHORT(peer_port);
 
 	/* Set the data length */
 	NET_PUT_SHORT(NET_UDP_HDRSIZE + datalen);
@@ -184,6 +281,28 @@ int8_t net_udp_send(struct net_udp_ctx *udp, uint8_t *buffer, uint16_t buflen,
 	/* Placeholder for the checksum */
 	NET_PUT_SHORT(0x0000);
 
+#ifdef NET_HAS_RECV_FROM
+	if (peer_addr != NULL) {
+		/* Set the checksum, of the pseudo-header of this peer */
+		_net_udp_fix_cksum(NET_UDP_GET_L3_CKSUM_TO(udp->lower, peer_addr),
+		                   cursor_before, NET_UDP_HDRSIZE + datalen);
+
+		dataoffset -= NET_UDP_HDRSIZE;
+		datalen += NET_UDP_HDRSIZE;
+
+		/* Pass to the lower layer, a reply not to be confirmed */
+		errno = NET_UDP_SEND_TO_LOWER(udp->lower, buffer, buflen, dataoffset, datalen, peer_addr);
+		goto out_stats;
+	}
+#endif
+
+#ifdef NET_HAS_ADDR_GEN
+	/* The source address changed since connected, by autoconfiguration for instance */
+	if (udp->addr_gen != NET_UDP_ADDR_GEN_LOWER(udp->lower)) {
+		_net_udp_pre_compute(udp);
+	}
+#endif
+
 #ifdef NET_HAS_GET_L3_CKSUM
 	/* Set the checksum */
 	_net_udp_fix_cksum(udp->cksum_pre_compute, cursor_before, NET_UDP_HDRSIZE + datalen);
@@ -192,6 +311,239 @@ int8_t net_udp_send(struct net_udp_ctx *udp, uint8_t *buffer, uint16_t buflen,
 	dataoffset -= NET_UDP_HDRSIZE;
 	datalen += NET_UDP_HDRSIZE;
 
-	/* Pass to the lower layer */
-	return NET_UDP_SEND_LOWER(udp->lower, buffer, buflen, dataoffset, datalen);
+	/* Pass to the lower layer, to the peer of the flow if any */
+#ifdef NET_HAS_RECV_FROM
+	if (udp->peer_addr != NULL) {
+		errno = NET_UDP_SEND_TO_LOWER(udp->lower, buffer, buflen, dataoffset, datalen,
+		                              udp->peer_addr);
+	} else
+#endif
+	{
+		errno = NET_UDP_SEND_LOWER(udp->lower, buffer, buflen, dataoffset, datalen);
+	}
+	if (errno == NET_STATUS_OK) {
+		udp->sent = 1;
+	}
+
+out_stats:
+	if (errno == NET_STATUS_OK) {
+		NET_STATS_TX(udp, datalen);
+	} else {
+		NET_STATS_TX_ERROR(udp);
+	}
+
+	return errno;
+}
+
+int8_t net_udp_send(struct net_udp_ctx *udp, uint8_t *buffer, uint16_t buflen,
+                    uint16_t dataoffset, uint16_t datalen)
+{
+	return _net_udp_send(udp, buffer, buflen, dataoffset, datalen, NULL, udp->destination_port);
+}
+
+
+#ifdef NET_HAS_RECV_FROM
+
+int8_t net_udp_set_peer_addr(struct net_udp_ctx *udp, uint8_t *peer_addr)
+{
+	udp->peer_addr = peer_addr;
+	return NET_STATUS_OK;
+}
+
+int8_t net_udp_listen(struct net_udp_ctx *udp)
+{
+	if (udp->source_port == 0) {
+		return NET_ECONFIG;
+	}
+
+	return NET_UDP_CONNECT_LOWER(udp->lower);
+}
+
+int8_t net_udp_recv_from(struct net_udp_ctx *udp, uint8_t *buffer, uint16_t buflen,
+                         uint16_t *dataoffset, uint16_t *datalen,
+                         uint8_t **peer_addr, uint16_t *peer_port)
+{
+	return _net_udp_recv(udp, buffer, buflen, dataoffset, datalen, peer_addr, peer_port);
+}
+
+int8_t net_udp_send_to(struct net_udp_ctx *udp, uint8_t *buffer, uint16_t buflen,
+                       uint16_t dataoffset, uint16_t datalen,
+                       uint8_t *peer_addr, uint16_t peer_port)
+{
+	return _net_udp_send(udp, buffer, buflen, dataoffset, datalen, peer_addr, peer_port);
+}
+
+/* Slot of a context, listening ones being of no peer */
+static uint8_t _net_udp_flows_hash(struct net_udp_ctx *udp)
+{
+	if (udp->destination_port == 0) {
+		return NET_UDP_FLOW_HASH(0, udp->source_port, 0);
+	}
+
+	return NET_UDP_FLOW_HASH(NET_UDP_FLOW_HASH_LOWER(udp->lower, udp->peer_addr),
+	                         udp->source_port, udp->destination_port);
+}
+
+int8_t net_udp_flows_add(struct net_udp_flows *flows, struct net_udp_ctx *udp)
+{
+	uint8_t hash = 0;
+	uint8_t i = 0;
+	struct net_udp_ctx *flow = NULL;
+
+	if (udp->source_port == 0) {
+		return NET_ECONFIG;
+	}
+
+	/* Frames of all the flows are received through the context of the table */
+	if (udp->lower != flows->lower) {
+		return NET_EINVAL;
+	}
+
+	hash = _net_udp_flows_hash(udp);
+
+	for (i = 0; i < NET_UDP_FLOW_CNT; i++) {
+		flow = flows->flows[(hash + i) & (NET_UDP_FLOW_CNT - 1)];
+		if (flow == NULL) {
+			flows->flows[(hash + i) & (NET_UDP_FLOW_CNT - 1)] = udp;
+			return NET_STATUS_OK;
+		}
+
+		if (flow == udp) {
+			return NET_EINVAL;
+		}
+	}
+
+	return NET_ENOMEM;
+}
+
+int8_t net_udp_flows_del(struct net_udp_flows *flows, struct net_udp_ctx *udp)
+{
+	uint8_t hash = 0;
+	uint8_t slot = 0;
+	uint8_t i = 0;
+	struct net_udp_ctx *flow = NULL;
+
+	for (slot = 0; slot < NET_UDP_FLOW_CNT; slot++) {
+		if (flows->flows[slot] == udp) {
+			break;
+		}
+	}
+	if (slot == NET_UDP_FLOW_CNT) {
+		return NET_EINVAL;
+	}
+	flows->flows[slot] = NULL;
+
+	/* Move the flows probed after this slot, for a lookup to stop at an empty one */
+	for (i = 1; i < NET_UDP_FLOW_CNT; i++) {
+		flow = flows->flows[(slot + i) & (NET_UDP_FLOW_CNT - 1)];
+		if (flow == NULL) {
+			break;
+		}
+		flows->flows[(slot + i) & (NET_UDP_FLOW_CNT - 1)] = NULL;
+
+		hash = _net_udp_flows_hash(flow);
+		while (flows->flows[hash] != NULL) {
+			hash = (hash + 1) & (NET_UDP_FLOW_CNT - 1);
+		}
+		flows->flows[hash] = flow;
+	}
+
+	return NET_STATUS_OK;
 }
+
+/* Look up a flow, up to the first empty slot. Listening contexts are of no peer address */
+static struct net_udp_ctx *_net_udp_flows_find(struct net_udp_flows *flows, uint8_t hash,
+                                               uint8_t *peer_addr, uint16_t local_port,
+                                               uint16_t peer_port)
+{
+	uint8_t i = 0;
+	struct net_udp_ctx *flow = NULL;
+
+	for (i = 0; i < NET_UDP_FLOW_CNT; i++) {
+		flow = flows->flows[(hash + i) & (NET_UDP_FLOW_CNT - 1)];
+		if (flow == NULL) {
+			break;
+		}
+		if ((flow->source_port == local_port) &&
+		    (flow->destination_port == peer_port) &&
+		    ((peer_addr == NULL) ||
+	     NET_UDP_FLOW_MATCH_LOWER(flow->lower, peer_addr, flow->peer_addr))) {
+			return flow;
+		}
+	}
+
+	return NULL;
+}
+
+int8_t net_udp_flows_recv(struct net_udp_flows *flows, uint8_t *buffer, uint16_t buflen,
+                          uint16_t *dataoffset, uint16_t *datalen, struct net_udp_ctx **udp,
+                          uint8_t **peer_addr, uint16_t *peer_port)
+{
+	int8_t errno = 0;
+	uint8_t *cursor = NULL;
+	uint16_t source_port = 0;
+	uint16_t destination_port = 0;
+	uint16_t length = 0;
+	struct net_udp_ctx *flow = NULL;
+
+	NET_MEMSTATS_SCOPE(NET_MEMSTATS_UDP_RECV);
+	NET_TRACE_SCOPE(NET_TRACE_UDP_RECV, buflen, datalen);
+
+	*udp = NULL;
+
+	/* Get the packet from the lower layer, of any peer */
+	errno = NET_UDP_RECV_FROM_LOWER(flows->lower, buffer, buflen, dataoffset, datalen, peer_addr);
+	if (errno < 0) {
+		goto out_zerodata;
+	}
+
+	/* Set the cursor to the position of the udp header in the buffer */
+	NET_SET_CURSOR(buffer, *dataoffset);
+
+	/* Check that buffer is big enough for udp header size */
+	if (!NET_CHECK_BUFLEN(cursor, *datalen, NET_UDP_HDRSIZE)) {
+		NET_STATS_DROP(flows, LEN);
+		errno = NET_EOVERFLOW;
+		goto out_zerodata;
+	}
+
+	NET_GET_SHORT(source_port);
+	NET_GET_SHORT(destination_port);
+	NET_GET_SHORT(length);
+
+	/* The flow of the peer, or else a context listening to the port */
+	flow = _net_udp_flows_find(flows,
+	                           NET_UDP_FLOW_HASH(NET_UDP_FLOW_HASH_LOWER(flows->lower, *peer_addr),
+	                                             destination_port, source_port),
+	                           *peer_addr, destination_port, source_port);
+	if (flow == NULL) {
+		flow = _net_udp_flows_find(flows, NET_UDP_FLOW_HASH(0, destination_port, 0),
+		                           NULL, destination_port, 0);
+	}
+
+	if (flow == NULL) {
+		NET_STATS_DROP(flows, PORT);
+		errno = NET_EAGAIN;
+		goto out_zerodata;
+	}
+
+	/* Check that length fits in the remaining packet length */
+	if (*datalen < length) {
+		NET_STATS_DROP(flow, LEN);
+		errno = NET_EOVERFLOW;
+		goto out_zerodata;
+	}
+
+	_net_udp_deliver(flow, dataoffset, datalen, *peer_addr, source_port);
+	*udp = flow;
+	*peer_port = source_port;
+
+	return NET_STATUS_OK;
+
+out_zerodata:
+	*dataoffset = 0;
+	*datalen = 0;
+	return errno;
+}
+
+#endif
@@ -13,10 +13,23 @@ extern "C" {
 
 #include <stdint.h>
 
+#include "net_stats.h"
+
 struct net_udp_ctx {
 	uint16_t source_port;
 	uint16_t destination_port;
 	uint16_t cksum_pre_compute;
+#ifdef NET_HAS_ADDR_GEN
+	uint8_t addr_gen;            /* Of the lower context, when cksum_pre_compute was */
+#endif
+	uint8_t sent;                /* Datagram sent, the next one received being a reply */
+#ifdef NET_HAS_RECV_FROM
+	uint8_t *peer_addr;          /* Peer of a flow, NULL for the destination of the lower context */
+#endif
+
+#ifdef NET_STATS_ENABLE
+	struct net_stats stats;
+#endif
 
 	struct NET_UDP_PROTO_LOWER(_ctx) *lower;
 };
@@ -32,6 +45,66 @@ extern int8_t net_udp_recv(struct net_udp_ctx *udp, uint8_t *buffer, uint16_t bu
 extern int8_t net_udp_send(struct net_udp_ctx *udp, uint8_t *buffer, uint16_t buflen,
                            uint16_t dataoffset, uint16_t datalen);
 
+#ifdef NET_HAS_RECV_FROM
+
+/**
+ * Listening mode, for servers: net_udp_listen() binds the context to its
+ * source port only, instead of net_udp_connect(), and net_udp_recv_from()
+ * returns the datagrams of any peer to this port. The address and port of the
+ * peer are returned as well, the address pointing into the buffer: the reply
+ * is sent to them with net_udp_send_to(), in the same buffer and before the
+ * next frame is received, without any change of the contexts. The link-layer
+ * address of the peer is the one of the neighbor cache if address resolution
+ * is enabled, see net_ip6_set_resolution().
+ */
+extern int8_t net_udp_listen(struct net_udp_ctx *udp);
+/* Peer address of a flow, set before net_udp_connect() and kept by the caller */
+extern int8_t net_udp_set_peer_addr(struct net_udp_ctx *udp, uint8_t *peer_addr);
+extern int8_t net_udp_recv_from(struct net_udp_ctx *udp, uint8_t *buffer, uint16_t buflen,
+                                uint16_t *dataoffset, uint16_t *datalen,
+                                uint8_t **peer_addr, uint16_t *peer_port);
+extern int8_t net_udp_send_to(struct net_udp_ctx *udp, uint8_t *buffer, uint16_t buflen,
+                              uint16_t dataoffset, uint16_t datalen,
+                              uint8_t *peer_addr, uint16_t peer_port);
+
+/**
+ * Flows of several UDP contexts sharing one link, to a server and to a log
+ * collector for example: all the contexts share the lower context of the
+ * table (the IPv6 context, its neighbor cache included), and each one is
+ * connected to its peer by its ports and the peer address set with
+ * net_udp_set_peer_addr(), or else the destination address of the lower
+ * context. Datagrams are sent to this peer by net_udp_send(), as by
+ * net_udp_send_to(). Frames are received once for all the flows, through the
+ * lower context of the table, and returned along with the context of their
+ * flow, found in the table by hash of the peer address, the local port and
+ * the peer port, and with the address and port of the peer, as by
+ * net_udp_recv_from(). Contexts in listening mode receive the datagrams of
+ * their port from the peers of no flow, the others are dropped. The table is
+ * of open addressing, NET_UDP_FLOW_CNT being a power of two.
+ */
+#ifndef NET_UDP_FLOW_CNT
+#define NET_UDP_FLOW_CNT 8
+#endif
+
+struct net_udp_flows {
+	struct net_udp_ctx *flows[NET_UDP_FLOW_CNT];
+
+#ifdef NET_STATS_ENABLE
+	struct net_stats stats;   /* Drops before a flow is found */
+#endif
+
+	struct NET_UDP_PROTO_LOWER(_ctx) *lower;
+};
+
+/* Contexts of the lower context of the table are added once connected or listening, and deleted before any change of their addresses or ports */
+extern int8_t net_udp_flows_add(struct net_udp_flows *flows, struct net_udp_ctx *udp);
+extern int8_t net_udp_flows_del(struct net_udp_flows *flows, struct net_udp_ctx *udp);
+extern int8_t net_udp_flows_recv(struct net_udp_flows *flows, uint8_t *buffer, uint16_t buflen,
+                                 uint16_t *dataoffset, uint16_t *datalen, struct net_udp_ctx **udp,
+                                 uint8_t **peer_addr, uint16_t *peer_port);
+
+#endif
+
 
 #ifdef __cplusplus
 }
@@ -159,6 +159,9 @@ void loop() {
 					Serial.print(buffer[dataoffset+d], HEX);
 				}
 				serial_debug_end();
+			} else {
+				/* Answer the solicitations recorded meanwhile (NET_IP6_RATELIMIT_ENABLE) */
+				net_ip6_service(&ip6, buffer, 1514);
 			}
 		}
 	}
@@ -7,6 +7,9 @@ import sys
 import time
 import re
 import binascii
+import argparse
+import collections
+import struct
 
 from scapy.config import conf
 from scapy.packet import Raw
@@ -38,9 +41,8 @@ def serial_send(pkt):
 	global serial_obj
 	if (serial_obj == None):
 		return
-	tosend=("P: %s" % binascii.hexlify(bytearray(pkt.build())).upper())
-	serial_obj.write(tosend)
-	serial_obj.write('\n')
+	tosend=("P: %s" % binascii.hexlify(bytearray(pkt.build())).upper().decode())
+	serial_obj.write((tosend + '\n').encode())
 	if VERBOSE:
 		print("> %s" % tosend)
 
@@ -49,8 +51,7 @@ def serial_signal(test):
 	if (serial_obj == None):
 		return
 	tosend=("T: %s" % str(test))
-	serial_obj.write(tosend)
-	serial_obj.write('\n')
+	serial_obj.write((tosend + '\n').encode())
 	if VERBOSE:
 		print("> %s" % tosend)
 
@@ -331,7 +332,7 @@ def test_ip6_icmpv6_nsna_recv_lla():
 	eth = Ether(src="76:88:99:AA:BB:CC",dst="33:33:00:00:00:01",type=0x86DD)
 	ipv6 = IPv6(src="fe80::a:b:c:d",dst="fe80::f:e:d:c",nh=58)
 	icmpv6 = ICMPv6ND_NS(tgt="fe80::f:e:d:c")
- 	icmpv6ndopt = ICMPv6NDOptSrcLLAddr(lladdr="76:88:99:AA:BB:CC")
+	icmpv6ndopt = ICMPv6NDOptSrcLLAddr(lladdr="76:88:99:AA:BB:CC")
 	pkt = eth/ipv6/icmpv6/icmpv6ndopt
 	if VERBOSE:
 		pkt.show2()
@@ -373,7 +374,7 @@ def test_ip6_icmpv6_nsna_recv_mcsn():
 	eth = Ether(src="76:88:99:AA:BB:CC",dst="33:33:ff:0d:00:0c",type=0x86DD)
 	ipv6 = IPv6(src="fe80::a:b:c:d",dst="ff02::1:ff0d:c",nh=58)
 	icmpv6 = ICMPv6ND_NS(tgt="2001:1:2:3:f:e:d:c")
- 	icmpv6ndopt = ICMPv6NDOptSrcLLAddr(lladdr="76:88:99:AA:BB:CC")
+	icmpv6ndopt = ICMPv6NDOptSrcLLAddr(lladdr="76:88:99:AA:BB:CC")
 	pkt = eth/ipv6/icmpv6/icmpv6ndopt
 	if VERBOSE:
 		pkt.show2()
@@ -415,7 +416,7 @@ def test_ip6_icmpv6_nsna_recv_dad():
 	eth = Ether(src="76:88:99:AA:BB:CC",dst="33:33:00:00:00:01",type=0x86DD)
 	ipv6 = IPv6(src="::",dst="2001:1:2:3:f:e:d:c",nh=58)
 	icmpv6 = ICMPv6ND_NS(tgt="2001:1:2:3:f:e:d:c")
- 	icmpv6ndopt = ICMPv6NDOptSrcLLAddr(lladdr="76:88:99:AA:BB:CC")
+	icmpv6ndopt = ICMPv6NDOptSrcLLAddr(lladdr="76:88:99:AA:BB:CC")
 	pkt = eth/ipv6/icmpv6/icmpv6ndopt
 	if VERBOSE:
 		pkt.show2()
@@ -429,12 +430,13 @@ def test_ip6_icmpv6_nsna_recv_dad():
 	if VERBOSE:
 		eth.show()
 
-	if ((eth[IPv6].dst != "ff02::1") or
+	if ((eth.dst != "33:33:00:00:00:01") or
+	    (eth[IPv6].dst != "ff02::1") or
 	    (eth[IPv6].nh != 58) or
 	    (eth[ICMPv6ND_NA].type != 136) or
 	    (eth[ICMPv6ND_NA].code != 0) or
 	    (eth[ICMPv6ND_NA].R != 0) or
-	    (eth[ICMPv6ND_NA].S != 1) or
+	    (eth[ICMPv6ND_NA].S != 0) or
 	    (eth[ICMPv6ND_NA].O != 1) or
 	    (eth[ICMPv6ND_NA].res != 0) or
 	    (eth[ICMPv6ND_NA].tgt != "2001:1:2:3:f:e:d:c") or
@@ -457,7 +459,7 @@ def test_ip6_icmpv6_nsna_recv_badtgt():
 	eth = Ether(src="76:88:99:AA:BB:CC",dst="33:33:00:00:00:01",type=0x86DD)
 	ipv6 = IPv6(src="fe80::a:b:c:d",dst="ff02::1",nh=58)
 	icmpv6 = ICMPv6ND_NS(tgt="2001:1:2:3:c:d:e:f")
- 	icmpv6ndopt = ICMPv6NDOptSrcLLAddr(lladdr="AA:BB:CC:DD:EE:FF")
+	icmpv6ndopt = ICMPv6NDOptSrcLLAddr(lladdr="AA:BB:CC:DD:EE:FF")
 	pkt = eth/ipv6/icmpv6/icmpv6ndopt
 	if VERBOSE:
 		pkt.show2()
@@ -472,6 +474,480 @@ def test_ip6_icmpv6_nsna_recv_badtgt():
 
 	return VERDICT_OK
 
+def test_ip6_icmpv6_nc_resolve():
+	rep = serial_recv(0.5)
+	if (rep == None):
+		return VERDICT_NOK
+
+	eth = Ether(rep)
+	if VERBOSE:
+		eth.show()
+
+	if ((eth.dst != "33:33:ff:0c:00:0d") or
+	    (eth[IPv6].src != "fe80::f:e:d:c") or
+	    (eth[IPv6].dst != "ff02::1:ff0c:d") or
+	    (eth[IPv6].hlim != 255) or
+	    (eth[ICMPv6ND_NS].type != 135) or
+	    (eth[ICMPv6ND_NS].tgt != "2001:1:2:3:a:b:c:d") or
+	    (eth[ICMPv6NDOptSrcLLAddr].lladdr != "10:22:33:44:55:66")):
+		return VERDICT_NOK
+
+	eth = Ether(src="76:88:99:AA:BB:CC",dst="10:22:33:44:55:66",type=0x86DD)
+	ipv6 = IPv6(src="2001:1:2:3:a:b:c:d",dst="fe80::f:e:d:c",nh=58)
+	icmpv6 = ICMPv6ND_NA(tgt="2001:1:2:3:a:b:c:d",R=0,S=1,O=1)
+	icmpv6ndopt = ICMPv6NDOptDstLLAddr(lladdr="76:88:99:AA:BB:CC")
+	pkt = eth/ipv6/icmpv6/icmpv6ndopt
+	if VERBOSE:
+		pkt.show2()
+	serial_send(pkt)
+
+	rep = serial_recv(2.5)
+	if (rep == None):
+		return VERDICT_NOK
+
+	eth = Ether(rep)
+	if ((eth.dst != "76:88:99:aa:bb:cc") or
+	    (eth[IPv6].dst != "2001:1:2:3:a:b:c:d") or
+	    (eth[IPv6].load != "test")):
+		return VERDICT_NOK
+
+	eth = Ether(src="AA:BB:CC:DD:EE:FF",dst="10:22:33:44:55:66",type=0x86DD)
+	ipv6 = IPv6(src="2001:1:2:3:d:c:b:a",dst="2001:1:2:3:f:e:d:c",nh=58)
+	icmpv6 = ICMPv6ND_NS(tgt="2001:1:2:3:f:e:d:c")
+	icmpv6ndopt = ICMPv6NDOptSrcLLAddr(lladdr="AA:BB:CC:DD:EE:FF")
+	pkt = eth/ipv6/icmpv6/icmpv6ndopt
+	serial_send(pkt)
+
+	rep = serial_recv(0.5)
+	if (rep == None):
+		return VERDICT_NOK
+
+	eth = Ether(rep)
+	if ((eth.dst != "aa:bb:cc:dd:ee:ff") or
+	    (eth[IPv6].dst != "2001:1:2:3:d:c:b:a") or
+	    (eth[ICMPv6ND_NA].tgt != "2001:1:2:3:f:e:d:c")):
+		return VERDICT_NOK
+
+	rep = serial_recv(0.5)
+	if (rep == None):
+		return VERDICT_NOK
+
+	eth = Ether(rep)
+	if ((eth.dst != "aa:bb:cc:dd:ee:ff") or
+	    (eth[IPv6].dst != "2001:1:2:3:d:c:b:a") or
+	    (eth[IPv6].load != "test")):
+		return VERDICT_NOK
+
+	return VERDICT_OK
+
+def test_ip6_icmpv6_ra_slaac():
+	rep = serial_recv(0.5)
+	if (rep == None):
+		return VERDICT_NOK
+
+	eth = Ether(rep)
+	if VERBOSE:
+		eth.show()
+
+	if ((eth.dst != "33:33:00:00:00:02") or
+	    (eth[IPv6].src != "fe80::1222:33ff:fe44:5566") or
+	    (eth[IPv6].dst != "ff02::2") or
+	    (eth[IPv6].hlim != 255) or
+	    (eth[ICMPv6ND_RS].type != 133) or
+	    (eth[ICMPv6NDOptSrcLLAddr].lladdr != "10:22:33:44:55:66")):
+		return VERDICT_NOK
+
+	eth = Ether(src="76:88:99:AA:BB:CC",dst="33:33:00:00:00:01",type=0x86DD)
+	ipv6 = IPv6(src="fe80::a:b:c:d",dst="ff02::1",nh=58,hlim=255)
+	icmpv6 = ICMPv6ND_RA(chlim=64,routerlifetime=1800)
+	icmpv6ndopt = ICMPv6NDOptSrcLLAddr(lladdr="76:88:99:AA:BB:CC")
+	icmpv6ndmtu = ICMPv6NDOptMTU(mtu=1400)
+	icmpv6ndprefix = ICMPv6NDOptPrefixInfo(prefixlen=64,L=1,A=1,validlifetime=86400,
+	                                       preferredlifetime=14400,prefix="2001:db8:1:2::")
+	pkt = eth/ipv6/icmpv6/icmpv6ndopt/icmpv6ndmtu/icmpv6ndprefix
+	if VERBOSE:
+		pkt.show2()
+	serial_send(pkt)
+
+	rep = serial_recv(2.5)
+	if (rep == None):
+		return VERDICT_NOK
+
+	eth = Ether(rep)
+	if ((eth.dst != "76:88:99:aa:bb:cc") or
+	    (eth[IPv6].src != "2001:db8:1:2:1222:33ff:fe44:5566") or
+	    (eth[IPv6].dst != "2001:db8:ffff::1") or
+	    (eth[IPv6].load != "test")):
+		return VERDICT_NOK
+
+	return VERDICT_OK
+
+def test_ip6_icmpv6_ra_udp():
+	rep = serial_recv(0.5)
+	if (rep == None):
+		return VERDICT_NOK
+
+	eth = Ether(rep)
+	if VERBOSE:
+		eth.show()
+
+	if ((eth[IPv6].dst != "ff02::2") or
+	    (eth[ICMPv6ND_RS].type != 133)):
+		return VERDICT_NOK
+
+	eth = Ether(src="76:88:99:AA:BB:CC",dst="33:33:00:00:00:01",type=0x86DD)
+	ipv6 = IPv6(src="fe80::a:b:c:d",dst="ff02::1",nh=58,hlim=255)
+	icmpv6 = ICMPv6ND_RA(chlim=64,routerlifetime=1800)
+	icmpv6ndopt = ICMPv6NDOptSrcLLAddr(lladdr="76:88:99:AA:BB:CC")
+	icmpv6ndprefix = ICMPv6NDOptPrefixInfo(prefixlen=64,L=1,A=1,validlifetime=86400,
+	                                       preferredlifetime=14400,prefix="2001:db8:1:2::")
+	pkt = eth/ipv6/icmpv6/icmpv6ndopt/icmpv6ndprefix
+	if VERBOSE:
+		pkt.show2()
+	serial_send(pkt)
+
+	rep = serial_recv(2.5)
+	if (rep == None):
+		return VERDICT_NOK
+
+	eth = Ether(rep)
+	if ((eth[IPv6].src != "2001:db8:1:2:1222:33ff:fe44:5566") or
+	    (eth[IPv6].dst != "2001:1:2:3:a:b:c:d") or
+	    (eth[UDP].sport != 1234) or
+	    (eth[UDP].dport != 5678) or
+	    (eth[UDP].load != "test")):
+		return VERDICT_NOK
+
+	checksum_orig = eth[UDP].chksum
+	eth[UDP].chksum = 0
+	checksum_comp = in6_chksum(eth[IPv6].nh, eth[IPv6], raw(eth)[54:])
+	if (checksum_orig != checksum_comp):
+		if VERBOSE:
+			print("checksum: orig=%x, comp=%x" % (checksum_orig, checksum_comp))
+		return VERDICT_NOK
+
+	return VERDICT_OK
+
+def test_ip6_icmpv6_dad():
+	rep = serial_recv(0.5)
+	if (rep == None):
+		return VERDICT_NOK
+
+	eth = Ether(rep)
+	if VERBOSE:
+		eth.show()
+
+	if ((eth.dst != "33:33:ff:0d:00:0c") or
+	    (eth[IPv6].src != "::") or
+	    (eth[IPv6].dst != "ff02::1:ff0d:c") or
+	    (eth[IPv6].hlim != 255) or
+	    (eth[ICMPv6ND_NS].type != 135) or
+	    (eth[ICMPv6ND_NS].tgt != "2001:1:2:3:f:e:d:c") or
+	    (ICMPv6NDOptSrcLLAddr in eth)):
+		return VERDICT_NOK
+
+	rep = serial_recv(0.5)
+	if (rep == None):
+		return VERDICT_NOK
+
+	eth = Ether(rep)
+	if VERBOSE:
+		eth.show()
+
+	if ((eth.dst != "33:33:00:00:00:01") or
+	    (eth[IPv6].dst != "ff02::1") or
+	    (eth[ICMPv6ND_NA].type != 136) or
+	    (eth[ICMPv6ND_NA].S != 0) or
+	    (eth[ICMPv6ND_NA].O != 0) or
+	    (eth[ICMPv6ND_NA].tgt != "2001:1:2:3:f:e:d:c") or
+	    (eth[ICMPv6NDOptDstLLAddr].lladdr != "10:22:33:44:55:66")):
+		return VERDICT_NOK
+
+	rep = serial_recv(0.5)
+	if (rep == None):
+		return VERDICT_NOK
+
+	eth = Ether(rep)
+	if ((eth.dst != "76:88:99:aa:bb:cc") or
+	    (eth[IPv6].src != "2001:1:2:3:f:e:d:c") or
+	    (eth[IPv6].load != "test")):
+		return VERDICT_NOK
+
+	eth = Ether(src="76:88:99:AA:BB:CC",dst="33:33:00:00:00:01",type=0x86DD)
+	ipv6 = IPv6(src="fe80::a:b:c:d",dst="ff02::1",nh=58,hlim=255)
+	icmpv6 = ICMPv6ND_NA(tgt="2001:1:2:3:f:e:d:c",R=0,S=0,O=1)
+	icmpv6ndopt = ICMPv6NDOptDstLLAddr(lladdr="76:88:99:AA:BB:CC")
+	pkt = eth/ipv6/icmpv6/icmpv6ndopt
+	if VERBOSE:
+		pkt.show2()
+	serial_send(pkt)
+
+	rep = serial_recv(0.5)
+	if (rep != None):
+		return VERDICT_NOK
+
+	return VERDICT_OK
+
+def test_ip6_icmpv6_nud():
+	eth = Ether(src="76:88:99:AA:BB:CC",dst="33:33:00:00:00:01",type=0x86DD)
+	ipv6 = IPv6(src="2001:1:2:3:a:b:c:d",dst="ff02::1",nh=58,hlim=255)
+	icmpv6 = ICMPv6ND_NA(tgt="2001:1:2:3:a:b:c:d",R=0,S=0,O=1)
+	icmpv6ndopt = ICMPv6NDOptDstLLAddr(lladdr="76:88:99:AA:BB:CC")
+	pkt = eth/ipv6/icmpv6/icmpv6ndopt
+	if VERBOSE:
+		pkt.show2()
+	serial_send(pkt)
+
+	rep = serial_recv(2.5)
+	if (rep == None):
+		return VERDICT_NOK
+
+	eth = Ether(rep)
+	if VERBOSE:
+		eth.show()
+
+	if ((eth.dst != "76:88:99:aa:bb:cc") or
+	    (UDP not in eth) or
+	    (eth[UDP].load != "test")):
+		return VERDICT_NOK
+
+	eth = Ether(src="76:88:99:AA:BB:CC",dst="10:22:33:44:55:66",type=0x86DD)
+	ipv6 = IPv6(src="2001:1:2:3:a:b:c:d",dst="2001:1:2:3:f:e:d:c",nh=17)
+	udp = UDP(sport=5678, dport=1234)
+	pkt = eth/ipv6/udp/"ok"
+	serial_send(pkt)
+
+	# Datagram without probe, then probe and datagram
+	rep = serial_recv(2.5)
+	if ((rep == None) or (UDP not in Ether(rep))):
+		return VERDICT_NOK
+
+	rep = serial_recv(0.5)
+	if (rep == None):
+		return VERDICT_NOK
+
+	eth = Ether(rep)
+	if VERBOSE:
+		eth.show()
+
+	if ((eth.dst != "76:88:99:aa:bb:cc") or
+	    (eth[IPv6].src != "fe80::f:e:d:c") or
+	    (eth[IPv6].dst != "2001:1:2:3:a:b:c:d") or
+	    (eth[ICMPv6ND_NS].type != 135) or
+	    (eth[ICMPv6ND_NS].tgt != "2001:1:2:3:a:b:c:d") or
+	    (eth[ICMPv6NDOptSrcLLAddr].lladdr != "10:22:33:44:55:66")):
+		return VERDICT_NOK
+
+	rep = serial_recv(0.5)
+	if ((rep == None) or (UDP not in Ether(rep))):
+		return VERDICT_NOK
+
+	eth = Ether(src="76:88:99:AA:BB:CC",dst="10:22:33:44:55:66",type=0x86DD)
+	ipv6 = IPv6(src="2001:1:2:3:a:b:c:d",dst="fe80::f:e:d:c",nh=58)
+	icmpv6 = ICMPv6ND_NA(tgt="2001:1:2:3:a:b:c:d",R=0,S=1,O=1)
+	icmpv6ndopt = ICMPv6NDOptDstLLAddr(lladdr="76:88:99:AA:BB:CC")
+	pkt = eth/ipv6/icmpv6/icmpv6ndopt
+	serial_send(pkt)
+
+	rep = serial_recv(0.5)
+	if (rep != None):
+		return VERDICT_NOK
+
+	return VERDICT_OK
+
+def test_ip6_icmpv6_echo():
+	for (src, dst, seq) in [("2001:1:2:3:a:b:c:d", "2001:1:2:3:f:e:d:c", 1),
+	                        ("fe80::a:b:c:d", "fe80::f:e:d:c", 2)]:
+		eth = Ether(src="76:88:99:AA:BB:CC",dst="10:22:33:44:55:66",type=0x86DD)
+		ipv6 = IPv6(src=src,dst=dst,nh=58)
+		icmpv6 = ICMPv6EchoRequest(id=0x1234,seq=seq,data="abcdefghijklmnop")
+		pkt = eth/ipv6/icmpv6
+		if VERBOSE:
+			pkt.show2()
+		serial_send(pkt)
+
+		rep = serial_recv(0.5)
+		if (rep == None):
+			return VERDICT_NOK
+
+		eth = Ether(rep)
+		if VERBOSE:
+			eth.show()
+
+		# Answered from the address the request was sent to
+		if ((eth.dst != "76:88:99:aa:bb:cc") or
+		    (eth[IPv6].src != dst) or
+		    (eth[IPv6].dst != src) or
+		    (ICMPv6EchoReply not in eth) or
+		    (eth[ICMPv6EchoReply].id != 0x1234) or
+		    (eth[ICMPv6EchoReply].seq != seq) or
+		    (eth[ICMPv6EchoReply].data != b"abcdefghijklmnop")):
+			return VERDICT_NOK
+
+		checksum_orig = eth[ICMPv6EchoReply].cksum
+		eth[ICMPv6EchoReply].cksum = 0
+		checksum_comp = in6_chksum(eth[IPv6].nh, eth[IPv6], raw(eth)[54:])
+		if (checksum_orig != checksum_comp):
+			if VERBOSE:
+				print("checksum: orig=%x, comp=%x" % (checksum_orig, checksum_comp))
+			return VERDICT_NOK
+
+	return VERDICT_OK
+
+def test_ip6_icmpv6_ratelimit():
+	eth = Ether(src="76:88:99:AA:BB:CC",dst="33:33:00:00:00:01",type=0x86DD)
+	ipv6 = IPv6(src="2001:1:2:3:a:b:c:d",dst="2001:1:2:3:f:e:d:c",nh=58)
+	icmpv6 = ICMPv6ND_NS(tgt="2001:1:2:3:f:e:d:c")
+	icmpv6ndopt = ICMPv6NDOptSrcLLAddr(lladdr="76:88:99:AA:BB:CC")
+	pkt = eth/ipv6/icmpv6/icmpv6ndopt
+	if VERBOSE:
+		pkt.show2()
+	for i in range(10):
+		serial_send(pkt)
+
+	# The 8 of the burst (NET_IP6_ICMPV6_BURST) are answered, not the others
+	answered = 0
+	while True:
+		rep = serial_recv(0.5)
+		if (rep == None):
+			break
+		eth = Ether(rep)
+		if VERBOSE:
+			eth.show()
+		if ((ICMPv6ND_NA not in eth) or
+		    (eth[ICMPv6ND_NA].tgt != "2001:1:2:3:f:e:d:c")):
+			return VERDICT_NOK
+		answered += 1
+
+	if (answered != 8):
+		if VERBOSE:
+			print("answered: %d" % answered)
+		return VERDICT_NOK
+
+	return VERDICT_OK
+
+
+#
+# 6LoWPAN tests, frames of compressed headers without Ethernet header
+#
+
+def lowpan_expect(frame):
+	rep = serial_recv(0.5)
+	if (rep == None):
+		return VERDICT_NOK
+
+	if VERBOSE:
+		print(binascii.hexlify(rep))
+	if (bytes(rep) != frame):
+		return VERDICT_NOK
+
+	return VERDICT_OK
+
+def lowpan_send(frame):
+	pkt = Raw(frame)
+	if VERBOSE:
+		pkt.show2()
+	serial_send(pkt)
+
+def test_lowpan_send_udp():
+	# IPHC of EUI-64 addresses of the context 0, UDP NHC of the ports inline
+	return lowpan_expect(b"\x7f\x77\xf0\x04\xd2\x16\x33\x12\x34test")
+
+def test_lowpan_send_inline():
+	return lowpan_expect(b"\x7e\x55" +
+	                     b"\x00\x0f\x00\x0e\x00\x0d\x00\x0c" +
+	                     b"\x00\x0a\x00\x0b\x00\x0c\x00\x0d" +
+	                     b"\xf3\x12\x12\x34test")
+
+def test_lowpan_send_mcast():
+	return lowpan_expect(b"\x7b\x3b\x3a\x01test")
+
+def test_lowpan_recv_udp():
+	lowpan_send(b"\x7f\x77\xf0\x16\x33\x04\xd2\x56\x78test")
+	return VERDICT_OK
+
+def test_lowpan_recv_inline():
+	lowpan_send(b"\x6c\x29\x81\x23\x45\x20\x12\x34" +
+	            b"\x05\x00\x00\x01\x00\x03" +
+	            b"\xf1\x16\x33\xb1\x9a\xbcok")
+	return VERDICT_OK
+
+def test_lowpan_recv_bad():
+	ipv6 = IPv6(src="2001:1:2:3:a:b:c:d",dst="2001:1:2:3:f:e:d:c",nh=59,hlim=64)
+	lowpan_send(b"\x80\x00test")
+	lowpan_send(b"\x7e\x55\x00\x0f\x00\x0e")
+	lowpan_send(b"\x7f\xf7\x00\xf0\x16\x33\x04\xd2\x56\x78")
+	lowpan_send(b"\x41" + bytes(ipv6))
+	return VERDICT_OK
+
+def test_lowpan_modes():
+	# IPHC and UDP NHC of each round trip, the frame being sent back as is
+	modes = [b"\x7f\x33\xf0", b"\x76\x77\xf1", b"\x6d\x22\xf2", b"\x64\x66\xf3",
+	         b"\x7b\x11", b"\x7e\x55\xf0", b"\x7e\x00\xf0", b"\x7b\x4b",
+	         b"\x7f\x3a\xf3", b"\x7f\x39\xf0", b"\x7f\x38\xf0"]
+	ports_len = [4, 3, 3, 1]
+
+	for mode in modes:
+		rep = serial_recv(0.5)
+		if (rep == None):
+			return VERDICT_NOK
+
+		rep = bytes(rep)
+		if VERBOSE:
+			print(binascii.hexlify(rep))
+		if (rep[0:2] != mode[0:2]):
+			return VERDICT_NOK
+		if (len(mode) > 2):
+			nhcpos = len(rep) - 4 - 2 - ports_len[ord(mode[2:3]) & 0x03] - 1
+			if (rep[nhcpos:nhcpos+1] != mode[2:3]):
+				return VERDICT_NOK
+		lowpan_send(rep)
+
+	return VERDICT_OK
+
+def test_lowpan_recv_unsupp():
+	# Contexts 0 (unknown there) and 1, UDP checksum elided, then a valid frame
+	lowpan_send(b"\x7f\x77\xf0\x16\x33\x04\xd2\x11\x11test")
+	lowpan_send(b"\x7f\xf7\x11\xf0\x16\x33\x04\xd2\x22\x22test")
+	lowpan_send(b"\x7f\x33\xf4\x16\x33\x04\xd2test")
+	lowpan_send(b"\x7f\x33\xf0\x16\x33\x04\xd2\x56\x78test")
+	return VERDICT_OK
+
+def test_lowpan_udp():
+	# Datagram of the UDP context, through the IPv6 context, then the reply
+	if (lowpan_expect(b"\x7f\x55" +
+	                  b"\x00\x0f\x00\x0e\x00\x0d\x00\x0c" +
+	                  b"\x00\x0a\x00\x0b\x00\x0c\x00\x0d" +
+	                  b"\xf0\x04\xd2\x16\x2e\xbc\x8atest") != VERDICT_OK):
+		return VERDICT_NOK
+
+	lowpan_send(b"\x7f\x55" +
+	            b"\x00\x0a\x00\x0b\x00\x0c\x00\x0d" +
+	            b"\x00\x0f\x00\x0e\x00\x0d\x00\x0c" +
+	            b"\xf0\x16\x2e\x04\xd2\x34\xfdok")
+	return VERDICT_OK
+
+def test_lowpan_echo():
+	# Echo Requests to the global and link-local addresses, answered in order
+	lowpan_send(b"\x7b\x55\x3a" +
+	            b"\x00\x0a\x00\x0b\x00\x0c\x00\x0d" +
+	            b"\x00\x0f\x00\x0e\x00\x0d\x00\x0c" +
+	            b"\x80\x00\xe9\xba\x12\x34\x00\x01abcdefghijklmnop")
+	lowpan_send(b"\x7b\x11\x3a" +
+	            b"\x00\x0a\x00\x0b\x00\x0c\x00\x0d" +
+	            b"\x00\x0f\x00\x0e\x00\x0d\x00\x0c" +
+	            b"\x80\x00\x2c\xc6\x12\x34\x00\x02abcdefghijklmnop")
+
+	if (lowpan_expect(b"\x7b\x55\x3a" +
+	                  b"\x00\x0f\x00\x0e\x00\x0d\x00\x0c" +
+	                  b"\x00\x0a\x00\x0b\x00\x0c\x00\x0d" +
+	                  b"\x81\x00\xe8\xba\x12\x34\x00\x01abcdefghijklmnop") != VERDICT_OK):
+		return VERDICT_NOK
+	return lowpan_expect(b"\x7b\x11\x3a" +
+	                     b"\x00\x0f\x00\x0e\x00\x0d\x00\x0c" +
+	                     b"\x00\x0a\x00\x0b\x00\x0c\x00\x0d" +
+	                     b"\x81\x00\x2b\xc6\x12\x34\x00\x02abcdefghijklmnop")
+
 
 #
 # UDP tests
@@ -581,6 +1057,104 @@ def test_udp_send_data():
 	return VERDICT_OK
 
 
+def test_udp_flows():
+	eth = Ether(src="76:88:99:AA:BB:CC",dst="10:22:33:44:55:66",type=0x86DD)
+	peer = IPv6(src="2001:1:2:3:a:b:c:d",dst="2001:1:2:3:f:e:d:c",nh=17)
+	peer2 = IPv6(src="2001:1:2:3:a:b:c:e",dst="2001:1:2:3:f:e:d:c",nh=17)
+	other = IPv6(src="2001:1:2:3:d:c:b:a",dst="2001:1:2:3:f:e:d:c",nh=17)
+	pkts = [eth/peer2/UDP(sport=5678, dport=1234)/Raw("b"),
+	        eth/peer/UDP(sport=514, dport=1235)/Raw("c"),
+	        eth/peer/UDP(sport=5679, dport=1234)/Raw("x"),
+	        eth/other/UDP(sport=5678, dport=1234)/Raw("w"),
+	        eth/peer/UDP(sport=5678, dport=1234)/Raw("a"),
+	        eth/peer2/UDP(sport=5678, dport=1234)/Raw("y"),
+	        eth/peer/UDP(sport=5678, dport=1234)/Raw("z")]
+	for pkt in pkts:
+		if VERBOSE:
+			pkt.show2()
+		serial_send(pkt)
+	return VERDICT_OK
+
+def test_udp_flows_resolve():
+	rep = serial_recv(0.5)
+	if (rep == None):
+		return VERDICT_NOK
+
+	eth = Ether(rep)
+	if VERBOSE:
+		eth.show()
+
+	if ((eth.dst != "33:33:ff:0c:00:0e") or
+	    (eth[IPv6].dst != "ff02::1:ff0c:e") or
+	    (eth[ICMPv6ND_NS].tgt != "2001:1:2:3:a:b:c:e")):
+		return VERDICT_NOK
+
+	eth = Ether(src="76:88:99:AA:BB:CC",dst="10:22:33:44:55:66",type=0x86DD)
+	ipv6 = IPv6(src="2001:1:2:3:a:b:c:e",dst="fe80::f:e:d:c",nh=58)
+	icmpv6 = ICMPv6ND_NA(tgt="2001:1:2:3:a:b:c:e",R=0,S=1,O=1)
+	icmpv6ndopt = ICMPv6NDOptDstLLAddr(lladdr="AA:BB:CC:DD:EE:FF")
+	pkt = eth/ipv6/icmpv6/icmpv6ndopt
+	if VERBOSE:
+		pkt.show2()
+	serial_send(pkt)
+
+	rep = serial_recv(2.5)
+	if (rep == None):
+		return VERDICT_NOK
+
+	eth = Ether(rep)
+	if ((eth.dst != "aa:bb:cc:dd:ee:ff") or
+	    (eth[IPv6].dst != "2001:1:2:3:a:b:c:e") or
+	    (eth[UDP].sport != 1234) or
+	    (eth[UDP].dport != 5678) or
+	    (eth[UDP].load != "test")):
+		return VERDICT_NOK
+
+	eth = Ether(src="AA:BB:CC:DD:EE:FF",dst="10:22:33:44:55:66",type=0x86DD)
+	ipv6 = IPv6(src="2001:1:2:3:a:b:c:e",dst="2001:1:2:3:f:e:d:c",nh=17)
+	pkt = eth/ipv6/UDP(sport=5678, dport=1234)/Raw("ok")
+	if VERBOSE:
+		pkt.show2()
+	serial_send(pkt)
+
+	return VERDICT_OK
+
+def test_udp_listen():
+	eth = Ether(src="76:88:99:AA:BB:CC",dst="10:22:33:44:55:66",type=0x86DD)
+	peer = IPv6(src="2001:1:2:3:a:b:c:d",dst="2001:1:2:3:f:e:d:c",nh=17)
+	peer2 = IPv6(src="2001:1:2:3:a:b:c:e",dst="2001:1:2:3:f:e:d:c",nh=17)
+	reqs = [(peer, 5678, 1234, "get1", True),
+	        (peer2, 6000, 1234, "get2", True),
+	        (peer, 5678, 1235, "get0", False),
+	        (peer, 5679, 1234, "get3", True)]
+	for (ipv6, sport, dport, data, answered) in reqs:
+		pkt = eth/ipv6/UDP(sport=sport, dport=dport)/Raw(data)
+		if VERBOSE:
+			pkt.show2()
+		serial_send(pkt)
+		if not answered:
+			continue
+
+		rep = serial_recv(0.5)
+		if (rep == None):
+			return VERDICT_NOK
+		eth_rep = Ether(rep)
+		if VERBOSE:
+			eth_rep.show()
+		if ((eth_rep[IPv6].dst != ipv6.src) or
+		    (eth_rep[UDP].sport != 1234) or
+		    (eth_rep[UDP].dport != sport) or
+		    (eth_rep[UDP].load != "ok")):
+			return VERDICT_NOK
+
+		checksum_orig = eth_rep[UDP].chksum
+		eth_rep[UDP].chksum = 0
+		checksum_comp = in6_chksum(eth_rep[IPv6].nh, eth_rep[IPv6], raw(eth_rep)[54:])
+		if (checksum_orig != checksum_comp):
+			return VERDICT_NOK
+
+	return VERDICT_OK
+
 def test_coap_noncf_send_nodata():
 	rep = serial_recv(0.5)
 	if (rep == None):
@@ -818,6 +1392,101 @@ def test_coap_send_msgid_incr():
 #	serial_send(pkt)
 #	return VERDICT_OK
 
+def test_memstats_report():
+	# The report is printed by the device as debug lines, shown with VERBOSE
+	return VERDICT_OK
+
+def test_stats_drops():
+	eth = Ether(src="76:88:99:AA:BB:CC",dst="10:22:33:44:55:66",type=0x0800)
+	pkt=eth/Raw("test")
+	serial_send(pkt)
+	eth = Ether(src="76:88:99:AA:BB:CC",dst="10:22:33:44:55:66",type=0x86DD)
+	ipv6 = IPv6(src="2001:1:2:3:a:b:c:d",dst="2001:1:2:3:f:e:d:c",nh=6)
+	pkt=eth/ipv6
+	serial_send(pkt)
+	ipv6 = IPv6(src="2001:1:2:3:a:b:c:d",dst="2001:1:2:3:f:e:d:c",nh=17)
+	udp = UDP(sport=5670, dport=1234, len=12)
+	pkt=eth/ipv6/udp/Raw("test")
+	serial_send(pkt)
+	udp = UDP(sport=5678, dport=1234, len=12)
+	pkt=eth/ipv6/udp/Raw("test")
+	if VERBOSE:
+		pkt.show2()
+	serial_send(pkt)
+	return VERDICT_OK
+
+def test_trace_dump():
+	# Two datagrams are sent, the trace is printed as debug lines
+	if (test_udp_send_nodata() != VERDICT_OK):
+		return VERDICT_NOK
+	return test_udp_send_nodata()
+
+def test_tap_capture():
+	eth = Ether(src="76:88:99:AA:BB:CC",dst="10:22:33:44:55:66",type=0x0800)/Raw("test")
+	serial_send(eth)
+	eth = Ether(src="76:88:99:AA:BB:CC",dst="10:22:33:44:55:66",type=0x9000)/Raw("test")
+	if VERBOSE:
+		eth.show2()
+	serial_send(eth)
+	# The device sends a frame back, its capture is checked on the device
+	return test_mac_send_data()
+
+def test_load_serve():
+	# One frame of each kind of the load mode, then the end of the load
+	for kind in LOAD_KINDS:
+		serial_send(load_frame(kind, 42)[0])
+	serial_send(load_frame('end', 0)[0])
+	for kind in LOAD_KINDS:
+		rep = serial_recv(0.5)
+		if ((rep == None) or (load_match(bytearray(rep)) != (kind, load_frame(kind, 42)[1]))):
+			return VERDICT_NOK
+	return VERDICT_OK
+
+def test_poll_dispatch():
+	eth = Ether(src="76:88:99:AA:BB:CC",dst="10:22:33:44:55:66",type=0x86DD)
+	peer = IPv6(src="2001:1:2:3:a:b:c:d",dst="2001:1:2:3:f:e:d:c",nh=17)
+	peer2 = IPv6(src="2001:1:2:3:a:b:c:e",dst="2001:1:2:3:f:e:d:c",nh=17)
+	ns = Ether(src="76:88:99:AA:BB:CC",dst="33:33:00:00:00:01",type=0x86DD)/ \
+	     IPv6(src="2001:1:2:3:a:b:c:d",dst="2001:1:2:3:f:e:d:c",nh=58)/ \
+	     ICMPv6ND_NS(tgt="2001:1:2:3:f:e:d:c")/ICMPv6NDOptSrcLLAddr(lladdr="76:88:99:AA:BB:CC")
+	pkts = [eth/peer/UDP(sport=5683, dport=1234)/CoAP(type=1, tkl=1, code=0x41, token='\x56'),
+	        eth/peer2/UDP(sport=6000, dport=5684)/Raw("ping"),
+	        eth/peer/UDP(sport=514, dport=1235)/Raw("l1"),
+	        eth/peer/UDP(sport=514, dport=1235)/Raw("l2"),
+	        eth/peer/UDP(sport=514, dport=1235)/Raw("l3"),
+	        eth/peer/UDP(sport=514, dport=5685)/Raw("l0"),
+	        eth/peer/UDP(sport=514, dport=1235)/Raw("l4"),
+	        ns]
+	for pkt in pkts:
+		if VERBOSE:
+			pkt.show2()
+		serial_send(pkt)
+
+	# The answer of the listening endpoint, then the advertisement
+	rep = serial_recv(0.5)
+	if (rep == None):
+		return VERDICT_NOK
+	eth_rep = Ether(rep)
+	if VERBOSE:
+		eth_rep.show()
+	if ((eth_rep[IPv6].dst != "2001:1:2:3:a:b:c:e") or
+	    (eth_rep[UDP].sport != 5684) or
+	    (eth_rep[UDP].dport != 6000) or
+	    (eth_rep[UDP].load != "ok")):
+		return VERDICT_NOK
+
+	rep = serial_recv(0.5)
+	if (rep == None):
+		return VERDICT_NOK
+	eth_rep = Ether(rep)
+	if VERBOSE:
+		eth_rep.show()
+	if ((eth_rep[IPv6].dst != "2001:1:2:3:a:b:c:d") or
+	    (eth_rep[ICMPv6ND_NA].tgt != "2001:1:2:3:f:e:d:c")):
+		return VERDICT_NOK
+
+	return VERDICT_OK
+
 
 tests = {
 #	0x1*: test_mac_*
@@ -845,6 +1514,25 @@ tests = {
 	0x33: test_ip6_icmpv6_nsna_recv_mcsn,
 	0x34: test_ip6_icmpv6_nsna_recv_dad,
 	0x35: test_ip6_icmpv6_nsna_recv_badtgt,
+	0x36: test_ip6_icmpv6_nc_resolve,  # NET_IP6_NC_ENABLE
+	0x37: test_ip6_icmpv6_ra_slaac,  # NET_IP6_NC_ENABLE, NET_IP6_AUTOCONF_ENABLE
+	0x38: test_ip6_icmpv6_dad,  # NET_IP6_DAD_ENABLE
+	0x39: test_ip6_icmpv6_nud,  # NET_IP6_NC_ENABLE
+	0x3A: test_ip6_icmpv6_echo,
+	0x3B: test_ip6_icmpv6_ratelimit,  # NET_IP6_RATELIMIT_ENABLE
+	0x3C: test_ip6_icmpv6_ra_udp,  # NET_IP6_AUTOCONF_ENABLE
+
+#	0x4*: test_lowpan_*
+	0x41: test_lowpan_send_udp,
+	0x42: test_lowpan_send_inline,
+	0x43: test_lowpan_send_mcast,
+	0x44: test_lowpan_recv_udp,
+	0x45: test_lowpan_recv_inline,
+	0x46: test_lowpan_recv_bad,
+	0x47: test_lowpan_udp,  # NET_LOWPAN_ENABLE
+	0x48: test_lowpan_echo,  # NET_LOWPAN_ENABLE
+	0x49: test_lowpan_modes,
+	0x4A: test_lowpan_recv_unsupp,
 
 #	0x5*: test_udp_*
 	0x51: test_udp_recv_nodata,
@@ -854,6 +1542,9 @@ tests = {
 	0x55: test_udp_recv_badlen,
 	0x56: test_udp_send_nodata,
 	0x57: test_udp_send_data,
+	0x58: test_udp_flows,
+	0x59: test_udp_listen,
+	0x5A: test_udp_flows_resolve,  # NET_IP6_NC_ENABLE
 
 #	0x6*: test_coap_*
 	0x61: test_coap_noncf_send_nodata,
@@ -863,6 +1554,14 @@ tests = {
 	0x65: test_coap_cf_send_data,
 	0x66: test_coap_cf_send_data_ackresp,
 	0x67: test_coap_cf_send_data_piggybacked,
+
+#	0x7*: test_memstats_*
+	0x71: test_memstats_report,
+	0x72: test_stats_drops,
+	0x73: test_trace_dump,
+	0x74: test_tap_capture,
+	0x75: test_load_serve,
+	0x76: test_poll_dispatch,
 }
 
 # Run tests, with python as the test controller
@@ -890,6 +1589,180 @@ def net_console():
 		if (pkt != None):
 			IPv6(pkt).show2()
 
-serial_init()
-run_tests()
-#net_console()
+
+#
+# Load mode
+#
+# The device serves test 0x75 (test_load_serve): datagrams to port 1234 are
+# echoed, CoAP requests acknowledged (CON) or answered with a 2.04 (NON), and
+# NS answered by the IPv6 layer. Frames are sent at a constant rate, cycling
+# over the kinds of traffic, and their answers matched by sequence number
+# (udp), message ID (coap), token (coapnon), or in order (ns). An empty
+# datagram ends the load.
+#
+
+LOAD_TEST=0x75
+LOAD_KINDS=('udp', 'coap', 'coapnon', 'ns')
+
+load_line=bytearray()
+
+def load_frame(kind, seq):
+	eth = Ether(src="76:88:99:AA:BB:CC",dst="10:22:33:44:55:66",type=0x86DD)
+	ipv6 = IPv6(src="2001:1:2:3:a:b:c:d",dst="2001:1:2:3:f:e:d:c")
+	udp = UDP(sport=5678, dport=1234)
+	if (kind == 'udp'):
+		# The first byte is 0, the datagram is not taken for CoAP
+		return (eth/ipv6/udp/Raw(b'\x00' + struct.pack('>I', seq)), seq)
+	elif (kind == 'coap'):
+		msg_id = seq & 0xFFFF
+		coap = struct.pack('>BBH', 0x40, 0x02, msg_id)
+		return (eth/ipv6/udp/Raw(coap), msg_id)
+	elif (kind == 'coapnon'):
+		coap = struct.pack('>BBHI', 0x54, 0x02, seq & 0xFFFF, seq)
+		return (eth/ipv6/udp/Raw(coap), seq)
+	elif (kind == 'end'):
+		return (eth/ipv6/udp, None)
+	eth = Ether(src="76:88:99:AA:BB:CC",dst="33:33:ff:0d:00:0c")
+	ipv6 = IPv6(src="2001:1:2:3:a:b:c:d",dst="ff02::1:ff0d:c")
+	ns = ICMPv6ND_NS(tgt="2001:1:2:3:f:e:d:c")/ICMPv6NDOptSrcLLAddr(lladdr="76:88:99:aa:bb:cc")
+	return (eth/ipv6/ns, None)
+
+# Kind and key of an answer, None for other frames
+def load_match(frame):
+	if ((len(frame) < 58) or (frame[12:14] != b'\x86\xdd')):
+		return None
+	if ((frame[20] == 58) and (frame[54] == 136)):
+		return ('ns', None)
+	if ((frame[20] != 17) or (len(frame) < 62)):
+		return None
+	data = frame[62:]
+	if ((len(data) == 5) and (data[0] == 0)):
+		return ('udp', struct.unpack('>I', bytes(data[1:5]))[0])
+	if ((len(data) == 4) and (data[0] == 0x60)):
+		return ('coap', struct.unpack('>H', bytes(data[2:4]))[0])
+	if ((len(data) == 8) and (data[0] == 0x54) and (data[1] == 0x44)):
+		return ('coapnon', struct.unpack('>I', bytes(data[4:8]))[0])
+	return None
+
+# Lines received so far, without waiting
+def load_read_lines():
+	global load_line
+	lines = []
+	while (serial_obj.in_waiting > 0):
+		load_line += bytearray(serial_obj.read(serial_obj.in_waiting))
+		while (b'\n' in load_line):
+			pos = load_line.index(b'\n')
+			lines.append(bytes(load_line[:pos]).strip())
+			load_line = load_line[pos+1:]
+	return lines
+
+def load_percentile(values, p):
+	if (len(values) == 0):
+		return 0.0
+	return values[min(len(values) - 1, int(len(values) * p / 100))] * 1000
+
+def run_load(kinds, rate, duration, drain):
+	stats = dict((kind, {'sent': 0, 'received': 0, 'rtt': []}) for kind in kinds)
+	outstanding = {}
+	ns_pending = collections.deque()
+	verdict = None
+
+	def process(lines):
+		for line in lines:
+			if line.startswith(b'T:'):
+				return int(line[2:])
+			if (not line.startswith(b'P:')):
+				if VERBOSE:
+					print("< %s" % line)
+				continue
+			match = load_match(bytearray(binascii.unhexlify(line[2:].strip())))
+			if (match == None):
+				continue
+			if (match[0] == 'ns'):
+				sent = ns_pending.popleft() if ns_pending else None
+			else:
+				sent = outstanding.pop(match, None)
+			if (sent != None):
+				stats[match[0]]['received'] += 1
+				stats[match[0]]['rtt'].append(time.time() - sent)
+		return None
+
+	serial_signal(LOAD_TEST)
+	time.sleep(0.2)
+	load_read_lines()
+
+	start = time.time()
+	next_send = start
+	seq = 0
+	while (time.time() < start + duration):
+		# Answers are read before sending more, for the link not to stall
+		process(load_read_lines())
+		now = time.time()
+		if (now >= next_send):
+			kind = kinds[seq % len(kinds)]
+			(pkt, key) = load_frame(kind, seq)
+			serial_send(pkt)
+			if (kind == 'ns'):
+				ns_pending.append(now)
+			else:
+				outstanding[(kind, key)] = now
+			stats[kind]['sent'] += 1
+			seq += 1
+			next_send += 1.0 / rate
+		else:
+			time.sleep(min(next_send - now, 0.001))
+	elapsed = time.time() - start
+
+	# Answers still in flight
+	end = time.time() + drain
+	while ((outstanding or ns_pending) and (time.time() < end)):
+		process(load_read_lines())
+		time.sleep(0.001)
+
+	serial_send(load_frame('end', 0)[0])
+	end = time.time() + 5
+	while ((verdict == None) and (time.time() < end)):
+		verdict = process(load_read_lines())
+		time.sleep(0.01)
+
+	print("%-8s %8s %8s %6s %8s %8s %8s %8s %8s %8s" % ("kind", "sent", "answered", "loss%",
+	      "tx fps", "rx fps", "p50 ms", "p90 ms", "p99 ms", "max ms"))
+	for kind in kinds:
+		s = stats[kind]
+		rtt = sorted(s['rtt'])
+		print("%-8s %8d %8d %6.1f %8.1f %8.1f %8.2f %8.2f %8.2f %8.2f" % (kind, s['sent'],
+		      s['received'], (100.0 * (s['sent'] - s['received']) / s['sent']) if s['sent'] else 0.0,
+		      s['sent'] / elapsed, s['received'] / elapsed, load_percentile(rtt, 50),
+		      load_percentile(rtt, 90), load_percentile(rtt, 99), load_percentile(rtt, 100)))
+	if (verdict != VERDICT_OK):
+		print("device verdict: %s" % ("none" if (verdict == None) else "NOK"))
+		return 1
+	return 0
+
+
+if __name__ == '__main__':
+	parser = argparse.ArgumentParser(description="Test controller of the device")
+	parser.add_argument('-p', '--port', default=SERIAL_PORT)
+	parser.add_argument('-b', '--baudrate', type=int, default=SERIAL_BAUDRATE)
+	parser.add_argument('-v', '--verbose', action='store_true')
+	parser.add_argument('--load', metavar='KINDS',
+	                    help="load mode, kinds among %s" % ",".join(LOAD_KINDS))
+	parser.add_argument('--rate', type=float, default=10, help="frames per second")
+	parser.add_argument('--duration', type=float, default=10, help="seconds")
+	parser.add_argument('--drain', type=float, default=2,
+	                    help="seconds waiting for the last answers")
+	args = parser.parse_args()
+
+	SERIAL_PORT = args.port
+	SERIAL_BAUDRATE = args.baudrate
+	VERBOSE = 1 if args.verbose else VERBOSE
+	serial_init()
+
+	if (args.load != None):
+		kinds = args.load.split(',')
+		if ((len(kinds) == 0) or any(kind not in LOAD_KINDS for kind in kinds)):
+			parser.error("kinds among %s" % ",".join(LOAD_KINDS))
+		sys.exit(run_load(kinds, args.rate, args.duration, args.drain))
+
+	run_tests()
+	#net_console()
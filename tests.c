@@ -6,17 +6,24 @@
 
 #include "tests.h"
 #include "platform.h"
+#include "net_memstats.h"
+#include "net_trace.h"
+#include "net_tap.h"
 
 #include <stdlib.h>
 #include <string.h>
 
 #define DEBUG(...) serial_debug(__VA_ARGS__)
 
+/* Receiving does not block, poll for up to TEST_RECV_TIMEOUT milliseconds */
+#define TEST_RECV_TIMEOUT 2500
+
 #define TEST_RECV_RETRY(call) \
-	for (retry=0; retry<5; retry++) { \
+	for (retry=0; retry<TEST_RECV_TIMEOUT; retry++) { \
 		if ((call) != NET_EAGAIN) { \
 			break; \
 		} \
+		msleep(1); \
 	}
 
 #define TEST_ASSERT(cond) \
@@ -50,20 +57,34 @@ uint8_t src_l2addr[6] = {0x10, 0x22, 0x33, 0x44, 0x55, 0x66};
 uint8_t dst_l2addr[6] = {0x76, 0x88, 0x99, 0xAA, 0xBB, 0xCC};
 
 
-struct hw_serial_ctx serial;
-struct net_mac_ctx mac = { .lower = &serial };
-struct net_ip6_ctx ip6 = { .lower = &mac };
+/* Link of the IPv6 contexts, as selected in config.h */
+#ifdef NET_LOWPAN_ENABLE
+#define TEST_IP6_LINK lowpan
+#else
+#define TEST_IP6_LINK mac
+#endif
+
+struct NET_MAC_PROTO_LOWER(_ctx) hw;
+struct net_mac_ctx mac = { .lower = &hw };
+struct net_lowpan_ctx lowpan = { .lower = &hw };
+struct net_ip6_ctx ip6 = { .lower = &TEST_IP6_LINK };
 struct net_udp_ctx udp = { .lower = &ip6 };
 struct net_coap_ctx coap = { .lower = &udp };
 
 
 void tests_init()
 {
+#ifdef NET_LOWPAN_ENABLE
+	/* Ends of the serial link, the site prefix being the one of our address */
+	net_lowpan_set_source_addr(&lowpan, src_l2addr);
+	net_lowpan_set_destination_addr(&lowpan, dst_l2addr);
+	net_lowpan_set_context(&lowpan, src_addr);
+#endif
 }
 
 static uint8_t test_mac_recv_nodata()
 {
-	int8_t retry = 0;
+	uint16_t retry = 0;
 	int8_t err = 0;
 	uint16_t dataoffset = 0;
 	uint16_t datalen = 0;
@@ -86,7 +107,7 @@ static uint8_t test_mac_recv_nodata()
 
 static uint8_t test_mac_recv_data_common()
 {
-	int8_t retry = 0;
+	uint16_t retry = 0;
 	int8_t err = 0;
 	uint16_t dataoffset = 0;
 	uint16_t datalen = 0;
@@ -121,7 +142,7 @@ static uint8_t test_mac_recv_data_mcast()
 
 static uint8_t test_mac_recv_badcommon()
 {
-	int8_t retry = 0;
+	uint16_t retry = 0;
 	int8_t err = 0;
 	uint16_t dataoffset = 0;
 	uint16_t datalen = 0;
@@ -193,7 +214,7 @@ static uint8_t test_mac_send_data()
 
 static uint8_t test_ip6_recv_nodata()
 {
-	int8_t retry = 0;
+	uint16_t retry = 0;
 	int8_t err = 0;
 	uint16_t dataoffset = 0;
 	uint16_t datalen = 0;
@@ -220,7 +241,7 @@ static uint8_t test_ip6_recv_nodata()
 
 static uint8_t test_ip6_recv_data()
 {
-	int8_t retry = 0;
+	uint16_t retry = 0;
 	int8_t err = 0;
 	uint16_t dataoffset = 0;
 	uint16_t datalen = 0;
@@ -248,7 +269,7 @@ static uint8_t test_ip6_recv_data()
 
 static uint8_t test_ip6_recv_badcommon()
 {
-	int8_t retry = 0;
+	uint16_t retry = 0;
 	int8_t err = 0;
 	uint16_t dataoffset = 0;
 	uint16_t datalen = 0;
@@ -293,7 +314,7 @@ static uint8_t test_ip6_recv_baddst()
 
 static uint8_t test_ip6_recv_badlen()
 {
-	int8_t retry = 0;
+	uint16_t retry = 0;
 	int8_t err = 0;
 	uint16_t dataoffset = 0;
 	uint16_t datalen = 0;
@@ -365,9 +386,22 @@ static uint8_t test_ip6_send_data()
 	return VERDICT_OK;
 }
 
+/* Receives, answering the solicitations recorded meanwhile, as when idle */
+static int8_t test_ip6_recv_service(struct net_ip6_ctx *ctx, uint8_t *buffer, uint16_t buflen,
+                                    uint16_t *dataoffset, uint16_t *datalen)
+{
+	int8_t err = net_ip6_recv(ctx, buffer, buflen, dataoffset, datalen);
+
+	if (err == NET_EAGAIN) {
+		net_ip6_service(ctx, buffer, buflen);
+	}
+
+	return err;
+}
+
 static uint8_t test_ip6_icmpv6_nsna_recv_common()
 {
-	int8_t retry = 0;
+	uint16_t retry = 0;
 	int8_t err = 0;
 	uint16_t dataoffset = 0;
 	uint16_t datalen = 0;
@@ -383,7 +417,7 @@ static uint8_t test_ip6_icmpv6_nsna_recv_common()
 	TEST_ASSERT(net_ip6_set_nexthdr(&ip6, 253) == NET_STATUS_OK);
 
 	TEST_ASSERT(net_ip6_connect(&ip6) == NET_STATUS_OK);
-	TEST_RECV_RETRY(err = net_ip6_recv(&ip6, &(buffer[1514 - 256]), 256, &dataoffset, &datalen));
+	TEST_RECV_RETRY(err = test_ip6_recv_service(&ip6, &(buffer[1514 - 256]), 256, &dataoffset, &datalen));
 	TEST_ASSERT(err == NET_EAGAIN);
 
 	return VERDICT_OK;
@@ -425,109 +459,200 @@ static uint8_t test_ip6_icmpv6_nsna_recv_badtgt()
 	return test_ip6_icmpv6_nsna_recv_common();
 }
 
-
-static uint8_t test_udp_recv_nodata()
+#ifdef NET_IP6_NC_ENABLE
+static uint8_t test_ip6_icmpv6_nc_resolve()
 {
-	int8_t retry = 0;
+	uint16_t retry = 0;
 	int8_t err = 0;
 	uint16_t dataoffset = 0;
 	uint16_t datalen = 0;
+	uint8_t payload[] = "test";
+	uint8_t other_addr[16] = {0x20,0x01,0x00,0x01,0x00,0x02,0x00,0x03,
+	                          0x00,0x0d,0x00,0x0c,0x00,0x0b,0x00,0x0a};
+	uint8_t other_l2addr[6] = {0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF};
+	uint8_t no_l2addr[6] = {0};
+	uint8_t *l2addr;
 	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(src_addr);
+	/* Own context, for the neighbor cache to start empty */
+	struct net_ip6_ctx nc_ip6 = { .lower = &TEST_IP6_LINK };
 
 	DEBUG(__FUNCTION__);
 
-	TEST_ASSERT(net_ip6_set_source_addr(&ip6, src_addr) == NET_STATUS_OK);
-	TEST_ASSERT(net_ip6_set_destination_addr(&ip6, dst_addr) == NET_STATUS_OK);
-	TEST_ASSERT(net_ip6_set_nexthdr(&ip6, NET_IP6_NH_UDP) == NET_STATUS_OK);
-	TEST_ASSERT(net_udp_set_source_port(&udp, 1234) == NET_STATUS_OK);
-	TEST_ASSERT(net_udp_set_destination_port(&udp, 5678) == NET_STATUS_OK);
-	TEST_ASSERT(net_udp_connect(&udp) == NET_STATUS_OK);
-	TEST_RECV_RETRY(err = net_udp_recv(&udp, buffer, 1514, &dataoffset, &datalen));
+	TEST_ASSERT(net_mac_set_source_addr(&mac, src_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_destination_addr(&mac, no_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_IPV6) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ip6mcast(&mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_ip6_set_source_addr(&nc_ip6, src_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_destination_addr(&nc_ip6, dst_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_nexthdr(&nc_ip6, 253) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_resolution(&nc_ip6, 1) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_connect(&nc_ip6) == NET_STATUS_OK);
+
+	/* Unknown neighbor: solicited once, the packet is to be sent again */
+	dataoffset = net_ip6_pload_pos(&nc_ip6);
+	memcpy(&(buffer[dataoffset]), payload, 4);
+	TEST_ASSERT(net_ip6_send(&nc_ip6, buffer, 1514, dataoffset, 4) == NET_EAGAIN);
+	TEST_ASSERT(net_ip6_send(&nc_ip6, buffer, 1514, dataoffset, 4) == NET_EAGAIN);
+	TEST_ASSERT(net_ip6_get_neighbor(&nc_ip6, dst_addr) == NULL);
+
+	/* Sent once the advertisement is received */
+	for (retry=0; retry<TEST_RECV_TIMEOUT; retry++) {
+		net_ip6_recv(&nc_ip6, buffer, 1514, &dataoffset, &datalen);
+		dataoffset = net_ip6_pload_pos(&nc_ip6);
+		memcpy(&(buffer[dataoffset]), payload, 4);
+		err = net_ip6_send(&nc_ip6, buffer, 1514, dataoffset, 4);
+		if (err != NET_EAGAIN) {
+			break;
+		}
+		msleep(1);
+	}
 	TEST_ASSERT(err == NET_STATUS_OK);
-	TEST_ASSERT(datalen == 0);
+	l2addr = net_ip6_get_neighbor(&nc_ip6, dst_addr);
+	TEST_ASSERT((l2addr != NULL) && (memcmp(l2addr, dst_l2addr, 6) == 0));
+
+	/* Neighbors soliciting us are learned */
+	for (retry=0; retry<TEST_RECV_TIMEOUT; retry++) {
+		net_ip6_recv(&nc_ip6, buffer, 1514, &dataoffset, &datalen);
+		if (net_ip6_get_neighbor(&nc_ip6, other_addr) != NULL) {
+			break;
+		}
+		msleep(1);
+	}
+	l2addr = net_ip6_get_neighbor(&nc_ip6, other_addr);
+	TEST_ASSERT((l2addr != NULL) && (memcmp(l2addr, other_l2addr, 6) == 0));
+
+#ifdef NET_IP6_RATELIMIT_ENABLE
+	/* The solicitation is answered out of the receive path */
+	TEST_ASSERT(net_ip6_service(&nc_ip6, buffer, 1514) == NET_STATUS_OK);
+#endif
+	TEST_ASSERT(net_ip6_service(&nc_ip6, buffer, 1514) == NET_EAGAIN);
+
+	TEST_ASSERT(net_ip6_set_destination_addr(&nc_ip6, other_addr) == NET_STATUS_OK);
+	dataoffset = net_ip6_pload_pos(&nc_ip6);
+	memcpy(&(buffer[dataoffset]), payload, 4);
+	TEST_ASSERT(net_ip6_send(&nc_ip6, buffer, 1514, dataoffset, 4) == NET_STATUS_OK);
 
 	return VERDICT_OK;
 }
+#endif
 
-static uint8_t test_udp_recv_data()
+#if defined(NET_IP6_NC_ENABLE) && defined(NET_IP6_AUTOCONF_ENABLE)
+static uint8_t test_ip6_icmpv6_ra_slaac()
 {
-	int8_t retry = 0;
-	int8_t err = 0;
+	uint16_t retry = 0;
 	uint16_t dataoffset = 0;
 	uint16_t datalen = 0;
-	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(src_addr);
+	uint8_t payload[] = "test";
+	uint8_t ll_addr[16] = {0xfe,0x80,0x00,0x00,0x00,0x00,0x00,0x00,
+	                       0x12,0x22,0x33,0xff,0xfe,0x44,0x55,0x66};
+	uint8_t global_addr[16] = {0x20,0x01,0x0d,0xb8,0x00,0x01,0x00,0x02,
+	                           0x12,0x22,0x33,0xff,0xfe,0x44,0x55,0x66};
+	uint8_t offlink_addr[16] = {0x20,0x01,0x0d,0xb8,0xff,0xff,0x00,0x00,
+	                            0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01};
+	uint8_t no_l2addr[6] = {0};
+	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(ll_addr);
+	/* Own context, for the autoconfiguration to start from scratch */
+	struct net_ip6_ctx ra_ip6 = { .lower = &TEST_IP6_LINK };
 
 	DEBUG(__FUNCTION__);
 
 	TEST_ASSERT(net_mac_set_source_addr(&mac, src_l2addr) == NET_STATUS_OK);
-	TEST_ASSERT(net_mac_set_destination_addr(&mac, dst_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_destination_addr(&mac, no_l2addr) == NET_STATUS_OK);
 	TEST_ASSERT(net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_IPV6) == NET_STATUS_OK);
 	TEST_ASSERT(net_mac_set_ip6mcast(&mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes) == NET_STATUS_OK);
 
-	TEST_ASSERT(net_ip6_set_source_addr(&ip6, src_addr) == NET_STATUS_OK);
-	TEST_ASSERT(net_ip6_set_destination_addr(&ip6, dst_addr) == NET_STATUS_OK);
-	TEST_ASSERT(net_ip6_set_nexthdr(&ip6, NET_IP6_NH_UDP) == NET_STATUS_OK);
-
-	TEST_ASSERT(net_udp_set_source_port(&udp, 1234) == NET_STATUS_OK);
-	TEST_ASSERT(net_udp_set_destination_port(&udp, 5678) == NET_STATUS_OK);
+	/* Link-local address, then Router Solicitation */
+	TEST_ASSERT(net_ip6_autoconf(&ra_ip6, buffer, 1514) == NET_STATUS_OK);
+	TEST_ASSERT(memcmp(ra_ip6.src_addr, ll_addr, 16) == 0);
+	TEST_ASSERT(net_ip6_set_resolution(&ra_ip6, 1) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_nexthdr(&ra_ip6, 253) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_connect(&ra_ip6) == NET_STATUS_OK);
+
+	/* Global address, router and MTU from the Router Advertisement */
+	for (retry=0; retry<TEST_RECV_TIMEOUT; retry++) {
+		net_ip6_recv(&ra_ip6, buffer, 1514, &dataoffset, &datalen);
+		if (ra_ip6.autoconf & NET_IP6_AUTOCONF_PREFIX) {
+			break;
+		}
+		msleep(1);
+	}
+	TEST_ASSERT(memcmp(ra_ip6.src_addr, global_addr, 16) == 0);
+	TEST_ASSERT(ra_ip6.autoconf & NET_IP6_AUTOCONF_ROUTER);
+	TEST_ASSERT(memcmp(ra_ip6.router_l2addr, dst_l2addr, 6) == 0);
+	TEST_ASSERT(ra_ip6.mtu == 1400);
+
+	/* Off-link destination, sent to the router without resolution */
+	TEST_ASSERT(net_ip6_set_destination_addr(&ra_ip6, offlink_addr) == NET_STATUS_OK);
+	dataoffset = net_ip6_pload_pos(&ra_ip6);
+	memcpy(&(buffer[dataoffset]), payload, 4);
+	TEST_ASSERT(net_ip6_send(&ra_ip6, buffer, 1514, dataoffset, 4) == NET_STATUS_OK);
 
-	TEST_ASSERT(net_udp_connect(&udp) == NET_STATUS_OK);
-	TEST_RECV_RETRY(err = net_udp_recv(&udp, buffer, 1514, &dataoffset, &datalen));
-	TEST_ASSERT(err == NET_STATUS_OK);
-	TEST_ASSERT(datalen == 4);
-	TEST_ASSERT(memcmp(&(buffer[dataoffset]), "test", datalen) == 0);
+	/* Packets bigger than the MTU are not sent */
+	TEST_ASSERT(net_ip6_send(&ra_ip6, buffer, 1514, dataoffset, 1400) == NET_EOVERFLOW);
 
 	return VERDICT_OK;
 }
+#endif
 
-static uint8_t test_udp_recv_badcommon()
+#ifdef NET_IP6_AUTOCONF_ENABLE
+static uint8_t test_ip6_icmpv6_ra_udp()
 {
-	int8_t retry = 0;
-	int8_t err = 0;
+	uint16_t retry = 0;
 	uint16_t dataoffset = 0;
 	uint16_t datalen = 0;
-	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(src_addr);
+	uint8_t payload[] = "test";
+	uint8_t global_addr[16] = {0x20,0x01,0x0d,0xb8,0x00,0x01,0x00,0x02,
+	                           0x12,0x22,0x33,0xff,0xfe,0x44,0x55,0x66};
+	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(global_addr);
+	/* Own contexts, for the autoconfiguration to start from scratch */
+	struct net_ip6_ctx ra_ip6 = { .lower = &TEST_IP6_LINK };
+	struct net_udp_ctx ra_udp = { .lower = &ra_ip6 };
+
+	DEBUG(__FUNCTION__);
 
 	TEST_ASSERT(net_mac_set_source_addr(&mac, src_l2addr) == NET_STATUS_OK);
 	TEST_ASSERT(net_mac_set_destination_addr(&mac, dst_l2addr) == NET_STATUS_OK);
 	TEST_ASSERT(net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_IPV6) == NET_STATUS_OK);
 	TEST_ASSERT(net_mac_set_ip6mcast(&mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes) == NET_STATUS_OK);
 
-	TEST_ASSERT(net_ip6_set_source_addr(&ip6, src_addr) == NET_STATUS_OK);
-	TEST_ASSERT(net_ip6_set_destination_addr(&ip6, dst_addr) == NET_STATUS_OK);
-	TEST_ASSERT(net_ip6_set_nexthdr(&ip6, NET_IP6_NH_UDP) == NET_STATUS_OK);
-
-	TEST_ASSERT(net_udp_set_source_port(&udp, 1234) == NET_STATUS_OK);
-	TEST_ASSERT(net_udp_set_destination_port(&udp, 5678) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_autoconf(&ra_ip6, buffer, 1514) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_destination_addr(&ra_ip6, dst_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_nexthdr(&ra_ip6, NET_IP6_NH_UDP) == NET_STATUS_OK);
+
+	/* Connected from the link-local address, before the Router Advertisement */
+	TEST_ASSERT(net_udp_set_source_port(&ra_udp, 1234) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_set_destination_port(&ra_udp, 5678) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_connect(&ra_udp) == NET_STATUS_OK);
+
+	for (retry=0; retry<TEST_RECV_TIMEOUT; retry++) {
+		net_udp_recv(&ra_udp, buffer, 1514, &dataoffset, &datalen);
+		if (ra_ip6.autoconf & NET_IP6_AUTOCONF_PREFIX) {
+			break;
+		}
+		msleep(1);
+	}
+	TEST_ASSERT(memcmp(ra_ip6.src_addr, global_addr, 16) == 0);
 
-	TEST_ASSERT(net_udp_connect(&udp) == NET_STATUS_OK);
-	TEST_RECV_RETRY(err = net_udp_recv(&udp, buffer, 1514, &dataoffset, &datalen));
-	TEST_ASSERT(err == NET_EAGAIN);
+	/* Sent from the global address, the checksum being of its pseudo-header */
+	dataoffset = net_udp_pload_pos(&ra_udp);
+	memcpy(&(buffer[dataoffset]), payload, 4);
+	TEST_ASSERT(net_udp_send(&ra_udp, buffer, 1514, dataoffset, 4) == NET_STATUS_OK);
 
 	return VERDICT_OK;
 }
+#endif
 
-static uint8_t test_udp_recv_badsrc()
-{
-	DEBUG(__FUNCTION__);
-
-	return test_udp_recv_badcommon();
-}
-
-static uint8_t test_udp_recv_baddst()
-{
-	DEBUG(__FUNCTION__);
-
-	return test_udp_recv_badcommon();
-}
-
-static uint8_t test_udp_recv_badlen()
+#ifdef NET_IP6_DAD_ENABLE
+static uint8_t test_ip6_icmpv6_dad()
 {
-	int8_t retry = 0;
-	int8_t err = 0;
+	uint16_t retry = 0;
 	uint16_t dataoffset = 0;
 	uint16_t datalen = 0;
+	uint8_t payload[] = "test";
 	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(src_addr);
+	/* Own context, for the address to be detected from scratch */
+	struct net_ip6_ctx dad_ip6 = { .lower = &TEST_IP6_LINK };
 
 	DEBUG(__FUNCTION__);
 
@@ -536,51 +661,145 @@ static uint8_t test_udp_recv_badlen()
 	TEST_ASSERT(net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_IPV6) == NET_STATUS_OK);
 	TEST_ASSERT(net_mac_set_ip6mcast(&mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes) == NET_STATUS_OK);
 
-	TEST_ASSERT(net_ip6_set_source_addr(&ip6, src_addr) == NET_STATUS_OK);
-	TEST_ASSERT(net_ip6_set_destination_addr(&ip6, dst_addr) == NET_STATUS_OK);
-	TEST_ASSERT(net_ip6_set_nexthdr(&ip6, NET_IP6_NH_UDP) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_dad(&dad_ip6, 1) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_source_addr(&dad_ip6, src_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_destination_addr(&dad_ip6, dst_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_nexthdr(&dad_ip6, 253) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_connect(&dad_ip6) == NET_STATUS_OK);
+	TEST_ASSERT(dad_ip6.dad == NET_IP6_DAD_PENDING);
 
-	TEST_ASSERT(net_udp_set_source_port(&udp, 1234) == NET_STATUS_OK);
-	TEST_ASSERT(net_udp_set_destination_port(&udp, 5678) == NET_STATUS_OK);
+	/* Solicitation and announcement, then the packet without waiting */
+	dataoffset = net_ip6_pload_pos(&dad_ip6);
+	memcpy(&(buffer[dataoffset]), payload, 4);
+	TEST_ASSERT(net_ip6_send(&dad_ip6, buffer, 1514, dataoffset, 4) == NET_STATUS_OK);
+	TEST_ASSERT(dad_ip6.dad == NET_IP6_DAD_OPTIMISTIC);
+
+	/* Address advertised by another node */
+	for (retry=0; retry<TEST_RECV_TIMEOUT; retry++) {
+		net_ip6_recv(&dad_ip6, buffer, 1514, &dataoffset, &datalen);
+		if (dad_ip6.dad == NET_IP6_DAD_DUPLICATE) {
+			break;
+		}
+		msleep(1);
+	}
+	TEST_ASSERT(dad_ip6.dad == NET_IP6_DAD_DUPLICATE);
 
-	TEST_ASSERT(net_udp_connect(&udp) == NET_STATUS_OK);
-	TEST_RECV_RETRY(err = net_udp_recv(&udp, buffer, 1514, &dataoffset, &datalen));
-	TEST_ASSERT(err == NET_EOVERFLOW);
+	/* Nothing sent from a duplicate address */
+	dataoffset = net_ip6_pload_pos(&dad_ip6);
+	memcpy(&(buffer[dataoffset]), payload, 4);
+	TEST_ASSERT(net_ip6_send(&dad_ip6, buffer, 1514, dataoffset, 4) == NET_ECONFIG);
 
 	return VERDICT_OK;
 }
+#endif
 
-static uint8_t test_udp_send_nodata()
+#ifdef NET_IP6_NC_ENABLE
+static uint8_t test_ip6_icmpv6_nud()
 {
+	uint16_t retry = 0;
+	int8_t err = 0;
 	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+	uint8_t payload[] = "test";
+	uint8_t no_l2addr[6] = {0};
+	uint8_t *peer_addr = NULL;
+	uint16_t peer_port = 0;
+	uint8_t i = 0;
 	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(src_addr);
+	/* Own contexts, for the neighbor cache to start empty */
+	struct net_ip6_ctx nud_ip6 = { .lower = &TEST_IP6_LINK };
+	struct net_udp_ctx nud_udp = { .lower = &nud_ip6 };
+	/* Single neighbor, first entry of the cache */
+	struct net_ip6_neighbor *neighbor = &(nud_ip6.neighbors[0]);
 
 	DEBUG(__FUNCTION__);
 
 	TEST_ASSERT(net_mac_set_source_addr(&mac, src_l2addr) == NET_STATUS_OK);
-	TEST_ASSERT(net_mac_set_destination_addr(&mac, dst_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_destination_addr(&mac, no_l2addr) == NET_STATUS_OK);
 	TEST_ASSERT(net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_IPV6) == NET_STATUS_OK);
 	TEST_ASSERT(net_mac_set_ip6mcast(&mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes) == NET_STATUS_OK);
 
-	TEST_ASSERT(net_ip6_set_source_addr(&ip6, src_addr) == NET_STATUS_OK);
-	TEST_ASSERT(net_ip6_set_destination_addr(&ip6, dst_addr) == NET_STATUS_OK);
-	TEST_ASSERT(net_ip6_set_nexthdr(&ip6, NET_IP6_NH_UDP) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_source_addr(&nud_ip6, src_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_destination_addr(&nud_ip6, dst_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_nexthdr(&nud_ip6, NET_IP6_NH_UDP) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_resolution(&nud_ip6, 1) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_set_source_port(&nud_udp, 1234) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_set_destination_port(&nud_udp, 5678) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_connect(&nud_udp) == NET_STATUS_OK);
+
+	/* Neighbor learnt from its announcement */
+	for (retry=0; retry<TEST_RECV_TIMEOUT; retry++) {
+		net_udp_recv(&nud_udp, buffer, 1514, &dataoffset, &datalen);
+		if (net_ip6_get_neighbor(&nud_ip6, dst_addr) != NULL) {
+			break;
+		}
+		msleep(1);
+	}
+	TEST_ASSERT(neighbor->state == NET_IP6_NC_STALE);
 
-	TEST_ASSERT(net_udp_set_source_port(&udp, 1234) == NET_STATUS_OK);
-	TEST_ASSERT(net_udp_set_destination_port(&udp, 5678) == NET_STATUS_OK);
+	/* Sent to without probe, then confirmed by the reply, not by the
+	 * datagrams of another address or port received before it */
+	dataoffset = net_udp_pload_pos(&nud_udp);
+	memcpy(&(buffer[dataoffset]), payload, 4);
+	TEST_ASSERT(net_udp_send(&nud_udp, buffer, 1514, dataoffset, 4) == NET_STATUS_OK);
+	TEST_ASSERT(neighbor->state == NET_IP6_NC_DELAY);
+	for (i=0; i<2; i++) {
+		TEST_RECV_RETRY(err = net_udp_recv_from(&nud_udp, buffer, 1514, &dataoffset, &datalen,
+		                                        &peer_addr, &peer_port));
+		TEST_ASSERT(err == NET_STATUS_OK);
+		TEST_ASSERT(neighbor->state == NET_IP6_NC_DELAY);
+	}
+	TEST_RECV_RETRY(err = net_udp_recv_from(&nud_udp, buffer, 1514, &dataoffset, &datalen,
+	                                        &peer_addr, &peer_port));
+	TEST_ASSERT(err == NET_STATUS_OK);
+	TEST_ASSERT(neighbor->state == NET_IP6_NC_REACHABLE);
 
-	TEST_ASSERT(net_udp_connect(&udp) == NET_STATUS_OK);
-	dataoffset = net_udp_pload_pos(&udp);
-	TEST_ASSERT(net_udp_send(&udp, buffer, 1514, dataoffset, 0) == NET_STATUS_OK);
+	/* Not confirmed in time: delayed, then probed along with the packet */
+	neighbor->time_us -= NET_IP6_REACHABLE_TIME_US;
+	dataoffset = net_udp_pload_pos(&nud_udp);
+	memcpy(&(buffer[dataoffset]), payload, 4);
+	TEST_ASSERT(net_udp_send(&nud_udp, buffer, 1514, dataoffset, 4) == NET_STATUS_OK);
+	TEST_ASSERT(neighbor->state == NET_IP6_NC_DELAY);
+
+	neighbor->time_us -= NET_IP6_DELAY_FIRST_PROBE_US;
+	dataoffset = net_udp_pload_pos(&nud_udp);
+	memcpy(&(buffer[dataoffset]), payload, 4);
+	TEST_ASSERT(net_udp_send(&nud_udp, buffer, 1514, dataoffset, 4) == NET_STATUS_OK);
+	TEST_ASSERT((neighbor->state == NET_IP6_NC_PROBE) && (neighbor->solicits == 1));
+
+	/* Reachable again once the probe is answered */
+	for (retry=0; retry<TEST_RECV_TIMEOUT; retry++) {
+		net_udp_recv(&nud_udp, buffer, 1514, &dataoffset, &datalen);
+		if (neighbor->state == NET_IP6_NC_REACHABLE) {
+			break;
+		}
+		msleep(1);
+	}
+	TEST_ASSERT(neighbor->state == NET_IP6_NC_REACHABLE);
 
 	return VERDICT_OK;
 }
+#endif
 
-static uint8_t test_udp_send_data()
+
+static uint8_t test_ip6_icmpv6_echo()
+{
+	DEBUG(__FUNCTION__);
+
+	/* Echo Requests are answered while receiving, like solicitations */
+	return test_ip6_icmpv6_nsna_recv_common();
+}
+
+#ifdef NET_IP6_RATELIMIT_ENABLE
+static uint8_t test_ip6_icmpv6_ratelimit()
 {
+	uint16_t retry = 0;
+	int8_t err = 0;
 	uint16_t dataoffset = 0;
-	uint8_t payload[] = "test";
+	uint16_t datalen = 0;
 	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(src_addr);
+	/* Own context, for the bucket to start full */
+	struct net_ip6_ctx rl_ip6 = { .lower = &TEST_IP6_LINK };
 
 	DEBUG(__FUNCTION__);
 
@@ -589,178 +808,948 @@ static uint8_t test_udp_send_data()
 	TEST_ASSERT(net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_IPV6) == NET_STATUS_OK);
 	TEST_ASSERT(net_mac_set_ip6mcast(&mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes) == NET_STATUS_OK);
 
-	TEST_ASSERT(net_ip6_set_source_addr(&ip6, src_addr) == NET_STATUS_OK);
-	TEST_ASSERT(net_ip6_set_destination_addr(&ip6, dst_addr) == NET_STATUS_OK);
-	TEST_ASSERT(net_ip6_set_nexthdr(&ip6, NET_IP6_NH_UDP) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_source_addr(&rl_ip6, src_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_destination_addr(&rl_ip6, dst_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_nexthdr(&rl_ip6, 253) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_connect(&rl_ip6) == NET_STATUS_OK);
 
-	TEST_ASSERT(net_udp_set_source_port(&udp, 1234) == NET_STATUS_OK);
-	TEST_ASSERT(net_udp_set_destination_port(&udp, 5678) == NET_STATUS_OK);
+	/* Solicitations answered up to the burst, between the recv calls */
+	TEST_RECV_RETRY(err = test_ip6_recv_service(&rl_ip6, buffer, 1514, &dataoffset, &datalen));
+	TEST_ASSERT(err == NET_EAGAIN);
+	TEST_ASSERT(net_ip6_service(&rl_ip6, buffer, 1514) == NET_EAGAIN);
+#ifdef NET_STATS_ENABLE
+	TEST_ASSERT(rl_ip6.stats.drops[NET_STATS_DROP_RATE] == 2);
+#endif
 
-	TEST_ASSERT(net_udp_connect(&udp) == NET_STATUS_OK);
-	dataoffset = net_udp_pload_pos(&udp);
-	memcpy(&(buffer[dataoffset]), payload, 4);
-	TEST_ASSERT(net_udp_send(&udp, buffer, 1514, dataoffset, 4) == NET_STATUS_OK);
+	return VERDICT_OK;
+}
+#endif
+
+/* Over the link directly, whatever the lower layer of the IPv6 context */
+static uint8_t site_prefix[8] = {0x20,0x01,0x00,0x01,0x00,0x02,0x00,0x03};
+
+static uint8_t test_lowpan_setup()
+{
+	TEST_ASSERT(net_lowpan_set_source_addr(&lowpan, src_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_lowpan_set_destination_addr(&lowpan, dst_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_lowpan_set_context(&lowpan, site_prefix) == NET_STATUS_OK);
 
 	return VERDICT_OK;
 }
 
-static uint8_t test_coap_noncf_send_nodata()
+/* Datagram as built by the IPv6 and UDP layers, of a checksum left as is */
+static uint16_t test_lowpan_build(uint8_t *src, uint8_t *dst, uint8_t nh, uint8_t hlim,
+                                  uint16_t sport, uint16_t dport)
 {
-	uint16_t dataoffset = 0;
-	uint8_t token[] = {0x12};
-	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(src_addr);
+	uint16_t plen = (nh == NET_IP6_NH_UDP) ? 12 : 4;
+	uint8_t *pos = buffer;
+
+	memset(buffer, 0, 40);
+	buffer[0] = 0x60;
+	buffer[4] = plen >> 8;
+	buffer[5] = plen & 0xFF;
+	buffer[6] = nh;
+	buffer[7] = hlim;
+	memcpy(&(buffer[8]), src, 16);
+	memcpy(&(buffer[24]), dst, 16);
+	pos += 40;
+
+	if (nh == NET_IP6_NH_UDP) {
+		pos[0] = sport >> 8;
+		pos[1] = sport & 0xFF;
+		pos[2] = dport >> 8;
+		pos[3] = dport & 0xFF;
+		pos[4] = plen >> 8;
+		pos[5] = plen & 0xFF;
+		pos[6] = 0x12;
+		pos[7] = 0x34;
+		pos += 8;
+	}
+	memcpy(pos, "test", 4);
 
-	DEBUG(__FUNCTION__);
+	return 40 + plen;
+}
 
-	TEST_ASSERT(net_mac_set_source_addr(&mac, src_l2addr) == NET_STATUS_OK);
-	TEST_ASSERT(net_mac_set_destination_addr(&mac, dst_l2addr) == NET_STATUS_OK);
-	TEST_ASSERT(net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_IPV6) == NET_STATUS_OK);
-	TEST_ASSERT(net_mac_set_ip6mcast(&mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes) == NET_STATUS_OK);
+static uint8_t test_lowpan_send_udp()
+{
+	uint8_t src_eui64[16] = {0x20,0x01,0x00,0x01,0x00,0x02,0x00,0x03,
+	                         0x12,0x22,0x33,0xff,0xfe,0x44,0x55,0x66};
+	uint8_t dst_eui64[16] = {0x20,0x01,0x00,0x01,0x00,0x02,0x00,0x03,
+	                         0x74,0x88,0x99,0xff,0xfe,0xaa,0xbb,0xcc};
+	uint16_t datalen = 0;
 
-	TEST_ASSERT(net_ip6_set_source_addr(&ip6, src_addr) == NET_STATUS_OK);
-	TEST_ASSERT(net_ip6_set_destination_addr(&ip6, dst_addr) == NET_STATUS_OK);
-	TEST_ASSERT(net_ip6_set_nexthdr(&ip6, NET_IP6_NH_UDP) == NET_STATUS_OK);
+	DEBUG(__FUNCTION__);
 
-	TEST_ASSERT(net_udp_set_source_port(&udp, 1234) == NET_STATUS_OK);
-	TEST_ASSERT(net_udp_set_destination_port(&udp, 5683) == NET_STATUS_OK);
+	TEST_ASSERT(test_lowpan_setup() == VERDICT_OK);
 
-	TEST_ASSERT(net_coap_connect(&coap) == NET_STATUS_OK);
-	TEST_ASSERT(net_coap_set_method(&coap, NET_COAP_TYPE_NONCONFIRMABLE, NET_COAP_CODE_POST) == NET_STATUS_OK);
-	TEST_ASSERT(net_coap_set_token(&coap, 1, token) == NET_STATUS_OK);
-	dataoffset = net_coap_pload_pos(&coap);
-	TEST_ASSERT(net_coap_send(&coap, buffer, 1514, dataoffset, 0) == NET_STATUS_OK);
+	/* Of 9 bytes of headers */
+	datalen = test_lowpan_build(src_eui64, dst_eui64, NET_IP6_NH_UDP, 255, 1234, 5683);
+	TEST_ASSERT(net_lowpan_send(&lowpan, buffer, 1514, net_lowpan_pload_pos(&lowpan),
+	                            datalen) == NET_STATUS_OK);
 
 	return VERDICT_OK;
 }
 
-static uint8_t test_coap_noncf_send_data()
+static uint8_t test_lowpan_send_inline()
 {
-	uint16_t dataoffset = 0;
-	uint8_t token[] = {0x34};
-	char * const uriquery[] = { "stub=stub" };
-	uint8_t payload[] = "test";
-	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(src_addr);
+	uint16_t datalen = 0;
 
 	DEBUG(__FUNCTION__);
 
-	TEST_ASSERT(net_mac_set_source_addr(&mac, src_l2addr) == NET_STATUS_OK);
-	TEST_ASSERT(net_mac_set_destination_addr(&mac, dst_l2addr) == NET_STATUS_OK);
-	TEST_ASSERT(net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_IPV6) == NET_STATUS_OK);
-	TEST_ASSERT(net_mac_set_ip6mcast(&mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes) == NET_STATUS_OK);
+	TEST_ASSERT(test_lowpan_setup() == VERDICT_OK);
 
-	TEST_ASSERT(net_ip6_set_source_addr(&ip6, src_addr) == NET_STATUS_OK);
-	TEST_ASSERT(net_ip6_set_destination_addr(&ip6, dst_addr) == NET_STATUS_OK);
-	TEST_ASSERT(net_ip6_set_nexthdr(&ip6, NET_IP6_NH_UDP) == NET_STATUS_OK);
+	/* Interface identifiers other than EUI-64, ports of 4 bits */
+	datalen = test_lowpan_build(src_addr, dst_addr, NET_IP6_NH_UDP, 64, 0xF0B1, 0xF0B2);
+	TEST_ASSERT(net_lowpan_send(&lowpan, buffer, 1514, 0, datalen) == NET_STATUS_OK);
 
-	TEST_ASSERT(net_udp_set_source_port(&udp, 1234) == NET_STATUS_OK);
-	TEST_ASSERT(net_udp_set_destination_port(&udp, 5683) == NET_STATUS_OK);
+	return VERDICT_OK;
+}
 
-	TEST_ASSERT(net_coap_connect(&coap) == NET_STATUS_OK);
-	TEST_ASSERT(net_coap_set_method(&coap, NET_COAP_TYPE_NONCONFIRMABLE, NET_COAP_CODE_POST) == NET_STATUS_OK);
-	TEST_ASSERT(net_coap_set_token(&coap, 1, token) == NET_STATUS_OK);
-	TEST_ASSERT(net_coap_set_uriquery(&coap, 1, uriquery) == NET_STATUS_OK);
-	dataoffset = net_coap_pload_pos(&coap);
-	memcpy(&(buffer[dataoffset]), payload, 4);
-	TEST_ASSERT(net_coap_send(&coap, buffer, 1514, dataoffset, 4) == NET_STATUS_OK);
+static uint8_t test_lowpan_send_mcast()
+{
+	uint8_t src_ll[16] = {0xfe,0x80,0x00,0x00,0x00,0x00,0x00,0x00,
+	                      0x12,0x22,0x33,0xff,0xfe,0x44,0x55,0x66};
+	uint8_t allnodes[16] = {0xff,0x02,0x00,0x00,0x00,0x00,0x00,0x00,
+	                        0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01};
+	uint16_t datalen = 0;
+
+	DEBUG(__FUNCTION__);
+
+	TEST_ASSERT(test_lowpan_setup() == VERDICT_OK);
+
+	/* Link-local, without context, and next header inline */
+	TEST_ASSERT(net_lowpan_set_context(&lowpan, NULL) == NET_STATUS_OK);
+	datalen = test_lowpan_build(src_ll, allnodes, NET_IP6_NH_ICMPV6, 255, 0, 0);
+	TEST_ASSERT(net_lowpan_send(&lowpan, buffer, 1514, 0, datalen) == NET_STATUS_OK);
+	TEST_ASSERT(net_lowpan_set_context(&lowpan, site_prefix) == NET_STATUS_OK);
 
 	return VERDICT_OK;
 }
 
-static uint8_t test_coap_noncf_send_data_resp()
+static uint8_t test_lowpan_recv_udp()
 {
-	int8_t retry = 0;
+	uint16_t retry = 0;
 	int8_t err = 0;
 	uint16_t dataoffset = 0;
 	uint16_t datalen = 0;
-	uint8_t token[] = {0x56};
-	char * const uriquery[] = { "stub=stub" };
-	uint8_t payload[] = "test";
-	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(src_addr);
+	uint8_t expected[52] = {0x60,0x00,0x00,0x00,0x00,0x0c,0x11,0xff,
+	                        0x20,0x01,0x00,0x01,0x00,0x02,0x00,0x03,
+	                        0x74,0x88,0x99,0xff,0xfe,0xaa,0xbb,0xcc,
+	                        0x20,0x01,0x00,0x01,0x00,0x02,0x00,0x03,
+	                        0x12,0x22,0x33,0xff,0xfe,0x44,0x55,0x66,
+	                        0x16,0x33,0x04,0xd2,0x00,0x0c,0x56,0x78,
+	                        't','e','s','t'};
 
 	DEBUG(__FUNCTION__);
 
-	TEST_ASSERT(net_mac_set_source_addr(&mac, src_l2addr) == NET_STATUS_OK);
-	TEST_ASSERT(net_mac_set_destination_addr(&mac, dst_l2addr) == NET_STATUS_OK);
-	TEST_ASSERT(net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_IPV6) == NET_STATUS_OK);
-	TEST_ASSERT(net_mac_set_ip6mcast(&mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes) == NET_STATUS_OK);
+	TEST_ASSERT(test_lowpan_setup() == VERDICT_OK);
 
-	TEST_ASSERT(net_ip6_set_source_addr(&ip6, src_addr) == NET_STATUS_OK);
-	TEST_ASSERT(net_ip6_set_destination_addr(&ip6, dst_addr) == NET_STATUS_OK);
-	TEST_ASSERT(net_ip6_set_nexthdr(&ip6, NET_IP6_NH_UDP) == NET_STATUS_OK);
+	TEST_RECV_RETRY(err = net_lowpan_recv(&lowpan, buffer, 1514, &dataoffset, &datalen));
+	TEST_ASSERT(err == NET_STATUS_OK);
+	TEST_ASSERT((dataoffset == 0) && (datalen == 52));
+	TEST_ASSERT(memcmp(buffer, expected, 52) == 0);
 
-	TEST_ASSERT(net_udp_set_source_port(&udp, 1234) == NET_STATUS_OK);
-	TEST_ASSERT(net_udp_set_destination_port(&udp, 5683) == NET_STATUS_OK);
+	return VERDICT_OK;
+}
 
-	TEST_ASSERT(net_coap_connect(&coap) == NET_STATUS_OK);
-	TEST_ASSERT(net_coap_set_method(&coap, NET_COAP_TYPE_NONCONFIRMABLE, NET_COAP_CODE_POST) == NET_STATUS_OK);
-	TEST_ASSERT(net_coap_set_token(&coap, 1, token) == NET_STATUS_OK);
-	TEST_ASSERT(net_coap_set_uriquery(&coap, 1, uriquery) == NET_STATUS_OK);
+static uint8_t test_lowpan_recv_inline()
+{
+	uint16_t retry = 0;
+	int8_t err = 0;
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+	uint8_t expected[50] = {0x60,0x21,0x23,0x45,0x00,0x0a,0x11,0x20,
+	                        0xfe,0x80,0x00,0x00,0x00,0x00,0x00,0x00,
+	                        0x00,0x00,0x00,0xff,0xfe,0x00,0x12,0x34,
+	                        0xff,0x05,0x00,0x00,0x00,0x00,0x00,0x00,
+	                        0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x03,
+	                        0x16,0x33,0xf0,0xb1,0x00,0x0a,0x9a,0xbc,
+	                        'o','k'};
 
-	dataoffset = net_coap_pload_pos(&coap);
-	memcpy(&(buffer[dataoffset]), payload, 4);
-	TEST_ASSERT(net_coap_send(&coap, buffer, 1514, dataoffset, 4) == NET_STATUS_OK);
+	DEBUG(__FUNCTION__);
 
-	TEST_RECV_RETRY(err = net_coap_recv(&coap, buffer, 1514, &dataoffset, &datalen));
+	TEST_ASSERT(test_lowpan_setup() == VERDICT_OK);
+
+	/* Flow label, hop limit, short addresses and ports */
+	TEST_RECV_RETRY(err = net_lowpan_recv(&lowpan, buffer, 1514, &dataoffset, &datalen));
 	TEST_ASSERT(err == NET_STATUS_OK);
-	TEST_ASSERT(net_coap_get_responsecode(&coap) == NET_COAP_CODE_CREATED);
+	TEST_ASSERT((dataoffset == 0) && (datalen == 50));
+	TEST_ASSERT(memcmp(buffer, expected, 50) == 0);
 
 	return VERDICT_OK;
 }
 
-static uint8_t test_coap_cf_send_nodata()
+static uint8_t test_lowpan_recv_bad()
 {
-	int8_t retry = 0;
+	uint16_t retry = 0;
 	int8_t err = 0;
 	uint16_t dataoffset = 0;
 	uint16_t datalen = 0;
-	uint8_t token[] = {0x78};
-	uint8_t payload[] = "test";
-	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(src_addr);
+	/* Own context, for its counters */
+	struct net_lowpan_ctx bad_lowpan = { .lower = &hw };
 
 	DEBUG(__FUNCTION__);
 
-	TEST_ASSERT(net_mac_set_source_addr(&mac, src_l2addr) == NET_STATUS_OK);
-	TEST_ASSERT(net_mac_set_destination_addr(&mac, dst_l2addr) == NET_STATUS_OK);
-	TEST_ASSERT(net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_IPV6) == NET_STATUS_OK);
-	TEST_ASSERT(net_mac_set_ip6mcast(&mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes) == NET_STATUS_OK);
-
-	TEST_ASSERT(net_ip6_set_source_addr(&ip6, src_addr) == NET_STATUS_OK);
-	TEST_ASSERT(net_ip6_set_destination_addr(&ip6, dst_addr) == NET_STATUS_OK);
-	TEST_ASSERT(net_ip6_set_nexthdr(&ip6, NET_IP6_NH_UDP) == NET_STATUS_OK);
-
-	TEST_ASSERT(net_udp_set_source_port(&udp, 1234) == NET_STATUS_OK);
-	TEST_ASSERT(net_udp_set_destination_port(&udp, 5683) == NET_STATUS_OK);
-
-	TEST_ASSERT(net_coap_connect(&coap) == NET_STATUS_OK);
-	TEST_ASSERT(net_coap_set_method(&coap, NET_COAP_TYPE_CONFIRMABLE, NET_COAP_CODE_POST) == NET_STATUS_OK);
-	TEST_ASSERT(net_coap_set_token(&coap, 1, token) == NET_STATUS_OK);
+	TEST_ASSERT(net_lowpan_set_source_addr(&bad_lowpan, src_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_lowpan_set_destination_addr(&bad_lowpan, dst_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_lowpan_set_context(&bad_lowpan, site_prefix) == NET_STATUS_OK);
 
-	dataoffset = net_coap_pload_pos(&coap);
-	TEST_ASSERT(net_coap_send(&coap, buffer, 1514, dataoffset, 0) == NET_STATUS_OK);
+	/* Other dispatch, then truncated addresses */
+	TEST_RECV_RETRY(err = net_lowpan_recv(&bad_lowpan, buffer, 1514, &dataoffset, &datalen));
+	TEST_ASSERT((err == NET_EPROTO) && (datalen == 0));
+	TEST_RECV_RETRY(err = net_lowpan_recv(&bad_lowpan, buffer, 1514, &dataoffset, &datalen));
+	TEST_ASSERT((err == NET_EOVERFLOW) && (datalen == 0));
 
-	TEST_RECV_RETRY(err = net_coap_recv(&coap, buffer, 1514, &dataoffset, &datalen));
-	TEST_ASSERT(err == NET_COAP_STATUS_ACK);
+	/* Other context dropped, then an uncompressed header */
+	TEST_RECV_RETRY(err = net_lowpan_recv(&bad_lowpan, buffer, 1514, &dataoffset, &datalen));
+	TEST_ASSERT(err == NET_STATUS_OK);
+	TEST_ASSERT((dataoffset == 0) && (datalen == 40));
+	TEST_ASSERT((buffer[0] == 0x60) && (buffer[6] == 59));
+	TEST_ASSERT(memcmp(&(buffer[8]), dst_addr, 16) == 0);
+	TEST_ASSERT(memcmp(&(buffer[24]), src_addr, 16) == 0);
+#ifdef NET_STATS_ENABLE
+	TEST_ASSERT(bad_lowpan.stats.drops[NET_STATS_DROP_PROTO] == 1);
+	TEST_ASSERT(bad_lowpan.stats.drops[NET_STATS_DROP_LEN] == 1);
+	TEST_ASSERT(bad_lowpan.stats.drops[NET_STATS_DROP_UNSUPP] == 1);
+	TEST_ASSERT(bad_lowpan.stats.rx_frames == 1);
+#endif
 
 	return VERDICT_OK;
 }
 
-static uint8_t test_coap_cf_send_data()
+#ifdef NET_LOWPAN_ENABLE
+/* Through the IPv6 and UDP contexts, the lowpan context being their link */
+static uint8_t test_lowpan_udp()
 {
-	int8_t retry = 0;
+	uint16_t retry = 0;
 	int8_t err = 0;
 	uint16_t dataoffset = 0;
 	uint16_t datalen = 0;
-	uint8_t token[] = {0x9a};
-	char * const uriquery[] = { "stub=stub" };
 	uint8_t payload[] = "test";
-	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(src_addr);
 
 	DEBUG(__FUNCTION__);
 
-	TEST_ASSERT(net_mac_set_source_addr(&mac, src_l2addr) == NET_STATUS_OK);
-	TEST_ASSERT(net_mac_set_destination_addr(&mac, dst_l2addr) == NET_STATUS_OK);
-	TEST_ASSERT(net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_IPV6) == NET_STATUS_OK);
-	TEST_ASSERT(net_mac_set_ip6mcast(&mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes) == NET_STATUS_OK);
+	TEST_ASSERT(test_lowpan_setup() == VERDICT_OK);
+
+	TEST_ASSERT(net_ip6_set_source_addr(&ip6, src_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_destination_addr(&ip6, dst_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_nexthdr(&ip6, NET_IP6_NH_UDP) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_udp_set_source_port(&udp, 1234) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_set_destination_port(&udp, 5678) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_connect(&udp) == NET_STATUS_OK);
+
+	dataoffset = net_udp_pload_pos(&udp);
+	memcpy(&(buffer[dataoffset]), payload, 4);
+	TEST_ASSERT(net_udp_send(&udp, buffer, 1514, dataoffset, 4) == NET_STATUS_OK);
+
+	TEST_RECV_RETRY(err = net_udp_recv(&udp, buffer, 1514, &dataoffset, &datalen));
+	TEST_ASSERT(err == NET_STATUS_OK);
+	TEST_ASSERT((datalen == 2) && (memcmp(&(buffer[dataoffset]), "ok", 2) == 0));
+
+	return VERDICT_OK;
+}
+
+static uint8_t test_lowpan_echo()
+{
+	uint16_t retry = 0;
+	int8_t err = 0;
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+
+	DEBUG(__FUNCTION__);
+
+	TEST_ASSERT(test_lowpan_setup() == VERDICT_OK);
+
+	TEST_ASSERT(net_ip6_set_source_addr(&ip6, src_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_destination_addr(&ip6, dst_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_nexthdr(&ip6, 253) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_connect(&ip6) == NET_STATUS_OK);
+
+	/* Echo Requests are answered while receiving */
+	TEST_RECV_RETRY(err = test_ip6_recv_service(&ip6, buffer, 1514, &dataoffset, &datalen));
+	TEST_ASSERT(err == NET_EAGAIN);
+
+	return VERDICT_OK;
+}
+#endif
+
+/* Headers sent for each mode of the IPHC and UDP NHC fields, see test_lowpan_modes() */
+struct test_lowpan_mode {
+	uint8_t src[16];
+	uint8_t dst[16];
+	uint8_t vtcflow[4];          /* Version, traffic class and flow label */
+	uint8_t nh;
+	uint8_t hlim;
+	uint16_t sport;
+	uint16_t dport;
+};
+
+static const struct test_lowpan_mode test_lowpan_modes_list[] = {
+	/* EUI-64 link-local addresses, nothing inline */
+	{ {0xfe,0x80,0,0,0,0,0,0,0x12,0x22,0x33,0xff,0xfe,0x44,0x55,0x66},
+	  {0xfe,0x80,0,0,0,0,0,0,0x74,0x88,0x99,0xff,0xfe,0xaa,0xbb,0xcc},
+	  {0x60,0x00,0x00,0x00}, NET_IP6_NH_UDP, 255, 1234, 5683 },
+	/* EUI-64 addresses of the context, traffic class only, destination port of 8 bits */
+	{ {0x20,0x01,0,0x01,0,0x02,0,0x03,0x12,0x22,0x33,0xff,0xfe,0x44,0x55,0x66},
+	  {0x20,0x01,0,0x01,0,0x02,0,0x03,0x74,0x88,0x99,0xff,0xfe,0xaa,0xbb,0xcc},
+	  {0x6b,0x80,0x00,0x00}, NET_IP6_NH_UDP, 64, 1234, 0xF012 },
+	/* Short link-local addresses, ECN and flow label, source port of 8 bits */
+	{ {0xfe,0x80,0,0,0,0,0,0,0,0,0,0xff,0xfe,0,0x12,0x34},
+	  {0xfe,0x80,0,0,0,0,0,0,0,0,0,0xff,0xfe,0,0x56,0x78},
+	  {0x60,0x11,0x23,0x45}, NET_IP6_NH_UDP, 1, 0xF012, 5683 },
+	/* Short addresses of the context, everything inline, ports of 4 bits */
+	{ {0x20,0x01,0,0x01,0,0x02,0,0x03,0,0,0,0xff,0xfe,0,0x12,0x34},
+	  {0x20,0x01,0,0x01,0,0x02,0,0x03,0,0,0,0xff,0xfe,0,0x56,0x78},
+	  {0x6b,0x91,0x23,0x45}, NET_IP6_NH_UDP, 32, 0xF0B1, 0xF0B2 },
+	/* Link-local addresses of 64 bits, next header inline */
+	{ {0xfe,0x80,0,0,0,0,0,0,0,0x0a,0,0x0b,0,0x0c,0,0x0d},
+	  {0xfe,0x80,0,0,0,0,0,0,0,0x0f,0,0x0e,0,0x0d,0,0x0c},
+	  {0x60,0x00,0x00,0x00}, NET_IP6_NH_ICMPV6, 255, 0, 0 },
+	/* Addresses of 64 bits of the context */
+	{ {0x20,0x01,0,0x01,0,0x02,0,0x03,0,0x0f,0,0x0e,0,0x0d,0,0x0c},
+	  {0x20,0x01,0,0x01,0,0x02,0,0x03,0,0x0a,0,0x0b,0,0x0c,0,0x0d},
+	  {0x60,0x00,0x00,0x00}, NET_IP6_NH_UDP, 64, 1234, 5683 },
+	/* Full addresses inline */
+	{ {0x20,0x01,0x0d,0xb8,0,0,0,0,0,0,0,0,0,0,0,0x01},
+	  {0x20,0x01,0x0d,0xb8,0,0,0,0,0,0,0,0,0,0,0,0x02},
+	  {0x60,0x00,0x00,0x00}, NET_IP6_NH_UDP, 64, 1234, 5683 },
+	/* Unspecified source, to all nodes (multicast of 8 bits) */
+	{ {0},
+	  {0xff,0x02,0,0,0,0,0,0,0,0,0,0,0,0,0,0x01},
+	  {0x60,0x00,0x00,0x00}, NET_IP6_NH_ICMPV6, 255, 0, 0 },
+	/* Multicast of 32 bits, of 48 bits, then inline */
+	{ {0xfe,0x80,0,0,0,0,0,0,0x12,0x22,0x33,0xff,0xfe,0x44,0x55,0x66},
+	  {0xff,0x05,0,0,0,0,0,0,0,0,0,0,0,0x01,0,0x03},
+	  {0x60,0x00,0x00,0x00}, NET_IP6_NH_UDP, 255, 0xF0B1, 0xF0B2 },
+	{ {0xfe,0x80,0,0,0,0,0,0,0x12,0x22,0x33,0xff,0xfe,0x44,0x55,0x66},
+	  {0xff,0x05,0,0,0,0,0,0,0,0,0,0x12,0x34,0x56,0x78,0x9a},
+	  {0x60,0x00,0x00,0x00}, NET_IP6_NH_UDP, 255, 1234, 5683 },
+	{ {0xfe,0x80,0,0,0,0,0,0,0x12,0x22,0x33,0xff,0xfe,0x44,0x55,0x66},
+	  {0xff,0x05,0,0x01,0,0,0,0,0,0,0,0,0,0,0,0x01},
+	  {0x60,0x00,0x00,0x00}, NET_IP6_NH_UDP, 255, 1234, 5683 },
+};
+
+/**
+ * Round trips of each mode: the frames sent are sent back as is by the peer,
+ * then decompressed as by the peer, into the headers sent.
+ */
+static uint8_t test_lowpan_modes()
+{
+	uint16_t retry = 0;
+	int8_t err = 0;
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+	uint16_t sentlen = 0;
+	uint8_t sent[52];
+	const struct test_lowpan_mode *mode;
+	uint8_t i;
+	/* Own context, of the addresses of the peer */
+	struct net_lowpan_ctx rt_lowpan = { .lower = &hw };
+
+	DEBUG(__FUNCTION__);
+
+	TEST_ASSERT(test_lowpan_setup() == VERDICT_OK);
+	TEST_ASSERT(net_lowpan_set_source_addr(&rt_lowpan, dst_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_lowpan_set_destination_addr(&rt_lowpan, src_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_lowpan_set_context(&rt_lowpan, site_prefix) == NET_STATUS_OK);
+
+	for (i=0; i<sizeof(test_lowpan_modes_list)/sizeof(test_lowpan_modes_list[0]); i++) {
+		mode = &(test_lowpan_modes_list[i]);
+		sentlen = test_lowpan_build((uint8_t *) mode->src, (uint8_t *) mode->dst, mode->nh,
+		                            mode->hlim, mode->sport, mode->dport);
+		memcpy(buffer, mode->vtcflow, 4);
+		memcpy(sent, buffer, sentlen);
+		TEST_ASSERT(net_lowpan_send(&lowpan, buffer, 1514, 0, sentlen) == NET_STATUS_OK);
+
+		TEST_RECV_RETRY(err = net_lowpan_recv(&rt_lowpan, buffer, 1514, &dataoffset, &datalen));
+		TEST_ASSERT(err == NET_STATUS_OK);
+		TEST_ASSERT((dataoffset == 0) && (datalen == sentlen));
+		TEST_ASSERT(memcmp(buffer, sent, sentlen) == 0);
+	}
+
+	return VERDICT_OK;
+}
+
+static uint8_t test_lowpan_recv_unsupp()
+{
+	uint16_t retry = 0;
+	int8_t err = 0;
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+	uint8_t expected[52] = {0x60,0x00,0x00,0x00,0x00,0x0c,0x11,0xff,
+	                        0xfe,0x80,0x00,0x00,0x00,0x00,0x00,0x00,
+	                        0x74,0x88,0x99,0xff,0xfe,0xaa,0xbb,0xcc,
+	                        0xfe,0x80,0x00,0x00,0x00,0x00,0x00,0x00,
+	                        0x12,0x22,0x33,0xff,0xfe,0x44,0x55,0x66,
+	                        0x16,0x33,0x04,0xd2,0x00,0x0c,0x56,0x78,
+	                        't','e','s','t'};
+	/* Own context, for its counters, of no prefix for the context 0 */
+	struct net_lowpan_ctx unsupp_lowpan = { .lower = &hw };
+
+	DEBUG(__FUNCTION__);
+
+	TEST_ASSERT(net_lowpan_set_source_addr(&unsupp_lowpan, src_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_lowpan_set_destination_addr(&unsupp_lowpan, dst_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_lowpan_set_context(&unsupp_lowpan, NULL) == NET_STATUS_OK);
+
+	/* Contexts 0 and 1 unknown, then the UDP checksum elided, all dropped before the last frame */
+	TEST_RECV_RETRY(err = net_lowpan_recv(&unsupp_lowpan, buffer, 1514, &dataoffset, &datalen));
+	TEST_ASSERT(err == NET_STATUS_OK);
+	TEST_ASSERT((dataoffset == 0) && (datalen == 52));
+	TEST_ASSERT(memcmp(buffer, expected, 52) == 0);
+#ifdef NET_STATS_ENABLE
+	TEST_ASSERT(unsupp_lowpan.stats.drops[NET_STATS_DROP_UNSUPP] == 3);
+	TEST_ASSERT(unsupp_lowpan.stats.rx_frames == 1);
+#endif
+
+	return VERDICT_OK;
+}
+
+static uint8_t test_udp_recv_nodata()
+{
+	uint16_t retry = 0;
+	int8_t err = 0;
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(src_addr);
+
+	DEBUG(__FUNCTION__);
+
+	TEST_ASSERT(net_ip6_set_source_addr(&ip6, src_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_destination_addr(&ip6, dst_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_nexthdr(&ip6, NET_IP6_NH_UDP) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_set_source_port(&udp, 1234) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_set_destination_port(&udp, 5678) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_connect(&udp) == NET_STATUS_OK);
+	TEST_RECV_RETRY(err = net_udp_recv(&udp, buffer, 1514, &dataoffset, &datalen));
+	TEST_ASSERT(err == NET_STATUS_OK);
+	TEST_ASSERT(datalen == 0);
+
+	return VERDICT_OK;
+}
+
+static uint8_t test_udp_recv_data()
+{
+	uint16_t retry = 0;
+	int8_t err = 0;
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(src_addr);
+
+	DEBUG(__FUNCTION__);
+
+	TEST_ASSERT(net_mac_set_source_addr(&mac, src_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_destination_addr(&mac, dst_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_IPV6) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ip6mcast(&mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_ip6_set_source_addr(&ip6, src_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_destination_addr(&ip6, dst_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_nexthdr(&ip6, NET_IP6_NH_UDP) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_udp_set_source_port(&udp, 1234) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_set_destination_port(&udp, 5678) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_udp_connect(&udp) == NET_STATUS_OK);
+	TEST_RECV_RETRY(err = net_udp_recv(&udp, buffer, 1514, &dataoffset, &datalen));
+	TEST_ASSERT(err == NET_STATUS_OK);
+	TEST_ASSERT(datalen == 4);
+	TEST_ASSERT(memcmp(&(buffer[dataoffset]), "test", datalen) == 0);
+
+	return VERDICT_OK;
+}
+
+static uint8_t test_udp_recv_badcommon()
+{
+	uint16_t retry = 0;
+	int8_t err = 0;
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(src_addr);
+
+	TEST_ASSERT(net_mac_set_source_addr(&mac, src_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_destination_addr(&mac, dst_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_IPV6) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ip6mcast(&mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_ip6_set_source_addr(&ip6, src_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_destination_addr(&ip6, dst_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_nexthdr(&ip6, NET_IP6_NH_UDP) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_udp_set_source_port(&udp, 1234) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_set_destination_port(&udp, 5678) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_udp_connect(&udp) == NET_STATUS_OK);
+	TEST_RECV_RETRY(err = net_udp_recv(&udp, buffer, 1514, &dataoffset, &datalen));
+	TEST_ASSERT(err == NET_EAGAIN);
+
+	return VERDICT_OK;
+}
+
+static uint8_t test_udp_recv_badsrc()
+{
+	DEBUG(__FUNCTION__);
+
+	return test_udp_recv_badcommon();
+}
+
+static uint8_t test_udp_recv_baddst()
+{
+	DEBUG(__FUNCTION__);
+
+	return test_udp_recv_badcommon();
+}
+
+static uint8_t test_udp_recv_badlen()
+{
+	uint16_t retry = 0;
+	int8_t err = 0;
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(src_addr);
+
+	DEBUG(__FUNCTION__);
+
+	TEST_ASSERT(net_mac_set_source_addr(&mac, src_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_destination_addr(&mac, dst_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_IPV6) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ip6mcast(&mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_ip6_set_source_addr(&ip6, src_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_destination_addr(&ip6, dst_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_nexthdr(&ip6, NET_IP6_NH_UDP) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_udp_set_source_port(&udp, 1234) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_set_destination_port(&udp, 5678) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_udp_connect(&udp) == NET_STATUS_OK);
+	TEST_RECV_RETRY(err = net_udp_recv(&udp, buffer, 1514, &dataoffset, &datalen));
+	TEST_ASSERT(err == NET_EOVERFLOW);
+
+	return VERDICT_OK;
+}
+
+static uint8_t test_udp_send_nodata()
+{
+	uint16_t dataoffset = 0;
+	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(src_addr);
+
+	DEBUG(__FUNCTION__);
+
+	TEST_ASSERT(net_mac_set_source_addr(&mac, src_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_destination_addr(&mac, dst_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_IPV6) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ip6mcast(&mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_ip6_set_source_addr(&ip6, src_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_destination_addr(&ip6, dst_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_nexthdr(&ip6, NET_IP6_NH_UDP) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_udp_set_source_port(&udp, 1234) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_set_destination_port(&udp, 5678) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_udp_connect(&udp) == NET_STATUS_OK);
+	dataoffset = net_udp_pload_pos(&udp);
+	TEST_ASSERT(net_udp_send(&udp, buffer, 1514, dataoffset, 0) == NET_STATUS_OK);
+
+	return VERDICT_OK;
+}
+
+static uint8_t test_udp_send_data()
+{
+	uint16_t dataoffset = 0;
+	uint8_t payload[] = "test";
+	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(src_addr);
+
+	DEBUG(__FUNCTION__);
+
+	TEST_ASSERT(net_mac_set_source_addr(&mac, src_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_destination_addr(&mac, dst_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_IPV6) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ip6mcast(&mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_ip6_set_source_addr(&ip6, src_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_destination_addr(&ip6, dst_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_nexthdr(&ip6, NET_IP6_NH_UDP) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_udp_set_source_port(&udp, 1234) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_set_destination_port(&udp, 5678) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_udp_connect(&udp) == NET_STATUS_OK);
+	dataoffset = net_udp_pload_pos(&udp);
+	memcpy(&(buffer[dataoffset]), payload, 4);
+	TEST_ASSERT(net_udp_send(&udp, buffer, 1514, dataoffset, 4) == NET_STATUS_OK);
+
+	return VERDICT_OK;
+}
+
+static uint8_t test_udp_flows()
+{
+	uint16_t retry = 0;
+	int8_t err = 0;
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(src_addr);
+	uint8_t dst2_addr[16] = {0x20,0x01,0x00,0x01,0x00,0x02,0x00,0x03,
+	                         0x00,0x0a,0x00,0x0b,0x00,0x0c,0x00,0x0e};
+	/* Two peers, the first one of two flows, all through the lower context of the table */
+	struct net_ip6_ctx fl_ip6 = { .lower = &TEST_IP6_LINK };
+	struct net_ip6_ctx fl_ip6_other = { .lower = &TEST_IP6_LINK };
+	struct net_udp_ctx fl_udp = { .lower = &fl_ip6 };
+	struct net_udp_ctx fl_udp_2 = { .lower = &fl_ip6 };
+	struct net_udp_ctx fl_udp_log = { .lower = &fl_ip6 };
+	struct net_udp_ctx fl_udp_other = { .lower = &fl_ip6_other };
+	struct net_udp_flows flows = { .lower = &fl_ip6 };
+	struct net_udp_ctx *flow = NULL;
+	uint8_t *peer_addr = NULL;
+	uint16_t peer_port = 0;
+
+	DEBUG(__FUNCTION__);
+
+	TEST_ASSERT(net_mac_set_source_addr(&mac, src_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_destination_addr(&mac, dst_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_IPV6) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ip6mcast(&mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_ip6_set_source_addr(&fl_ip6, src_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_destination_addr(&fl_ip6, dst_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_nexthdr(&fl_ip6, NET_IP6_NH_UDP) == NET_STATUS_OK);
+
+	/* Same ports for both peers */
+	TEST_ASSERT(net_udp_set_source_port(&fl_udp, 1234) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_set_destination_port(&fl_udp, 5678) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_connect(&fl_udp) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_set_source_port(&fl_udp_2, 1234) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_set_destination_port(&fl_udp_2, 5678) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_set_peer_addr(&fl_udp_2, dst2_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_connect(&fl_udp_2) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_set_source_port(&fl_udp_log, 1235) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_set_destination_port(&fl_udp_log, 514) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_connect(&fl_udp_log) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_udp_flows_add(&flows, &fl_udp) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_flows_add(&flows, &fl_udp_2) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_flows_add(&flows, &fl_udp_log) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_flows_add(&flows, &fl_udp_log) == NET_EINVAL);
+	TEST_ASSERT(net_udp_set_source_port(&fl_udp_other, 1236) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_flows_add(&flows, &fl_udp_other) == NET_EINVAL);
+
+	/* Datagrams returned to their flow, in the order received */
+	TEST_RECV_RETRY(err = net_udp_flows_recv(&flows, buffer, 1514, &dataoffset, &datalen,
+	                                         &flow, &peer_addr, &peer_port));
+	TEST_ASSERT(err == NET_STATUS_OK);
+	TEST_ASSERT(flow == &fl_udp_2);
+	TEST_ASSERT((datalen == 1) && (buffer[dataoffset] == 'b'));
+
+	TEST_RECV_RETRY(err = net_udp_flows_recv(&flows, buffer, 1514, &dataoffset, &datalen,
+	                                         &flow, &peer_addr, &peer_port));
+	TEST_ASSERT(err == NET_STATUS_OK);
+	TEST_ASSERT(flow == &fl_udp_log);
+	TEST_ASSERT((datalen == 1) && (buffer[dataoffset] == 'c'));
+
+	/* After datagrams of no flow, of other ports or of another peer of the same hash */
+	TEST_RECV_RETRY(err = net_udp_flows_recv(&flows, buffer, 1514, &dataoffset, &datalen,
+	                                         &flow, &peer_addr, &peer_port));
+	TEST_ASSERT(err == NET_STATUS_OK);
+	TEST_ASSERT(flow == &fl_udp);
+	TEST_ASSERT((datalen == 1) && (buffer[dataoffset] == 'a'));
+
+	/* Datagrams of a flow deleted are dropped */
+	TEST_ASSERT(net_udp_flows_del(&flows, &fl_udp_2) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_flows_del(&flows, &fl_udp_2) == NET_EINVAL);
+	TEST_RECV_RETRY(err = net_udp_flows_recv(&flows, buffer, 1514, &dataoffset, &datalen,
+	                                         &flow, &peer_addr, &peer_port));
+	TEST_ASSERT(err == NET_STATUS_OK);
+	TEST_ASSERT(flow == &fl_udp);
+	TEST_ASSERT((datalen == 1) && (buffer[dataoffset] == 'z'));
+#ifdef NET_STATS_ENABLE
+	TEST_ASSERT(flows.stats.drops[NET_STATS_DROP_PORT] == 3);
+#endif
+
+	return VERDICT_OK;
+}
+
+#ifdef NET_IP6_NC_ENABLE
+static uint8_t test_udp_flows_resolve()
+{
+	uint16_t retry = 0;
+	int8_t err = 0;
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+	uint8_t payload[] = "test";
+	uint8_t dst2_addr[16] = {0x20,0x01,0x00,0x01,0x00,0x02,0x00,0x03,
+	                         0x00,0x0a,0x00,0x0b,0x00,0x0c,0x00,0x0e};
+	uint8_t dst2_l2addr[6] = {0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF};
+	uint8_t no_l2addr[6] = {0};
+	uint8_t *l2addr;
+	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(src_addr);
+	/* Flow of the second peer, resolved in the neighbor cache of the table */
+	struct net_ip6_ctx fr_ip6 = { .lower = &TEST_IP6_LINK };
+	struct net_udp_ctx fr_udp = { .lower = &fr_ip6 };
+	struct net_udp_flows flows = { .lower = &fr_ip6 };
+	struct net_udp_ctx *flow = NULL;
+	uint8_t *peer_addr = NULL;
+	uint16_t peer_port = 0;
+
+	DEBUG(__FUNCTION__);
+
+	TEST_ASSERT(net_mac_set_source_addr(&mac, src_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_destination_addr(&mac, no_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_IPV6) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ip6mcast(&mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_ip6_set_source_addr(&fr_ip6, src_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_destination_addr(&fr_ip6, dst_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_nexthdr(&fr_ip6, NET_IP6_NH_UDP) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_resolution(&fr_ip6, 1) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_udp_set_source_port(&fr_udp, 1234) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_set_destination_port(&fr_udp, 5678) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_set_peer_addr(&fr_udp, dst2_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_connect(&fr_udp) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_flows_add(&flows, &fr_udp) == NET_STATUS_OK);
+
+	/* Unknown peer: solicited, the datagram is to be sent again */
+	dataoffset = net_udp_pload_pos(&fr_udp);
+	memcpy(&(buffer[dataoffset]), payload, 4);
+	TEST_ASSERT(net_udp_send(&fr_udp, buffer, 1514, dataoffset, 4) == NET_EAGAIN);
+
+	/* Sent once the advertisement is received through the table */
+	for (retry=0; retry<TEST_RECV_TIMEOUT; retry++) {
+		net_udp_flows_recv(&flows, buffer, 1514, &dataoffset, &datalen,
+		                   &flow, &peer_addr, &peer_port);
+		dataoffset = net_udp_pload_pos(&fr_udp);
+		memcpy(&(buffer[dataoffset]), payload, 4);
+		err = net_udp_send(&fr_udp, buffer, 1514, dataoffset, 4);
+		if (err != NET_EAGAIN) {
+			break;
+		}
+		msleep(1);
+	}
+	TEST_ASSERT(err == NET_STATUS_OK);
+	l2addr = net_ip6_get_neighbor(&fr_ip6, dst2_addr);
+	TEST_ASSERT((l2addr != NULL) && (memcmp(l2addr, dst2_l2addr, 6) == 0));
+
+	/* Reply of the peer, confirming it */
+	TEST_RECV_RETRY(err = net_udp_flows_recv(&flows, buffer, 1514, &dataoffset, &datalen,
+	                                         &flow, &peer_addr, &peer_port));
+	TEST_ASSERT(err == NET_STATUS_OK);
+	TEST_ASSERT(flow == &fr_udp);
+	TEST_ASSERT((datalen == 2) && (memcmp(&(buffer[dataoffset]), "ok", 2) == 0));
+	TEST_ASSERT(fr_udp.sent == 0);
+
+	return VERDICT_OK;
+}
+#endif
+
+static uint8_t test_udp_listen()
+{
+	uint16_t retry = 0;
+	int8_t err = 0;
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+	uint8_t i = 0;
+	uint8_t *peer_addr = NULL;
+	uint16_t peer_port = 0;
+	uint16_t peer_ports[] = {5678, 6000, 5679};
+	uint8_t peer_iids[] = {0x0d, 0x0e, 0x0d};
+	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(src_addr);
+	/* No destination, nor destination port */
+	struct net_ip6_ctx ls_ip6 = { .lower = &TEST_IP6_LINK };
+	struct net_udp_ctx ls_udp = { .lower = &ls_ip6 };
+
+	DEBUG(__FUNCTION__);
+
+	TEST_ASSERT(net_mac_set_source_addr(&mac, src_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_destination_addr(&mac, dst_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_IPV6) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ip6mcast(&mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_ip6_set_source_addr(&ls_ip6, src_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_nexthdr(&ls_ip6, NET_IP6_NH_UDP) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_udp_listen(&ls_udp) == NET_ECONFIG);
+	TEST_ASSERT(net_udp_set_source_port(&ls_udp, 1234) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_listen(&ls_udp) == NET_STATUS_OK);
+
+	/* Requests of several peers, each answered in the buffer received */
+	for (i = 0; i < 3; i++) {
+		TEST_RECV_RETRY(err = net_udp_recv_from(&ls_udp, buffer, 1514, &dataoffset, &datalen,
+		                                        &peer_addr, &peer_port));
+		TEST_ASSERT(err == NET_STATUS_OK);
+		TEST_ASSERT((datalen == 4) && (memcmp(&(buffer[dataoffset]), "get", 3) == 0));
+		TEST_ASSERT(buffer[dataoffset + 3] == '1' + i);
+		TEST_ASSERT(peer_port == peer_ports[i]);
+		TEST_ASSERT(memcmp(peer_addr, dst_addr, 15) == 0);
+		TEST_ASSERT(peer_addr[15] == peer_iids[i]);
+
+		dataoffset = net_udp_pload_pos(&ls_udp);
+		memcpy(&(buffer[dataoffset]), "ok", 2);
+		TEST_ASSERT(net_udp_send_to(&ls_udp, buffer, 1514, dataoffset, 2,
+		                            peer_addr, peer_port) == NET_STATUS_OK);
+	}
+
+	return VERDICT_OK;
+}
+
+static uint8_t test_coap_noncf_send_nodata()
+{
+	uint16_t dataoffset = 0;
+	uint8_t token[] = {0x12};
+	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(src_addr);
+
+	DEBUG(__FUNCTION__);
+
+	TEST_ASSERT(net_mac_set_source_addr(&mac, src_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_destination_addr(&mac, dst_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_IPV6) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ip6mcast(&mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_ip6_set_source_addr(&ip6, src_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_destination_addr(&ip6, dst_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_nexthdr(&ip6, NET_IP6_NH_UDP) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_udp_set_source_port(&udp, 1234) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_set_destination_port(&udp, 5683) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_coap_connect(&coap) == NET_STATUS_OK);
+	TEST_ASSERT(net_coap_set_method(&coap, NET_COAP_TYPE_NONCONFIRMABLE, NET_COAP_CODE_POST) == NET_STATUS_OK);
+	TEST_ASSERT(net_coap_set_token(&coap, 1, token) == NET_STATUS_OK);
+	dataoffset = net_coap_pload_pos(&coap);
+	TEST_ASSERT(net_coap_send(&coap, buffer, 1514, dataoffset, 0) == NET_STATUS_OK);
+
+	return VERDICT_OK;
+}
+
+static uint8_t test_coap_noncf_send_data()
+{
+	uint16_t dataoffset = 0;
+	uint8_t token[] = {0x34};
+	static char * const uriquery[] = { "stub=stub" };
+	uint8_t payload[] = "test";
+	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(src_addr);
+
+	DEBUG(__FUNCTION__);
+
+	TEST_ASSERT(net_mac_set_source_addr(&mac, src_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_destination_addr(&mac, dst_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_IPV6) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ip6mcast(&mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_ip6_set_source_addr(&ip6, src_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_destination_addr(&ip6, dst_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_nexthdr(&ip6, NET_IP6_NH_UDP) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_udp_set_source_port(&udp, 1234) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_set_destination_port(&udp, 5683) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_coap_connect(&coap) == NET_STATUS_OK);
+	TEST_ASSERT(net_coap_set_method(&coap, NET_COAP_TYPE_NONCONFIRMABLE, NET_COAP_CODE_POST) == NET_STATUS_OK);
+	TEST_ASSERT(net_coap_set_token(&coap, 1, token) == NET_STATUS_OK);
+	TEST_ASSERT(net_coap_set_uriquery(&coap, 1, uriquery) == NET_STATUS_OK);
+	dataoffset = net_coap_pload_pos(&coap);
+	memcpy(&(buffer[dataoffset]), payload, 4);
+	TEST_ASSERT(net_coap_send(&coap, buffer, 1514, dataoffset, 4) == NET_STATUS_OK);
+
+	return VERDICT_OK;
+}
+
+static uint8_t test_coap_noncf_send_data_resp()
+{
+	uint16_t retry = 0;
+	int8_t err = 0;
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+	uint8_t token[] = {0x56};
+	static char * const uriquery[] = { "stub=stub" };
+	uint8_t payload[] = "test";
+	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(src_addr);
+
+	DEBUG(__FUNCTION__);
+
+	TEST_ASSERT(net_mac_set_source_addr(&mac, src_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_destination_addr(&mac, dst_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_IPV6) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ip6mcast(&mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_ip6_set_source_addr(&ip6, src_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_destination_addr(&ip6, dst_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_nexthdr(&ip6, NET_IP6_NH_UDP) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_udp_set_source_port(&udp, 1234) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_set_destination_port(&udp, 5683) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_coap_connect(&coap) == NET_STATUS_OK);
+	TEST_ASSERT(net_coap_set_method(&coap, NET_COAP_TYPE_NONCONFIRMABLE, NET_COAP_CODE_POST) == NET_STATUS_OK);
+	TEST_ASSERT(net_coap_set_token(&coap, 1, token) == NET_STATUS_OK);
+	TEST_ASSERT(net_coap_set_uriquery(&coap, 1, uriquery) == NET_STATUS_OK);
+
+	dataoffset = net_coap_pload_pos(&coap);
+	memcpy(&(buffer[dataoffset]), payload, 4);
+	TEST_ASSERT(net_coap_send(&coap, buffer, 1514, dataoffset, 4) == NET_STATUS_OK);
+
+	TEST_RECV_RETRY(err = net_coap_recv(&coap, buffer, 1514, &dataoffset, &datalen));
+	TEST_ASSERT(err == NET_STATUS_OK);
+	TEST_ASSERT(net_coap_get_responsecode(&coap) == NET_COAP_CODE_CREATED);
+
+	return VERDICT_OK;
+}
+
+static uint8_t test_coap_cf_send_nodata()
+{
+	uint16_t retry = 0;
+	int8_t err = 0;
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+	uint8_t token[] = {0x78};
+	uint8_t payload[] = "test";
+	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(src_addr);
+
+	DEBUG(__FUNCTION__);
+
+	TEST_ASSERT(net_mac_set_source_addr(&mac, src_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_destination_addr(&mac, dst_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_IPV6) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ip6mcast(&mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_ip6_set_source_addr(&ip6, src_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_destination_addr(&ip6, dst_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_nexthdr(&ip6, NET_IP6_NH_UDP) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_udp_set_source_port(&udp, 1234) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_set_destination_port(&udp, 5683) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_coap_connect(&coap) == NET_STATUS_OK);
+	TEST_ASSERT(net_coap_set_method(&coap, NET_COAP_TYPE_CONFIRMABLE, NET_COAP_CODE_POST) == NET_STATUS_OK);
+	TEST_ASSERT(net_coap_set_token(&coap, 1, token) == NET_STATUS_OK);
+
+	dataoffset = net_coap_pload_pos(&coap);
+	TEST_ASSERT(net_coap_send(&coap, buffer, 1514, dataoffset, 0) == NET_STATUS_OK);
+
+	TEST_RECV_RETRY(err = net_coap_recv(&coap, buffer, 1514, &dataoffset, &datalen));
+	TEST_ASSERT(err == NET_COAP_STATUS_ACK);
+
+	return VERDICT_OK;
+}
+
+static uint8_t test_coap_cf_send_data()
+{
+	uint16_t retry = 0;
+	int8_t err = 0;
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+	uint8_t token[] = {0x9a};
+	static char * const uriquery[] = { "stub=stub" };
+	uint8_t payload[] = "test";
+	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(src_addr);
+
+	DEBUG(__FUNCTION__);
+
+	TEST_ASSERT(net_mac_set_source_addr(&mac, src_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_destination_addr(&mac, dst_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_IPV6) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ip6mcast(&mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes) == NET_STATUS_OK);
 
 	TEST_ASSERT(net_ip6_set_source_addr(&ip6, src_addr) == NET_STATUS_OK);
 	TEST_ASSERT(net_ip6_set_destination_addr(&ip6, dst_addr) == NET_STATUS_OK);
@@ -786,12 +1775,12 @@ static uint8_t test_coap_cf_send_data()
 
 static uint8_t test_coap_cf_send_data_ackresp()
 {
-	int8_t retry = 0;
+	uint16_t retry = 0;
 	int8_t err = 0;
 	uint16_t dataoffset = 0;
 	uint16_t datalen = 0;
 	uint8_t token[] = {0xbc};
-	char * const uriquery[] = { "stub=stub" };
+	static char * const uriquery[] = { "stub=stub" };
 	uint8_t payload[] = "test";
 	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(src_addr);
 
@@ -830,12 +1819,12 @@ static uint8_t test_coap_cf_send_data_ackresp()
 
 static uint8_t test_coap_cf_send_data_piggybacked()
 {
-	int8_t retry = 0;
+	uint16_t retry = 0;
 	int8_t err = 0;
 	uint16_t dataoffset = 0;
 	uint16_t datalen = 0;
 	uint8_t token[] = {0xde};
-	char * const uriquery[] = { "stub=stub" };
+	static char * const uriquery[] = { "stub=stub" };
 	uint8_t payload[] = "test";
 	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(src_addr);
 
@@ -869,6 +1858,374 @@ static uint8_t test_coap_cf_send_data_piggybacked()
 	return VERDICT_OK;
 }
 
+static uint8_t test_memstats_report()
+{
+	DEBUG(__FUNCTION__);
+
+	net_memstats_print("static.buffer", sizeof(buffer));
+	net_memstats_report();
+
+	return VERDICT_OK;
+}
+
+static uint8_t test_stats_drops()
+{
+	uint16_t retry = 0;
+	int8_t err = 0;
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(src_addr);
+#ifdef NET_STATS_ENABLE
+	struct net_stats stats;
+#endif
+
+	DEBUG(__FUNCTION__);
+
+	TEST_ASSERT(net_mac_set_source_addr(&mac, src_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_destination_addr(&mac, dst_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_IPV6) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ip6mcast(&mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_ip6_set_source_addr(&ip6, src_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_destination_addr(&ip6, dst_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_nexthdr(&ip6, NET_IP6_NH_UDP) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_udp_set_source_port(&udp, 1234) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_set_destination_port(&udp, 5678) == NET_STATUS_OK);
+
+#ifdef NET_STATS_ENABLE
+	net_stats_snapshot(&mac.stats, &stats, true);
+	net_stats_snapshot(&ip6.stats, &stats, true);
+	net_stats_snapshot(&udp.stats, &stats, true);
+#endif
+
+	/* The peer sends a bad ethertype, a bad next header and a bad port first */
+	TEST_ASSERT(net_udp_connect(&udp) == NET_STATUS_OK);
+	TEST_RECV_RETRY(err = net_udp_recv(&udp, buffer, 1514, &dataoffset, &datalen));
+	TEST_ASSERT(err == NET_STATUS_OK);
+	TEST_ASSERT(datalen == 4);
+
+#ifdef NET_STATS_ENABLE
+	net_stats_snapshot(&mac.stats, &stats, false);
+	net_stats_dump("mac", &stats);
+	TEST_ASSERT(stats.rx_frames == 3);
+	TEST_ASSERT(stats.drops[NET_STATS_DROP_TYPE] == 1);
+
+	net_stats_snapshot(&ip6.stats, &stats, false);
+	net_stats_dump("ip6", &stats);
+	TEST_ASSERT(stats.rx_frames == 2);
+	TEST_ASSERT(stats.rx_bytes == 2 * (40 + 12));
+	TEST_ASSERT(stats.drops[NET_STATS_DROP_TYPE] == 1);
+
+	net_stats_snapshot(&udp.stats, &stats, false);
+	net_stats_dump("udp", &stats);
+	TEST_ASSERT(stats.rx_frames == 1);
+	TEST_ASSERT(stats.drops[NET_STATS_DROP_PORT] == 1);
+#endif
+
+	return VERDICT_OK;
+}
+
+static uint8_t test_trace_dump()
+{
+	uint16_t dataoffset = 0;
+	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(src_addr);
+#ifdef NET_TRACE_ENABLE
+	const uint8_t expected[] = {
+		NET_TRACE_UDP_SEND, NET_TRACE_IP6_SEND, NET_TRACE_MAC_SEND,
+		NET_TRACE_MAC_SEND | NET_TRACE_EXIT,
+		NET_TRACE_IP6_SEND | NET_TRACE_EXIT,
+		NET_TRACE_UDP_SEND | NET_TRACE_EXIT,
+	};
+	struct net_trace_record records[NET_TRACE_RING_SIZE];
+	uint16_t cnt = 0;
+	uint16_t i = 0;
+	uint8_t n = 0;
+#endif
+
+	DEBUG(__FUNCTION__);
+
+	TEST_ASSERT(net_mac_set_source_addr(&mac, src_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_destination_addr(&mac, dst_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_IPV6) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ip6mcast(&mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_ip6_set_source_addr(&ip6, src_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_destination_addr(&ip6, dst_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_nexthdr(&ip6, NET_IP6_NH_UDP) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_udp_set_source_port(&udp, 1234) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_set_destination_port(&udp, 5678) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_udp_connect(&udp) == NET_STATUS_OK);
+	net_trace_reset();
+	dataoffset = net_udp_pload_pos(&udp);
+	TEST_ASSERT(net_udp_send(&udp, buffer, 1514, dataoffset, 0) == NET_STATUS_OK);
+
+#ifdef NET_TRACE_ENABLE
+	/* Layers are nested, the link and SPI events depend on the link */
+	cnt = net_trace_read(records, NET_TRACE_RING_SIZE);
+	for (i=0; i<cnt; i++) {
+		if (records[i].event < NET_TRACE_MAC_RECV) {
+			continue;
+		}
+		TEST_ASSERT(n < sizeof(expected));
+		TEST_ASSERT(records[i].event == expected[n]);
+		n++;
+	}
+	TEST_ASSERT(n == sizeof(expected));
+	TEST_ASSERT(records[cnt-1].len == 8);
+	TEST_ASSERT(net_trace_lost() == 0);
+#endif
+
+	/* A second datagram, whose trace is dumped over serial */
+	dataoffset = net_udp_pload_pos(&udp);
+	TEST_ASSERT(net_udp_send(&udp, buffer, 1514, dataoffset, 0) == NET_STATUS_OK);
+	net_trace_dump();
+
+	return VERDICT_OK;
+}
+
+#ifdef NET_TAP_ENABLE
+#define TEST_TAP_RECORDS 4
+
+static struct net_tap_record tap_records[TEST_TAP_RECORDS];
+static uint8_t tap_cnt;
+
+static void test_tap_writer(void *priv, const struct net_tap_record *record,
+                            const uint8_t *data)
+{
+	if (tap_cnt < TEST_TAP_RECORDS) {
+		tap_records[tap_cnt] = *record;
+	}
+	tap_cnt++;
+}
+#endif
+
+static uint8_t test_tap_capture()
+{
+	uint16_t retry = 0;
+	int8_t err = 0;
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(src_addr);
+
+	DEBUG(__FUNCTION__);
+
+	TEST_ASSERT(net_mac_set_source_addr(&mac, src_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_destination_addr(&mac, dst_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_LB) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ip6mcast(&mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes) == NET_STATUS_OK);
+
+#ifdef NET_TAP_ENABLE
+	tap_cnt = 0;
+	net_tap_open(test_tap_writer, NULL, 16, 0);
+#endif
+
+	/* The peer sends a bad ethertype first, then a frame with data */
+	TEST_RECV_RETRY(err = net_mac_recv(&mac, buffer, 1514, &dataoffset, &datalen));
+	TEST_ASSERT(err == NET_STATUS_OK);
+	TEST_ASSERT(datalen == 4);
+
+	dataoffset = net_mac_pload_pos(&mac);
+	memcpy(&buffer[dataoffset], "test", 4);
+	TEST_ASSERT(net_mac_send(&mac, buffer, 1514, dataoffset, 4) == NET_STATUS_OK);
+
+#ifdef NET_TAP_ENABLE
+	net_tap_close();
+
+	TEST_ASSERT(tap_cnt == 3);
+	TEST_ASSERT(tap_records[0].flags == (NET_TAP_DIR_IN | NET_STATS_DROP_TYPE));
+	TEST_ASSERT(tap_records[1].flags == (NET_TAP_DIR_IN | NET_TAP_REASON_NONE));
+	TEST_ASSERT(tap_records[2].flags == (NET_TAP_DIR_OUT | NET_TAP_REASON_NONE));
+	TEST_ASSERT(tap_records[1].len == 18);
+	TEST_ASSERT(tap_records[1].caplen == 16);
+	TEST_ASSERT(tap_records[2].len == 18);
+	TEST_ASSERT((int32_t) (tap_records[2].time_us - tap_records[0].time_us) >= 0);
+	TEST_ASSERT(tap_records[0].skipped == 0);
+#endif
+
+	return VERDICT_OK;
+}
+
+/* The load ends with an empty datagram, or after TEST_LOAD_IDLE empty polls */
+#define TEST_LOAD_IDLE 30000
+
+/**
+ * Answer of the load target, built in place: CoAP requests get an empty
+ * acknowledgement (confirmable) or a 2.04 Changed response with the same
+ * token (non-confirmable), other datagrams are echoed. Returns its length.
+ */
+static uint16_t test_load_answer(uint8_t *data, uint16_t datalen, uint16_t *messageid)
+{
+	uint8_t type = (data[0] >> 4) & 0x03;
+	uint8_t tokenlen = data[0] & 0x0F;
+
+	if ((datalen < 4) || ((data[0] >> 6) != NET_COAP_VERSION) ||
+	    (data[1] == NET_COAP_CODE_EMPTY) || ((data[1] >> 5) != 0) ||
+	    (tokenlen > 8) || (datalen < 4 + tokenlen)) {
+		return datalen;
+	}
+
+	if (type == NET_COAP_TYPE_CONFIRMABLE) {
+		data[0] = (NET_COAP_VERSION << 6) | (NET_COAP_TYPE_ACKNOWLEDGE << 4);
+		data[1] = NET_COAP_CODE_EMPTY;
+		return 4;
+	} else if (type == NET_COAP_TYPE_NONCONFIRMABLE) {
+		data[1] = NET_COAP_CODE_CHANGED;
+		data[2] = (*messageid & 0xFF00) >> 8;
+		data[3] = *messageid & 0x00FF;
+		(*messageid)++;
+		return 4 + tokenlen;
+	}
+
+	return datalen;
+}
+
+static uint8_t test_load_serve()
+{
+	uint16_t idle = 0;
+	int8_t err = 0;
+	uint16_t dataoffset = 0;
+	uint16_t datalen = 0;
+	uint16_t messageid = 0;
+	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(src_addr);
+
+	DEBUG(__FUNCTION__);
+
+	TEST_ASSERT(net_mac_set_source_addr(&mac, src_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_destination_addr(&mac, dst_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_IPV6) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ip6mcast(&mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_ip6_set_source_addr(&ip6, src_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_destination_addr(&ip6, dst_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_nexthdr(&ip6, NET_IP6_NH_UDP) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_udp_set_source_port(&udp, 1234) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_set_destination_port(&udp, 5678) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_udp_connect(&udp) == NET_STATUS_OK);
+	while (idle < TEST_LOAD_IDLE) {
+		err = net_udp_recv(&udp, buffer, 1514, &dataoffset, &datalen);
+		if (err != NET_STATUS_OK) {
+			/* NS recorded by the IPv6 layer are answered when idle */
+			net_ip6_service(&ip6, buffer, 1514);
+			idle++;
+			msleep(1);
+			continue;
+		}
+		idle = 0;
+
+		if (datalen == 0) {
+			return VERDICT_OK;
+		}
+		datalen = test_load_answer(&(buffer[dataoffset]), datalen, &messageid);
+		memmove(&(buffer[net_udp_pload_pos(&udp)]), &(buffer[dataoffset]), datalen);
+		net_udp_send(&udp, buffer, 1514, net_udp_pload_pos(&udp), datalen);
+	}
+
+	return VERDICT_NOK;
+}
+
+
+/* Datagrams and messages delivered to each endpoint of test_poll_dispatch */
+static uint8_t poll_coap_cnt = 0;
+static uint8_t poll_listen_cnt = 0;
+static uint8_t poll_log_cnt = 0;
+
+static void test_poll_coap_cback(struct net_coap_ctx *coap, int8_t status, uint8_t *buffer,
+                                 uint16_t buflen, uint16_t dataoffset, uint16_t datalen)
+{
+	if ((status == NET_STATUS_OK) &&
+	    (net_coap_get_responsecode(coap) == NET_COAP_CODE_CREATED)) {
+		poll_coap_cnt++;
+	}
+}
+
+/* Requests answered from the callback, in the buffer received */
+static void test_poll_listen_cback(struct net_udp_ctx *udp, uint8_t *buffer, uint16_t buflen,
+                                   uint16_t dataoffset, uint16_t datalen,
+                                   uint8_t *peer_addr, uint16_t peer_port)
+{
+	if ((datalen != 4) || (memcmp(&(buffer[dataoffset]), "ping", 4) != 0)) {
+		return;
+	}
+	poll_listen_cnt++;
+
+	dataoffset = net_udp_pload_pos(udp);
+	memcpy(&(buffer[dataoffset]), "ok", 2);
+	net_udp_send_to(udp, buffer, buflen, dataoffset, 2, peer_addr, peer_port);
+}
+
+static void test_poll_log_cback(struct net_udp_ctx *udp, uint8_t *buffer, uint16_t buflen,
+                                uint16_t dataoffset, uint16_t datalen,
+                                uint8_t *peer_addr, uint16_t peer_port)
+{
+	if ((datalen == 2) && (buffer[dataoffset] == 'l') &&
+	    (buffer[dataoffset + 1] == '1' + poll_log_cnt)) {
+		poll_log_cnt++;
+	}
+}
+
+static uint8_t test_poll_dispatch()
+{
+	uint16_t retry = 0;
+	int8_t err = 0;
+	uint8_t token[] = {0x56};
+	net_mac_mcsuffix_t mcsuffixes[] = NET_IP6_L2_MCSUFFIXES(src_addr);
+	/* Three endpoints of the same peer, through the lower context of the table */
+	struct net_ip6_ctx pl_ip6 = { .lower = &TEST_IP6_LINK };
+	struct net_udp_ctx pl_udp_coap = { .lower = &pl_ip6 };
+	struct net_coap_ctx pl_coap = { .lower = &pl_udp_coap };
+	struct net_udp_ctx pl_udp_listen = { .lower = &pl_ip6 };
+	struct net_udp_ctx pl_udp_log = { .lower = &pl_ip6 };
+	struct net_udp_flows flows = { .lower = &pl_ip6 };
+	struct net_poll_ctx poll = { .lower = &flows };
+
+	DEBUG(__FUNCTION__);
+
+	poll_coap_cnt = 0;
+	poll_listen_cnt = 0;
+	poll_log_cnt = 0;
+
+	TEST_ASSERT(net_mac_set_source_addr(&mac, src_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_destination_addr(&mac, dst_l2addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ethertype(&mac, NET_MAC_ETHERTYPE_IPV6) == NET_STATUS_OK);
+	TEST_ASSERT(net_mac_set_ip6mcast(&mac, NET_IP6_L2_MCSUFFIX_CNT, mcsuffixes) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_ip6_set_source_addr(&pl_ip6, src_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_destination_addr(&pl_ip6, dst_addr) == NET_STATUS_OK);
+	TEST_ASSERT(net_ip6_set_nexthdr(&pl_ip6, NET_IP6_NH_UDP) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_udp_set_source_port(&pl_udp_coap, 1234) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_set_destination_port(&pl_udp_coap, 5683) == NET_STATUS_OK);
+	TEST_ASSERT(net_coap_connect(&pl_coap) == NET_STATUS_OK);
+	TEST_ASSERT(net_coap_set_token(&pl_coap, 1, token) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_set_source_port(&pl_udp_listen, 5684) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_listen(&pl_udp_listen) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_set_source_port(&pl_udp_log, 1235) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_set_destination_port(&pl_udp_log, 514) == NET_STATUS_OK);
+	TEST_ASSERT(net_udp_connect(&pl_udp_log) == NET_STATUS_OK);
+
+	TEST_ASSERT(net_poll_add_coap(&poll, &pl_coap, test_poll_coap_cback) == NET_STATUS_OK);
+	TEST_ASSERT(net_poll_add_udp(&poll, &pl_udp_listen, test_poll_listen_cback) == NET_STATUS_OK);
+	TEST_ASSERT(net_poll_add_udp(&poll, &pl_udp_log, test_poll_log_cback) == NET_STATUS_OK);
+	TEST_ASSERT(net_poll_add_udp(&poll, &pl_udp_log, test_poll_log_cback) == NET_EINVAL);
+
+	/* Each datagram delivered once, the frames of no endpoint taking a slot of the budget */
+	TEST_RECV_RETRY(err = net_poll(&poll, buffer, 1514));
+	TEST_ASSERT(err == NET_POLL_BUDGET);
+	TEST_ASSERT(net_poll(&poll, buffer, 1514) == 2);
+	TEST_ASSERT(net_poll(&poll, buffer, 1514) == NET_EAGAIN);
+	TEST_ASSERT((poll_coap_cnt == 1) && (poll_listen_cnt == 1) && (poll_log_cnt == 4));
+#ifdef NET_STATS_ENABLE
+	TEST_ASSERT(flows.stats.drops[NET_STATS_DROP_PORT] == 1);
+#endif
+
+	return VERDICT_OK;
+}
+
 uint8_t tests_exec(uint8_t test_id)
 {
 	switch(test_id) {
@@ -894,6 +2251,38 @@ uint8_t tests_exec(uint8_t test_id)
 	case 0x33: return test_ip6_icmpv6_nsna_recv_mcsn();
 	case 0x34: return test_ip6_icmpv6_nsna_recv_dad();
 	case 0x35: return test_ip6_icmpv6_nsna_recv_badtgt();
+#ifdef NET_IP6_NC_ENABLE
+	case 0x36: return test_ip6_icmpv6_nc_resolve();
+#endif
+#if defined(NET_IP6_NC_ENABLE) && defined(NET_IP6_AUTOCONF_ENABLE)
+	case 0x37: return test_ip6_icmpv6_ra_slaac();
+#endif
+#ifdef NET_IP6_DAD_ENABLE
+	case 0x38: return test_ip6_icmpv6_dad();
+#endif
+#ifdef NET_IP6_NC_ENABLE
+	case 0x39: return test_ip6_icmpv6_nud();
+#endif
+	case 0x3A: return test_ip6_icmpv6_echo();
+#ifdef NET_IP6_RATELIMIT_ENABLE
+	case 0x3B: return test_ip6_icmpv6_ratelimit();
+#endif
+#ifdef NET_IP6_AUTOCONF_ENABLE
+	case 0x3C: return test_ip6_icmpv6_ra_udp();
+#endif
+
+	case 0x41: return test_lowpan_send_udp();
+	case 0x42: return test_lowpan_send_inline();
+	case 0x43: return test_lowpan_send_mcast();
+	case 0x44: return test_lowpan_recv_udp();
+	case 0x45: return test_lowpan_recv_inline();
+	case 0x46: return test_lowpan_recv_bad();
+#ifdef NET_LOWPAN_ENABLE
+	case 0x47: return test_lowpan_udp();
+	case 0x48: return test_lowpan_echo();
+#endif
+	case 0x49: return test_lowpan_modes();
+	case 0x4A: return test_lowpan_recv_unsupp();
 
 	case 0x51: return test_udp_recv_nodata();
 	case 0x52: return test_udp_recv_data();
@@ -902,6 +2291,11 @@ uint8_t tests_exec(uint8_t test_id)
 	case 0x55: return test_udp_recv_badlen();
 	case 0x56: return test_udp_send_nodata();
 	case 0x57: return test_udp_send_data();
+	case 0x58: return test_udp_flows();
+	case 0x59: return test_udp_listen();
+#ifdef NET_IP6_NC_ENABLE
+	case 0x5A: return test_udp_flows_resolve();
+#endif
 
 	case 0x61: return test_coap_noncf_send_nodata();
 	case 0x62: return test_coap_noncf_send_data();
@@ -910,6 +2304,13 @@ uint8_t tests_exec(uint8_t test_id)
 	case 0x65: return test_coap_cf_send_data();
 	case 0x66: return test_coap_cf_send_data_ackresp();
 	case 0x67: return test_coap_cf_send_data_piggybacked();
+
+	case 0x71: return test_memstats_report();
+	case 0x72: return test_stats_drops();
+	case 0x73: return test_trace_dump();
+	case 0x74: return test_tap_capture();
+	case 0x75: return test_load_serve();
+	case 0x76: return test_poll_dispatch();
 	}
 
 	return 0x01;